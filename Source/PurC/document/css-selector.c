@@ -0,0 +1,1480 @@
+/**
+ * @file css-selector.c
+ * @date 2026/10/19
+ * @brief The implementation of the compiled CSS selectors.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A selector list is compiled into complex selectors, and every complex
+ * selector into the compound selectors in right-to-left order: the first
+ * compound selector matches the subject element, and the combinator of
+ * a compound selector tells how to reach the element matched by the next
+ * one.
+ *
+ * When selecting elements from a subtree, a counting Bloom filter holds
+ * the tag names, identifiers and classes of the ancestors of the current
+ * element. A complex selector records the hashes of the features which
+ * must be present on the ancestors, so most elements are rejected without
+ * walking up the tree.
+ */
+
+#include "config.h"
+
+#include "purc-errors.h"
+#include "private/instance.h"
+#include "private/css-selector.h"
+#include "private/document.h"
+#include "private/debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum simple_type {
+    /* in the order of evaluation: the cheapest and most selective first */
+    SIMPLE_ID = 0,
+    SIMPLE_TYPE,
+    SIMPLE_CLASS,
+    SIMPLE_ATTR,
+    SIMPLE_ROOT,
+    SIMPLE_EMPTY,
+    SIMPLE_NTH_CHILD,
+    SIMPLE_NTH_LAST_CHILD,
+    SIMPLE_NTH_OF_TYPE,
+    SIMPLE_NTH_LAST_OF_TYPE,
+    SIMPLE_NOT,
+};
+
+enum attr_op {
+    ATTR_EXISTS = 0,
+    ATTR_EQUALS,        /* = */
+    ATTR_INCLUDES,      /* ~= */
+    ATTR_DASH_MATCH,    /* |= */
+    ATTR_PREFIX,        /* ^= */
+    ATTR_SUFFIX,        /* $= */
+    ATTR_SUBSTRING,     /* *= */
+};
+
+enum combinator {
+    COMB_NONE = 0,
+    COMB_DESCENDANT,
+    COMB_CHILD,
+    COMB_ADJACENT,
+    COMB_SIBLING,
+};
+
+struct compound_selector;
+
+struct simple_selector {
+    enum simple_type    type;
+    enum attr_op        attr_op;
+    /* compare the attribute value case-insensitively */
+    bool                ci;
+
+    /* the tag name, identifier, class, or attribute name */
+    char               *name;
+    size_t              name_len;
+    /* the attribute value */
+    char               *value;
+    size_t              value_len;
+
+    /* for `:nth-*()`: matches the positions a*n+b for n >= 0 */
+    int                 a, b;
+
+    /* for `:not()` */
+    struct compound_selector *negation;
+};
+
+struct compound_selector {
+    struct simple_selector *simples;
+    size_t                  nr_simples;
+
+    /* how to reach the element matched by the next compound selector */
+    enum combinator         combinator;
+};
+
+/* the maximal number of the ancestor features recorded for a selector */
+#define MAX_ANCESTOR_HASHES     4
+
+struct complex_selector {
+    /* the compound selectors from right to left */
+    struct compound_selector   *compounds;
+    size_t                      nr_compounds;
+
+    uint32_t                    ancestor_hashes[MAX_ANCESTOR_HASHES];
+    size_t                      nr_ancestor_hashes;
+};
+
+struct pcdoc_selector {
+    unsigned                    refc;
+    /* some complex selectors have the ancestor features */
+    bool                        use_filter;
+
+    struct complex_selector    *complexes;
+    size_t                      nr_complexes;
+};
+
+static void
+compound_release(struct compound_selector *compound)
+{
+    for (size_t i = 0; i < compound->nr_simples; i++) {
+        struct simple_selector *simple = compound->simples + i;
+        free(simple->name);
+        free(simple->value);
+        if (simple->negation) {
+            compound_release(simple->negation);
+            free(simple->negation);
+        }
+    }
+    free(compound->simples);
+}
+
+void
+pcdoc_selector_delete(struct pcdoc_selector *sel)
+{
+    for (size_t i = 0; i < sel->nr_complexes; i++) {
+        struct complex_selector *complex = sel->complexes + i;
+        for (size_t j = 0; j < complex->nr_compounds; j++)
+            compound_release(complex->compounds + j);
+        free(complex->compounds);
+    }
+
+    free(sel->complexes);
+    free(sel);
+}
+
+/* the hashes of the features; the type is mixed to tell them apart */
+enum feature_type {
+    FEATURE_TAG = 1,
+    FEATURE_ID,
+    FEATURE_CLASS,
+};
+
+static uint32_t
+feature_hash(enum feature_type type, const char *str, size_t len)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261U ^ (uint32_t)type;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+struct parser {
+    const char *p;
+    /* set on an unsupported construction */
+    bool        unsupported;
+};
+
+static inline bool
+is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
+
+static inline bool
+skip_ws(struct parser *ps)
+{
+    const char *start = ps->p;
+    while (is_ws(*ps->p))
+        ps->p++;
+    return ps->p > start;
+}
+
+static inline bool
+is_hex_digit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+        (c >= 'A' && c <= 'F');
+}
+
+static inline bool
+is_name_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+        (unsigned char)c >= 0x80 || c == '\\';
+}
+
+static inline bool
+is_name_char(char c)
+{
+    return is_name_start(c) || (c >= '0' && c <= '9') || c == '-';
+}
+
+struct strbuf {
+    char   *buf;
+    size_t  len;
+    size_t  sz;
+};
+
+static bool
+strbuf_append(struct strbuf *sb, const char *str, size_t len)
+{
+    if (sb->len + len + 1 > sb->sz) {
+        size_t sz = sb->sz ? sb->sz * 2 : 32;
+        while (sz < sb->len + len + 1)
+            sz *= 2;
+
+        char *buf = realloc(sb->buf, sz);
+        if (buf == NULL)
+            return false;
+        sb->buf = buf;
+        sb->sz = sz;
+    }
+
+    memcpy(sb->buf + sb->len, str, len);
+    sb->len += len;
+    sb->buf[sb->len] = '\0';
+    return true;
+}
+
+/* append the character of an escape sequence, following the backslash */
+static bool
+append_escape(struct parser *ps, struct strbuf *sb)
+{
+    if (*ps->p == '\0')
+        return false;
+
+    if (!is_hex_digit(*ps->p)) {
+        return strbuf_append(sb, ps->p++, 1);
+    }
+
+    uint32_t uc = 0;
+    for (int i = 0; i < 6 && is_hex_digit(*ps->p); i++, ps->p++) {
+        char c = *ps->p;
+        uc = uc * 16 + ((c <= '9') ? (c - '0') : ((c | 0x20) - 'a' + 10));
+    }
+    /* a white space after a hexadecimal escape is consumed */
+    if (is_ws(*ps->p))
+        ps->p++;
+
+    if (uc == 0 || uc > 0x10FFFF || (uc >= 0xD800 && uc <= 0xDFFF))
+        uc = 0xFFFD;
+
+    char utf8[4];
+    size_t len;
+    if (uc < 0x80) {
+        utf8[0] = (char)uc;
+        len = 1;
+    }
+    else if (uc < 0x800) {
+        utf8[0] = (char)(0xC0 | (uc >> 6));
+        utf8[1] = (char)(0x80 | (uc & 0x3F));
+        len = 2;
+    }
+    else if (uc < 0x10000) {
+        utf8[0] = (char)(0xE0 | (uc >> 12));
+        utf8[1] = (char)(0x80 | ((uc >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (uc & 0x3F));
+        len = 3;
+    }
+    else {
+        utf8[0] = (char)(0xF0 | (uc >> 18));
+        utf8[1] = (char)(0x80 | ((uc >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((uc >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (uc & 0x3F));
+        len = 4;
+    }
+
+    return strbuf_append(sb, utf8, len);
+}
+
+static char *
+parse_ident(struct parser *ps, size_t *len, bool lowercase)
+{
+    struct strbuf sb = { NULL, 0, 0 };
+
+    bool dash = (*ps->p == '-');
+    if (!is_name_start(ps->p[dash ? 1 : 0]))
+        return NULL;
+    if (dash) {
+        if (!strbuf_append(&sb, "-", 1))
+            return NULL;
+        ps->p++;
+    }
+
+    while (is_name_char(*ps->p)) {
+        bool ok;
+        if (*ps->p == '\\') {
+            ps->p++;
+            ok = append_escape(ps, &sb);
+        }
+        else {
+            char c = *ps->p++;
+            if (lowercase && c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+            ok = strbuf_append(&sb, &c, 1);
+        }
+
+        if (!ok) {
+            free(sb.buf);
+            return NULL;
+        }
+    }
+
+    *len = sb.len;
+    return sb.buf;
+}
+
+static char *
+parse_string(struct parser *ps, size_t *len)
+{
+    struct strbuf sb = { NULL, 0, 0 };
+    char quote = *ps->p++;
+
+    if (!strbuf_append(&sb, "", 0))
+        return NULL;
+
+    while (*ps->p != quote) {
+        bool ok;
+        if (*ps->p == '\0' || *ps->p == '\n') {
+            ok = false;
+        }
+        else if (*ps->p == '\\') {
+            ps->p++;
+            if (*ps->p == '\n') {
+                ps->p++;
+                ok = true;
+            }
+            else {
+                ok = append_escape(ps, &sb);
+            }
+        }
+        else {
+            ok = strbuf_append(&sb, ps->p++, 1);
+        }
+
+        if (!ok) {
+            free(sb.buf);
+            return NULL;
+        }
+    }
+
+    ps->p++;
+    *len = sb.len;
+    return sb.buf;
+}
+
+static bool
+parse_integer(struct parser *ps, int *value)
+{
+    if (*ps->p < '0' || *ps->p > '9')
+        return false;
+
+    long v = 0;
+    while (*ps->p >= '0' && *ps->p <= '9') {
+        if (v < 100000000)
+            v = v * 10 + (*ps->p - '0');
+        ps->p++;
+    }
+
+    *value = (int)v;
+    return true;
+}
+
+/* parse the argument of `:nth-*()`: odd, even, or An+B */
+static bool
+parse_nth(struct parser *ps, int *a, int *b)
+{
+    skip_ws(ps);
+
+    if (pcutils_strncasecmp(ps->p, "odd", 3) == 0 && !is_name_char(ps->p[3])) {
+        ps->p += 3;
+        *a = 2;
+        *b = 1;
+    }
+    else if (pcutils_strncasecmp(ps->p, "even", 4) == 0 &&
+            !is_name_char(ps->p[4])) {
+        ps->p += 4;
+        *a = 2;
+        *b = 0;
+    }
+    else {
+        int sign = 1, v;
+        if (*ps->p == '+' || *ps->p == '-') {
+            sign = (*ps->p == '-') ? -1 : 1;
+            ps->p++;
+        }
+
+        bool has_digits = parse_integer(ps, &v);
+        if (*ps->p == 'n' || *ps->p == 'N') {
+            ps->p++;
+            *a = sign * (has_digits ? v : 1);
+            *b = 0;
+
+            skip_ws(ps);
+            if (*ps->p == '+' || *ps->p == '-') {
+                sign = (*ps->p == '-') ? -1 : 1;
+                ps->p++;
+                skip_ws(ps);
+                if (!parse_integer(ps, &v))
+                    return false;
+                *b = sign * v;
+            }
+        }
+        else if (has_digits) {
+            *a = 0;
+            *b = sign * v;
+        }
+        else {
+            return false;
+        }
+    }
+
+    skip_ws(ps);
+    if (*ps->p != ')')
+        return false;
+    ps->p++;
+    return true;
+}
+
+static struct simple_selector *
+compound_add_simple(struct compound_selector *compound, enum simple_type type)
+{
+    struct simple_selector *simples = realloc(compound->simples,
+            sizeof(*simples) * (compound->nr_simples + 1));
+    if (simples == NULL)
+        return NULL;
+
+    compound->simples = simples;
+    struct simple_selector *simple = simples + compound->nr_simples++;
+    memset(simple, 0, sizeof(*simple));
+    simple->type = type;
+    return simple;
+}
+
+static bool
+parse_compound(struct parser *ps, struct compound_selector *compound,
+        bool negated);
+
+static bool
+parse_attribute(struct parser *ps, struct simple_selector *simple)
+{
+    skip_ws(ps);
+    /* attribute names are case-insensitive in HTML documents */
+    simple->name = parse_ident(ps, &simple->name_len, true);
+    if (simple->name == NULL)
+        return false;
+    skip_ws(ps);
+
+    if (*ps->p == ']') {
+        ps->p++;
+        simple->attr_op = ATTR_EXISTS;
+        return true;
+    }
+
+    switch (*ps->p) {
+    case '=':
+        simple->attr_op = ATTR_EQUALS;
+        break;
+    case '~':
+        simple->attr_op = ATTR_INCLUDES;
+        break;
+    case '|':
+        simple->attr_op = ATTR_DASH_MATCH;
+        break;
+    case '^':
+        simple->attr_op = ATTR_PREFIX;
+        break;
+    case '$':
+        simple->attr_op = ATTR_SUFFIX;
+        break;
+    case '*':
+        simple->attr_op = ATTR_SUBSTRING;
+        break;
+    default:
+        return false;
+    }
+
+    if (simple->attr_op != ATTR_EQUALS) {
+        if (ps->p[1] != '=')
+            return false;
+        ps->p++;
+    }
+    ps->p++;
+    skip_ws(ps);
+
+    if (*ps->p == '"' || *ps->p == '\'')
+        simple->value = parse_string(ps, &simple->value_len);
+    else
+        simple->value = parse_ident(ps, &simple->value_len, false);
+    if (simple->value == NULL)
+        return false;
+    skip_ws(ps);
+
+    if (*ps->p == 'i' || *ps->p == 'I' || *ps->p == 's' || *ps->p == 'S') {
+        simple->ci = (*ps->p == 'i' || *ps->p == 'I');
+        ps->p++;
+        skip_ws(ps);
+    }
+
+    if (*ps->p != ']')
+        return false;
+    ps->p++;
+    return true;
+}
+
+static const struct pseudo_class {
+    const char         *name;
+    enum simple_type    type;
+    int                 a, b;
+} pseudo_classes[] = {
+    { "root",           SIMPLE_ROOT,                0, 0 },
+    { "empty",          SIMPLE_EMPTY,               0, 0 },
+    { "first-child",    SIMPLE_NTH_CHILD,           0, 1 },
+    { "last-child",     SIMPLE_NTH_LAST_CHILD,      0, 1 },
+    { "first-of-type",  SIMPLE_NTH_OF_TYPE,         0, 1 },
+    { "last-of-type",   SIMPLE_NTH_LAST_OF_TYPE,    0, 1 },
+};
+
+static const struct pseudo_class functional_pseudo_classes[] = {
+    { "nth-child",          SIMPLE_NTH_CHILD,           0, 0 },
+    { "nth-last-child",     SIMPLE_NTH_LAST_CHILD,      0, 0 },
+    { "nth-of-type",        SIMPLE_NTH_OF_TYPE,         0, 0 },
+    { "nth-last-of-type",   SIMPLE_NTH_LAST_OF_TYPE,    0, 0 },
+};
+
+static bool
+parse_pseudo_class(struct parser *ps, struct compound_selector *compound,
+        bool negated)
+{
+    size_t len;
+    char *name = parse_ident(ps, &len, true);
+    if (name == NULL)
+        return false;
+
+    bool ok = false;
+    struct simple_selector *simple;
+    if (*ps->p == '(') {
+        ps->p++;
+
+        if (strcmp(name, "not") == 0) {
+            if (negated) {
+                /* no nested negation */
+                ps->unsupported = true;
+                goto done;
+            }
+
+            if ((simple = compound_add_simple(compound, SIMPLE_NOT)) == NULL ||
+                    (simple->negation = calloc(1,
+                        sizeof(*simple->negation))) == NULL)
+                goto done;
+
+            skip_ws(ps);
+            if (!parse_compound(ps, simple->negation, true))
+                goto done;
+            skip_ws(ps);
+            if (*ps->p != ')')
+                goto done;
+            ps->p++;
+            ok = true;
+            goto done;
+        }
+
+        for (size_t i = 0; i < PCA_TABLESIZE(functional_pseudo_classes);
+                i++) {
+            const struct pseudo_class *pc = functional_pseudo_classes + i;
+            if (strcmp(name, pc->name) == 0) {
+                if ((simple = compound_add_simple(compound, pc->type)))
+                    ok = parse_nth(ps, &simple->a, &simple->b);
+                goto done;
+            }
+        }
+    }
+    else {
+        if (strcmp(name, "only-child") == 0 ||
+                strcmp(name, "only-of-type") == 0) {
+            bool of_type = (name[5] == 'o');
+            struct simple_selector *first, *last;
+            first = compound_add_simple(compound,
+                    of_type ? SIMPLE_NTH_OF_TYPE : SIMPLE_NTH_CHILD);
+            if (first == NULL)
+                goto done;
+            first->b = 1;
+            last = compound_add_simple(compound,
+                    of_type ? SIMPLE_NTH_LAST_OF_TYPE : SIMPLE_NTH_LAST_CHILD);
+            if (last == NULL)
+                goto done;
+            last->b = 1;
+            ok = true;
+            goto done;
+        }
+
+        for (size_t i = 0; i < PCA_TABLESIZE(pseudo_classes); i++) {
+            const struct pseudo_class *pc = pseudo_classes + i;
+            if (strcmp(name, pc->name) == 0) {
+                if ((simple = compound_add_simple(compound, pc->type))) {
+                    simple->a = pc->a;
+                    simple->b = pc->b;
+                    ok = true;
+                }
+                goto done;
+            }
+        }
+    }
+
+    ps->unsupported = true;
+
+done:
+    free(name);
+    return ok;
+}
+
+static int
+compare_simples(const void *a, const void *b)
+{
+    const struct simple_selector *sa = a, *sb = b;
+    return (int)sa->type - (int)sb->type;
+}
+
+static bool
+parse_compound(struct parser *ps, struct compound_selector *compound,
+        bool negated)
+{
+    struct simple_selector *simple;
+    bool empty = true;
+
+    if (*ps->p == '*') {
+        ps->p++;
+        empty = false;
+    }
+    else if (is_name_start(*ps->p) || *ps->p == '-') {
+        if ((simple = compound_add_simple(compound, SIMPLE_TYPE)) == NULL)
+            return false;
+        /* tag names are case-insensitive in HTML documents */
+        simple->name = parse_ident(ps, &simple->name_len, true);
+        if (simple->name == NULL)
+            return false;
+        empty = false;
+    }
+
+    for (;;) {
+        char c = *ps->p;
+        if (c == '#' || c == '.') {
+            ps->p++;
+            simple = compound_add_simple(compound,
+                    (c == '#') ? SIMPLE_ID : SIMPLE_CLASS);
+            if (simple == NULL)
+                return false;
+            simple->name = parse_ident(ps, &simple->name_len, false);
+            if (simple->name == NULL)
+                return false;
+        }
+        else if (c == '[') {
+            ps->p++;
+            if ((simple = compound_add_simple(compound, SIMPLE_ATTR)) == NULL ||
+                    !parse_attribute(ps, simple))
+                return false;
+        }
+        else if (c == ':') {
+            ps->p++;
+            if (*ps->p == ':') {
+                /* pseudo-elements never match elements */
+                ps->unsupported = true;
+                return false;
+            }
+            if (!parse_pseudo_class(ps, compound, negated))
+                return false;
+        }
+        else {
+            break;
+        }
+
+        empty = false;
+    }
+
+    if (empty)
+        return false;
+
+    if (compound->nr_simples > 1)
+        qsort(compound->simples, compound->nr_simples,
+                sizeof(compound->simples[0]), compare_simples);
+    return true;
+}
+
+static void
+add_ancestor_hash(struct complex_selector *complex, uint32_t hash)
+{
+    if (complex->nr_ancestor_hashes < MAX_ANCESTOR_HASHES)
+        complex->ancestor_hashes[complex->nr_ancestor_hashes++] = hash;
+}
+
+/*
+ * Record the features required on the ancestors: the ones of the compound
+ * selectors reached from the subject only by the descendant or child
+ * combinators; the identifiers first, then the classes and the tags.
+ */
+static void
+collect_ancestor_hashes(struct complex_selector *complex)
+{
+    static const struct {
+        enum simple_type    simple;
+        enum feature_type   feature;
+    } kinds[] = {
+        { SIMPLE_ID,    FEATURE_ID },
+        { SIMPLE_CLASS, FEATURE_CLASS },
+        { SIMPLE_TYPE,  FEATURE_TAG },
+    };
+
+    for (size_t k = 0; k < PCA_TABLESIZE(kinds); k++) {
+        for (size_t i = 1; i < complex->nr_compounds; i++) {
+            enum combinator comb = complex->compounds[i - 1].combinator;
+            if (comb != COMB_DESCENDANT && comb != COMB_CHILD)
+                break;
+
+            struct compound_selector *compound = complex->compounds + i;
+            for (size_t j = 0; j < compound->nr_simples; j++) {
+                struct simple_selector *simple = compound->simples + j;
+                if (simple->type == kinds[k].simple)
+                    add_ancestor_hash(complex, feature_hash(kinds[k].feature,
+                                simple->name, simple->name_len));
+            }
+        }
+    }
+}
+
+static bool
+parse_complex(struct parser *ps, struct complex_selector *complex)
+{
+    for (;;) {
+        struct compound_selector *compounds = realloc(complex->compounds,
+                sizeof(*compounds) * (complex->nr_compounds + 1));
+        if (compounds == NULL)
+            return false;
+        complex->compounds = compounds;
+
+        struct compound_selector *compound;
+        compound = compounds + complex->nr_compounds++;
+        memset(compound, 0, sizeof(*compound));
+        if (!parse_compound(ps, compound, false))
+            return false;
+
+        bool ws = skip_ws(ps);
+        char c = *ps->p;
+        if (c == '>' || c == '+' || c == '~') {
+            compound->combinator = (c == '>') ? COMB_CHILD :
+                ((c == '+') ? COMB_ADJACENT : COMB_SIBLING);
+            ps->p++;
+            skip_ws(ps);
+        }
+        else if (ws && c != ',' && c != '\0') {
+            compound->combinator = COMB_DESCENDANT;
+        }
+        else {
+            break;
+        }
+    }
+
+    /* reverse the compound selectors; the combinator of a compound selector
+       then tells how to reach the next one from right to left */
+    size_t n = complex->nr_compounds;
+    for (size_t i = 0; i < n / 2; i++) {
+        struct compound_selector tmp = complex->compounds[i];
+        complex->compounds[i] = complex->compounds[n - 1 - i];
+        complex->compounds[n - 1 - i] = tmp;
+    }
+    for (size_t i = 0; i + 1 < n; i++) {
+        complex->compounds[i].combinator = complex->compounds[i + 1].combinator;
+    }
+    complex->compounds[n - 1].combinator = COMB_NONE;
+
+    collect_ancestor_hashes(complex);
+    return true;
+}
+
+struct pcdoc_selector *
+pcdoc_selector_new(const char *selector)
+{
+    struct parser ps = { selector, false };
+    struct pcdoc_selector *sel = calloc(1, sizeof(*sel));
+    if (sel == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    sel->refc = 1;
+
+    skip_ws(&ps);
+    for (;;) {
+        struct complex_selector *complexes = realloc(sel->complexes,
+                sizeof(*complexes) * (sel->nr_complexes + 1));
+        if (complexes == NULL)
+            goto failed;
+        sel->complexes = complexes;
+
+        struct complex_selector *complex;
+        complex = complexes + sel->nr_complexes++;
+        memset(complex, 0, sizeof(*complex));
+        if (!parse_complex(&ps, complex))
+            goto failed;
+        if (complex->nr_ancestor_hashes)
+            sel->use_filter = true;
+
+        if (*ps.p == '\0')
+            break;
+        if (*ps.p != ',')
+            goto failed;
+        ps.p++;
+        skip_ws(&ps);
+    }
+
+    return sel;
+
+failed:
+    pcdoc_selector_delete(sel);
+    purc_set_error(ps.unsupported ?
+            PURC_ERROR_NOT_SUPPORTED : PURC_ERROR_INVALID_VALUE);
+    return NULL;
+}
+
+static inline pcdom_element_t *
+parent_element(pcdom_element_t *elem)
+{
+    pcdom_node_t *parent = elem->node.parent;
+    if (parent && parent->type == PCDOM_NODE_TYPE_ELEMENT)
+        return pcdom_interface_element(parent);
+    return NULL;
+}
+
+static inline pcdom_element_t *
+prev_element(pcdom_element_t *elem)
+{
+    pcdom_node_t *node = elem->node.prev;
+    while (node && node->type != PCDOM_NODE_TYPE_ELEMENT)
+        node = node->prev;
+    return node ? pcdom_interface_element(node) : NULL;
+}
+
+static bool
+has_token(const char *str, size_t len, const char *token, size_t token_len)
+{
+    const char *end = str + len;
+    while (str < end) {
+        while (str < end && is_ws(*str))
+            str++;
+
+        const char *start = str;
+        while (str < end && !is_ws(*str))
+            str++;
+
+        if ((size_t)(str - start) == token_len &&
+                memcmp(start, token, token_len) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static inline bool
+equal_str(const char *a, const char *b, size_t len, bool ci)
+{
+    return ci ? pcutils_strncasecmp(a, b, len) == 0 : memcmp(a, b, len) == 0;
+}
+
+static bool
+match_attr(const struct simple_selector *simple, pcdom_element_t *elem)
+{
+    pcdom_attr_t *attr = pcdom_element_attr_by_name(elem,
+            (const unsigned char *)simple->name, simple->name_len);
+    if (attr == NULL)
+        return false;
+    if (simple->attr_op == ATTR_EXISTS)
+        return true;
+
+    size_t len;
+    const char *val = (const char *)pcdom_attr_value(attr, &len);
+    if (val == NULL) {
+        val = "";
+        len = 0;
+    }
+
+    const char *v = simple->value;
+    size_t vlen = simple->value_len;
+    switch (simple->attr_op) {
+    case ATTR_EQUALS:
+        return len == vlen && equal_str(val, v, len, simple->ci);
+
+    case ATTR_INCLUDES: {
+        if (vlen == 0 || strpbrk(v, " \t\n\f\r"))
+            return false;
+
+        const char *end = val + len;
+        while (val < end) {
+            while (val < end && is_ws(*val))
+                val++;
+            const char *start = val;
+            while (val < end && !is_ws(*val))
+                val++;
+            if ((size_t)(val - start) == vlen &&
+                    equal_str(start, v, vlen, simple->ci))
+                return true;
+        }
+        return false;
+    }
+
+    case ATTR_DASH_MATCH:
+        return (len == vlen || (len > vlen && val[vlen] == '-')) &&
+            equal_str(val, v, vlen, simple->ci);
+
+    case ATTR_PREFIX:
+        return vlen > 0 && len >= vlen && equal_str(val, v, vlen, simple->ci);
+
+    case ATTR_SUFFIX:
+        return vlen > 0 && len >= vlen &&
+            equal_str(val + len - vlen, v, vlen, simple->ci);
+
+    case ATTR_SUBSTRING:
+        if (vlen == 0 || len < vlen)
+            return false;
+        for (size_t i = 0; i + vlen <= len; i++) {
+            if (equal_str(val + i, v, vlen, simple->ci))
+                return true;
+        }
+        return false;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+static inline bool
+match_nth(int a, int b, int pos)
+{
+    if (a == 0)
+        return pos == b;
+
+    int diff = pos - b;
+    return (diff / a) >= 0 && (diff % a) == 0;
+}
+
+static int
+element_position(pcdom_element_t *elem, bool from_end, bool of_type)
+{
+    pcdom_node_t *self = pcdom_interface_node(elem);
+    int pos = 1;
+
+    for (pcdom_node_t *node = from_end ? self->next : self->prev; node;
+            node = from_end ? node->next : node->prev) {
+        if (node->type != PCDOM_NODE_TYPE_ELEMENT)
+            continue;
+        if (of_type && (node->local_name != self->local_name ||
+                    node->ns != self->ns))
+            continue;
+        pos++;
+    }
+
+    return pos;
+}
+
+static bool
+match_compound(const struct compound_selector *compound,
+        pcdom_element_t *elem);
+
+static bool
+match_simple(const struct simple_selector *simple, pcdom_element_t *elem)
+{
+    const char *str;
+    size_t len;
+
+    switch (simple->type) {
+    case SIMPLE_ID:
+        if (elem->attr_id == NULL ||
+                (str = (const char *)pcdom_attr_value(elem->attr_id,
+                    &len)) == NULL)
+            return false;
+        return len == simple->name_len &&
+            memcmp(str, simple->name, len) == 0;
+
+    case SIMPLE_TYPE:
+        str = (const char *)pcdom_element_local_name(elem, &len);
+        return str && len == simple->name_len &&
+            pcutils_strncasecmp(str, simple->name, len) == 0;
+
+    case SIMPLE_CLASS:
+        if (elem->attr_class == NULL ||
+                (str = (const char *)pcdom_attr_value(elem->attr_class,
+                    &len)) == NULL)
+            return false;
+        return has_token(str, len, simple->name, simple->name_len);
+
+    case SIMPLE_ATTR:
+        return match_attr(simple, elem);
+
+    case SIMPLE_ROOT:
+        return parent_element(elem) == NULL;
+
+    case SIMPLE_EMPTY:
+        for (pcdom_node_t *child = elem->node.first_child; child;
+                child = child->next) {
+            if (child->type == PCDOM_NODE_TYPE_ELEMENT)
+                return false;
+            if (child->type == PCDOM_NODE_TYPE_TEXT &&
+                    pcdom_interface_text(child)->char_data.data.length > 0)
+                return false;
+        }
+        return true;
+
+    case SIMPLE_NTH_CHILD:
+    case SIMPLE_NTH_LAST_CHILD:
+    case SIMPLE_NTH_OF_TYPE:
+    case SIMPLE_NTH_LAST_OF_TYPE:
+        return match_nth(simple->a, simple->b, element_position(elem,
+                    simple->type == SIMPLE_NTH_LAST_CHILD ||
+                    simple->type == SIMPLE_NTH_LAST_OF_TYPE,
+                    simple->type == SIMPLE_NTH_OF_TYPE ||
+                    simple->type == SIMPLE_NTH_LAST_OF_TYPE));
+
+    case SIMPLE_NOT:
+        return !match_compound(simple->negation, elem);
+    }
+
+    return false;
+}
+
+static bool
+match_compound(const struct compound_selector *compound,
+        pcdom_element_t *elem)
+{
+    for (size_t i = 0; i < compound->nr_simples; i++) {
+        if (!match_simple(compound->simples + i, elem))
+            return false;
+    }
+
+    return true;
+}
+
+/* match the compound selectors after the i-th one, which matches `elem` */
+static bool
+match_rest(const struct complex_selector *complex, size_t i,
+        pcdom_element_t *elem)
+{
+    if (i + 1 == complex->nr_compounds)
+        return true;
+
+    const struct compound_selector *next = complex->compounds + i + 1;
+    pcdom_element_t *other;
+
+    switch (complex->compounds[i].combinator) {
+    case COMB_CHILD:
+        other = parent_element(elem);
+        return other && match_compound(next, other) &&
+            match_rest(complex, i + 1, other);
+
+    case COMB_DESCENDANT:
+        for (other = parent_element(elem); other;
+                other = parent_element(other)) {
+            if (match_compound(next, other) &&
+                    match_rest(complex, i + 1, other))
+                return true;
+        }
+        return false;
+
+    case COMB_ADJACENT:
+        other = prev_element(elem);
+        return other && match_compound(next, other) &&
+            match_rest(complex, i + 1, other);
+
+    case COMB_SIBLING:
+        for (other = prev_element(elem); other;
+                other = prev_element(other)) {
+            if (match_compound(next, other) &&
+                    match_rest(complex, i + 1, other))
+                return true;
+        }
+        return false;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+static inline bool
+match_complex(const struct complex_selector *complex, pcdom_element_t *elem)
+{
+    return match_compound(complex->compounds, elem) &&
+        match_rest(complex, 0, elem);
+}
+
+bool
+pcdoc_selector_match(const struct pcdoc_selector *sel, pcdom_element_t *elem)
+{
+    for (size_t i = 0; i < sel->nr_complexes; i++) {
+        if (match_complex(sel->complexes + i, elem))
+            return true;
+    }
+
+    return false;
+}
+
+static unsigned
+compound_dependencies(const struct compound_selector *compound)
+{
+    unsigned deps = 0;
+
+    for (size_t i = 0; i < compound->nr_simples; i++) {
+        const struct simple_selector *simple = compound->simples + i;
+
+        switch (simple->type) {
+        case SIMPLE_ID:
+            deps |= PCDOC_CHANGE_MASK(PCDOC_CHANGE_ID);
+            break;
+
+        case SIMPLE_CLASS:
+            deps |= PCDOC_CHANGE_MASK(PCDOC_CHANGE_CLASS);
+            break;
+
+        case SIMPLE_ATTR:
+            /* the attribute names are in lower case */
+            if (strcmp(simple->name, "id") == 0)
+                deps |= PCDOC_CHANGE_MASK(PCDOC_CHANGE_ID);
+            else if (strcmp(simple->name, "class") == 0)
+                deps |= PCDOC_CHANGE_MASK(PCDOC_CHANGE_CLASS);
+            else
+                deps |= PCDOC_CHANGE_MASK(PCDOC_CHANGE_ATTR);
+            break;
+
+        case SIMPLE_EMPTY:
+            deps |= PCDOC_CHANGE_MASK(PCDOC_CHANGE_TEXT);
+            break;
+
+        case SIMPLE_NOT:
+            deps |= compound_dependencies(simple->negation);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return deps;
+}
+
+unsigned
+pcdoc_selector_dependencies(const struct pcdoc_selector *sel)
+{
+    unsigned deps = 0;
+
+    for (size_t i = 0; i < sel->nr_complexes; i++) {
+        const struct complex_selector *complex = sel->complexes + i;
+        for (size_t j = 0; j < complex->nr_compounds; j++)
+            deps |= compound_dependencies(complex->compounds + j);
+    }
+
+    return deps;
+}
+
+/* a counting Bloom filter with two probes per key */
+#define FILTER_KEY_BITS         12
+#define FILTER_SIZE             (1 << FILTER_KEY_BITS)
+#define FILTER_KEY_MASK         (FILTER_SIZE - 1)
+#define FILTER_MAX_COUNT        0xFF
+
+struct ancestor_filter {
+    uint8_t     counts[FILTER_SIZE];
+
+    /* the hashes added for the ancestors, and the number of the hashes
+       added for every ancestor; to remove them without hashing again */
+    uint32_t   *hashes;
+    size_t      nr_hashes, sz_hashes;
+    size_t     *nr_pushed;
+    size_t      depth, sz_depth;
+};
+
+static inline void
+filter_add(struct ancestor_filter *filter, uint32_t hash)
+{
+    uint8_t *c1 = filter->counts + (hash & FILTER_KEY_MASK);
+    uint8_t *c2 = filter->counts + ((hash >> FILTER_KEY_BITS) &
+            FILTER_KEY_MASK);
+
+    /* a saturated counter sticks; it only causes false positives */
+    if (*c1 < FILTER_MAX_COUNT)
+        (*c1)++;
+    if (*c2 < FILTER_MAX_COUNT)
+        (*c2)++;
+}
+
+static inline void
+filter_remove(struct ancestor_filter *filter, uint32_t hash)
+{
+    uint8_t *c1 = filter->counts + (hash & FILTER_KEY_MASK);
+    uint8_t *c2 = filter->counts + ((hash >> FILTER_KEY_BITS) &
+            FILTER_KEY_MASK);
+
+    if (*c1 < FILTER_MAX_COUNT)
+        (*c1)--;
+    if (*c2 < FILTER_MAX_COUNT)
+        (*c2)--;
+}
+
+static inline bool
+filter_may_contain(const struct ancestor_filter *filter, uint32_t hash)
+{
+    return filter->counts[hash & FILTER_KEY_MASK] &&
+        filter->counts[(hash >> FILTER_KEY_BITS) & FILTER_KEY_MASK];
+}
+
+static int
+filter_add_hash(struct ancestor_filter *filter, uint32_t hash)
+{
+    if (filter->nr_hashes == filter->sz_hashes) {
+        size_t sz = filter->sz_hashes ? filter->sz_hashes * 2 : 64;
+        uint32_t *hashes = realloc(filter->hashes, sizeof(*hashes) * sz);
+        if (hashes == NULL)
+            return -1;
+        filter->hashes = hashes;
+        filter->sz_hashes = sz;
+    }
+
+    filter->hashes[filter->nr_hashes++] = hash;
+    filter_add(filter, hash);
+    return 0;
+}
+
+static int
+filter_push(struct ancestor_filter *filter, pcdom_element_t *elem)
+{
+    const char *str;
+    size_t len;
+
+    if (filter->depth == filter->sz_depth) {
+        size_t sz = filter->sz_depth ? filter->sz_depth * 2 : 32;
+        size_t *nr_pushed = realloc(filter->nr_pushed,
+                sizeof(*nr_pushed) * sz);
+        if (nr_pushed == NULL)
+            return -1;
+        filter->nr_pushed = nr_pushed;
+        filter->sz_depth = sz;
+    }
+
+    size_t nr_hashes = filter->nr_hashes;
+
+    str = (const char *)pcdom_element_local_name(elem, &len);
+    if (str && filter_add_hash(filter, feature_hash(FEATURE_TAG, str, len)))
+        return -1;
+
+    if (elem->attr_id &&
+            (str = (const char *)pcdom_attr_value(elem->attr_id, &len)) &&
+            filter_add_hash(filter, feature_hash(FEATURE_ID, str, len)))
+        return -1;
+
+    if (elem->attr_class &&
+            (str = (const char *)pcdom_attr_value(elem->attr_class, &len))) {
+        const char *end = str + len;
+        while (str < end) {
+            while (str < end && is_ws(*str))
+                str++;
+            const char *start = str;
+            while (str < end && !is_ws(*str))
+                str++;
+            if (str > start && filter_add_hash(filter,
+                        feature_hash(FEATURE_CLASS, start, str - start)))
+                return -1;
+        }
+    }
+
+    filter->nr_pushed[filter->depth++] = filter->nr_hashes - nr_hashes;
+    return 0;
+}
+
+static void
+filter_pop(struct ancestor_filter *filter)
+{
+    size_t n = filter->nr_pushed[--filter->depth];
+    while (n-- > 0)
+        filter_remove(filter, filter->hashes[--filter->nr_hashes]);
+}
+
+static bool
+match_with_filter(const struct pcdoc_selector *sel,
+        const struct ancestor_filter *filter, pcdom_element_t *elem)
+{
+    for (size_t i = 0; i < sel->nr_complexes; i++) {
+        const struct complex_selector *complex = sel->complexes + i;
+
+        size_t j;
+        for (j = 0; j < complex->nr_ancestor_hashes; j++) {
+            if (!filter_may_contain(filter, complex->ancestor_hashes[j]))
+                break;
+        }
+
+        if (j == complex->nr_ancestor_hashes && match_complex(complex, elem))
+            return true;
+    }
+
+    return false;
+}
+
+int
+pcdoc_selector_select(const struct pcdoc_selector *sel, pcdom_node_t *scope,
+        struct pcutils_arrlist *results, size_t max_nr)
+{
+    struct ancestor_filter *filter = NULL;
+    pcdom_node_t *node;
+
+    if (sel->use_filter) {
+        filter = calloc(1, sizeof(*filter));
+        if (filter == NULL)
+            goto failed;
+
+        /* the ancestors of the scope count for the combinators; the order
+           does not matter since they are never popped */
+        for (node = scope->parent; node; node = node->parent) {
+            if (node->type == PCDOM_NODE_TYPE_ELEMENT &&
+                    filter_push(filter, pcdom_interface_element(node)))
+                goto failed;
+        }
+    }
+
+    size_t nr_found = 0;
+    node = scope;
+    for (;;) {
+        if (node->type == PCDOM_NODE_TYPE_ELEMENT) {
+            pcdom_element_t *elem = pcdom_interface_element(node);
+            bool matched = filter ? match_with_filter(sel, filter, elem) :
+                pcdoc_selector_match(sel, elem);
+            if (matched) {
+                if (pcutils_arrlist_append(results, elem))
+                    goto failed;
+
+                if (++nr_found == max_nr)
+                    break;
+            }
+        }
+
+        if (node->first_child) {
+            if (filter && node->type == PCDOM_NODE_TYPE_ELEMENT &&
+                    filter_push(filter, pcdom_interface_element(node)))
+                goto failed;
+            node = node->first_child;
+            continue;
+        }
+
+        while (node != scope && node->next == NULL) {
+            node = node->parent;
+            if (filter && node->type == PCDOM_NODE_TYPE_ELEMENT)
+                filter_pop(filter);
+        }
+
+        if (node == scope)
+            break;
+        node = node->next;
+    }
+
+    if (filter) {
+        free(filter->hashes);
+        free(filter->nr_pushed);
+        free(filter);
+    }
+    return 0;
+
+failed:
+    if (filter) {
+        free(filter->hashes);
+        free(filter->nr_pushed);
+        free(filter);
+    }
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -1;
+}
+
+/* the number of the entries in the selector cache of an instance */
+#define NR_SELECTOR_CACHE_ENTRIES   64
+
+struct selector_cache_entry {
+    char                   *text;
+    struct pcdoc_selector  *sel;
+};
+
+struct pcdoc_selector_cache {
+    struct selector_cache_entry entries[NR_SELECTOR_CACHE_ENTRIES];
+};
+
+void
+pcdoc_selector_release(struct pcdoc_selector *sel)
+{
+    if (--sel->refc == 0)
+        pcdoc_selector_delete(sel);
+}
+
+struct pcdoc_selector *
+pcdoc_selector_get(const char *selector)
+{
+    struct pcinst *inst = pcinst_current();
+    if (inst == NULL)
+        return pcdoc_selector_new(selector);
+
+    if (inst->selector_cache == NULL) {
+        inst->selector_cache = calloc(1, sizeof(*inst->selector_cache));
+        if (inst->selector_cache == NULL)
+            return pcdoc_selector_new(selector);
+    }
+
+    size_t len = strlen(selector);
+    uint32_t h = feature_hash(0, selector, len);
+    struct selector_cache_entry *entry;
+    entry = inst->selector_cache->entries + (h % NR_SELECTOR_CACHE_ENTRIES);
+    if (entry->text && strcmp(entry->text, selector) == 0) {
+        entry->sel->refc++;
+        return entry->sel;
+    }
+
+    struct pcdoc_selector *sel = pcdoc_selector_new(selector);
+    if (sel == NULL)
+        return NULL;
+
+    char *text = strdup(selector);
+    if (text) {
+        if (entry->text) {
+            free(entry->text);
+            pcdoc_selector_release(entry->sel);
+        }
+
+        entry->text = text;
+        entry->sel = sel;
+        sel->refc++;
+    }
+
+    return sel;
+}
+
+void
+pcdoc_release_selector_cache(struct pcinst *inst)
+{
+    if (inst->selector_cache == NULL)
+        return;
+
+    for (size_t i = 0; i < NR_SELECTOR_CACHE_ENTRIES; i++) {
+        struct selector_cache_entry *entry;
+        entry = inst->selector_cache->entries + i;
+        if (entry->text) {
+            free(entry->text);
+            pcdoc_selector_release(entry->sel);
+        }
+    }
+
+    free(inst->selector_cache);
+    inst->selector_cache = NULL;
+}
@@ -26,8 +26,12 @@
 #include "purc-errors.h"
 
 #include "private/document.h"
+#include "private/css-selector.h"
+#include "private/instance.h"
 #include "private/stringbuilder.h"
 
+#include <strings.h>
+
 static struct doc_type {
     const char                 *target_name;
     struct purc_document_ops   *ops;
@@ -105,6 +109,8 @@ purc_document_ref(purc_document_t doc)
     return doc;
 }
 
+static void release_query_cache(purc_document_t doc);
+
 unsigned int
 purc_document_unref(purc_document_t doc)
 {
@@ -112,6 +118,7 @@ purc_document_unref(purc_document_t doc)
 
     unsigned int refc = doc->refc;
     if (refc == 0) {
+        release_query_cache(doc);
         doc->ops->destroy(doc);
     }
 
@@ -122,6 +129,7 @@ unsigned int
 purc_document_delete(purc_document_t doc)
 {
     unsigned int refc = doc->refc;
+    release_query_cache(doc);
     doc->ops->destroy(doc);
     return refc;
 }
@@ -132,23 +140,42 @@ purc_document_special_elem(purc_document_t doc, pcdoc_special_elem elem)
     return doc->ops->special_elem(doc, elem);
 }
 
+static inline void
+bump_generation(purc_document_t doc, enum pcdoc_change_kind kind)
+{
+    doc->generations[kind]++;
+}
+
+/* the kind of the change made by inserting a text or data node */
+static inline enum pcdoc_change_kind
+content_change_kind(pcdoc_operation op)
+{
+    /* the child elements are removed when the content is displaced */
+    if (op == PCDOC_OP_DISPLACE || op == PCDOC_OP_UPDATE)
+        return PCDOC_CHANGE_STRUCTURE;
+    return PCDOC_CHANGE_TEXT;
+}
+
 pcdoc_element_t
 pcdoc_element_new_element(purc_document_t doc,
         pcdoc_element_t elem, pcdoc_operation op,
         const char *tag, bool self_close)
 {
+    bump_generation(doc, PCDOC_CHANGE_STRUCTURE);
     return doc->ops->operate_element(doc, elem, op, tag, self_close);
 }
 
 void
 pcdoc_element_clear(purc_document_t doc, pcdoc_element_t elem)
 {
+    bump_generation(doc, PCDOC_CHANGE_STRUCTURE);
     doc->ops->operate_element(doc, elem, PCDOC_OP_CLEAR, NULL, 0);
 }
 
 void
 pcdoc_element_erase(purc_document_t doc, pcdoc_element_t elem)
 {
+    bump_generation(doc, PCDOC_CHANGE_STRUCTURE);
     doc->ops->operate_element(doc, elem, PCDOC_OP_ERASE, NULL, 0);
 }
 
@@ -157,6 +184,7 @@ pcdoc_element_new_text_content(purc_document_t doc,
         pcdoc_element_t elem, pcdoc_operation op,
         const char *text, size_t len)
 {
+    bump_generation(doc, content_change_kind(op));
     return doc->ops->new_text_content(doc, elem, op, text, len);
 }
 
@@ -165,6 +193,7 @@ pcdoc_element_set_data_content(purc_document_t doc,
         pcdoc_element_t elem, pcdoc_operation op,
         purc_variant_t data)
 {
+    bump_generation(doc, content_change_kind(op));
     if (doc->ops->new_data_content)
         return doc->ops->new_data_content(doc, elem, op, data);
 
@@ -177,6 +206,7 @@ pcdoc_element_new_content(purc_document_t doc,
         pcdoc_element_t elem, pcdoc_operation op,
         const char *content, size_t len)
 {
+    bump_generation(doc, PCDOC_CHANGE_STRUCTURE);
     return doc->ops->new_content(doc, elem, op, content, len);
 }
 
@@ -186,6 +216,12 @@ pcdoc_element_set_attribute(purc_document_t doc,
         const char *name, const char *val, size_t len)
 {
     if (doc->ops->set_attribute) {
+        if (strcasecmp(name, "id") == 0)
+            bump_generation(doc, PCDOC_CHANGE_ID);
+        else if (strcasecmp(name, "class") == 0)
+            bump_generation(doc, PCDOC_CHANGE_CLASS);
+        else
+            bump_generation(doc, PCDOC_CHANGE_ATTR);
         return doc->ops->set_attribute(doc, elem, op, name, val, len);
     }
 
@@ -517,11 +553,26 @@ static pcdoc_elem_coll_t
 element_collection_new(const char *selector)
 {
     pcdoc_elem_coll_t coll = calloc(1, sizeof(*coll));
+    if (coll == NULL)
+        goto failed;
+
     coll->selector = selector ? strdup(selector) : NULL;
     coll->refc = 1;
     coll->elems = pcutils_arrlist_new_ex(NULL, 4);
+    if ((selector && coll->selector == NULL) || coll->elems == NULL)
+        goto failed;
 
     return coll;
+
+failed:
+    if (coll) {
+        if (coll->elems)
+            pcutils_arrlist_free(coll->elems);
+        free(coll->selector);
+        free(coll);
+    }
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return NULL;
 }
 
 pcdoc_elem_coll_t
@@ -530,13 +581,13 @@ pcdoc_elem_coll_new_from_descendants(purc_document_t doc,
 {
     pcdoc_elem_coll_t coll = element_collection_new(selector);
 
-    if (doc->ops->elem_coll_select) {
+    if (coll && doc->ops->elem_coll_select) {
         if (ancestor == NULL) {
             ancestor = doc->ops->special_elem(doc,
                     PCDOC_SPECIAL_ELEM_ROOT);
         }
 
-        if (!doc->ops->elem_coll_select(doc, coll, ancestor, selector)) {
+        if (doc->ops->elem_coll_select(doc, coll, ancestor, selector)) {
             pcdoc_elem_coll_delete(doc, coll);
             coll = NULL;
         }
@@ -546,13 +597,13 @@ pcdoc_elem_coll_new_from_descendants(purc_document_t doc,
 }
 
 pcdoc_elem_coll_t
-pcdoc_elem_coll_filter(purc_document_t doc,
+pcdoc_elem_coll_select(purc_document_t doc,
         pcdoc_elem_coll_t elem_coll, const char *selector)
 {
     pcdoc_elem_coll_t dst_coll = element_collection_new(selector);
 
-    if (doc->ops->elem_coll_filter) {
-        if (!doc->ops->elem_coll_filter(doc, dst_coll,
+    if (dst_coll && doc->ops->elem_coll_filter) {
+        if (doc->ops->elem_coll_filter(doc, dst_coll,
                 elem_coll, selector)) {
             pcdoc_elem_coll_delete(doc, dst_coll);
             dst_coll = NULL;
@@ -569,6 +620,7 @@ pcdoc_elem_coll_delete(purc_document_t doc,
     UNUSED_PARAM(doc);
 
     pcutils_arrlist_free(elem_coll->elems);
+    free(elem_coll->selector);
     return free(elem_coll);
 }
 
@@ -603,3 +655,145 @@ element_collection_unref(purc_document_t doc, pcdoc_elem_coll_t coll)
 }
 #endif
 
+/* the number of the entries in the query cache of a document */
+#define NR_QUERY_CACHE_ENTRIES      32
+
+struct query_cache_entry {
+    char               *selector;
+    pcdoc_element_t     root;
+    purc_variant_t      result;
+
+    /* the kinds of the changes other than the structure changes which may
+       change the result */
+    unsigned            deps;
+    /* the generations of the document when the result was cached */
+    uint64_t            generations[PCDOC_NR_CHANGE_KINDS];
+};
+
+struct pcdoc_query_cache {
+    struct query_cache_entry entries[NR_QUERY_CACHE_ENTRIES];
+};
+
+static inline struct query_cache_entry *
+query_cache_slot(struct pcdoc_query_cache *cache, pcdoc_element_t root,
+        const char *selector)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261U;
+    for (const unsigned char *p = (const unsigned char *)selector; *p; p++) {
+        h ^= *p;
+        h *= 16777619U;
+    }
+    h ^= (uint32_t)((uintptr_t)root >> 4);
+    return cache->entries + (h % NR_QUERY_CACHE_ENTRIES);
+}
+
+static void
+clear_query_cache_entry(struct query_cache_entry *entry)
+{
+    if (entry->selector) {
+        free(entry->selector);
+        purc_variant_unref(entry->result);
+        entry->selector = NULL;
+        entry->result = PURC_VARIANT_INVALID;
+    }
+}
+
+static bool
+is_query_cache_entry_valid(purc_document_t doc,
+        const struct query_cache_entry *entry)
+{
+    unsigned deps = entry->deps | PCDOC_CHANGE_MASK(PCDOC_CHANGE_STRUCTURE);
+    for (int kind = 0; kind < PCDOC_NR_CHANGE_KINDS; kind++) {
+        if ((deps & PCDOC_CHANGE_MASK(kind)) &&
+                entry->generations[kind] != doc->generations[kind])
+            return false;
+    }
+
+    return true;
+}
+
+purc_variant_t
+pcdoc_query_cache_get(purc_document_t doc, pcdoc_element_t root,
+        const char *selector)
+{
+    if (doc->query_cache == NULL)
+        return PURC_VARIANT_INVALID;
+
+    struct query_cache_entry *entry;
+    entry = query_cache_slot(doc->query_cache, root, selector);
+    if (entry->selector == NULL || entry->root != root ||
+            strcmp(entry->selector, selector))
+        return PURC_VARIANT_INVALID;
+
+    if (!is_query_cache_entry_valid(doc, entry)) {
+        clear_query_cache_entry(entry);
+        return PURC_VARIANT_INVALID;
+    }
+
+    return purc_variant_ref(entry->result);
+}
+
+void
+pcdoc_query_cache_put(purc_document_t doc, pcdoc_element_t root,
+        const char *selector, purc_variant_t result)
+{
+    unsigned deps = 0;
+    if (strcmp(selector, "*")) {
+        struct pcdoc_selector *sel = pcdoc_selector_get(selector);
+        if (sel == NULL) {
+            /* not cacheable; not an error for the query */
+            purc_clr_error();
+            return;
+        }
+
+        deps = pcdoc_selector_dependencies(sel);
+        pcdoc_selector_release(sel);
+    }
+
+    if (doc->query_cache == NULL) {
+        doc->query_cache = calloc(1, sizeof(*doc->query_cache));
+        if (doc->query_cache == NULL)
+            return;
+    }
+
+    char *text = strdup(selector);
+    if (text == NULL)
+        return;
+
+    struct query_cache_entry *entry;
+    entry = query_cache_slot(doc->query_cache, root, selector);
+    clear_query_cache_entry(entry);
+
+    entry->selector = text;
+    entry->root = root;
+    entry->result = purc_variant_ref(result);
+    entry->deps = deps;
+    memcpy(entry->generations, doc->generations, sizeof(doc->generations));
+}
+
+static void
+release_query_cache(purc_document_t doc)
+{
+    if (doc->query_cache == NULL)
+        return;
+
+    for (size_t i = 0; i < NR_QUERY_CACHE_ENTRIES; i++)
+        clear_query_cache_entry(doc->query_cache->entries + i);
+
+    free(doc->query_cache);
+    doc->query_cache = NULL;
+}
+
+bool
+purc_get_fragment_cache_stats(struct purc_fragment_cache_stats *stats)
+{
+    struct pcinst *inst = pcinst_current();
+    if (inst == NULL) {
+        purc_set_error(PURC_ERROR_NO_INSTANCE);
+        return false;
+    }
+
+    *stats = inst->fragment_cache_stats;
+    return true;
+}
@@ -29,8 +29,763 @@
 #include "purc-html.h"
 
 #include "private/document.h"
+#include "private/dom.h"
+#include "private/hashtable.h"
+#include "private/css-selector.h"
+#include "private/instance.h"
 #include "private/debug.h"
 
+#include "html/serialize.h"
+
+/*
+ * The index of the elements by identifier and class. It is built on the
+ * first query and maintained by the operations which change the identifier
+ * or the class of an element, or insert or destroy elements.
+ *
+ * Every key maps to the list of the elements having it, in no particular
+ * order; duplicate identifiers are allowed in a document.
+ */
+struct index_entry {
+    char                   *key;
+    struct pchash_table    *table;
+    struct pcutils_arrlist *elems;
+    /* some elements are being removed from the list */
+    bool                    dirty;
+};
+
+struct pcdoc_elem_index {
+    struct pchash_table    *ids;
+    struct pchash_table    *classes;
+};
+
+/* the flags in pcdom_node.flags used by the index */
+#define ELEM_FLAG_UNINDEXING        0x0001
+#define ELEM_FLAG_SELECTED          0x0002
+/* the flag in pcdom_node.flags marking the elements in the serial cache */
+#define ELEM_FLAG_SERIALIZED        0x0004
+
+/* the maximal number of the found elements sorted in document order
+   by comparing positions; more are picked by traveling the scope. */
+#define MAX_ELEMS_TO_SORT           32
+
+static void index_entry_free(struct pchash_entry *e)
+{
+    struct index_entry *entry = pchash_entry_v(e);
+
+    pcutils_arrlist_free(entry->elems);
+    free(entry->key);
+    free(entry);
+}
+
+static void elem_index_delete(struct pcdoc_elem_index *index)
+{
+    if (index->ids)
+        pchash_table_free(index->ids);
+    if (index->classes)
+        pchash_table_free(index->classes);
+    free(index);
+}
+
+/* drop the index on failure; the queries fall back to traveling the tree */
+static void elem_index_drop(purc_document_t doc)
+{
+    if (doc->elem_index) {
+        elem_index_delete(doc->elem_index);
+        doc->elem_index = NULL;
+    }
+}
+
+static struct index_entry *
+index_lookup(struct pchash_table *table, const char *key, size_t len)
+{
+    char buf[64];
+    char *k = buf;
+    void *v = NULL;
+
+    if (len >= sizeof(buf)) {
+        k = strndup(key, len);
+        if (k == NULL)
+            return NULL;
+    }
+    else {
+        memcpy(buf, key, len);
+        buf[len] = '\0';
+    }
+
+    pchash_table_lookup_ex(table, k, &v);
+    if (k != buf)
+        free(k);
+    return v;
+}
+
+static int
+index_add(struct pchash_table *table, const char *key, size_t len,
+        pcdom_element_t *elem)
+{
+    struct index_entry *entry = index_lookup(table, key, len);
+
+    if (entry == NULL) {
+        entry = calloc(1, sizeof(*entry));
+        if (entry == NULL)
+            return -1;
+
+        entry->key = strndup(key, len);
+        entry->table = table;
+        entry->elems = pcutils_arrlist_new_ex(NULL, 1);
+        if (entry->key == NULL || entry->elems == NULL ||
+                pchash_table_insert(table, entry->key, entry)) {
+            if (entry->elems)
+                pcutils_arrlist_free(entry->elems);
+            free(entry->key);
+            free(entry);
+            return -1;
+        }
+    }
+
+    /* a class token repeated in the attribute is indexed once; the
+       tokens of an element are added one after another */
+    size_t n = pcutils_arrlist_length(entry->elems);
+    if (n > 0 && pcutils_arrlist_get_idx(entry->elems, n - 1) == elem)
+        return 0;
+
+    return pcutils_arrlist_append(entry->elems, elem);
+}
+
+static inline bool
+is_class_separator(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
+
+typedef int (*class_token_cb)(struct pchash_table *table,
+        const char *token, size_t len, pcdom_element_t *elem);
+
+static int
+for_each_class(pcdom_element_t *elem, struct pchash_table *table,
+        class_token_cb cb)
+{
+    size_t len;
+    const char *klass;
+
+    if (elem->attr_class == NULL ||
+            (klass = (const char *)pcdom_attr_value(elem->attr_class,
+                &len)) == NULL)
+        return 0;
+
+    const char *end = klass + len;
+    while (klass < end) {
+        while (klass < end && is_class_separator(*klass))
+            klass++;
+
+        const char *token = klass;
+        while (klass < end && !is_class_separator(*klass))
+            klass++;
+
+        if (klass > token && cb(table, token, klass - token, elem))
+            return -1;
+    }
+
+    return 0;
+}
+
+static inline const char *
+element_id(pcdom_element_t *elem, size_t *len)
+{
+    if (elem->attr_id == NULL)
+        return NULL;
+
+    const char *id = (const char *)pcdom_attr_value(elem->attr_id, len);
+    return (id && *len > 0) ? id : NULL;
+}
+
+static int
+index_element(struct pcdoc_elem_index *index, pcdom_element_t *elem)
+{
+    const char *id;
+    size_t len;
+
+    if ((id = element_id(elem, &len)) &&
+            index_add(index->ids, id, len, elem))
+        return -1;
+
+    return for_each_class(elem, index->classes, index_add);
+}
+
+static int
+index_remove(struct pchash_table *table, const char *key, size_t len,
+        pcdom_element_t *elem)
+{
+    struct index_entry *entry = index_lookup(table, key, len);
+    if (entry == NULL)
+        return 0;
+
+    size_t n = pcutils_arrlist_length(entry->elems);
+    for (size_t i = n; i > 0; i--) {
+        if (pcutils_arrlist_get_idx(entry->elems, i - 1) == elem) {
+            pcutils_arrlist_swap(entry->elems, i - 1, n - 1);
+            pcutils_arrlist_del_idx(entry->elems, n - 1, 1);
+            break;
+        }
+    }
+
+    if (pcutils_arrlist_length(entry->elems) == 0)
+        pchash_table_delete(table, entry->key);
+    return 0;
+}
+
+static void
+unindex_element(struct pcdoc_elem_index *index, pcdom_element_t *elem)
+{
+    const char *id;
+    size_t len;
+
+    if ((id = element_id(elem, &len)))
+        index_remove(index->ids, id, len, elem);
+    for_each_class(elem, index->classes, index_remove);
+}
+
+/* the next element in document order within the subtree of `root` */
+static pcdom_node_t *
+next_element(pcdom_node_t *node, pcdom_node_t *root)
+{
+    if (node->first_child) {
+        node = node->first_child;
+    }
+    else {
+        while (node != root && node->next == NULL)
+            node = node->parent;
+        if (node == root)
+            return NULL;
+        node = node->next;
+    }
+
+    while (node->type != PCDOM_NODE_TYPE_ELEMENT) {
+        if (node->first_child) {
+            node = node->first_child;
+            continue;
+        }
+
+        while (node != root && node->next == NULL)
+            node = node->parent;
+        if (node == root)
+            return NULL;
+        node = node->next;
+    }
+
+    return node;
+}
+
+static int
+index_subtree(struct pcdoc_elem_index *index, pcdom_node_t *root)
+{
+    pcdom_node_t *node = root;
+
+    if (node->type != PCDOM_NODE_TYPE_ELEMENT)
+        node = next_element(node, root);
+
+    for (; node; node = next_element(node, root)) {
+        if (index_element(index, pcdom_interface_element(node)))
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+mark_unindexing(struct pchash_table *table, const char *key, size_t len,
+        pcdom_element_t *elem)
+{
+    UNUSED_PARAM(elem);
+
+    struct index_entry *entry = index_lookup(table, key, len);
+    if (entry)
+        entry->dirty = true;
+
+    return 0;
+}
+
+static void
+purge_dirty_entries(struct pchash_table *table)
+{
+    struct pchash_entry *e, *tmp;
+
+    pchash_foreach_safe(table, e, tmp) {
+        struct index_entry *entry = pchash_entry_v(e);
+        if (!entry->dirty)
+            continue;
+
+        size_t n = pcutils_arrlist_length(entry->elems), kept = 0;
+        for (size_t i = 0; i < n; i++) {
+            pcdom_node_t *node = pcutils_arrlist_get_idx(entry->elems, i);
+            if (!(node->flags & ELEM_FLAG_UNINDEXING))
+                pcutils_arrlist_put_idx(entry->elems, kept++, node);
+        }
+        if (kept < n)
+            pcutils_arrlist_del_idx(entry->elems, kept, n - kept);
+
+        entry->dirty = false;
+        if (kept == 0)
+            pchash_table_delete_entry(table, e);
+    }
+}
+
+static int
+index_children(struct pcdoc_elem_index *index, pcdom_node_t *parent)
+{
+    for (pcdom_node_t *child = parent->first_child; child;
+            child = child->next) {
+        if (index_subtree(index, child))
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Remove the elements in the subtree from the index in one pass over every
+ * affected list, since a subtree may contain many elements of a class.
+ * The subtree will be destroyed by the caller, so the marks on the nodes
+ * are not cleared.
+ */
+static void
+unindex_subtree(struct pcdoc_elem_index *index, pcdom_node_t *root)
+{
+    pcdom_node_t *node = root;
+    size_t nr_elems = 0;
+
+    if (node->type != PCDOM_NODE_TYPE_ELEMENT)
+        node = next_element(node, root);
+
+    for (; node; node = next_element(node, root)) {
+        pcdom_element_t *elem = pcdom_interface_element(node);
+        const char *id;
+        size_t len;
+
+        if ((id = element_id(elem, &len)))
+            mark_unindexing(index->ids, id, len, elem);
+        for_each_class(elem, index->classes, mark_unindexing);
+
+        node->flags |= ELEM_FLAG_UNINDEXING;
+        nr_elems++;
+    }
+
+    if (nr_elems) {
+        purge_dirty_entries(index->ids);
+        purge_dirty_entries(index->classes);
+    }
+}
+
+static void
+unindex_children(struct pcdoc_elem_index *index, pcdom_node_t *parent)
+{
+    for (pcdom_node_t *child = parent->first_child; child;
+            child = child->next) {
+        unindex_subtree(index, child);
+    }
+}
+
+static struct pcdoc_elem_index *
+elem_index_build(purc_document_t doc)
+{
+    struct pcdoc_elem_index *index = calloc(1, sizeof(*index));
+    if (index == NULL)
+        goto failed;
+
+    index->ids = pchash_kchar_table_new(HASHTABLE_DEFAULT_SIZE,
+            index_entry_free);
+    index->classes = pchash_kchar_table_new(HASHTABLE_DEFAULT_SIZE,
+            index_entry_free);
+    if (index->ids == NULL || index->classes == NULL)
+        goto failed;
+
+    pchtml_html_document_t *html_doc = doc->impl;
+    pcdom_node_t *root = pcdom_interface_node(
+            pchtml_doc_get_document(html_doc)->element);
+    if (root && index_subtree(index, root))
+        goto failed;
+
+    return index;
+
+failed:
+    if (index)
+        elem_index_delete(index);
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return NULL;
+}
+
+/*
+ * The cache of the serialized elements. The output of a serialization is
+ * kept in a tape, and every element whose bytes are long enough refers to
+ * its span in the tape. A serialization copies the bytes of the cached
+ * elements instead of walking their subtrees again; a change to an element
+ * drops the cached bytes of the element and its ancestors.
+ */
+
+/* the shorter elements are not cached */
+#define MIN_SERIALIZED_SIZE         256
+/* the cache is dropped when the tapes in use take more space */
+#define MAX_SERIAL_CACHE_SIZE       (16 * 1024 * 1024)
+
+struct pcdoc_serial_cache;
+
+struct serial_tape {
+    struct pcdoc_serial_cache  *cache;
+    unsigned                    refc;
+
+    unsigned char              *data;
+    size_t                      len;
+    size_t                      sz;
+};
+
+struct serial_entry {
+    struct serial_tape *tape;
+    size_t              offset;
+    size_t              len;
+
+    /* the options and the indent the element was serialized with */
+    unsigned            opts;
+    size_t              indent;
+};
+
+struct pcdoc_serial_cache {
+    /* pcdom_node_t * -> struct serial_entry * */
+    struct pchash_table    *entries;
+    /* the space taken by the tapes referred to by the entries */
+    size_t                  nr_bytes;
+};
+
+static void
+serial_tape_release(struct serial_tape *tape)
+{
+    if (--tape->refc == 0) {
+        if (tape->cache)
+            tape->cache->nr_bytes -= tape->sz;
+        free(tape->data);
+        free(tape);
+    }
+}
+
+static void serial_entry_free(struct pchash_entry *e)
+{
+    pcdom_node_t *node = (pcdom_node_t *)pchash_entry_k(e);
+    struct serial_entry *entry = pchash_entry_v(e);
+
+    node->flags &= ~ELEM_FLAG_SERIALIZED;
+    serial_tape_release(entry->tape);
+    free(entry);
+}
+
+static void
+release_serial_cache(purc_document_t doc)
+{
+    if (doc->serial_cache) {
+        pchash_table_free(doc->serial_cache->entries);
+        free(doc->serial_cache);
+        doc->serial_cache = NULL;
+    }
+}
+
+static struct pcdoc_serial_cache *
+serial_cache_get(purc_document_t doc)
+{
+    if (doc->serial_cache == NULL) {
+        struct pcdoc_serial_cache *cache = calloc(1, sizeof(*cache));
+        if (cache == NULL)
+            return NULL;
+
+        cache->entries = pchash_kptr_table_new(HASHTABLE_DEFAULT_SIZE,
+                serial_entry_free);
+        if (cache->entries == NULL) {
+            free(cache);
+            return NULL;
+        }
+
+        doc->serial_cache = cache;
+    }
+
+    return doc->serial_cache;
+}
+
+static inline bool
+serial_cache_empty(purc_document_t doc)
+{
+    return doc->serial_cache == NULL || doc->serial_cache->entries->count == 0;
+}
+
+/* drop the cached bytes of the node and its ancestors */
+static void
+serial_cache_invalidate(purc_document_t doc, pcdom_node_t *node)
+{
+    if (serial_cache_empty(doc))
+        return;
+
+    while (node) {
+        if (node->flags & ELEM_FLAG_SERIALIZED)
+            pchash_table_delete(doc->serial_cache->entries, node);
+
+        /* the content of a template is serialized with the template */
+        if (node->type == PCDOM_NODE_TYPE_DOCUMENT_FRAGMENT &&
+                pcdom_interface_document_fragment(node)->host)
+            node = pcdom_interface_node(
+                    pcdom_interface_document_fragment(node)->host);
+        else
+            node = node->parent;
+    }
+}
+
+/* drop the cached bytes of the elements in the subtree to be destroyed,
+   since the nodes will be reused by other elements */
+static void
+serial_cache_drop_subtree(purc_document_t doc, pcdom_node_t *root)
+{
+    if (serial_cache_empty(doc))
+        return;
+
+    pcdom_node_t *node = root;
+    if (node->type != PCDOM_NODE_TYPE_ELEMENT)
+        node = next_element(node, root);
+
+    for (; node; node = next_element(node, root)) {
+        if (node->flags & ELEM_FLAG_SERIALIZED)
+            pchash_table_delete(doc->serial_cache->entries, node);
+    }
+}
+
+static void
+serial_cache_drop_children(purc_document_t doc, pcdom_node_t *parent)
+{
+    for (pcdom_node_t *child = parent->first_child; child;
+            child = child->next) {
+        serial_cache_drop_subtree(doc, child);
+    }
+}
+
+/* called before the operation `op` on the element */
+static void
+serial_cache_update(purc_document_t doc, pcdom_node_t *node,
+        pcdoc_operation op)
+{
+    if (serial_cache_empty(doc))
+        return;
+
+    switch (op) {
+    case PCDOC_OP_INSERTBEFORE:
+    case PCDOC_OP_INSERTAFTER:
+        node = node->parent;
+        break;
+
+    case PCDOC_OP_DISPLACE:
+    case PCDOC_OP_CLEAR:
+        serial_cache_drop_children(doc, node);
+        break;
+
+    case PCDOC_OP_ERASE:
+        serial_cache_drop_subtree(doc, node);
+        node = node->parent;
+        break;
+
+    default:
+        break;
+    }
+
+    serial_cache_invalidate(doc, node);
+}
+
+struct serial_ctxt {
+    struct pcdoc_serial_cache  *cache;
+    struct serial_tape         *tape;
+    unsigned                    opts;
+    bool                        oom;
+
+    /* the offsets of the elements being serialized in the tape */
+    size_t                     *starts;
+    size_t                      nr_starts;
+    size_t                      sz_starts;
+};
+
+static unsigned int
+serial_tape_write(const unsigned char *data, size_t len, void *ctxt)
+{
+    struct serial_ctxt *ctx = ctxt;
+    struct serial_tape *tape = ctx->tape;
+
+    if (ctx->oom)
+        return PCHTML_STATUS_OK;
+
+    if (tape->len + len > tape->sz) {
+        size_t sz = pcutils_get_next_fibonacci_number(tape->len + len);
+        unsigned char *buf = realloc(tape->data, sz);
+        if (buf == NULL) {
+            ctx->oom = true;
+            return PCHTML_STATUS_OK;
+        }
+
+        tape->data = buf;
+        tape->sz = sz;
+    }
+
+    memcpy(tape->data + tape->len, data, len);
+    tape->len += len;
+    return PCHTML_STATUS_OK;
+}
+
+static const unsigned char *
+serial_cache_get_bytes(pcdom_node_t *node, size_t indent, size_t *len,
+        void *ctxt)
+{
+    struct serial_ctxt *ctx = ctxt;
+    void *v = NULL;
+
+    if ((node->flags & ELEM_FLAG_SERIALIZED) == 0 ||
+            !pchash_table_lookup_ex(ctx->cache->entries, node, &v))
+        return NULL;
+
+    struct serial_entry *entry = v;
+    if (entry->opts != ctx->opts || entry->indent != indent)
+        return NULL;
+
+    *len = entry->len;
+    return entry->tape->data + entry->offset;
+}
+
+static void
+serial_cache_enter(pcdom_node_t *node, size_t indent, void *ctxt)
+{
+    UNUSED_PARAM(node);
+    UNUSED_PARAM(indent);
+    struct serial_ctxt *ctx = ctxt;
+
+    if (ctx->nr_starts == ctx->sz_starts) {
+        size_t sz = ctx->sz_starts ? ctx->sz_starts * 2 : 32;
+        size_t *starts = realloc(ctx->starts, sizeof(size_t) * sz);
+        if (starts == NULL) {
+            ctx->oom = true;
+            return;
+        }
+
+        ctx->starts = starts;
+        ctx->sz_starts = sz;
+    }
+
+    ctx->starts[ctx->nr_starts++] = ctx->tape->len;
+}
+
+static void
+serial_cache_leave(pcdom_node_t *node, size_t indent, void *ctxt)
+{
+    struct serial_ctxt *ctx = ctxt;
+
+    /* the stack is not reliable after a failure */
+    if (ctx->oom)
+        return;
+
+    size_t start = ctx->starts[--ctx->nr_starts];
+    if (ctx->tape->len - start < MIN_SERIALIZED_SIZE)
+        return;
+
+    struct serial_entry *entry = malloc(sizeof(*entry));
+    if (entry == NULL)
+        return;
+
+    entry->tape = ctx->tape;
+    entry->offset = start;
+    entry->len = ctx->tape->len - start;
+    entry->opts = ctx->opts;
+    entry->indent = indent;
+
+    /* replace the bytes serialized with other options */
+    if (node->flags & ELEM_FLAG_SERIALIZED)
+        pchash_table_delete(ctx->cache->entries, node);
+
+    if (pchash_table_insert(ctx->cache->entries, node, entry)) {
+        free(entry);
+        return;
+    }
+
+    node->flags |= ELEM_FLAG_SERIALIZED;
+    ctx->tape->refc++;
+}
+
+static int
+serialize_cached(purc_document_t doc, pcdom_node_t *node, unsigned opts,
+        purc_rwstream_t stm)
+{
+    struct pcdoc_serial_cache *cache = doc->serial_cache;
+    if (cache && cache->nr_bytes > MAX_SERIAL_CACHE_SIZE) {
+        release_serial_cache(doc);
+        cache = NULL;
+    }
+
+    if (cache == NULL && (cache = serial_cache_get(doc)) == NULL)
+        goto failed;
+
+    struct serial_ctxt ctx = { };
+    ctx.cache = cache;
+    ctx.opts = opts;
+    ctx.tape = calloc(1, sizeof(*ctx.tape));
+    if (ctx.tape == NULL)
+        goto failed;
+    ctx.tape->refc = 1;
+
+    pchtml_html_serialize_cache_t hooks = {
+        .get    = serial_cache_get_bytes,
+        .enter  = serial_cache_enter,
+        .leave  = serial_cache_leave,
+        .ctxt   = &ctx,
+    };
+
+    pchtml_html_serialize_pretty_tree_cached_cb(node, opts, 0,
+            serial_tape_write, &ctx, &hooks);
+    free(ctx.starts);
+
+    int ret = 0;
+    if (ctx.oom) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        ret = -1;
+    }
+    else if (ctx.tape->len > 0) {
+        ssize_t sz = purc_rwstream_write(stm, ctx.tape->data, ctx.tape->len);
+        if (sz < 0 || (size_t)sz != ctx.tape->len)
+            ret = -1;
+    }
+
+    if (ctx.tape->refc > 1) {
+        ctx.tape->cache = cache;
+        cache->nr_bytes += ctx.tape->sz;
+    }
+    serial_tape_release(ctx.tape);
+    return ret;
+
+failed:
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -1;
+}
+
+static purc_document_t
+new_document(pchtml_html_document_t *html_doc)
+{
+    purc_document_t doc = calloc(1, sizeof(*doc));
+    if (doc == NULL) {
+        pchtml_html_document_destroy(html_doc);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    doc->type = PCDOC_K_TYPE_HTML;
+    doc->def_text_type = PCRDR_MSG_DATA_TYPE_HTML;
+    doc->need_rdr = 1;
+    doc->data_content = 0;
+    doc->have_head = 1;
+    doc->have_body = 1;
+
+    doc->refc = 1;
+
+    doc->ops = &_pcdoc_html_ops;
+    doc->impl = html_doc;
+
+    return doc;
+}
+
 static purc_document_t create(const char *content, size_t length)
 {
     pchtml_html_document_t *html_doc;
@@ -56,25 +811,60 @@ static purc_document_t create(const char *content, size_t length)
         PC_WARN("bad content\n");
     }
 
-    purc_document_t doc = calloc(1, sizeof(*doc));
-    doc->type = PCDOC_K_TYPE_HTML;
-    doc->def_text_type = PCRDR_MSG_DATA_TYPE_HTML;
-    doc->need_rdr = 1;
-    doc->data_content = 0;
-    doc->have_head = 1;
-    doc->have_body = 1;
+    return new_document(html_doc);
+}
 
-    doc->refc = 1;
+/* the chunks are parsed as they are loaded; the parser keeps the state
+   of a token spanning chunks by itself */
+static purc_document_t load_begin(void)
+{
+    pchtml_html_document_t *html_doc;
+    html_doc = pchtml_html_document_create();
+    if (!html_doc) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
 
-    doc->ops = &_pcdoc_html_ops;
-    doc->impl = html_doc;
+    if (pchtml_html_document_parse_chunk_begin(html_doc)) {
+        pchtml_html_document_destroy(html_doc);
+        return NULL;
+    }
 
-    return doc;
+    return new_document(html_doc);
+}
+
+static int load_chunk(purc_document_t doc, const char *chunk, size_t len)
+{
+    unsigned int r;
+    r = pchtml_html_document_parse_chunk(doc->impl,
+            (const unsigned char*)chunk, len);
+    if (r) {
+        PC_WARN("bad content\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int load_end(purc_document_t doc)
+{
+    if (pchtml_html_document_parse_chunk_end(doc->impl)) {
+        PC_WARN("bad content\n");
+        return -1;
+    }
+
+    return 0;
 }
 
+static void release_fragment_cache(purc_document_t doc);
+
 static void destroy(purc_document_t doc)
 {
     assert(doc->impl);
+    if (doc->elem_index)
+        elem_index_delete(doc->elem_index);
+    release_fragment_cache(doc);
+    release_serial_cache(doc);
     pchtml_html_document_destroy(doc->impl);
     free(doc);
 }
@@ -158,10 +948,16 @@ static pcdoc_element_t operate_element(purc_document_t doc,
     UNUSED_PARAM(self_close);
 
     if (op == PCDOC_OP_ERASE) {
+        if (doc->elem_index)
+            unindex_subtree(doc->elem_index, pcdom_interface_node(elem));
+        serial_cache_update(doc, pcdom_interface_node(elem), op);
         dom_erase_element(pcdom_interface_element(elem));
         return NULL;
     }
     else if (op == PCDOC_OP_CLEAR) {
+        if (doc->elem_index)
+            unindex_children(doc->elem_index, pcdom_interface_node(elem));
+        serial_cache_update(doc, pcdom_interface_node(elem), op);
         dom_clear_element(pcdom_interface_element(elem));
         return elem;
     }
@@ -171,12 +967,17 @@ static pcdoc_element_t operate_element(purc_document_t doc,
         return NULL;
     }
 
+    /* the new element has no identifier and class yet */
+    if (op == PCDOC_OP_DISPLACE && doc->elem_index)
+        unindex_children(doc->elem_index, pcdom_interface_node(elem));
+
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
     pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
     pcdom_element_t *new_elem;
     new_elem = pcdom_document_create_element(dom_doc,
             (const unsigned char*)tag, strlen(tag), NULL);
     if (new_elem) {
+        serial_cache_update(doc, pcdom_interface_node(dom_elem), op);
         dom_node_ops[op](dom_elem, pcdom_interface_node(new_elem));
     }
     else {
@@ -200,9 +1001,13 @@ static pcdoc_text_node_t new_text_content(purc_document_t doc,
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
     pcdom_text_t *text_node;
 
+    if (op == PCDOC_OP_DISPLACE && doc->elem_index)
+        unindex_children(doc->elem_index, pcdom_interface_node(elem));
+
     text_node = pcdom_document_create_text_node(dom_doc,
             (const unsigned char *)text, length ? length : strlen(text));
     if (text_node) {
+        serial_cache_update(doc, pcdom_interface_node(dom_elem), op);
         dom_node_ops[op](dom_elem, pcdom_interface_node(text_node));
     }
     else {
@@ -246,6 +1051,300 @@ failed:
     return root;
 }
 
+/*
+ * The cache of the parsed fragments. The markups inserted by templates are
+ * often identical; a markup seen the second time in the same context is
+ * kept with a copy of its subtree, which is cloned instead of parsing the
+ * markup again afterwards.
+ */
+
+/* the number of the entries in the fragment cache of a document */
+#define NR_FRAGMENT_CACHE_ENTRIES   32
+/* the longer fragments are not cached */
+#define MAX_CACHED_FRAGMENT_LEN     (64 * 1024)
+/* the number of the conflicting fragments a prebuilt subtree survives */
+#define MAX_FRAGMENT_CREDIT         4
+
+struct fragment_cache_entry {
+    char               *markup;
+    size_t              length;
+    uint32_t            hash;
+
+    /* the tag and the namespace of the context element */
+    uintptr_t           tag;
+    uintptr_t           ns;
+
+    /* the prebuilt subtree; NULL if the markup has been seen only once */
+    pcdom_node_t       *subtree;
+    unsigned            credit;
+};
+
+struct pcdoc_fragment_cache {
+    struct fragment_cache_entry entries[NR_FRAGMENT_CACHE_ENTRIES];
+};
+
+static uint32_t
+fragment_hash(pcdom_node_t *context, const char *markup, size_t length)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261U;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)markup[i];
+        h *= 16777619U;
+    }
+    h ^= (uint32_t)(context->local_name * 31 + context->ns);
+    return h;
+}
+
+static void
+clear_fragment_cache_entry(struct fragment_cache_entry *entry,
+        bool destroy_subtree)
+{
+    if (entry->markup) {
+        if (entry->subtree && destroy_subtree)
+            pcdom_node_destroy_deep(entry->subtree);
+        free(entry->markup);
+        memset(entry, 0, sizeof(*entry));
+    }
+}
+
+static void
+release_fragment_cache(purc_document_t doc)
+{
+    if (doc->fragment_cache == NULL)
+        return;
+
+    /* the subtrees go with the arena of the document */
+    for (size_t i = 0; i < NR_FRAGMENT_CACHE_ENTRIES; i++)
+        clear_fragment_cache_entry(doc->fragment_cache->entries + i, false);
+
+    free(doc->fragment_cache);
+    doc->fragment_cache = NULL;
+}
+
+/* only the subtrees of the elements, the text, and the comments which
+   carry no state other than their attributes are cloned */
+static pchtml_action_t
+check_cacheable(pcdom_node_t *node, void *ctx)
+{
+    bool *cacheable = ctx;
+
+    switch (node->type) {
+    case PCDOM_NODE_TYPE_ELEMENT:
+        if ((node->local_name == PCHTML_TAG_TEMPLATE &&
+                    node->ns == PCHTML_NS_HTML) ||
+                pcdom_interface_element(node)->is_value != NULL) {
+            *cacheable = false;
+            return PCHTML_ACTION_STOP;
+        }
+        break;
+
+    case PCDOM_NODE_TYPE_TEXT:
+    case PCDOM_NODE_TYPE_COMMENT:
+        break;
+
+    default:
+        *cacheable = false;
+        return PCHTML_ACTION_STOP;
+    }
+
+    return PCHTML_ACTION_OK;
+}
+
+static pcdom_attr_t *
+clone_attr(pcdom_document_t *dom_doc, pcdom_attr_t *attr)
+{
+    pcdom_attr_t *copy = pcdom_attr_interface_create(dom_doc);
+    if (copy == NULL)
+        return NULL;
+
+    copy->node.local_name = attr->node.local_name;
+    copy->node.prefix = attr->node.prefix;
+    copy->node.ns = attr->node.ns;
+    copy->upper_name = attr->upper_name;
+    copy->qualified_name = attr->qualified_name;
+
+    if (attr->value && pcdom_attr_set_value(copy, attr->value->data,
+                attr->value->length) != PURC_ERROR_OK) {
+        pcdom_attr_interface_destroy(copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+static pcdom_node_t *
+clone_node(pcdom_document_t *dom_doc, pcdom_node_t *node)
+{
+    pcdom_character_data_t *char_data;
+    pcdom_node_t *copy;
+
+    switch (node->type) {
+    case PCDOM_NODE_TYPE_ELEMENT: {
+        copy = pcdom_document_create_interface(dom_doc, node->local_name,
+                node->ns);
+        if (copy == NULL)
+            return NULL;
+
+        pcdom_element_t *from = pcdom_interface_element(node);
+        pcdom_element_t *to = pcdom_interface_element(copy);
+        copy->prefix = node->prefix;
+        to->upper_name = from->upper_name;
+        to->qualified_name = from->qualified_name;
+
+        for (pcdom_attr_t *attr = from->first_attr; attr; attr = attr->next) {
+            pcdom_attr_t *attr_copy = clone_attr(dom_doc, attr);
+            if (attr_copy == NULL) {
+                pcdom_node_destroy(copy);
+                return NULL;
+            }
+
+            attr_copy->owner = to;
+            pcdom_element_attr_append(to, attr_copy);
+        }
+        break;
+    }
+
+    case PCDOM_NODE_TYPE_TEXT:
+        char_data = pcdom_interface_character_data(node);
+        copy = pcdom_interface_node(pcdom_document_create_text_node(dom_doc,
+                    char_data->data.data, char_data->data.length));
+        break;
+
+    case PCDOM_NODE_TYPE_COMMENT:
+        char_data = pcdom_interface_character_data(node);
+        copy = pcdom_interface_node(pcdom_document_create_comment(dom_doc,
+                    char_data->data.data, char_data->data.length));
+        break;
+
+    default:
+        copy = NULL;
+        break;
+    }
+
+    return copy;
+}
+
+static pcdom_node_t *
+clone_subtree(pcdom_document_t *dom_doc, pcdom_node_t *root)
+{
+    pcdom_node_t *root_copy = clone_node(dom_doc, root);
+    if (root_copy == NULL)
+        return NULL;
+
+    /* `copy` is the copy of `node` */
+    pcdom_node_t *node = root;
+    pcdom_node_t *copy = root_copy;
+    while (true) {
+        if (node->first_child) {
+            node = node->first_child;
+        }
+        else {
+            while (node != root && node->next == NULL) {
+                node = node->parent;
+                copy = copy->parent;
+            }
+
+            if (node == root)
+                break;
+
+            node = node->next;
+            copy = copy->parent;
+        }
+
+        pcdom_node_t *child = clone_node(dom_doc, node);
+        if (child == NULL) {
+            pcdom_node_destroy_deep(root_copy);
+            return NULL;
+        }
+
+        pcdom_node_append_child(copy, child);
+        copy = child;
+    }
+
+    return root_copy;
+}
+
+static pcdom_node_t *
+parse_fragment(purc_document_t doc, pcdom_element_t *parent,
+        const char *fragment, size_t length)
+{
+    pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
+    pcdom_node_t *context = pcdom_interface_node(parent);
+
+    if (length > MAX_CACHED_FRAGMENT_LEN)
+        return dom_parse_fragment(dom_doc, parent, fragment, length);
+
+    if (doc->fragment_cache == NULL) {
+        doc->fragment_cache = calloc(1, sizeof(*doc->fragment_cache));
+        if (doc->fragment_cache == NULL)
+            return dom_parse_fragment(dom_doc, parent, fragment, length);
+    }
+
+    struct pcinst *inst = pcinst_current();
+    struct purc_fragment_cache_stats dummy;
+    struct purc_fragment_cache_stats *stats =
+        inst ? &inst->fragment_cache_stats : &dummy;
+
+    uint32_t hash = fragment_hash(context, fragment, length);
+    struct fragment_cache_entry *entry;
+    entry = doc->fragment_cache->entries + (hash % NR_FRAGMENT_CACHE_ENTRIES);
+
+    bool same = entry->markup && entry->hash == hash &&
+        entry->length == length && entry->tag == context->local_name &&
+        entry->ns == context->ns && memcmp(entry->markup, fragment, length) == 0;
+
+    pcdom_node_t *subtree;
+    if (same && entry->subtree) {
+        subtree = clone_subtree(dom_doc, entry->subtree);
+        if (subtree) {
+            if (entry->credit < MAX_FRAGMENT_CREDIT)
+                entry->credit++;
+            stats->nr_hits++;
+            return subtree;
+        }
+    }
+
+    stats->nr_misses++;
+    subtree = dom_parse_fragment(dom_doc, parent, fragment, length);
+    if (subtree == NULL)
+        return NULL;
+
+    if (same) {
+        if (entry->subtree == NULL) {
+            bool cacheable = true;
+            pcdom_node_simple_walk(subtree, check_cacheable, &cacheable);
+            if (cacheable) {
+                entry->subtree = clone_subtree(dom_doc, subtree);
+                if (entry->subtree) {
+                    entry->credit = 1;
+                    stats->nr_stored++;
+                }
+            }
+        }
+    }
+    else if (entry->subtree && entry->credit > 0) {
+        entry->credit--;
+    }
+    else {
+        char *markup = malloc(length);
+        if (markup) {
+            if (entry->subtree)
+                stats->nr_evictions++;
+            clear_fragment_cache_entry(entry, true);
+
+            memcpy(markup, fragment, length);
+            entry->markup = markup;
+            entry->length = length;
+            entry->hash = hash;
+            entry->tag = context->local_name;
+            entry->ns = context->ns;
+        }
+    }
+
+    return subtree;
+}
+
 static void
 dom_append_subtree_to_element(pcdom_element_t *element,
         pcdom_node_t *subtree)
@@ -379,12 +1478,24 @@ static pcdoc_node new_content(purc_document_t doc,
         goto done;
     }
 
-    pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
-    pcdom_node_t *subtree = dom_parse_fragment(dom_doc, dom_elem,
+    pcdom_node_t *subtree = parse_fragment(doc, dom_elem,
             content, length ? length : strlen(content));
 
     if (subtree) {
+        if (doc->elem_index) {
+            if (op == PCDOC_OP_DISPLACE)
+                unindex_children(doc->elem_index,
+                        pcdom_interface_node(dom_elem));
+
+            /* index the new elements, which are the children of the
+               wrapping `div` element */
+            if (subtree->first_child &&
+                    index_children(doc->elem_index, subtree->first_child))
+                elem_index_drop(doc);
+        }
+
+        serial_cache_update(doc, pcdom_interface_node(dom_elem), op);
         dom_subtree_ops[op](dom_elem, subtree);
     }
     else {
@@ -425,24 +1536,33 @@ static int set_attribute(purc_document_t doc,
             pcdoc_element_t elem, pcdoc_operation op,
             const char *name, const char *val, size_t len)
 {
-    UNUSED_PARAM(doc);
-
+    int retv = -1;
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
+
+    bool indexed = doc->elem_index && (strcasecmp(name, "id") == 0 ||
+            strcasecmp(name, "class") == 0);
+    if (indexed)
+        unindex_element(doc->elem_index, dom_elem);
+    serial_cache_invalidate(doc, pcdom_interface_node(dom_elem));
+
     if (op == PCDOC_OP_ERASE) {
-        return dom_remove_element_attr(dom_elem, name);
+        retv = dom_remove_element_attr(dom_elem, name);
     }
     else if (op == PCDOC_OP_CLEAR) {
-        return dom_set_element_attribute(dom_elem, name, "", 0);
+        retv = dom_set_element_attribute(dom_elem, name, "", 0);
     }
     else if (op == PCDOC_OP_DISPLACE) {
-        return dom_set_element_attribute(dom_elem, name,
+        retv = dom_set_element_attribute(dom_elem, name,
                 val, len ? len : strlen(val));
     }
     else {
         purc_set_error(PURC_ERROR_INVALID_VALUE);
     }
 
-    return -1;
+    if (indexed && index_element(doc->elem_index, dom_elem))
+        elem_index_drop(doc);
+
+    return retv;
 }
 
 static pcdoc_element_t special_elem(purc_document_t doc,
@@ -657,17 +1777,326 @@ travel(purc_document_t doc, pcdoc_element_t ancestor,
 static int serialize(purc_document_t doc, pcdoc_node node,
             unsigned opts, purc_rwstream_t stm)
 {
+    pcdom_node_t *dom_node;
     if (node.type == PCDOC_NODE_OTHERS)
-        return pchtml_doc_write_to_stream_ex(doc->impl, opts, stm);
+        dom_node = pcdom_interface_node(doc->impl);
+    else
+        dom_node = pcdom_interface_node(node.elem);
+
+    return serialize_cached(doc, dom_node, opts, stm);
+}
+
+static bool
+is_in_scope(pcdom_node_t *node, pcdom_node_t *scope)
+{
+    while (node) {
+        if (node == scope)
+            return true;
+        node = node->parent;
+    }
+
+    return false;
+}
+
+static unsigned
+node_depth(pcdom_node_t *node)
+{
+    unsigned depth = 0;
+    while ((node = node->parent))
+        depth++;
+    return depth;
+}
+
+/* compare the positions of two nodes in the same tree in document order */
+static int
+compare_position(pcdom_node_t *a, pcdom_node_t *b)
+{
+    unsigned depth_a = node_depth(a), depth_b = node_depth(b);
+
+    while (depth_a > depth_b) {
+        a = a->parent;
+        depth_a--;
+        if (a == b)
+            return 1;
+    }
+    while (depth_b > depth_a) {
+        b = b->parent;
+        depth_b--;
+        if (b == a)
+            return -1;
+    }
+
+    if (a == b)
+        return 0;
+
+    while (a->parent != b->parent) {
+        a = a->parent;
+        b = b->parent;
+    }
+
+    for (pcdom_node_t *sibling = a->next; sibling; sibling = sibling->next) {
+        if (sibling == b)
+            return -1;
+    }
+
+    return 1;
+}
+
+/*
+ * Parse a selector supported by the index: `#<id>` or `.<class>`.
+ * Returns the key or NULL if the selector is not such one.
+ */
+static const char *
+parse_simple_selector(const char *selector, bool *by_id, size_t *len)
+{
+    if (selector[0] != '#' && selector[0] != '.')
+        return NULL;
+
+    const char *key = selector + 1;
+    size_t n = strcspn(key, " \t\n\f\r#.[]:>+~,*()\\");
+    if (n == 0 || key[n] != '\0')
+        return NULL;
+
+    *by_id = (selector[0] == '#');
+    *len = n;
+    return key;
+}
+
+static bool
+match_element(pcdom_element_t *elem, bool by_id, const char *key, size_t len)
+{
+    size_t sz;
+
+    if (by_id) {
+        const char *id = element_id(elem, &sz);
+        return id && sz == len && memcmp(id, key, len) == 0;
+    }
+
+    const char *klass;
+    if (elem->attr_class == NULL ||
+            (klass = (const char *)pcdom_attr_value(elem->attr_class,
+                &sz)) == NULL)
+        return false;
+
+    const char *end = klass + sz;
+    while (klass < end) {
+        while (klass < end && is_class_separator(*klass))
+            klass++;
+
+        const char *token = klass;
+        while (klass < end && !is_class_separator(*klass))
+            klass++;
+
+        if ((size_t)(klass - token) == len && memcmp(token, key, len) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static pcdoc_element_t
+select_by_compiled(struct pcutils_arrlist *coll, pcdom_node_t *scope,
+        const char *selector, int *retv)
+{
+    struct pcdoc_selector *sel = pcdoc_selector_get(selector);
+    if (sel == NULL)
+        return NULL;
+
+    pcdoc_element_t found = NULL;
+    if (coll) {
+        *retv = pcdoc_selector_select(sel, scope, coll, 0);
+        if (*retv == 0 && pcutils_arrlist_length(coll) > 0)
+            found = pcutils_arrlist_get_idx(coll, 0);
+    }
+    else {
+        struct pcutils_arrlist *first = pcutils_arrlist_new_ex(NULL, 1);
+        if (first) {
+            *retv = pcdoc_selector_select(sel, scope, first, 1);
+            if (*retv == 0 && pcutils_arrlist_length(first) > 0)
+                found = pcutils_arrlist_get_idx(first, 0);
+            pcutils_arrlist_free(first);
+        }
+        else {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        }
+    }
+
+    pcdoc_selector_release(sel);
+    return found;
+}
+
+/*
+ * Select the elements matching the selector in the scope (including the
+ * scope itself) in document order. If `coll` is NULL, returns the first one
+ * only. The plain `#id` and `.class` selectors are served by the index;
+ * others by the compiled selectors.
+ */
+static pcdoc_element_t
+select_elements(purc_document_t doc, struct pcutils_arrlist *coll,
+        pcdom_node_t *scope, const char *selector, int *retv)
+{
+    bool by_id;
+    size_t len;
+    const char *key = parse_simple_selector(selector, &by_id, &len);
+
+    *retv = -1;
+    if (key == NULL)
+        return select_by_compiled(coll, scope, selector, retv);
+
+    if (doc->elem_index == NULL)
+        doc->elem_index = elem_index_build(doc);
+
+    pcdom_node_t *found = NULL;
+    if (doc->elem_index == NULL) {
+        /* no index available; travel the scope */
+        pcdom_node_t *node = scope;
+        if (node->type != PCDOM_NODE_TYPE_ELEMENT)
+            node = next_element(node, scope);
+
+        for (; node; node = next_element(node, scope)) {
+            if (!match_element(pcdom_interface_element(node),
+                        by_id, key, len))
+                continue;
+
+            if (found == NULL)
+                found = node;
+            if (coll == NULL)
+                break;
+            if (pcutils_arrlist_append(coll, node))
+                goto failed;
+        }
+
+        *retv = 0;
+        return (pcdoc_element_t)found;
+    }
+
+    struct index_entry *entry = index_lookup(by_id ? doc->elem_index->ids :
+            doc->elem_index->classes, key, len);
+    size_t nr_elems = entry ? pcutils_arrlist_length(entry->elems) : 0;
+    size_t nr_found = 0;
+
+    for (size_t i = 0; i < nr_elems; i++) {
+        pcdom_node_t *node = pcutils_arrlist_get_idx(entry->elems, i);
+        if (!is_in_scope(node, scope))
+            continue;
+
+        nr_found++;
+        if (coll == NULL) {
+            if (found == NULL || compare_position(node, found) < 0)
+                found = node;
+        }
+        else if (nr_found <= MAX_ELEMS_TO_SORT) {
+            if (pcutils_arrlist_append(coll, node))
+                goto failed;
+            found = node;
+        }
+        else {
+            node->flags |= ELEM_FLAG_SELECTED;
+        }
+    }
+
+    if (coll == NULL || nr_found == 0) {
+        *retv = 0;
+        return (pcdoc_element_t)found;
+    }
+
+    if (nr_found <= MAX_ELEMS_TO_SORT) {
+        /* insertion sort in document order */
+        for (size_t i = 1; i < nr_found; i++) {
+            pcdom_node_t *node = pcutils_arrlist_get_idx(coll, i);
+            size_t j = i;
+            while (j > 0 && compare_position(node,
+                        pcutils_arrlist_get_idx(coll, j - 1)) < 0) {
+                pcutils_arrlist_put_idx(coll, j,
+                        pcutils_arrlist_get_idx(coll, j - 1));
+                j--;
+            }
+            pcutils_arrlist_put_idx(coll, j, node);
+        }
+    }
     else {
-        pcdom_node_t *dom_node = pcdom_interface_node(node.elem);
-        return pcdom_node_write_to_stream_ex(dom_node, opts, stm);
+        /* too many to sort; mark all and collect them by traveling */
+        for (size_t i = 0; i < MAX_ELEMS_TO_SORT; i++) {
+            pcdom_node_t *node = pcutils_arrlist_get_idx(coll, i);
+            node->flags |= ELEM_FLAG_SELECTED;
+        }
+        pcutils_arrlist_del_idx(coll, 0, MAX_ELEMS_TO_SORT);
+
+        int failed = 0;
+        pcdom_node_t *node = scope;
+        if (node->type != PCDOM_NODE_TYPE_ELEMENT)
+            node = next_element(node, scope);
+
+        for (; node; node = next_element(node, scope)) {
+            if (node->flags & ELEM_FLAG_SELECTED) {
+                node->flags &= ~ELEM_FLAG_SELECTED;
+                if (!failed)
+                    failed = pcutils_arrlist_append(coll, node);
+            }
+        }
+
+        if (failed)
+            goto failed;
+    }
+
+    *retv = 0;
+    return pcutils_arrlist_get_idx(coll, 0);
+
+failed:
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return NULL;
+}
+
+static pcdoc_element_t
+find_elem(purc_document_t doc, pcdoc_element_t scope, const char *selector)
+{
+    int retv;
+    return select_elements(doc, NULL, pcdom_interface_node(scope),
+            selector, &retv);
+}
+
+static int
+elem_coll_select(purc_document_t doc,
+        pcdoc_elem_coll_t coll, pcdoc_element_t scope, const char *selector)
+{
+    int retv;
+    select_elements(doc, coll->elems, pcdom_interface_node(scope),
+            selector, &retv);
+    return retv;
+}
+
+static int
+elem_coll_filter(purc_document_t doc, pcdoc_elem_coll_t dst_coll,
+        pcdoc_elem_coll_t src_coll, const char *selector)
+{
+    UNUSED_PARAM(doc);
+
+    struct pcdoc_selector *sel = pcdoc_selector_get(selector);
+    if (sel == NULL)
+        return -1;
+
+    int retv = 0;
+    size_t n = pcutils_arrlist_length(src_coll->elems);
+    for (size_t i = 0; i < n; i++) {
+        pcdom_element_t *elem = pcutils_arrlist_get_idx(src_coll->elems, i);
+        if (pcdoc_selector_match(sel, elem) &&
+                pcutils_arrlist_append(dst_coll->elems, elem)) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            retv = -1;
+            break;
+        }
     }
+
+    pcdoc_selector_release(sel);
+    return retv;
 }
 
 struct purc_document_ops _pcdoc_html_ops = {
     .create = create,
     .destroy = destroy,
+    .load_begin = load_begin,
+    .load_chunk = load_chunk,
+    .load_end = load_end,
     .operate_element = operate_element,
     .new_text_content = new_text_content,
     .new_data_content = NULL,
@@ -683,7 +2112,8 @@ struct purc_document_ops _pcdoc_html_ops = {
     .get_data = NULL,
     .travel = travel,
     .serialize = serialize,
-    .elem_coll_select = NULL,
-    .elem_coll_filter = NULL,
+    .find_elem = find_elem,
+    .elem_coll_select = elem_coll_select,
+    .elem_coll_filter = elem_coll_filter,
 };
 
@@ -214,6 +214,35 @@ pcdom_document_destroy(pcdom_document_t *document)
     return pcutils_free(document);
 }
 
+static pchtml_action_t
+count_node(pcdom_node_t *node, void *ctx)
+{
+    struct pcdom_document_stats *stats = ctx;
+
+    stats->nr_nodes++;
+    if (node->type == PCDOM_NODE_TYPE_ELEMENT) {
+        pcdom_attr_t *attr = pcdom_interface_element(node)->first_attr;
+        while (attr) {
+            stats->nr_attrs++;
+            attr = attr->next;
+        }
+    }
+
+    return PCHTML_ACTION_OK;
+}
+
+void
+pcdom_document_get_stats(pcdom_document_t *document,
+        struct pcdom_document_stats *stats)
+{
+    stats->nr_nodes = 0;
+    stats->nr_attrs = 0;
+    pcdom_node_simple_walk(pcdom_interface_node(document), count_node, stats);
+
+    pcutils_mraw_get_stats(document->mraw, &stats->nodes);
+    pcutils_mraw_get_stats(document->text, &stats->text);
+}
+
 void
 pcdom_document_attach_doctype(pcdom_document_t *document,
                                 pcdom_document_type_t *doctype)
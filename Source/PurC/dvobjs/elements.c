@@ -486,53 +486,13 @@ add_element(struct pcdvobjs_elements *elements, pcdoc_element_t elem)
     return true;
 }
 
-struct visit_args {
-    struct pcdvobjs_elements *elements;
-    const char               *css;
-};
-
-static bool
-match_by_class(purc_document_t doc, pcdoc_element_t element,
-        struct visit_args *args)
-{
-    bool found = false;
-    pcdoc_element_has_class(doc, element, args->css + 1, &found);
-    return found;
-}
-
-static bool
-match_by_id(purc_document_t doc, pcdoc_element_t element,
-        struct visit_args *args)
-{
-    const char *s;
-    size_t len;
-    s = pcdoc_element_id(doc, element, &len);
-
-    if (s && s[len]=='\0' &&
-            strncmp(s, args->css + 1, len)==0 &&
-            args->css[1+len]=='\0')
-    {
-        return true;
-    }
-
-    return false;
-}
-
 static int
 visit_element(purc_document_t doc, pcdoc_element_t element, void *ud)
 {
-    struct visit_args *args = (struct visit_args*)ud;
+    UNUSED_PARAM(doc);
 
-    if (args->css[0] == '.') {
-        if (!match_by_class(doc, element, args))
-            return 0;
-    }
-    else if (args->css[0] == '#') {
-        if (!match_by_id(doc, element, args))
-            return 0;
-    }
-
-    if (!add_element(args->elements, element))
+    struct pcdvobjs_elements *elements = (struct pcdvobjs_elements*)ud;
+    if (!add_element(elements, element))
         return -1;
 
     return 0;
@@ -542,18 +502,17 @@ purc_variant_t
 pcdvobjs_query_elements(purc_document_t doc, pcdoc_element_t root,
         const char *css)
 {
-    if (strcmp(css, "*") != 0) {
-        if (css[0] != '.' && css[0] != '#') {
-            pcinst_set_error(PURC_ERROR_ARGUMENT_MISSED);
-            return PURC_VARIANT_INVALID;
-        }
-        if (css[1] == '\0') {
-            pcinst_set_error(PURC_ERROR_ARGUMENT_MISSED);
-            return PURC_VARIANT_INVALID;
-        }
+    if (css[0] == '\0') {
+        pcinst_set_error(PURC_ERROR_ARGUMENT_MISSED);
+        return PURC_VARIANT_INVALID;
     }
 
-    purc_variant_t elements = make_elements();
+    /* the result is shared by the queries until the document changes */
+    purc_variant_t elements = pcdoc_query_cache_get(doc, root, css);
+    if (elements != PURC_VARIANT_INVALID)
+        return elements;
+
+    elements = make_elements();
     if (elements == PURC_VARIANT_INVALID)
         return PURC_VARIANT_INVALID;
 
@@ -570,17 +529,37 @@ pcdvobjs_query_elements(purc_document_t doc, pcdoc_element_t root,
         return PURC_VARIANT_INVALID;
     }
 
-    struct visit_args args;
-    args.elements = (struct pcdvobjs_elements*)entity;
-    args.css      = css;
+    if (strcmp(css, "*") != 0) {
+        /* the document selects the elements with its index or the
+           compiled selector */
+        pcdoc_elem_coll_t coll;
+        coll = pcdoc_elem_coll_new_from_descendants(doc, root, css);
+        if (coll == NULL) {
+            purc_variant_unref(elements);
+            return PURC_VARIANT_INVALID;
+        }
+
+        size_t n = pcutils_arrlist_length(coll->elems);
+        for (size_t i = 0; i < n; i++) {
+            if (!add_element(elems, pcutils_arrlist_get_idx(coll->elems, i))) {
+                pcdoc_elem_coll_delete(doc, coll);
+                purc_variant_unref(elements);
+                return PURC_VARIANT_INVALID;
+            }
+        }
 
-    int r = pcdoc_travel_descendant_elements(doc, root,
-            visit_element, &args, NULL);
-    if (r) {
-        purc_variant_unref(elements);
-        return PURC_VARIANT_INVALID;
+        pcdoc_elem_coll_delete(doc, coll);
+    }
+    else {
+        int r = pcdoc_travel_descendant_elements(doc, root,
+                visit_element, elems, NULL);
+        if (r) {
+            purc_variant_unref(elements);
+            return PURC_VARIANT_INVALID;
+        }
     }
 
+    pcdoc_query_cache_put(doc, root, css, elements);
     return elements;
 }
 
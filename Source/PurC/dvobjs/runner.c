@@ -165,6 +165,98 @@ uri_getter(purc_variant_t root,
     return purc_variant_make_string(inst->endpoint_name, false);
 }
 
+/* makes an object whose properties are the unsigned long integers */
+static purc_variant_t
+make_ulongint_object(const char *keys[], const uint64_t values[], size_t nr)
+{
+    purc_variant_t retv = purc_variant_make_object(0,
+            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+    if (retv == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t val = purc_variant_make_ulongint(values[i]);
+        if (val == PURC_VARIANT_INVALID)
+            goto failed;
+
+        bool ok = purc_variant_object_set_by_static_ckey(retv, keys[i], val);
+        purc_variant_unref(val);
+        if (!ok)
+            goto failed;
+    }
+
+    return retv;
+
+failed:
+    purc_variant_unref(retv);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+vdom_cache_getter(purc_variant_t root,
+        size_t nr_args, purc_variant_t *argv, bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(nr_args);
+    UNUSED_PARAM(argv);
+
+    struct purc_vdom_cache_stats stats;
+    if (!purc_get_vdom_cache_stats(&stats))
+        goto failed;
+
+    static const char *keys[] = {
+        "entries", "origSize", "size", "budget",
+        "hits", "misses", "evictions", "expirations",
+    };
+    uint64_t values[] = {
+        stats.nr_entries, stats.orig_size, stats.size, stats.budget,
+        stats.nr_hits, stats.nr_misses, stats.nr_evictions,
+        stats.nr_expirations,
+    };
+
+    purc_variant_t retv;
+    retv = make_ulongint_object(keys, values, PCA_TABLESIZE(keys));
+    if (retv != PURC_VARIANT_INVALID)
+        return retv;
+
+failed:
+    if (silently)
+        return purc_variant_make_boolean(false);
+
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+fragment_cache_getter(purc_variant_t root,
+        size_t nr_args, purc_variant_t *argv, bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(nr_args);
+    UNUSED_PARAM(argv);
+
+    struct purc_fragment_cache_stats stats;
+    if (!purc_get_fragment_cache_stats(&stats))
+        goto failed;
+
+    static const char *keys[] = {
+        "hits", "misses", "stored", "evictions",
+    };
+    uint64_t values[] = {
+        stats.nr_hits, stats.nr_misses, stats.nr_stored, stats.nr_evictions,
+    };
+
+    purc_variant_t retv;
+    retv = make_ulongint_object(keys, values, PCA_TABLESIZE(keys));
+    if (retv != PURC_VARIANT_INVALID)
+        return retv;
+
+failed:
+    if (silently)
+        return purc_variant_make_boolean(false);
+
+    return PURC_VARIANT_INVALID;
+}
+
 static purc_variant_t
 chan_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         bool silently)
@@ -259,6 +351,8 @@ purc_dvobj_runner_new(void)
         { "rid",    rid_getter,     NULL },
         { "uri",    uri_getter,     NULL },
         { "chan",   chan_getter,    chan_setter },
+        { "vdomCache", vdom_cache_getter, NULL },
+        { "fragmentCache", fragment_cache_getter, NULL },
     };
 
     retv = purc_dvobj_make_from_methods(method, PCA_TABLESIZE(method));
@@ -25,6 +25,7 @@
 #include "private/ejson.h"
 #include "private/errors.h"
 #include "private/instance.h"
+#include "private/vcm.h"
 
 #include "purc-utils.h"
 #include "purc-errors.h"
@@ -64,12 +65,27 @@ static int ejson_init_once (void)
     return 0;
 }
 
+static int ejson_init_instance(struct pcinst *curr_inst,
+        const purc_instance_extra_info* extra_info)
+{
+    UNUSED_PARAM(curr_inst);
+    UNUSED_PARAM(extra_info);
+    return 0;
+}
+
+static void ejson_cleanup_instance(struct pcinst *curr_inst)
+{
+    pcvcm_release_const_cache(curr_inst);
+    pcvcm_release_member_cache(curr_inst);
+}
+
 struct pcmodule _module_ejson = {
     .id              = PURC_HAVE_EJSON,
     .module_inited   = 0,
 
-    .init_once       = ejson_init_once,
-    .init_instance   = NULL,
+    .init_once          = ejson_init_once,
+    .init_instance      = ejson_init_instance,
+    .cleanup_instance   = ejson_cleanup_instance,
 };
 
 
@@ -37,17 +37,19 @@
 struct pcexec_exe_char_inst {
     struct purc_exec_inst       super;
 
-    struct exe_char_param      param;
+    struct exe_char_param     *param;
 
     wchar_t                   *result_set;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_char);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_char_inst *exe_char_inst)
 {
-    struct exe_char_param *param = &exe_char_inst->param;
-    exe_char_param_reset(param);
+    pcexecutor_release_rule(exe_char_inst->param);
+    exe_char_inst->param = NULL;
     pcexecutor_inst_reset(&exe_char_inst->super);
     PCEXE_FREE(exe_char_inst->result_set);
 }
@@ -78,20 +80,20 @@ parse_rule(struct pcexec_exe_char_inst *exe_char_inst,
 {
     purc_exec_inst_t inst = &exe_char_inst->super;
 
-    struct exe_char_param param = {0};
-    int r = exe_char_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_char_param *param;
+    param = pcexecutor_parse_rule(&exe_char_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_char_param_reset(&exe_char_inst->param);
+    pcexecutor_release_rule(exe_char_inst->param);
     exe_char_inst->param = param;
 
     return prepare_result_set(exe_char_inst);
@@ -118,7 +120,7 @@ check_curr(struct pcexec_exe_char_inst *exe_char_inst)
 {
     purc_exec_inst_t inst = &exe_char_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct char_rule *rule = &exe_char_inst->param.rule;
+    struct char_rule *rule = &exe_char_inst->param->rule;
 
     int curr = (int)it->curr;
 
@@ -185,7 +187,7 @@ fetch_begin(struct pcexec_exe_char_inst *exe_char_inst)
 {
     purc_exec_inst_t inst = &exe_char_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct char_rule *rule = &exe_char_inst->param.rule;
+    struct char_rule *rule = &exe_char_inst->param->rule;
     it->curr = rule->from;
     if (check_curr(exe_char_inst)) {
         return it;
@@ -198,7 +200,7 @@ fetch_next(struct pcexec_exe_char_inst *exe_char_inst)
 {
     purc_exec_inst_t inst = &exe_char_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct char_rule *rule = &exe_char_inst->param.rule;
+    struct char_rule *rule = &exe_char_inst->param->rule;
     if (isnan(rule->advance)) {
         it->curr += 1;
     } else {
@@ -248,11 +250,6 @@ exe_char_create(enum purc_exec_type type,
     inst->type        = type;
     inst->asc_desc    = asc_desc;
 
-    int debug_flex, debug_bison;
-    pcexecutor_get_debug(&debug_flex, &debug_bison);
-    exe_char_inst->param.debug_flex  = debug_flex;
-    exe_char_inst->param.debug_bison = debug_bison;
-
     enum purc_variant_type vt = purc_variant_get_type(input);
     if (vt == PURC_VARIANT_TYPE_STRING) {
         inst->input = input;
@@ -34,17 +34,19 @@
 struct pcexec_exe_div_inst {
     struct purc_exec_inst       super;
 
-    struct exe_div_param        param;
+    struct exe_div_param       *param;
 
     double                      curr;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_div);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_div_inst *exe_div_inst)
 {
-    struct exe_div_param *param = &exe_div_inst->param;
-    exe_div_param_reset(param);
+    pcexecutor_release_rule(exe_div_inst->param);
+    exe_div_inst->param = NULL;
     pcexecutor_inst_reset(&exe_div_inst->super);
 }
 
@@ -54,20 +56,20 @@ parse_rule(struct pcexec_exe_div_inst *exe_div_inst,
 {
     purc_exec_inst_t inst = &exe_div_inst->super;
 
-    struct exe_div_param param = {0};
-    int r = exe_div_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_div_param *param;
+    param = pcexecutor_parse_rule(&exe_div_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_div_param_reset(&exe_div_inst->param);
+    pcexecutor_release_rule(exe_div_inst->param);
     exe_div_inst->param = param;
 
     return true;
@@ -77,7 +79,7 @@ static inline bool
 check_curr(struct pcexec_exe_div_inst *exe_div_inst, const double curr)
 {
     purc_exec_inst_t inst = &exe_div_inst->super;
-    struct exe_div_param *param = &exe_div_inst->param;
+    struct exe_div_param *param = exe_div_inst->param;
     struct div_rule *rule = &param->rule;
     struct number_comparing_logical_expression *ncle = rule->ncle;
 
@@ -128,7 +130,7 @@ fetch_next(struct pcexec_exe_div_inst *exe_div_inst)
 {
     purc_exec_inst_t inst = &exe_div_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_div_param *param = &exe_div_inst->param;
+    struct exe_div_param *param = exe_div_inst->param;
     struct div_rule *rule = &param->rule;
     double curr = exe_div_inst->curr;
     if (!isnan(rule->nexp)) {
@@ -37,17 +37,19 @@
 struct pcexec_exe_filter_inst {
     struct purc_exec_inst       super;
 
-    struct exe_filter_param        param;
+    struct exe_filter_param       *param;
 
     purc_variant_t              result_set;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_filter);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_filter_inst *exe_filter_inst)
 {
-    struct exe_filter_param *param = &exe_filter_inst->param;
-    exe_filter_param_reset(param);
+    pcexecutor_release_rule(exe_filter_inst->param);
+    exe_filter_inst->param = NULL;
     pcexecutor_inst_reset(&exe_filter_inst->super);
     PCEXE_CLR_VAR(exe_filter_inst->result_set);
 }
@@ -197,20 +199,20 @@ parse_rule(struct pcexec_exe_filter_inst *exe_filter_inst,
 {
     purc_exec_inst_t inst = &exe_filter_inst->super;
 
-    struct exe_filter_param param = {0};
-    int r = exe_filter_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_filter_param *param;
+    param = pcexecutor_parse_rule(&exe_filter_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_filter_param_reset(&exe_filter_inst->param);
+    pcexecutor_release_rule(exe_filter_inst->param);
     exe_filter_inst->param = param;
 
     return prepare_result_set(exe_filter_inst);
@@ -242,7 +244,7 @@ check_item_with_object(struct pcexec_exe_filter_inst *exe_filter_inst,
 {
     purc_exec_inst_t inst = &exe_filter_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct filter_rule *rule = &exe_filter_inst->param.rule;
+    struct filter_rule *rule = &exe_filter_inst->param->rule;
 
     purc_variant_t v = purc_variant_array_get(item, 1);
     PC_ASSERT(v != PURC_VARIANT_INVALID);
@@ -288,7 +290,7 @@ check_item_with_array(struct pcexec_exe_filter_inst *exe_filter_inst,
 {
     purc_exec_inst_t inst = &exe_filter_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct filter_rule *rule = &exe_filter_inst->param.rule;
+    struct filter_rule *rule = &exe_filter_inst->param->rule;
 
     if (filter_rule_eval(rule, item, result)) {
         // TODO: exception
@@ -451,11 +453,6 @@ exe_filter_create(enum purc_exec_type type,
     inst->type        = type;
     inst->asc_desc    = asc_desc;
 
-    int debug_flex, debug_bison;
-    pcexecutor_get_debug(&debug_flex, &debug_bison);
-    exe_filter_inst->param.debug_flex  = debug_flex;
-    exe_filter_inst->param.debug_bison = debug_bison;
-
     enum purc_variant_type vt = purc_variant_get_type(input);
     if (vt == PURC_VARIANT_TYPE_OBJECT ||
         vt == PURC_VARIANT_TYPE_ARRAY ||
@@ -34,17 +34,19 @@
 struct pcexec_exe_formula_inst {
     struct purc_exec_inst       super;
 
-    struct exe_formula_param        param;
+    struct exe_formula_param       *param;
 
     purc_variant_t              curr;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_formula);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_formula_inst *exe_formula_inst)
 {
-    struct exe_formula_param *param = &exe_formula_inst->param;
-    exe_formula_param_reset(param);
+    pcexecutor_release_rule(exe_formula_inst->param);
+    exe_formula_inst->param = NULL;
     pcexecutor_inst_reset(&exe_formula_inst->super);
     PCEXE_CLR_VAR(exe_formula_inst->curr);
 }
@@ -55,20 +57,20 @@ parse_rule(struct pcexec_exe_formula_inst *exe_formula_inst,
 {
     purc_exec_inst_t inst = &exe_formula_inst->super;
 
-    struct exe_formula_param param = {0};
-    int r = exe_formula_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_formula_param *param;
+    param = pcexecutor_parse_rule(&exe_formula_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_formula_param_reset(&exe_formula_inst->param);
+    pcexecutor_release_rule(exe_formula_inst->param);
     exe_formula_inst->param = param;
 
     return true;
@@ -77,7 +79,7 @@ parse_rule(struct pcexec_exe_formula_inst *exe_formula_inst,
 static inline bool
 iterate(struct pcexec_exe_formula_inst *exe_formula_inst)
 {
-    struct exe_formula_param *param = &exe_formula_inst->param;
+    struct exe_formula_param *param = exe_formula_inst->param;
     struct formula_rule *rule = &param->rule;
     purc_variant_t curr = exe_formula_inst->curr;
     purc_variant_t k = purc_variant_make_string_static("X", false);
@@ -116,7 +118,7 @@ static inline bool
 check_curr(struct pcexec_exe_formula_inst *exe_formula_inst)
 {
     purc_exec_inst_t inst = &exe_formula_inst->super;
-    struct exe_formula_param *param = &exe_formula_inst->param;
+    struct exe_formula_param *param = exe_formula_inst->param;
     struct formula_rule *rule = &param->rule;
     struct number_comparing_logical_expression *ncle = rule->ncle;
     purc_variant_t curr = exe_formula_inst->curr;
@@ -37,17 +37,19 @@
 struct pcexec_exe_key_inst {
     struct purc_exec_inst       super;
 
-    struct exe_key_param        param;
+    struct exe_key_param       *param;
 
     purc_variant_t              result_set;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_key);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_key_inst *exe_key_inst)
 {
-    struct exe_key_param *param = &exe_key_inst->param;
-    exe_key_param_reset(param);
+    pcexecutor_release_rule(exe_key_inst->param);
+    exe_key_inst->param = NULL;
     pcexecutor_inst_reset(&exe_key_inst->super);
     PCEXE_CLR_VAR(exe_key_inst->result_set);
 }
@@ -102,20 +104,20 @@ parse_rule(struct pcexec_exe_key_inst *exe_key_inst,
 {
     purc_exec_inst_t inst = &exe_key_inst->super;
 
-    struct exe_key_param param = {0};
-    int r = exe_key_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_key_param *param;
+    param = pcexecutor_parse_rule(&exe_key_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_key_param_reset(&exe_key_inst->param);
+    pcexecutor_release_rule(exe_key_inst->param);
     exe_key_inst->param = param;
 
     return prepare_result_set(exe_key_inst);
@@ -139,7 +141,7 @@ check_curr(struct pcexec_exe_key_inst *exe_key_inst)
 {
     purc_exec_inst_t inst = &exe_key_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct key_rule *rule = &exe_key_inst->param.rule;
+    struct key_rule *rule = &exe_key_inst->param->rule;
 
     int curr = (int)it->curr;
 
@@ -266,11 +268,6 @@ exe_key_create(enum purc_exec_type type,
     inst->type        = type;
     inst->asc_desc    = asc_desc;
 
-    int debug_flex, debug_bison;
-    pcexecutor_get_debug(&debug_flex, &debug_bison);
-    exe_key_inst->param.debug_flex  = debug_flex;
-    exe_key_inst->param.debug_bison = debug_bison;
-
     enum purc_variant_type vt = purc_variant_get_type(input);
     if (vt == PURC_VARIANT_TYPE_OBJECT) {
         inst->input = input;
@@ -35,17 +35,19 @@
 struct pcexec_exe_objformula_inst {
     struct purc_exec_inst       super;
 
-    struct exe_objformula_param        param;
+    struct exe_objformula_param       *param;
 
     purc_variant_t               curr;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_objformula);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_objformula_inst *exe_objformula_inst)
 {
-    struct exe_objformula_param *param = &exe_objformula_inst->param;
-    exe_objformula_param_reset(param);
+    pcexecutor_release_rule(exe_objformula_inst->param);
+    exe_objformula_inst->param = NULL;
     pcexecutor_inst_reset(&exe_objformula_inst->super);
     PCEXE_CLR_VAR(exe_objformula_inst->curr);
 }
@@ -56,24 +58,23 @@ parse_rule(struct pcexec_exe_objformula_inst *exe_objformula_inst,
 {
     purc_exec_inst_t inst = &exe_objformula_inst->super;
 
-    struct exe_objformula_param param = {0};
-    int r = exe_objformula_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_objformula_param *param;
+    param = pcexecutor_parse_rule(&exe_objformula_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_objformula_param_reset(&exe_objformula_inst->param);
+    pcexecutor_release_rule(exe_objformula_inst->param);
     exe_objformula_inst->param = param;
 
-    PC_ASSERT(param.rule.vncle);
-    PC_ASSERT(exe_objformula_inst->param.rule.vncle);
+    PC_ASSERT(param->rule.vncle);
 
     return true;
 }
@@ -81,7 +82,7 @@ parse_rule(struct pcexec_exe_objformula_inst *exe_objformula_inst,
 static inline bool
 iterate(struct pcexec_exe_objformula_inst *exe_objformula_inst)
 {
-    struct exe_objformula_param *param = &exe_objformula_inst->param;
+    struct exe_objformula_param *param = exe_objformula_inst->param;
     struct objformula_rule *rule = &param->rule;
     purc_variant_t curr = exe_objformula_inst->curr;
 
@@ -122,7 +123,7 @@ static inline bool
 check_curr(struct pcexec_exe_objformula_inst *exe_objformula_inst)
 {
     purc_exec_inst_t inst = &exe_objformula_inst->super;
-    struct exe_objformula_param *param = &exe_objformula_inst->param;
+    struct exe_objformula_param *param = exe_objformula_inst->param;
     struct objformula_rule *rule = &param->rule;
     struct value_number_comparing_logical_expression *vncle = rule->vncle;
     purc_variant_t curr = exe_objformula_inst->curr;
@@ -260,11 +261,6 @@ exe_objformula_create(enum purc_exec_type type,
     inst->type        = type;
     inst->asc_desc    = asc_desc;
 
-    int debug_flex, debug_bison;
-    pcexecutor_get_debug(&debug_flex, &debug_bison);
-    exe_objformula_inst->param.debug_flex  = debug_flex;
-    exe_objformula_inst->param.debug_bison = debug_bison;
-
     enum purc_variant_type vt = purc_variant_get_type(input);
     if (vt == PURC_VARIANT_TYPE_OBJECT) {
         inst->input = input;
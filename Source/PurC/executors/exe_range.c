@@ -39,17 +39,19 @@
 struct pcexec_exe_range_inst {
     struct purc_exec_inst       super;
 
-    struct exe_range_param        param;
+    struct exe_range_param       *param;
 
     purc_variant_t              result_set;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_range);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_range_inst *exe_range_inst)
 {
-    struct exe_range_param *param = &exe_range_inst->param;
-    exe_range_param_reset(param);
+    pcexecutor_release_rule(exe_range_inst->param);
+    exe_range_inst->param = NULL;
     pcexecutor_inst_reset(&exe_range_inst->super);
     PCEXE_CLR_VAR(exe_range_inst->result_set);
 }
@@ -166,20 +168,20 @@ parse_rule(struct pcexec_exe_range_inst *exe_range_inst,
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
 
-    struct exe_range_param param = {0};
-    int r = exe_range_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_range_param *param;
+    param = pcexecutor_parse_rule(&exe_range_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_range_param_reset(&exe_range_inst->param);
+    pcexecutor_release_rule(exe_range_inst->param);
     exe_range_inst->param = param;
 
     return prepare_result_set(exe_range_inst);
@@ -190,7 +192,7 @@ check_curr(struct pcexec_exe_range_inst *exe_range_inst)
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_range_param *param = &exe_range_inst->param;
+    struct exe_range_param *param = exe_range_inst->param;
     struct range_rule *rule = &param->rule;
 
     int curr = (int)it->curr;
@@ -240,7 +242,7 @@ fetch_begin(struct pcexec_exe_range_inst *exe_range_inst)
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_range_param *param = &exe_range_inst->param;
+    struct exe_range_param *param = exe_range_inst->param;
     struct range_rule *rule = &param->rule;
     it->curr = rule->from;
     if (check_curr(exe_range_inst)) {
@@ -254,7 +256,7 @@ fetch_next(struct pcexec_exe_range_inst *exe_range_inst)
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_range_param *param = &exe_range_inst->param;
+    struct exe_range_param *param = exe_range_inst->param;
     struct range_rule *rule = &param->rule;
     int advance = 1;
     if (isfinite(rule->advance))
@@ -307,11 +309,6 @@ exe_range_create(enum purc_exec_type type,
     inst->type        = type;
     inst->asc_desc    = asc_desc;
 
-    int debug_flex, debug_bison;
-    pcexecutor_get_debug(&debug_flex, &debug_bison);
-    exe_range_inst->param.debug_flex  = debug_flex;
-    exe_range_inst->param.debug_bison = debug_bison;
-
     enum purc_variant_type vt = purc_variant_get_type(input);
     if (vt == PURC_VARIANT_TYPE_ARRAY ||
         vt == PURC_VARIANT_TYPE_SET)
@@ -34,17 +34,19 @@
 struct pcexec_exe_sub_inst {
     struct purc_exec_inst       super;
 
-    struct exe_sub_param        param;
+    struct exe_sub_param       *param;
 
     double                      curr;
 };
 
+PCEXE_DEFINE_RULE_PARSER(exe_sub);
+
 // clear internal data except `input`
 static inline void
 reset(struct pcexec_exe_sub_inst *exe_sub_inst)
 {
-    struct exe_sub_param *param = &exe_sub_inst->param;
-    exe_sub_param_reset(param);
+    pcexecutor_release_rule(exe_sub_inst->param);
+    exe_sub_inst->param = NULL;
     pcexecutor_inst_reset(&exe_sub_inst->super);
 }
 
@@ -54,20 +56,20 @@ parse_rule(struct pcexec_exe_sub_inst *exe_sub_inst,
 {
     purc_exec_inst_t inst = &exe_sub_inst->super;
 
-    struct exe_sub_param param = {0};
-    int r = exe_sub_parse(rule, strlen(rule), &param);
+    char *err_msg;
+    struct exe_sub_param *param;
+    param = pcexecutor_parse_rule(&exe_sub_rule_parser, rule, &err_msg);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    if (!param) {
+        inst->err_msg = err_msg;
         return false;
     }
 
-    exe_sub_param_reset(&exe_sub_inst->param);
+    pcexecutor_release_rule(exe_sub_inst->param);
     exe_sub_inst->param = param;
 
     return true;
@@ -77,7 +79,7 @@ static inline bool
 check_curr(struct pcexec_exe_sub_inst *exe_sub_inst, const double curr)
 {
     purc_exec_inst_t inst = &exe_sub_inst->super;
-    struct exe_sub_param *param = &exe_sub_inst->param;
+    struct exe_sub_param *param = exe_sub_inst->param;
     struct sub_rule *rule = &param->rule;
     struct number_comparing_logical_expression *ncle = rule->ncle;
 
@@ -128,7 +130,7 @@ fetch_next(struct pcexec_exe_sub_inst *exe_sub_inst)
 {
     purc_exec_inst_t inst = &exe_sub_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_sub_param *param = &exe_sub_inst->param;
+    struct exe_sub_param *param = exe_sub_inst->param;
     struct sub_rule *rule = &param->rule;
     double curr = exe_sub_inst->curr;
     if (!isnan(rule->nexp)) {
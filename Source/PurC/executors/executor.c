@@ -26,6 +26,7 @@
 #include "private/debug.h"
 #include "private/errors.h"
 #include "private/instance.h"
+#include "private/hashtable.h"
 #include "keywords.h"
 
 #include "purc-utils.h"
@@ -52,6 +53,20 @@
 
 #include <pthread.h>
 
+#define NR_MAX_PARSED_RULES     64
+
+struct parsed_rule {
+    struct list_head                    node;
+    const struct pcexec_rule_parser    *parser;
+    char                               *rule;
+    unsigned long                       hash;
+    unsigned int                        refc;
+};
+
+#define PARAM_OFFSET    ((sizeof(struct parsed_rule) + 15) & ~(size_t)15)
+#define PARAM_OF(pr)    ((void *)((char *)(pr) + PARAM_OFFSET))
+#define RULE_OF(param)  ((struct parsed_rule *)((char *)(param) - PARAM_OFFSET))
+
 static int comp_pcexec_key(const void *key1, const void *key2)
 {
     purc_atom_t la = (purc_atom_t)(uint64_t)key1;
@@ -179,16 +194,32 @@ static int _init_instance(struct pcinst *inst,
 
     inst->executor_heap->debug_flex = 0;
     inst->executor_heap->debug_bison = 0;
+    list_head_init(&inst->executor_heap->rules);
 
     PC_ASSERT(purc_get_last_error() == 0);
     return 0;
 }
 
+static void parsed_rule_unref(struct parsed_rule *pr)
+{
+    if (--pr->refc == 0) {
+        pr->parser->reset(PARAM_OF(pr));
+        free(pr->rule);
+        free(pr);
+    }
+}
+
 static void _cleanup_instance(struct pcinst *inst)
 {
     if (!inst->executor_heap)
         return;
 
+    struct parsed_rule *pr, *n;
+    list_for_each_entry_safe(pr, n, &inst->executor_heap->rules, node) {
+        list_del_init(&pr->node);
+        parsed_rule_unref(pr);
+    }
+
     free(inst->executor_heap);
     inst->executor_heap = NULL;
 }
@@ -387,6 +418,73 @@ pcexecutor_inst_reset(struct purc_exec_inst *inst)
     }
 }
 
+void *
+pcexecutor_parse_rule(const struct pcexec_rule_parser *parser,
+        const char *rule, char **err_msg)
+{
+    struct pcexecutor_heap *heap = pcinst_current()->executor_heap;
+    unsigned long hash = pchash_perllike_str_hash(rule);
+    struct parsed_rule *pr;
+
+    *err_msg = NULL;
+    list_for_each_entry(pr, &heap->rules, node) {
+        if (pr->parser == parser && pr->hash == hash &&
+                strcmp(pr->rule, rule) == 0) {
+            list_move(&pr->node, &heap->rules);
+            pr->refc++;
+            return PARAM_OF(pr);
+        }
+    }
+
+    pr = (struct parsed_rule *)calloc(1, PARAM_OFFSET + parser->sz_param);
+    if (!pr) {
+        pcinst_set_error(PCEXECUTOR_ERROR_OOM);
+        return NULL;
+    }
+
+    struct pcexec_param_head *head = PARAM_OF(pr);
+    head->debug_flex  = heap->debug_flex;
+    head->debug_bison = heap->debug_bison;
+
+    if (parser->parse(rule, strlen(rule), head)) {
+        *err_msg = head->err_msg;
+        head->err_msg = NULL;
+        parser->reset(head);
+        free(pr);
+        return NULL;
+    }
+
+    pr->parser = parser;
+    pr->hash = hash;
+    pr->refc = 1;
+    pr->rule = strdup(rule);
+    if (!pr->rule) {
+        // not cached
+        list_head_init(&pr->node);
+        return head;
+    }
+
+    // one reference is held by the cache
+    pr->refc++;
+    list_add(&pr->node, &heap->rules);
+    if (++heap->nr_rules > NR_MAX_PARSED_RULES) {
+        struct parsed_rule *lru;
+        lru = list_last_entry(&heap->rules, struct parsed_rule, node);
+        list_del_init(&lru->node);
+        heap->nr_rules--;
+        parsed_rule_unref(lru);
+    }
+
+    return head;
+}
+
+void
+pcexecutor_release_rule(void *param)
+{
+    if (param)
+        parsed_rule_unref(RULE_OF(param));
+}
+
 purc_atom_t
 pcexecutor_get_rule_name(const char *rule)
 {
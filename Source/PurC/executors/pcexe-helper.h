@@ -52,6 +52,20 @@
     }                                             \
 } while (0)
 
+// defines `<_name>_rule_parser' for pcexecutor_parse_rule()
+#define PCEXE_DEFINE_RULE_PARSER(_name)                                     \
+static int _name##_parse_rule(const char *rule, size_t len, void *param)    \
+{                                                                           \
+    return _name##_parse(rule, len, (struct _name##_param *)param);         \
+}                                                                           \
+static void _name##_reset_param(void *param)                                \
+{                                                                           \
+    _name##_param_reset((struct _name##_param *)param);                     \
+}                                                                           \
+static const struct pcexec_rule_parser _name##_rule_parser = {              \
+    sizeof(struct _name##_param), _name##_parse_rule, _name##_reset_param   \
+}
+
 PCA_EXTERN_C_BEGIN
 
 int pcexe_ucs2utf8(char *utf, const char *uni, size_t n);
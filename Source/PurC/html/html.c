@@ -36,6 +36,7 @@
 #include "private/utils.h"
 #include "private/atom-buckets.h"
 #include "private/html.h"
+#include "private/css-selector.h"
 
 static int html_init_once(void)
 {
@@ -43,12 +44,26 @@ static int html_init_once(void)
     return 0;
 }
 
+static int html_init_instance(struct pcinst *curr_inst,
+        const purc_instance_extra_info* extra_info)
+{
+    UNUSED_PARAM(curr_inst);
+    UNUSED_PARAM(extra_info);
+    return 0;
+}
+
+static void html_cleanup_instance(struct pcinst *curr_inst)
+{
+    pcdoc_release_selector_cache(curr_inst);
+}
+
 struct pcmodule _module_html = {
     .id              = PURC_HAVE_HTML,
     .module_inited   = 0,
 
-    .init_once       = html_init_once,
-    .init_instance   = NULL,
+    .init_once          = html_init_once,
+    .init_instance      = html_init_instance,
+    .cleanup_instance   = html_cleanup_instance,
 };
 
 /* VW NOTE: HTML module should work without instance
@@ -84,6 +84,26 @@ pchtml_html_interface_create(pchtml_html_document_t *document, pchtml_tag_id_t t
     return node;
 }
 
+static void
+destroy_attributes(pcdom_element_t *element)
+{
+    pcdom_attr_t *attr_next;
+    pcdom_attr_t *attr = element->first_attr;
+
+    while (attr != NULL) {
+        attr_next = attr->next;
+
+        pcdom_attr_interface_destroy(attr);
+
+        attr = attr_next;
+    }
+
+    element->first_attr = NULL;
+    element->last_attr = NULL;
+    element->attr_id = NULL;
+    element->attr_class = NULL;
+}
+
 pcdom_interface_t *
 pchtml_html_interface_destroy(pcdom_interface_t *intrfc)
 {
@@ -93,6 +113,12 @@ pchtml_html_interface_destroy(pcdom_interface_t *intrfc)
 
     pcdom_node_t *node = intrfc;
 
+    /* the destructors of most HTML elements free the element only,
+       so return the attributes to the arena here */
+    if (node->type == PCDOM_NODE_TYPE_ELEMENT) {
+        destroy_attributes(pcdom_interface_element(node));
+    }
+
     switch (node->type) {
         case PCDOM_NODE_TYPE_TEXT:
         case PCDOM_NODE_TYPE_COMMENT:
@@ -35,6 +35,7 @@
 #include "private/instance.h"
 #include "private/errors.h"
 #include "private/dom.h"
+#include "private/scan.h"
 
 #include "html/serialize.h"
 #include "html/tree.h"
@@ -67,6 +68,20 @@ typedef struct {
 }
 pchtml_html_serialize_ctx_t;
 
+/* the bytes to be escaped; the runs of other bytes are sent at once */
+static const struct pcutils_scan_set text_escaping_set = {
+    { 0x26, 0xC2, 0x3C, 0x3E }, 4, false
+};
+
+static const struct pcutils_scan_set attribute_escaping_set = {
+    { 0x26, 0xC2, 0x3C, 0x3E, 0x22, 0x27 }, 6, false
+};
+
+/* the line breaks are indented as well */
+static const struct pcutils_scan_set pretty_text_escaping_set = {
+    { 0x26, 0xC2, 0x3C, 0x3E, 0x22, 0x27, 0x0A, 0x0D }, 8, false
+};
+
 
 static unsigned int
 pchtml_html_serialize_str_callback(const unsigned char *data, size_t len, void *ctx);
@@ -125,7 +140,8 @@ pchtml_html_serialize_attribute_cb(pcdom_attr_t *attr, bool has_raw,
 static unsigned int
 pchtml_html_serialize_pretty_node_cb(pcdom_node_t *node,
                                   pchtml_html_serialize_opt_t opt, size_t deep,
-                                  pchtml_html_serialize_cb_f cb, void *ctx);
+                                  pchtml_html_serialize_cb_f cb, void *ctx,
+                                  const pchtml_html_serialize_cache_t *cache);
 
 static unsigned int
 pchtml_html_serialize_pretty_element_cb(pcdom_element_t *element,
@@ -580,6 +596,11 @@ pchtml_html_serialize_send_escaping_attribute_string(const unsigned char *data,
     const unsigned char *end = data + len;
 
     while (data != end) {
+        data = pcutils_scan_bytes(data, end, &attribute_escaping_set);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+0026 AMPERSAND (&) */
             case 0x26:
@@ -693,6 +714,11 @@ pchtml_html_serialize_send_escaping_string(const unsigned char *data, size_t len
     const unsigned char *end = data + len;
 
     while (data != end) {
+        data = pcutils_scan_bytes(data, end, &text_escaping_set);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+0026 AMPERSAND (&) */
             case 0x26:
@@ -978,7 +1004,8 @@ pchtml_html_serialize_pretty_deep_cb(pcdom_node_t *node,
     node = node->first_child;
 
     while (node != NULL) {
-        status = pchtml_html_serialize_pretty_node_cb(node, opt, indent, cb, ctx);
+        status = pchtml_html_serialize_pretty_node_cb(node, opt, indent, cb, ctx,
+                                                      NULL);
         if (status != PCHTML_STATUS_OK) {
             return status;
         }
@@ -1013,23 +1040,81 @@ pchtml_html_serialize_pretty_deep_str(pcdom_node_t *node,
                                              &ctx);
 }
 
+static unsigned int
+pchtml_html_serialize_pretty_closed_cb(pcdom_node_t *node,
+                                    pchtml_html_serialize_opt_t opt, size_t deep,
+                                    pchtml_html_serialize_cb_f cb, void *ctx,
+                                    const pchtml_html_serialize_cache_t *cache)
+{
+    unsigned int status;
+
+    if (node->type != PCDOM_NODE_TYPE_ELEMENT) {
+        return PCHTML_STATUS_OK;
+    }
+
+    if (pchtml_html_node_is_void(node) == false
+        && (opt & PCHTML_HTML_SERIALIZE_OPT_WITHOUT_CLOSING) == 0)
+    {
+        if ((opt & PCHTML_HTML_SERIALIZE_OPT_WITHOUT_TEXT_INDENT)==0) {
+            pchtml_html_serialize_send_indent(deep, ctx);
+        }
+
+        status = pchtml_html_serialize_element_closed_cb(pcdom_interface_element(node),
+                                                      cb, ctx);
+        if (status != PCHTML_STATUS_OK) {
+            PC_ASSERT(0);
+            return status;
+        }
+
+        if ((opt & PCHTML_HTML_SERIALIZE_OPT_SKIP_WS_NODES)==0) {
+            pchtml_html_serialize_send("\n", 1, ctx);
+        }
+    }
+
+    if (cache != NULL) {
+        cache->leave(node, deep, cache->ctxt);
+    }
+
+    return PCHTML_STATUS_OK;
+}
+
 static unsigned int
 pchtml_html_serialize_pretty_node_cb(pcdom_node_t *node,
                                   pchtml_html_serialize_opt_t opt, size_t deep,
-                                  pchtml_html_serialize_cb_f cb, void *ctx)
+                                  pchtml_html_serialize_cb_f cb, void *ctx,
+                                  const pchtml_html_serialize_cache_t *cache)
 {
-    bool skip_it;
+    bool skip_it, cached;
+    size_t len;
     unsigned int status;
+    const unsigned char *data;
     pcdom_node_t *root = node;
 
     while (node != NULL) {
-        status = pchtml_html_serialize_pretty_cb(node, opt, deep, cb, ctx);
-        if (status != PCHTML_STATUS_OK) {
-            PC_ASSERT(0);
-            return status;
+        /* the cached element was serialized with its subtree and the
+           closing tag */
+        cached = false;
+
+        if (cache != NULL && node->type == PCDOM_NODE_TYPE_ELEMENT) {
+            data = cache->get(node, deep, &len, cache->ctxt);
+            if (data != NULL) {
+                pchtml_html_serialize_send(data, len, ctx);
+                cached = true;
+            }
+            else {
+                cache->enter(node, deep, cache->ctxt);
+            }
+        }
+
+        if (cached == false) {
+            status = pchtml_html_serialize_pretty_cb(node, opt, deep, cb, ctx);
+            if (status != PCHTML_STATUS_OK) {
+                PC_ASSERT(0);
+                return status;
+            }
         }
 
-        if (pchtml_html_tree_node_is(node, PCHTML_TAG_TEMPLATE)) {
+        if (cached == false && pchtml_html_tree_node_is(node, PCHTML_TAG_TEMPLATE)) {
             pchtml_html_template_element_t *temp;
 
             temp = pchtml_html_interface_template(node);
@@ -1054,7 +1139,7 @@ pchtml_html_serialize_pretty_node_cb(pcdom_node_t *node,
             }
         }
 
-        skip_it = pchtml_html_node_is_void(node);
+        skip_it = cached || pchtml_html_node_is_void(node);
 
         if (skip_it == false && node->first_child != NULL) {
             deep++;
@@ -1064,50 +1149,26 @@ pchtml_html_serialize_pretty_node_cb(pcdom_node_t *node,
         else {
             while(node != root && node->next == NULL)
             {
-                if (node->type == PCDOM_NODE_TYPE_ELEMENT
-                    && pchtml_html_node_is_void(node) == false)
-                {
-                    if ((opt & PCHTML_HTML_SERIALIZE_OPT_WITHOUT_CLOSING) == 0) {
-                        if ((opt & PCHTML_HTML_SERIALIZE_OPT_WITHOUT_TEXT_INDENT)==0) {
-                            pchtml_html_serialize_send_indent(deep, ctx);
-                        }
-
-                        status = pchtml_html_serialize_element_closed_cb(pcdom_interface_element(node),
-                                                                      cb, ctx);
-                        if (status != PCHTML_STATUS_OK) {
-                            PC_ASSERT(0);
-                            return status;
-                        }
-
-                        if ((opt & PCHTML_HTML_SERIALIZE_OPT_SKIP_WS_NODES)==0) {
-                            pchtml_html_serialize_send("\n", 1, ctx);
-                        }
+                if (cached == false) {
+                    status = pchtml_html_serialize_pretty_closed_cb(node, opt,
+                                                        deep, cb, ctx, cache);
+                    if (status != PCHTML_STATUS_OK) {
+                        return status;
                     }
                 }
 
+                cached = false;
+
                 deep--;
 
                 node = node->parent;
             }
 
-            if (node->type == PCDOM_NODE_TYPE_ELEMENT
-                && pchtml_html_node_is_void(node) == false)
-            {
-                if ((opt & PCHTML_HTML_SERIALIZE_OPT_WITHOUT_CLOSING) == 0) {
-                    if ((opt & PCHTML_HTML_SERIALIZE_OPT_WITHOUT_TEXT_INDENT)==0) {
-                        pchtml_html_serialize_send_indent(deep, ctx);
-                    }
-
-                    status = pchtml_html_serialize_element_closed_cb(pcdom_interface_element(node),
-                                                                  cb, ctx);
-                    if (status != PCHTML_STATUS_OK) {
-                        PC_ASSERT(0);
-                        return status;
-                    }
-
-                    if ((opt & PCHTML_HTML_SERIALIZE_OPT_SKIP_WS_NODES)==0) {
-                        pchtml_html_serialize_send("\n", 1, ctx);
-                    }
+            if (cached == false) {
+                status = pchtml_html_serialize_pretty_closed_cb(node, opt,
+                                                    deep, cb, ctx, cache);
+                if (status != PCHTML_STATUS_OK) {
+                    return status;
                 }
             }
 
@@ -1429,6 +1490,16 @@ unsigned int
 pchtml_html_serialize_pretty_tree_cb(pcdom_node_t *node,
                                   pchtml_html_serialize_opt_t opt, size_t indent,
                                   pchtml_html_serialize_cb_f cb, void *ctx)
+{
+    return pchtml_html_serialize_pretty_tree_cached_cb(node, opt, indent,
+                                                    cb, ctx, NULL);
+}
+
+unsigned int
+pchtml_html_serialize_pretty_tree_cached_cb(pcdom_node_t *node,
+                                  pchtml_html_serialize_opt_t opt, size_t indent,
+                                  pchtml_html_serialize_cb_f cb, void *ctx,
+                                  const pchtml_html_serialize_cache_t *cache)
 {
     /* For a document we must serialize all children without document node. */
     if (node->local_name == PCHTML_TAG__DOCUMENT) {
@@ -1436,7 +1507,7 @@ pchtml_html_serialize_pretty_tree_cb(pcdom_node_t *node,
 
         while (node != NULL) {
             unsigned int status = pchtml_html_serialize_pretty_node_cb(node, opt,
-                                                               indent, cb, ctx);
+                                                        indent, cb, ctx, cache);
             if (status != PCHTML_STATUS_OK) {
                 PC_ASSERT(0);
                 return status;
@@ -1448,7 +1519,8 @@ pchtml_html_serialize_pretty_tree_cb(pcdom_node_t *node,
         return PCHTML_STATUS_OK;
     }
 
-    return pchtml_html_serialize_pretty_node_cb(node, opt, indent, cb, ctx);
+    return pchtml_html_serialize_pretty_node_cb(node, opt, indent, cb, ctx,
+                                             cache);
 }
 
 unsigned int
@@ -1491,6 +1563,12 @@ pchtml_html_serialize_pretty_send_escaping_string(const unsigned char *data, siz
 //    pchtml_html_serialize_send("\"", 1, ctx);
 
     while (data != end) {
+        data = pcutils_scan_bytes(data, end, with_indent ?
+                &pretty_text_escaping_set : &attribute_escaping_set);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+0026 AMPERSAND (&) */
             case 0x26:
@@ -41,6 +41,23 @@
 #include "private/str.h"
 #include "html/base.h"
 
+/*
+ * The hooks to cache the serialized elements for the pretty serialization.
+ *
+ * `get` returns the bytes of the element serialized at `indent`, including
+ * the indentation, the subtree, and the closing tag, or NULL if the element
+ * is not cached. The bytes of an element which is not cached are sent
+ * between the calls to `enter` and `leave` for the element.
+ */
+typedef struct {
+    const unsigned char *(*get)(pcdom_node_t *node, size_t indent,
+            size_t *len, void *ctxt);
+    void (*enter)(pcdom_node_t *node, size_t indent, void *ctxt);
+    void (*leave)(pcdom_node_t *node, size_t indent, void *ctxt);
+    void *ctxt;
+}
+pchtml_html_serialize_cache_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -86,6 +103,12 @@ pchtml_html_serialize_pretty_tree_cb(pcdom_node_t *node,
                 pchtml_html_serialize_cb_f cb, void *ctx) WTF_INTERNAL;
 #endif
 
+unsigned int
+pchtml_html_serialize_pretty_tree_cached_cb(pcdom_node_t *node,
+                pchtml_html_serialize_opt_t opt, size_t indent,
+                pchtml_html_serialize_cb_f cb, void *ctx,
+                const pchtml_html_serialize_cache_t *cache) WTF_INTERNAL;
+
 unsigned int
 pchtml_html_serialize_pretty_tree_str(pcdom_node_t *node,
                 pchtml_html_serialize_opt_t opt, size_t indent,
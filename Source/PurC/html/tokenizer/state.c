@@ -34,6 +34,7 @@
 #include "config.h"
 #include "private/instance.h"
 #include "private/errors.h"
+#include "private/scan.h"
 
 #include "html/tokenizer/state.h"
 #include "html/tokenizer/state_comment.h"
@@ -250,6 +251,22 @@ pchtml_html_tokenizer_state_data_before(pchtml_html_tokenizer_t *tkz,
     return data;
 }
 
+/*
+ * The bytes acted on by the data state and the quoted attribute value
+ * states; the runs of other bytes are skipped in bulk.
+ */
+static const struct pcutils_scan_set data_scan_set = {
+    { 0x3C, 0x26, 0x0D, 0x00 }, 4, false
+};
+
+static const struct pcutils_scan_set double_quoted_scan_set = {
+    { 0x22, 0x26, 0x0D, 0x00 }, 4, false
+};
+
+static const struct pcutils_scan_set single_quoted_scan_set = {
+    { 0x27, 0x26, 0x0D, 0x00 }, 4, false
+};
+
 /*
  * 12.2.5.1 Data state
  */
@@ -260,6 +277,11 @@ pchtml_html_tokenizer_state_data(pchtml_html_tokenizer_t *tkz,
     pchtml_html_tokenizer_state_begin_set(tkz, data);
 
     while (data < end) {
+        data = pcutils_scan_bytes(data, end, &data_scan_set);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+003C LESS-THAN SIGN (<) */
             case 0x3C:
@@ -943,6 +965,11 @@ pchtml_html_tokenizer_state_attribute_value_double_quoted(pchtml_html_tokenizer_
     pchtml_html_tokenizer_state_begin_set(tkz, data);
 
     while (data != end) {
+        data = pcutils_scan_bytes(data, end, &double_quoted_scan_set);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+0022 QUOTATION MARK (") */
             case 0x22:
@@ -1037,6 +1064,11 @@ pchtml_html_tokenizer_state_attribute_value_single_quoted(pchtml_html_tokenizer_
     pchtml_html_tokenizer_state_begin_set(tkz, data);
 
     while (data != end) {
+        data = pcutils_scan_bytes(data, end, &single_quoted_scan_set);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+0027 APOSTROPHE (') */
             case 0x27:
@@ -408,6 +408,10 @@ pcvdom_gen_end(struct pcvdom_gen *gen)
     gen->doc  = NULL; // transfer ownership
     gen->curr = NULL;
 
+    // the vDOM is complete, fold the constant subtrees once for all
+    pcvdom_document_fold_constants(doc);
+    pcvdom_document_mark_static_subtrees(doc);
+
     gen->eof = 1;
 
     gen->parser = NULL;
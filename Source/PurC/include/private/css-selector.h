@@ -0,0 +1,100 @@
+/**
+ * @file css-selector.h
+ * @date 2026/10/19
+ * @brief The internal interfaces for the compiled CSS selectors.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PURC_PRIVATE_CSS_SELECTOR_H
+#define PURC_PRIVATE_CSS_SELECTOR_H
+
+#include "config.h"
+
+#include "purc-utils.h"
+#include "purc-dom.h"
+
+struct pcinst;
+struct pcdoc_selector;
+
+PCA_EXTERN_C_BEGIN
+
+/*
+ * Compile a selector list. The following selectors are supported:
+ *
+ *  - type and universal selectors: `div`, `*`;
+ *  - `#id`, `.class`;
+ *  - attribute selectors: `[attr]`, `[attr=v]`, `[attr~=v]`, `[attr|=v]`,
+ *    `[attr^=v]`, `[attr$=v]`, `[attr*=v]`, with an optional `i` flag;
+ *  - the pseudo-classes `:root`, `:empty`, `:first-child`, `:last-child`,
+ *    `:only-child`, `:first-of-type`, `:last-of-type`, `:only-of-type`,
+ *    `:nth-child()`, `:nth-last-child()`, `:nth-of-type()`,
+ *    `:nth-last-of-type()`, and `:not()` with a compound selector;
+ *  - the combinators ` `, `>`, `+`, and `~`;
+ *  - selector lists separated by `,`.
+ *
+ * Returns NULL and sets PURC_ERROR_INVALID_VALUE for a bad selector, or
+ * PURC_ERROR_NOT_SUPPORTED for an unsupported pseudo-class.
+ */
+struct pcdoc_selector *
+pcdoc_selector_new(const char *selector) WTF_INTERNAL;
+
+void
+pcdoc_selector_delete(struct pcdoc_selector *sel) WTF_INTERNAL;
+
+/*
+ * Get the compiled selector from the selector cache of the current
+ * instance, compile it if it is not cached. The returned selector must
+ * be released by calling pcdoc_selector_release().
+ */
+struct pcdoc_selector *
+pcdoc_selector_get(const char *selector) WTF_INTERNAL;
+
+void
+pcdoc_selector_release(struct pcdoc_selector *sel) WTF_INTERNAL;
+
+void
+pcdoc_release_selector_cache(struct pcinst *inst) WTF_INTERNAL;
+
+/*
+ * Get the kinds of the changes other than the structure changes which may
+ * change the elements matching the selector, as a mask of
+ * PCDOC_CHANGE_MASK(PCDOC_CHANGE_XXX) (see private/document.h).
+ */
+unsigned
+pcdoc_selector_dependencies(const struct pcdoc_selector *sel) WTF_INTERNAL;
+
+/* Check whether the element matches the selector. */
+bool
+pcdoc_selector_match(const struct pcdoc_selector *sel,
+        pcdom_element_t *elem) WTF_INTERNAL;
+
+/*
+ * Append the elements in the subtree of `scope` (including `scope` itself)
+ * which match the selector to `results` in document order; stop after
+ * `max_nr` elements are found if `max_nr` is not zero.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+pcdoc_selector_select(const struct pcdoc_selector *sel, pcdom_node_t *scope,
+        struct pcutils_arrlist *results, size_t max_nr) WTF_INTERNAL;
+
+PCA_EXTERN_C_END
+
+#endif  /* PURC_PRIVATE_CSS_SELECTOR_H */
@@ -48,6 +48,12 @@ struct purc_document_ops {
     purc_document_t (*create)(const char *content, size_t length);
     void (*destroy)(purc_document_t doc);
 
+    // nullable; create a document to load the content in chunks
+    purc_document_t (*load_begin)(void);
+    // null if `load_begin` is null
+    int (*load_chunk)(purc_document_t doc, const char *chunk, size_t len);
+    int (*load_end)(purc_document_t doc);
+
     pcdoc_element_t (*operate_element)(purc_document_t doc,
             pcdoc_element_t elem, pcdoc_operation op,
             const char *tag, bool self_close);
@@ -108,6 +114,29 @@ struct purc_document_ops {
             pcdoc_elem_coll_t src_coll, const char *selector);
 };
 
+struct pcdoc_elem_index;
+struct pcdoc_query_cache;
+struct pcdoc_fragment_cache;
+struct pcdoc_serial_cache;
+
+/* the kinds of the changes counted by the generations of a document */
+enum pcdoc_change_kind {
+    /* elements inserted, moved, or removed */
+    PCDOC_CHANGE_STRUCTURE = 0,
+    /* text or data nodes inserted or removed */
+    PCDOC_CHANGE_TEXT,
+    /* the `id` attributes changed */
+    PCDOC_CHANGE_ID,
+    /* the `class` attributes changed */
+    PCDOC_CHANGE_CLASS,
+    /* other attributes changed */
+    PCDOC_CHANGE_ATTR,
+
+    PCDOC_NR_CHANGE_KINDS,
+};
+
+#define PCDOC_CHANGE_MASK(kind)     (0x01U << (kind))
+
 struct purc_document {
     purc_document_type type;
     pcrdr_msg_data_type def_text_type;
@@ -121,6 +150,25 @@ struct purc_document {
     struct purc_document_ops *ops;
 
     void *impl;
+
+    /* the index of the elements by identifier and class; built on the first
+       query and maintained by the implementation; nullable */
+    struct pcdoc_elem_index *elem_index;
+
+    /* the generations of the document, one per kind of change; bumped by
+       the element operations in document.c */
+    uint64_t generations[PCDOC_NR_CHANGE_KINDS];
+
+    /* the cache of the query results; nullable */
+    struct pcdoc_query_cache *query_cache;
+
+    /* the cache of the parsed fragments; maintained by the implementation;
+       nullable */
+    struct pcdoc_fragment_cache *fragment_cache;
+
+    /* the cache of the serialized elements; maintained by the
+       implementation; nullable */
+    struct pcdoc_serial_cache *serial_cache;
 };
 
 struct pcdoc_elem_coll {
@@ -140,6 +188,24 @@ extern struct purc_document_ops _pcdoc_void_ops WTF_INTERNAL;
 extern struct purc_document_ops _pcdoc_plain_ops WTF_INTERNAL;
 extern struct purc_document_ops _pcdoc_html_ops WTF_INTERNAL;
 
+/*
+ * Get the cached result of the query for `selector` in the subtree of
+ * `root`. Returns a new reference to the result, or PURC_VARIANT_INVALID
+ * if there is no cached result or a change which may affect the result
+ * has been made to the document since the result was cached.
+ */
+purc_variant_t
+pcdoc_query_cache_get(purc_document_t doc, pcdoc_element_t root,
+        const char *selector) WTF_INTERNAL;
+
+/*
+ * Cache the result of the query for `selector` in the subtree of `root`.
+ * The result must not be changed after it is cached.
+ */
+void
+pcdoc_query_cache_put(purc_document_t doc, pcdoc_element_t root,
+        const char *selector, purc_variant_t result) WTF_INTERNAL;
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
@@ -175,6 +175,26 @@ pchtml_tag_mraw(pcutils_hash_t *hash)
     return pcutils_hash_mraw(hash);
 }
 
+struct pcdom_document_stats {
+    /* the number of the nodes in the tree, excluding the document itself */
+    size_t                      nr_nodes;
+    /* the number of the attributes of the elements in the tree */
+    size_t                      nr_attrs;
+
+    /* the arena of the nodes and the attributes */
+    struct pcutils_mraw_stats   nodes;
+    /* the arena of the character data */
+    struct pcutils_mraw_stats   text;
+};
+
+/*
+ * Get the statistics of the memory used by the document. The arenas
+ * are shared by the document and the documents owned by it.
+ */
+void
+pcdom_document_get_stats(pcdom_document_t *document,
+        struct pcdom_document_stats *stats) WTF_INTERNAL;
+
 
 /* VW NOTE: eDOM module should work without instance
 struct pcinst;
@@ -32,6 +32,7 @@
 #include "purc-executor.h"
 
 #include "private/map.h"
+#include "private/list.h"
 
 PCA_EXTERN_C_BEGIN
 
@@ -101,6 +102,24 @@ int pcexec_get_by_rule(const char *rule, pcexec_ops_t ops);
 struct pcexecutor_heap {
     unsigned int       debug_flex:1;
     unsigned int       debug_bison:1;
+
+    // the parsed rules, the most recently used first
+    struct list_head   rules;
+    size_t             nr_rules;
+};
+
+// the leading fields of the parameter of every rule parser
+struct pcexec_param_head {
+    char *err_msg;
+    int debug_flex;
+    int debug_bison;
+};
+
+// the parser of the rules of an executor
+struct pcexec_rule_parser {
+    size_t      sz_param;
+    int       (*parse)(const char *rule, size_t len, void *param);
+    void      (*reset)(void *param);
 };
 
 // 用于迭代的迭代器
@@ -132,6 +151,14 @@ void pcexecutor_get_debug(int *debug_flex, int *debug_bison);
 
 void pcexecutor_inst_reset(struct purc_exec_inst *inst);
 
+// Returns the parameter parsed from the rule, which is cached by the
+// current instance and shared by the executor instances until released.
+// Returns NULL on failure, with the error message of the parser in `err_msg'.
+void *pcexecutor_parse_rule(const struct pcexec_rule_parser *parser,
+        const char *rule, char **err_msg);
+
+void pcexecutor_release_rule(void *param);
+
 
 int pcexecutor_register(pcexec_ops_t ops);
 
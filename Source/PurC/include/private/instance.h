@@ -45,6 +45,9 @@ typedef struct pcmodule pcmodule;
 typedef struct pcmodule *pcmodule_t;
 
 struct pcinst_msg_queue;
+struct pcvcm_const_cache;
+struct pcvcm_member_cache;
+struct pcdoc_selector_cache;
 
 typedef int (*module_init_once_f)(void);
 typedef int (*module_init_instance_f)(struct pcinst *curr_inst,
@@ -95,6 +98,16 @@ struct pcinst {
     struct pcvariant_heap  *org_vrt_heap;
 
     struct pcvarmgr        *variables;
+    /* the cached values of the constant vcm nodes */
+    struct pcvcm_const_cache *vcm_const_cache;
+    /* the inline caches of the member accesses in vcm bytecode */
+    struct pcvcm_member_cache *vcm_member_cache;
+    /* bumped whenever a variable is bound or unbound */
+    uint64_t                vars_generation;
+    /* the compiled CSS selectors used recently */
+    struct pcdoc_selector_cache *selector_cache;
+    /* the statistics of the fragment caches of the documents */
+    struct purc_fragment_cache_stats fragment_cache_stats;
 
     struct pcrdr_conn      *conn_to_rdr;
     struct renderer_capabilities *rdr_caps;
@@ -73,9 +73,12 @@
 #define MSG_SUB_TYPE_EXITED           "exited"
 #define MSG_SUB_TYPE_PAGE_CLOSED      "pageClosed"
 #define MSG_SUB_TYPE_CONN_LOST        "connLost"
+#define MSG_SUB_TYPE_DOM_REQ_FAILED   "domReqFailed"
 #define MSG_SUB_TYPE_OBSERVING        "observing"
 
 struct pcintr_heap;
+struct pcintr_var_cache;
+struct pcvcm_var_ref;
 typedef struct pcintr_heap pcintr_heap;
 typedef struct pcintr_heap *pcintr_heap_t;
 
@@ -124,10 +127,18 @@ struct pcintr_heap {
 
     purc_atom_t         move_buff;
     pcintr_timer_t     *event_timer;    // 10ms
+    pcintr_timer_t     *vdom_cache_timer;   // 10s
 
     purc_cond_handler   cond_handler;
     unsigned int        keep_alive:1;
+    // send the DOM requests without waiting for the responses
+    unsigned int        async_dom_reqs:1;
+    // collect the DOM requests of a scheduling round into a batch
+    unsigned int        batch_dom_reqs:1;
     double              timestamp;
+
+    // the number of the DOM requests waiting for the responses
+    size_t              nr_inflight_dom_reqs;
 };
 
 struct pcintr_stack_frame;
@@ -233,6 +244,9 @@ struct pcintr_stack {
 
     // key: vdom_node  val: pcvarmgr_t
     struct rb_root                scoped_variables;
+
+    // the cached variants of the named variables, created on demand
+    struct pcintr_var_cache      *var_cache;
 };
 
 enum pcintr_coroutine_stage {
@@ -280,6 +294,10 @@ struct pcintr_coroutine {
     uint64_t                    target_dom_handle;
     purc_variant_t              doc_contents;
     purc_variant_t              doc_wrotten_len;
+    /* the DOM operations not sent yet (an array); see PURC_RDR_BATCH_DOM */
+    purc_variant_t              dom_batch;
+    /* the length of the serialized batch */
+    size_t                      dom_batch_len;
 
     struct rb_node              node;     /* heap::coroutines */
 
@@ -410,6 +428,9 @@ struct pcintr_stack_frame {
     purc_variant_t     except_templates;
     purc_variant_t     error_templates;
 
+    // the listener on $! to invalidate the cached variants of variables
+    struct pcvar_listener *exclamation_listener;
+
     unsigned int       silently:1;
 };
 
@@ -595,6 +616,16 @@ pcintr_get_scope_variable(purc_coroutine_t cor, pcvdom_element_t elem,
 purc_variant_t
 pcintr_find_named_var(pcintr_stack_t stack, const char* name);
 
+/*
+ * Like pcintr_find_named_var(), but caches the variant found for the
+ * reference, which is generally held by the bytecode of a vcm. A cached
+ * variant is returned only if the reference is evaluated again from the
+ * same frame and no variable has been bound, unbound or changed since.
+ */
+purc_variant_t
+pcintr_find_named_var_by_ref(pcintr_stack_t stack,
+        const struct pcvcm_var_ref *ref);
+
 purc_variant_t
 pcintr_get_symbolized_var (pcintr_stack_t stack, unsigned int number,
         char symbol);
@@ -718,6 +749,10 @@ pcintr_unload_module(void *handle);
 int
 pcintr_init_loader_once(void);
 
+// removes the expired entries from the vDOM cache and shrinks it to budget
+void
+pcintr_sweep_vdom_cache(void);
+
 bool
 pcintr_attach_to_renderer(pcintr_coroutine_t cor,
         pcrdr_page_type page_type, const char *target_workspace,
@@ -95,6 +95,9 @@ int pcutils_map_replace (pcutils_map* map, const void* key,
 
 int pcutils_map_erase (pcutils_map* map, const void* key);
 
+/* the following two functions should be called with the map locked */
+int pcutils_map_erase_nolock (pcutils_map* map, const void* key);
+
 void
 pcutils_map_erase_entry_nolock (pcutils_map* map, pcutils_map_entry *entry);
 
@@ -54,11 +54,37 @@ extern "C" {
         - (sizeof(size_t) % PCUTILS_MEM_ALIGN_STEP))  \
     : sizeof(size_t))
 
+/* the freed blocks up to this size are kept in the exact-size free lists */
+#define PCUTILS_MRAW_SMALL_MAX      512
+#define PCUTILS_MRAW_NR_CLASSES     (PCUTILS_MRAW_SMALL_MAX / PCUTILS_MEM_ALIGN_STEP)
+
+#define pcutils_mraw_class(size)    ((size) / PCUTILS_MEM_ALIGN_STEP - 1)
+
 struct pcutils_mraw {
     pcutils_mem_t *mem;
     pcutils_bst_t *cache;
+
+    /* the singly linked lists of the freed small blocks, by size */
+    void          *free_lists[PCUTILS_MRAW_NR_CLASSES];
+
+    /* the number and the size of the blocks in use */
+    size_t        nr_blocks;
+    size_t        bytes_used;
 };
 
+struct pcutils_mraw_stats {
+    /* the number of the blocks in use */
+    size_t nr_blocks;
+    /* the bytes of the blocks in use, excluding the meta data */
+    size_t bytes_used;
+    /* the bytes of all chunks */
+    size_t bytes_reserved;
+};
+
+void
+pcutils_mraw_get_stats(pcutils_mraw_t *mraw,
+        struct pcutils_mraw_stats *stats) WTF_INTERNAL;
+
 /*
  * Inline functions
  */
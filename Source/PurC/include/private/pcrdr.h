@@ -60,6 +60,9 @@ struct renderer_capabilities {
        0 for not supported, -1 for unlimited */
     long int    plainWindow;
 
+    /* the version of the binary message encoding if supported, else 0 */
+    long int    binary_msg_version;
+
     /* the session handle */
     uint64_t    session_handle;
     /* the default workspace handle */
@@ -76,6 +79,18 @@ pcrdr_parse_renderer_capabilities(const char *data) WTF_INTERNAL;
 void pcrdr_release_renderer_capabilities(
         struct renderer_capabilities *rdr_caps) WTF_INTERNAL;
 
+/* Serialize the message except for the text data held by the message,
+   which is returned via @text and @text_len (NULL and 0 if there is no
+   such data), so that the caller can send it without copying it. */
+int pcrdr_serialize_message_head(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt,
+        const char **text, size_t *text_len) WTF_INTERNAL;
+
+/* The binary counterpart of pcrdr_serialize_message_head(). */
+int pcrdr_serialize_message_binary_head(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt,
+        const char **text, size_t *text_len) WTF_INTERNAL;
+
 static inline purc_atom_t
 pcrdr_check_operation(const char *op)
 {
@@ -0,0 +1,64 @@
+/**
+ * @file scan.h
+ * @author
+ * @date 2026/10/19
+ * @brief The interfaces for scanning bytes in bulk.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PURC_PRIVATE_SCAN_H
+#define PURC_PRIVATE_SCAN_H
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PCUTILS_SCAN_SET_MAX    8
+
+/* a set of the bytes to scan for */
+struct pcutils_scan_set {
+    /* the bytes in the set */
+    unsigned char   bytes[PCUTILS_SCAN_SET_MAX];
+    unsigned        nr_bytes;
+
+    /* whether the set contains all control characters (0x00 - 0x1F) */
+    bool            ctrls;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Returns the pointer to the first byte in [data, end) which is in `set`,
+ * or `end` if there is no such byte.
+ *
+ * The bytes are compared 16 or 32 at a time with SSE2, AVX2 (selected at
+ * run time), or NEON where available.
+ */
+const unsigned char *
+pcutils_scan_bytes(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set) WTF_INTERNAL;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* PURC_PRIVATE_SCAN_H */
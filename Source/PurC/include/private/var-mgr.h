@@ -68,6 +68,12 @@ static inline bool pcvarmgr_remove(pcvarmgr_t mgr, const char* name)
 bool pcvarmgr_dispatch_except(pcvarmgr_t mgr, const char* name,
         const char* except);
 
+/*
+ * Invalidates the cached variants of the variable references; called
+ * whenever the result of a named variable lookup may change.
+ */
+void pcvarmgr_bump_generation(void);
+
 PCA_EXTERN_C_END
 
 #endif /* not defined PURC_PRIVATE_VAR_MGR_H */
@@ -211,6 +211,14 @@ struct pcvariant_heap {
 #endif
 };
 
+// returns the shape of the object; an object gets a new shape which is
+// unique in the process after a key is added or removed.
+uint64_t pcvar_obj_get_shape(purc_variant_t obj) WTF_INTERNAL;
+
+// finds the node of the key; the node is valid while the shape keeps.
+struct obj_node *
+pcvar_obj_find_node(purc_variant_t obj, const char *key) WTF_INTERNAL;
+
 // internal interfaces for moving variant.
 purc_variant_t pcvariant_move_heap_in(purc_variant_t v) WTF_INTERNAL;
 purc_variant_t pcvariant_move_heap_out(purc_variant_t v) WTF_INTERNAL;
@@ -270,6 +278,10 @@ struct variant_obj {
     struct rb_root          kvs;  // struct obj_node*
     size_t                  size;
 
+    // the identifier of the current set of keys, assigned on demand;
+    // reset to 0 when a key is added or removed.
+    uint64_t                shape;
+
     // key: arr_node/obj_node/set_node
     // val: parent
     pcutils_map                     *rev_update_chain;
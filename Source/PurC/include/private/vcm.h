@@ -66,12 +66,20 @@ enum pcvcm_node_type {
 #define PCVCM_EV_PROPERTY_VCM_EV          "vcm_ev"
 #define PCVCM_EV_PROPERTY_LAST_VALUE      "last_value"
 
+struct pcvcm_bytecode;
+
 struct pcvcm_node {
     struct pctree_node tree_node;
     enum pcvcm_node_type type;
     uint32_t extra;
     uintptr_t attach;
     bool is_closed;
+    /* the value of the node does not depend on any variable */
+    bool is_constant;
+    /* the unique identifier of a constant node for the constant cache */
+    uint32_t const_id;
+    /* the bytecode compiled lazily when the node is evaluated */
+    struct pcvcm_bytecode *bytecode;
     union {
         bool        b;
         double      d;
@@ -188,6 +196,41 @@ void pcvcm_stack_destroy(struct pcvcm_stack *stack);
 
 typedef purc_variant_t(*cb_find_var) (void *ctxt, const char *name);
 
+enum pcvcm_var_kind {
+    PCVCM_VAR_NAMED,
+    PCVCM_VAR_SYMBOLIZED,       /* $?, $2@, ... */
+    PCVCM_VAR_ANCHORED,         /* $#anchor? */
+};
+
+/*
+ * A variable reference with the name parsed once, so that the
+ * evaluation needs not to parse the name again.
+ */
+struct pcvcm_var_ref {
+    enum pcvcm_var_kind kind;
+    /* the symbol of a symbolized or an anchored variable */
+    char                symbol;
+    /* the number of the frames to go up for a symbolized variable */
+    unsigned int        number;
+    /* the full name; not owned by the reference */
+    const char         *name;
+    /* the atom of the name of a named variable */
+    purc_atom_t         atom;
+    /* the anchor of an anchored variable, without the leading `#' */
+    char               *anchor;
+};
+
+typedef purc_variant_t(*cb_find_var_ref) (void *ctxt,
+        const struct pcvcm_var_ref *ref);
+
+/*
+ * Creates a reference for the variable name. The name is not copied,
+ * and should outlive the reference.
+ */
+struct pcvcm_var_ref *pcvcm_var_ref_new(const char *name);
+
+void pcvcm_var_ref_destroy(struct pcvcm_var_ref *ref);
+
 purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree, cb_find_var find_var,
         void *ctxt, bool silently);
 
@@ -195,9 +238,72 @@ struct pcintr_stack;
 purc_variant_t pcvcm_eval(struct pcvcm_node *tree, struct pcintr_stack *stack,
         bool silently);
 
+/*
+ * Evaluates the tree by walking it node by node, without the bytecode;
+ * pcvcm_eval_ex() falls back to this for trees it can not compile.
+ */
+purc_variant_t pcvcm_eval_walk_ex(struct pcvcm_node *tree,
+        cb_find_var find_var, void *ctxt, bool silently);
+
+/*
+ * Compiles the tree to bytecode for the stack VM. Returns NULL if
+ * the tree can only be evaluated by walking it.
+ */
+struct pcvcm_bytecode *pcvcm_bytecode_compile(struct pcvcm_node *tree);
+
+void pcvcm_bytecode_destroy(struct pcvcm_bytecode *bc);
+
+size_t pcvcm_bytecode_length(struct pcvcm_bytecode *bc);
+
+purc_variant_t pcvcm_bytecode_eval(struct pcvcm_bytecode *bc,
+        cb_find_var find_var, void *ctxt, bool silently);
+
+/*
+ * Like pcvcm_bytecode_eval(), but resolves the variables whose names are
+ * constant through find_var_ref if it is not NULL.
+ */
+purc_variant_t pcvcm_bytecode_eval_ex(struct pcvcm_bytecode *bc,
+        cb_find_var find_var, cb_find_var_ref find_var_ref, void *ctxt,
+        bool silently);
+
 purc_variant_t
 pcvcm_to_expression_variable(struct pcvcm_node *vcm, bool release_vcm);
 
+/*
+ * Folds the constant subtrees of the tree (e.g. a concatenation of
+ * literal strings), and marks the constant nodes so that their values
+ * can be cached by the instance and shared by the evaluations.
+ * Returns true if the whole tree is constant.
+ */
+bool pcvcm_node_fold_constants(struct pcvcm_node *tree);
+
+struct pcinst;
+/* releases the values of the constant nodes cached by the instance */
+void pcvcm_release_const_cache(struct pcinst *inst);
+
+/* releases the member inline caches of the instance */
+void pcvcm_release_member_cache(struct pcinst *inst);
+
+/* returns the estimated memory used by the tree, not including bytecode */
+size_t pcvcm_node_estimate_size(const struct pcvcm_node *tree);
+
+/*
+ * Writes the vcm tree in the binary form used by the persistent vDOM
+ * cache. The form is only valid for the library which writes it.
+ * Returns 0 on success, or -1 if the writing fails or the tree nests
+ * the nodes too deep to be read back.
+ */
+int pcvcm_node_write_binary(purc_rwstream_t out,
+        const struct pcvcm_node *tree);
+
+/*
+ * Reads a vcm tree written by pcvcm_node_write_binary() from the memory
+ * pointed to by `*data` and advances `*data`. Returns NULL if the data
+ * is truncated or malformed, or nests the nodes too deep.
+ */
+struct pcvcm_node *pcvcm_node_read_binary(const unsigned char **data,
+        const unsigned char *end);
+
 #define PRINT_VCM_NODE(_node) do {                                        \
     size_t len;                                                           \
     char *s = pcvcm_node_to_string(_node, &len);                          \
@@ -93,9 +93,36 @@ pcvdom_document_ref(struct pcvdom_document *doc);
 void
 pcvdom_document_unref(struct pcvdom_document *doc);
 
+unsigned long
+pcvdom_document_get_refc(struct pcvdom_document *doc);
+
 struct pcvdom_document*
 pcvdom_document_create(void);
 
+// folds the constant vcm trees of the attributes and contents
+void
+pcvdom_document_fold_constants(struct pcvdom_document *doc);
+
+// marks the foreign elements whose subtrees are static; call it after
+// folding the constants
+void
+pcvdom_document_mark_static_subtrees(struct pcvdom_document *doc);
+
+// returns the estimated memory used by the document
+size_t
+pcvdom_document_estimate_size(struct pcvdom_document *doc);
+
+// writes the document in the binary form of the persistent vDOM cache,
+// fails if the document nests the nodes too deep to be read back
+int
+pcvdom_document_write_binary(struct pcvdom_document *doc,
+        purc_rwstream_t out);
+
+// rebuilds the document from the binary form, NULL if the data is
+// malformed or written by another version of the library
+struct pcvdom_document*
+pcvdom_document_read_binary(const void *data, size_t len);
+
 struct pcvdom_element*
 pcvdom_element_create(pcvdom_tag_id tag);
 
@@ -223,6 +250,11 @@ pcvdom_element_find_attr(struct pcvdom_element *element, const char *key);
 bool
 pcvdom_element_is_silently(struct pcvdom_element *element);
 
+// whether the whole subtree of the element can be built without
+// evaluating anything (see pcvdom_document_mark_static_subtrees())
+bool
+pcvdom_element_is_static_subtree(struct pcvdom_element *element);
+
 struct pcvdom_element*
 pcvdom_content_parent(struct pcvdom_content *content);
 
@@ -736,6 +736,36 @@ PCA_EXPORT void
 pcdoc_elem_coll_delete(purc_document_t doc,
         pcdoc_elem_coll_t elem_coll);
 
+struct purc_fragment_cache_stats {
+    /** The number of the fragments cloned from the prebuilt subtrees. */
+    uint64_t    nr_hits;
+    /** The number of the fragments parsed. */
+    uint64_t    nr_misses;
+    /** The number of the subtrees prebuilt for the repeated fragments. */
+    uint64_t    nr_stored;
+    /** The number of the prebuilt subtrees evicted by other fragments. */
+    uint64_t    nr_evictions;
+};
+
+/**
+ * Get the statistics of the caches of the parsed fragments.
+ *
+ * @param stats: The pointer to a struct purc_fragment_cache_stats buffer
+ *  to return the statistics.
+ *
+ * The markups inserted into an HTML document by pcdoc_element_new_content()
+ * are cached per document: a markup inserted repeatedly in the same context
+ * is parsed into a subtree once, which is cloned afterwards. This function
+ * gets the statistics of the caches of all documents of the current
+ * instance.
+ *
+ * Returns: @true for success; @false if there is no instance.
+ *
+ * Since: 0.8.2
+ */
+PCA_EXPORT bool
+purc_get_fragment_cache_stats(struct purc_fragment_cache_stats *stats);
+
 PCA_EXTERN_C_END
 
 #endif  /* PURC_PURC_DOCUMENT_H */
@@ -32,6 +32,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <time.h>
+#include <string.h>
 
 #include "purc-macros.h"
 #include "purc-rwstream.h"
@@ -127,9 +128,11 @@ enum {
 #define PCRDR_OPERATION_GETPROPERTY         "getProperty"
     PCRDR_K_OPERATION_SETPROPERTY,
 #define PCRDR_OPERATION_SETPROPERTY         "setProperty"
+    PCRDR_K_OPERATION_BATCH,
+#define PCRDR_OPERATION_BATCH               "batch"
 
     /* XXX: change this when you append a new operation */
-    PCRDR_K_OPERATION_LAST = PCRDR_K_OPERATION_SETPROPERTY,
+    PCRDR_K_OPERATION_LAST = PCRDR_K_OPERATION_BATCH,
 };
 
 #define PCRDR_NR_OPERATIONS \
@@ -175,6 +178,36 @@ enum {
 #define PCRDR_DEF_PACKET_BUFF_SIZE      1024
 #define PCRDR_DEF_TIME_EXPECTED         5   /* 5 seconds */
 
+/*
+ * The environment variable to send the DOM update requests to the renderer
+ * without waiting for the responses; set it to `1` or `true` to enable.
+ * The failed requests are reported to the coroutine by
+ * `rdrState:domReqFailed` events.
+ */
+#define PURC_ENVV_RDR_ASYNC_DOM         "PURC_RDR_ASYNC_DOM"
+
+/*
+ * The environment variable to collect the DOM update requests made by
+ * a coroutine in a scheduling round and send them in a single `batch`
+ * request; set it to `1` or `true` to enable. The renderer must support
+ * the `batch` operation.
+ *
+ * The data of a `batch` request is a JSON array; every member is an object
+ * describing one DOM operation:
+ *
+ *  {
+ *      "operation": "append",      // the DOM operation
+ *      "element": "7f3c2a40",      // the handle of the target element
+ *      "property": "textContent",  // optional
+ *      "dataType": "html",         // optional, `void` by default
+ *      "data": "<p>Hello</p>"      // optional
+ *  }
+ *
+ * The renderer applies all operations in order or none of them; the result
+ * value of the response is the number of applied operations.
+ */
+#define PURC_ENVV_RDR_BATCH_DOM         "PURC_RDR_BATCH_DOM"
+
 /* the maximal size of a payload in a frame (4KiB) */
 #define PCRDR_MAX_FRAME_PAYLOAD_SIZE    4096
 
@@ -906,6 +939,66 @@ PCA_EXPORT size_t
 pcrdr_serialize_message_to_buffer(const pcrdr_msg *msg,
         void *buff, size_t sz);
 
+/* The magic bytes at the head of a binary message packet */
+#define PCRDR_BINARY_MSG_MAGIC          "\x89PMB"
+#define PCRDR_BINARY_MSG_MAGIC_LEN      4
+/* The version of the binary message encoding */
+#define PCRDR_BINARY_MSG_VERSION        1
+
+/**
+ * Check whether a packet contains a binary message.
+ *
+ * @param packet: the pointer to the packet.
+ * @param sz_packet: the size of the packet.
+ *
+ * Returns: @true if the packet starts with the magic of the binary message.
+ *
+ * Since: 0.8.2
+ */
+static inline bool
+pcrdr_is_binary_packet(const void *packet, size_t sz_packet)
+{
+    return sz_packet >= PCRDR_BINARY_MSG_MAGIC_LEN &&
+        memcmp(packet, PCRDR_BINARY_MSG_MAGIC,
+                PCRDR_BINARY_MSG_MAGIC_LEN) == 0;
+}
+
+/**
+ * Parse a binary packet and make a corresponding message.
+ *
+ * @param packet: the pointer to the packet.
+ * @param sz_packet: the size of the packet.
+ * @param msg: The pointer to a pointer to return the parsed message structure.
+ *
+ * Note that pcrdr_parse_packet() calls this function for a binary packet.
+ *
+ * Returns: -1 for error; zero means everything is ok.
+ *
+ * Since: 0.8.2
+ */
+PCA_EXPORT int
+pcrdr_parse_packet_binary(const void *packet, size_t sz_packet,
+        pcrdr_msg **msg);
+
+/**
+ * Serialize a message in the binary encoding.
+ *
+ * @param msg: the pointer to the message to serialize.
+ * @param fn: the callback to write the bytes.
+ * @param ctxt: the context will be passed to fn.
+ *
+ * The binary encoding has a fixed-layout header and length-prefixed
+ * fields; the JSON data is encoded as a compact binary eJSON. Use it only
+ * if the renderer declares the capability `binaryMessage`.
+ *
+ * Returns: zero means everything is ok; an error code on failure.
+ *
+ * Since: 0.8.2
+ */
+PCA_EXPORT int
+pcrdr_serialize_message_binary(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt);
+
 /**
  * Compare two messages.
  *
@@ -1228,6 +1321,23 @@ PCA_EXPORT int
 pcrdr_purcmc_send_text_packet(pcrdr_conn* conn,
         const char *text, size_t txt_len);
 
+/**
+ * Send a binary packet to the PurCMC server.
+ *
+ * @param conn: the pointer to the renderer connection.
+ * @param data: the pointer to the data to send.
+ * @param sz: the length to send.
+ *
+ * Sends a binary packet to the PurCMC server.
+ *
+ * Returns: -1 for error; zero means everything is ok.
+ *
+ * Since: 0.8.2
+ */
+PCA_EXPORT int
+pcrdr_purcmc_send_binary_packet(pcrdr_conn* conn,
+        const void *data, size_t sz);
+
 /**@}*/
 
 /**
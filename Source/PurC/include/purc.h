@@ -354,12 +354,22 @@ purc_get_runner_variable(const char *name);
 struct pcvdom_document;
 typedef struct pcvdom_document* purc_vdom_t;
 
+/*
+ * The directory of the persistent vDOM cache. If it is set, the vDOMs
+ * loaded from strings or files are saved in the directory, keyed by the
+ * MD5 digest of the HVML text and the version of PurC, and the next load
+ * of the same program (even by another process) reads the saved vDOM
+ * instead of parsing the text again.
+ */
+#define PURC_ENVV_VDOM_CACHE_DIR    "PURC_VDOM_CACHE_DIR"
+
 /**
  * purc_load_hvml_from_string:
  *
  * @string: The pointer to the string contains the HVML docment.
  *
- * Loads a HVML program from a string.
+ * Loads a HVML program from a string. The persistent vDOM cache is used
+ * if the environment variable %PURC_VDOM_CACHE_DIR is set.
  *
  * Returns: A valid pointer to the vDOM tree for success; @NULL for failure.
  *
@@ -373,7 +383,8 @@ purc_load_hvml_from_string(const char* string);
  *
  * @file: The pointer to the string contains the file name.
  *
- * Loads a HVML program from a file.
+ * Loads a HVML program from a file. The persistent vDOM cache is used
+ * if the environment variable %PURC_VDOM_CACHE_DIR is set.
  *
  * Returns: A valid pointer to the vDOM tree for success; @NULL for failure.
  *
@@ -410,6 +421,104 @@ purc_load_hvml_from_url(const char* url);
 PCA_EXPORT purc_vdom_t
 purc_load_hvml_from_rwstream(purc_rwstream_t stream);
 
+/** The conventional suffix of a precompiled HVML bundle. */
+#define PURC_HVML_BUNDLE_SUFFIX     ".hvmlc"
+
+/**
+ * purc_load_hvml_from_bundle:
+ *
+ * @file: The pointer to the string contains the file name.
+ *
+ * Loads a HVML program from a bundle written by
+ * @purc_compile_hvml_to_bundle. No parsing is needed: the vDOM tree is
+ * rebuilt from the bundle with its constant expressions folded already.
+ * A bundle is only valid for the version of PurC which writes it.
+ *
+ * Returns: A valid pointer to the vDOM tree for success; @NULL for failure.
+ *
+ * Since 0.8.2
+ */
+PCA_EXPORT purc_vdom_t
+purc_load_hvml_from_bundle(const char* file);
+
+/**
+ * purc_compile_hvml_to_bundle:
+ *
+ * @vdom: The vDOM tree of the HVML program.
+ * @file: The pointer to the string contains the file name of the bundle.
+ *
+ * Writes the vDOM tree of a HVML program to a bundle, which can be
+ * loaded later by @purc_load_hvml_from_bundle. The file is replaced
+ * atomically if it exists.
+ *
+ * Returns: @true for success; @false for failure.
+ *
+ * Since 0.8.2
+ */
+PCA_EXPORT bool
+purc_compile_hvml_to_bundle(purc_vdom_t vdom, const char* file);
+
+/*
+ * The memory budget of the in-process vDOM cache in bytes. It can be
+ * overridden by the environment variable PURC_VDOM_CACHE_BUDGET or by
+ * calling purc_set_vdom_cache_budget().
+ */
+#define PURC_ENVV_VDOM_CACHE_BUDGET     "PURC_VDOM_CACHE_BUDGET"
+#define PURC_DEF_VDOM_CACHE_BUDGET      (16 * 1024 * 1024)
+
+struct purc_vdom_cache_stats {
+    /** The number of the cached vDOMs. */
+    size_t      nr_entries;
+    /** The total length of the HVML texts of the cached vDOMs. */
+    size_t      orig_size;
+    /** The estimated memory used by the cached vDOMs. */
+    size_t      size;
+    /** The memory budget. */
+    size_t      budget;
+
+    /** The number of the loads found the vDOM in the cache. */
+    uint64_t    nr_hits;
+    /** The number of the loads did not find the vDOM in the cache. */
+    uint64_t    nr_misses;
+    /** The number of the vDOMs evicted to keep the cache in the budget. */
+    uint64_t    nr_evictions;
+    /** The number of the vDOMs removed because they expired. */
+    uint64_t    nr_expirations;
+};
+
+/**
+ * purc_set_vdom_cache_budget:
+ *
+ * @budget: The new memory budget in bytes.
+ *
+ * Sets the memory budget of the in-process vDOM cache shared by all
+ * instances. The least recently used vDOMs are evicted if the estimated
+ * memory used by the cached vDOMs exceeds the budget. The vDOMs used by
+ * coroutines are not evicted, so the budget may be exceeded temporarily.
+ *
+ * Returns: The old budget.
+ *
+ * Since 0.8.2
+ */
+PCA_EXPORT size_t
+purc_set_vdom_cache_budget(size_t budget);
+
+/**
+ * purc_get_vdom_cache_stats:
+ *
+ * @stats: The pointer to a struct purc_vdom_cache_stats buffer to return
+ *  the statistics.
+ *
+ * Gets the statistics of the in-process vDOM cache.
+ *
+ * Returns: @true for success; @false if the cache is not initialized
+ *  (the interpreter module is not initialized).
+ *
+ * Since 0.8.2
+ */
+PCA_EXPORT bool
+purc_get_vdom_cache_stats(struct purc_vdom_cache_stats *stats);
+
 /**
  * purc_get_conn_to_renderer:
  *
@@ -203,6 +203,8 @@ post_process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame)
     if (ctxt->within_self && ctxt->concurrently == 0) {
         ctxt->define = define;
         frame->scope = define;
+        /* the variables are looked up in another scope from now on */
+        pcvarmgr_bump_generation();
         return 0;
     }
 
@@ -159,6 +159,65 @@ attr_found(struct pcintr_stack_frame *frame,
     return r ? -1 : 0;
 }
 
+/*
+ * Builds the attributes and the descendants of a static subtree (see
+ * pcvdom_document_mark_static_subtrees()) straight from the vDOM shared by
+ * the coroutines, without pushing a frame or evaluating a vcm tree for
+ * every node.
+ */
+static int
+build_static_subtree(purc_document_t doc, pcdoc_element_t elem,
+        struct pcvdom_element *element)
+{
+    for (unsigned int i = 0; i < element->nr_attrs; i++) {
+        struct pcvdom_attr *attr = element->attrs[i];
+        const char *sv = "";
+        if (attr->val)
+            sv = (const char *)attr->val->sz_ptr[1];
+
+        if (pcintr_util_set_attribute(doc, elem, PCDOC_OP_DISPLACE,
+                    attr->key, sv, 0))
+            return -1;
+    }
+
+    struct pcvdom_node *node = pcvdom_node_first_child(&element->node);
+    for (; node; node = pcvdom_node_next_sibling(node)) {
+        switch (node->type) {
+            case PCVDOM_NODE_ELEMENT:
+                {
+                    pcvdom_element_t child = PCVDOM_ELEMENT_FROM_NODE(node);
+                    pcdoc_element_t edom_child;
+                    edom_child = pcintr_util_new_element(doc, elem,
+                            PCDOC_OP_APPEND, child->tag_name, false);
+                    if (!edom_child)
+                        return -1;
+                    if (build_static_subtree(doc, edom_child, child))
+                        return -1;
+                }
+                break;
+            case PCVDOM_NODE_CONTENT:
+                {
+                    struct pcvcm_node *vcm;
+                    vcm = PCVDOM_CONTENT_FROM_NODE(node)->vcm;
+                    if (!vcm)
+                        break;
+
+                    const char *text = (const char *)vcm->sz_ptr[1];
+                    if (!pcintr_util_new_text_content(doc, elem,
+                                PCDOC_OP_APPEND, text, strlen(text)))
+                        return -1;
+                }
+                break;
+            default:
+                /* comments are ignored as in on_comment() */
+                break;
+        }
+    }
+
+    purc_clr_error();
+    return 0;
+}
+
 static void*
 after_pushed(pcintr_stack_t stack, pcvdom_element_t pos)
 {
@@ -221,8 +280,14 @@ after_pushed(pcintr_stack_t stack, pcvdom_element_t pos)
     if (r)
         return ctxt;
 
-    r = pcintr_vdom_walk_attrs(frame, element, stack, attr_found);
-    if (r)
+    if (element->static_subtree) {
+        /* select_child() selects none of the children */
+        r = build_static_subtree(frame->owner->doc, child, element);
+    }
+    else {
+        r = pcintr_vdom_walk_attrs(frame, element, stack, attr_found);
+    }
+    if (r || element->static_subtree)
         return ctxt;
 
     pcintr_calc_and_set_caret_symbol(stack, frame);
@@ -369,6 +434,10 @@ select_child(pcintr_stack_t stack, void* ud)
     if (stack->back_anchor)
         return NULL;
 
+    /* the subtree has been built in after_pushed() */
+    if (frame->pos->static_subtree)
+        return NULL;
+
     struct ctxt_for_undefined *ctxt;
     ctxt = (struct ctxt_for_undefined*)frame->ctxt;
 
@@ -22,15 +22,30 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
 #include "purc.h"
+#include "purc-version.h"
 
 #include "private/hvml.h"
 #include "private/map.h"
 #include "private/fetcher.h"
 #include "private/ports.h"
+#include "private/utils.h"
+#include "private/vdom.h"
+#include "private/list.h"
 #include "../hvml/hvml-gen.h"
+#include "../vdom/vdom-internal.h"
 
 #include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if HAVE(MMAP)
+#include <sys/mman.h>
+#endif
 
 purc_vdom_t
 purc_load_hvml_from_rwstream(purc_rwstream_t stm)
@@ -88,18 +103,41 @@ end:
 }
 
 /*
- * TODO:
- * When total_orig_size reaches a number (say 64KB), we can shrink the cached
- * by emoving some vDOMs according to LRU.
+ * The in-process vDOM cache shared by all instances.
+ *
+ * The entries are kept in a LRU list, and the least recently used ones
+ * are evicted by the sweeper called periodically by the instances when
+ * the estimated memory used by the cached vDOMs exceeds the budget. The
+ * expired entries are removed when they are looked up, and by the sweeper.
+ *
+ * A cached vDOM is owned by its entry: the reference of the creator is
+ * handed over to the entry, and a coroutine takes its own reference when
+ * it is created for the vDOM. The vDOM returned by a loader is borrowed
+ * from the cache, so the caller should schedule it before the next sweep.
+ * An entry is not evicted as long as its vDOM is used by a coroutine, and
+ * the vDOM is freed once it is evicted and the coroutines have exited.
  *
- * By now, we keep all vDOMs until the program exits.
+ * The LRU list, the sizes and the counters are protected by the lock of
+ * md5_vdom_map.
  */
-static size_t total_orig_size;
+#define VDOM_CACHE_EXPIRE_TIME      3600
+
 static pcutils_map* md5_vdom_map;
+static struct list_head lru_list;
+static size_t total_orig_size;
+static size_t total_size;
+static size_t cache_budget = PURC_DEF_VDOM_CACHE_BUDGET;
+static uint64_t nr_hits;
+static uint64_t nr_misses;
+static uint64_t nr_evictions;
+static uint64_t nr_expirations;
 
 struct vdom_entry {
+    struct list_head ln;    // the most recently used entry comes first
+    unsigned char md5[MD5_DIGEST_SIZE];
     time_t expire;
-    size_t length;
+    size_t length;          // the length of the HVML text
+    size_t size;            // the estimated memory used by the vDOM
     purc_vdom_t vdom;
 };
 
@@ -123,15 +161,19 @@ static int cmp_md5_keys(const void *key1, const void *key2)
 
 static void *copy_entry(const void *val)
 {
-    const struct vdom_entry *entry = val;
+    struct vdom_entry *entry = (struct vdom_entry *)val;
+    list_add(&entry->ln, &lru_list);
     total_orig_size += entry->length;
+    total_size += entry->size;
     return (void *)val;
 }
 
 static void free_entry(void *val)
 {
     struct vdom_entry *entry = val;
+    list_del(&entry->ln);
     total_orig_size -= entry->length;
+    total_size -= entry->size;
     pcvdom_document_unref(entry->vdom);
     free(val);
 }
@@ -149,6 +191,16 @@ static void cleanup_loader_once(void)
 
 int pcintr_init_loader_once(void)
 {
+    list_head_init(&lru_list);
+
+    const char *env = getenv(PURC_ENVV_VDOM_CACHE_BUDGET);
+    if (env) {
+        char *end;
+        unsigned long long budget = strtoull(env, &end, 10);
+        if (end != env && *end == '\0')
+            cache_budget = (size_t)budget;
+    }
+
     md5_vdom_map = pcutils_map_create(copy_md5_key, free_md5_key,
             copy_entry, free_entry, cmp_md5_keys, true);
     if (md5_vdom_map == NULL)
@@ -165,28 +217,56 @@ failed:
     return -1;
 }
 
+static inline bool is_vdom_in_use(purc_vdom_t vdom)
+{
+    /* any reference besides the one of the cache is held by a coroutine */
+    return pcvdom_document_get_refc(vdom) > 1;
+}
+
+/* called with the map locked */
+static void shrink_cache_nolock(size_t budget)
+{
+    struct vdom_entry *entry, *prev;
+    list_for_each_entry_reverse_safe(entry, prev, &lru_list, ln) {
+        if (total_size <= budget)
+            break;
+
+        if (is_vdom_in_use(entry->vdom))
+            continue;
+
+        pcutils_map_erase_nolock(md5_vdom_map, entry->md5);
+        nr_evictions++;
+    }
+}
+
 static bool
 cache_vdom(unsigned char *md5, unsigned expire_after, size_t length,
         purc_vdom_t vdom)
 {
     struct vdom_entry *entry = calloc(1, sizeof(*entry));
+    if (entry == NULL)
+        return false;
 
-    time_t expire;
-    if (expire_after)
-       expire = purc_monotonic_time_after(expire_after);
-    else
-       expire = purc_monotonic_time_after(3600);
+    if (expire_after == 0)
+       expire_after = VDOM_CACHE_EXPIRE_TIME;
 
-    entry->expire = expire;
+    time_t now = purc_get_monotoic_time();
+    memcpy(entry->md5, md5, MD5_DIGEST_SIZE);
+    entry->expire = now + expire_after;
     entry->length = length;
+    entry->size = sizeof(*entry) + pcvdom_document_estimate_size(vdom);
     entry->vdom = vdom;
 
+    /* the vDOM is left to the caller if it can not be cached */
     pcvdom_document_ref(vdom);
     if (pcutils_map_find_replace_or_insert(md5_vdom_map, md5, entry, NULL)) {
         pcvdom_document_unref(vdom);
+        free(entry);
         return false;
     }
 
+    /* hand the reference of the creator over to the entry */
+    pcvdom_document_unref(vdom);
     return true;
 }
 
@@ -201,18 +281,226 @@ static purc_vdom_t find_vdom_in_cache(unsigned char *md5)
         struct vdom_entry *vdom_entry = entry->val;
         if (t >= vdom_entry->expire) {
             pcutils_map_erase_entry_nolock(md5_vdom_map, entry);
+            nr_expirations++;
+            nr_misses++;
         }
         else {
-            struct vdom_entry *vdom_entry = entry->val;
+            list_move(&vdom_entry->ln, &lru_list);
             vdom = vdom_entry->vdom;
+            nr_hits++;
         }
 
         pcutils_map_unlock(md5_vdom_map);
     }
+    else {
+        pcutils_map_lock(md5_vdom_map);
+        nr_misses++;
+        pcutils_map_unlock(md5_vdom_map);
+    }
+
+    return vdom;
+}
+
+void pcintr_sweep_vdom_cache(void)
+{
+    if (md5_vdom_map == NULL)
+        return;
+
+    time_t now = purc_get_monotoic_time();
+
+    pcutils_map_lock(md5_vdom_map);
+
+    struct vdom_entry *entry, *next;
+    list_for_each_entry_safe(entry, next, &lru_list, ln) {
+        if (now >= entry->expire) {
+            pcutils_map_erase_nolock(md5_vdom_map, entry->md5);
+            nr_expirations++;
+        }
+    }
+
+    shrink_cache_nolock(cache_budget);
+
+    pcutils_map_unlock(md5_vdom_map);
+}
+
+size_t purc_set_vdom_cache_budget(size_t budget)
+{
+    size_t old;
+
+    if (md5_vdom_map == NULL) {
+        old = cache_budget;
+        cache_budget = budget;
+        return old;
+    }
+
+    pcutils_map_lock(md5_vdom_map);
+    old = cache_budget;
+    cache_budget = budget;
+    shrink_cache_nolock(budget);
+    pcutils_map_unlock(md5_vdom_map);
+
+    return old;
+}
+
+bool purc_get_vdom_cache_stats(struct purc_vdom_cache_stats *stats)
+{
+    if (md5_vdom_map == NULL) {
+        purc_set_error(PURC_ERROR_NOT_READY);
+        return false;
+    }
+
+    pcutils_map_lock(md5_vdom_map);
+    stats->nr_entries = pcutils_map_get_size(md5_vdom_map);
+    stats->orig_size = total_orig_size;
+    stats->size = total_size;
+    stats->budget = cache_budget;
+    stats->nr_hits = nr_hits;
+    stats->nr_misses = nr_misses;
+    stats->nr_evictions = nr_evictions;
+    stats->nr_expirations = nr_expirations;
+    pcutils_map_unlock(md5_vdom_map);
+
+    return true;
+}
+
+/*
+ * The persistent vDOM cache: the vDOM is saved in the binary form (see
+ * vdom/vdom-binary.c) in the directory given by PURC_VDOM_CACHE_DIR, in the
+ * file named by the MD5 digest of the HVML text and the version of PurC.
+ * A file written by another version, or broken, is ignored and replaced.
+ */
+static bool disk_cache_path(const unsigned char *md5, char *path)
+{
+    const char *dir = getenv(PURC_ENVV_VDOM_CACHE_DIR);
+    if (dir == NULL || dir[0] == '\0')
+        return false;
+
+    char md5_hex[MD5_DIGEST_SIZE * 2 + 1];
+    pcutils_bin2hex(md5, MD5_DIGEST_SIZE, md5_hex, false);
+
+    int n = snprintf(path, PATH_MAX, "%s/%s-%s.vdom", dir, md5_hex,
+            PURC_VERSION_STRING);
+    return (n > 0 && n < PATH_MAX);
+}
+
+static purc_vdom_t read_vdom_binary_file(const char *path)
+{
+    purc_vdom_t vdom = NULL;
+
+#if HAVE(MMAP)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        purc_set_error(PURC_ERROR_BAD_SYSTEM_CALL);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size <= 0) {
+        close(fd);
+        purc_set_error(PURC_ERROR_BAD_SYSTEM_CALL);
+        return NULL;
+    }
+
+    /* the strings are copied out, so the mapping is released at once */
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        purc_set_error(PURC_ERROR_BAD_SYSTEM_CALL);
+        return NULL;
+    }
+
+    vdom = pcvdom_document_read_binary(data, st.st_size);
+    munmap(data, st.st_size);
+#else
+    size_t length;
+    char *data = purc_load_file_contents(path, &length);
+    if (data == NULL)
+        return NULL;
+
+    vdom = pcvdom_document_read_binary(data, length);
+    free(data);
+#endif
 
+    if (vdom == NULL)
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
     return vdom;
 }
 
+static bool write_vdom_binary_file(const char *path, purc_vdom_t vdom)
+{
+    purc_rwstream_t out = purc_rwstream_new_buffer(0, 0);
+    if (out == NULL)
+        return false;
+
+    bool ok = false;
+    char tmp[PATH_MAX];
+    int fd;
+    mode_t mask;
+    size_t length;
+    const char *data;
+
+    if (pcvdom_document_write_binary(vdom, out))
+        goto done;
+
+    data = purc_rwstream_get_mem_buffer(out, &length);
+    if (data == NULL ||
+            snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= PATH_MAX) {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        goto done;
+    }
+
+    /* write to a temporary file and rename it, so a reader in another
+       process never sees a partially written file */
+    fd = mkstemp(tmp);
+    if (fd < 0) {
+        purc_set_error(PURC_ERROR_BAD_SYSTEM_CALL);
+        goto done;
+    }
+
+    /* mkstemp() creates the file only readable by the owner */
+    mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0666 & ~mask);
+
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        data += n;
+        length -= n;
+    }
+
+    if (close(fd) || length > 0 || rename(tmp, path)) {
+        unlink(tmp);
+        purc_set_error(PURC_ERROR_BAD_SYSTEM_CALL);
+    }
+    else
+        ok = true;
+
+done:
+    purc_rwstream_destroy(out);
+    return ok;
+}
+
+static purc_vdom_t load_vdom_from_disk(const char *path)
+{
+    purc_vdom_t vdom = read_vdom_binary_file(path);
+    if (vdom == NULL) {
+        /* missing, stale or broken; it is replaced after parsing */
+        purc_clr_error();
+    }
+    return vdom;
+}
+
+static void save_vdom_to_disk(const char *path, purc_vdom_t vdom)
+{
+    if (!write_vdom_binary_file(path, vdom))
+        purc_clr_error();
+}
+
 purc_vdom_t
 purc_load_hvml_from_string(const char* string)
 {
@@ -229,20 +517,29 @@ purc_load_hvml_from_string(const char* string)
 
     vdom = find_vdom_in_cache(md5);
     if (vdom == NULL) {
+        char path[PATH_MAX];
+        bool use_disk = disk_cache_path(md5, path);
+        if (use_disk && (vdom = load_vdom_from_disk(path))) {
+            cache_vdom(md5, 0, length, vdom);
+            goto done;
+        }
+
         purc_rwstream_t in;
         in = purc_rwstream_new_from_mem((void*)string, length);
         if (!in) {
-            goto failed;
+            goto done;
         }
 
         if ((vdom = purc_load_hvml_from_rwstream(in))) {
             cache_vdom(md5, 0, length, vdom);
+            if (use_disk)
+                save_vdom_to_disk(path, vdom);
         }
 
         purc_rwstream_destroy(in);
     }
 
-failed:
+done:
     return vdom;
 }
 
@@ -260,6 +557,13 @@ purc_load_hvml_from_file(const char* file)
 
     vdom = find_vdom_in_cache(md5);
     if (vdom == NULL) {
+        char path[PATH_MAX];
+        bool use_disk = disk_cache_path(md5, path);
+        if (use_disk && (vdom = load_vdom_from_disk(path))) {
+            cache_vdom(md5, 0, length, vdom);
+            return vdom;
+        }
+
         purc_rwstream_t in;
         in = purc_rwstream_new_from_file(file, "r");
         if (!in) {
@@ -268,6 +572,8 @@ purc_load_hvml_from_file(const char* file)
 
         if ((vdom = purc_load_hvml_from_rwstream(in))) {
             cache_vdom(md5, 0, length, vdom);
+            if (use_disk)
+                save_vdom_to_disk(path, vdom);
         }
         purc_rwstream_destroy(in);
     }
@@ -320,3 +626,36 @@ purc_load_hvml_from_url(const char* url)
     return vdom;
 }
 
+purc_vdom_t
+purc_load_hvml_from_bundle(const char* file)
+{
+    size_t length;
+    purc_vdom_t vdom;
+    unsigned char md5[MD5_DIGEST_SIZE];
+
+    if (!pcutils_file_md5(file, md5, &length) || length == 0) {
+        purc_set_error(PURC_ERROR_BAD_SYSTEM_CALL);
+        return NULL;
+    }
+
+    vdom = find_vdom_in_cache(md5);
+    if (vdom == NULL) {
+        vdom = read_vdom_binary_file(file);
+        if (vdom)
+            cache_vdom(md5, 0, length, vdom);
+    }
+
+    return vdom;
+}
+
+bool
+purc_compile_hvml_to_bundle(purc_vdom_t vdom, const char* file)
+{
+    if (vdom == NULL || file == NULL || file[0] == '\0') {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        return false;
+    }
+
+    return write_vdom_binary_file(file, vdom);
+}
+
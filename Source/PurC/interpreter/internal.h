@@ -287,6 +287,23 @@ pcintr_rdr_update_widget(struct pcrdr_conn *conn, uint64_t workspace,
 bool
 pcintr_rdr_page_control_load(pcintr_stack_t stack);
 
+struct page_writer;
+
+/* creates a writer sending the contents of a page to the renderer in
+   chunks which never split a UTF-8 character */
+struct page_writer *
+pcintr_rdr_page_writer_new(struct pcrdr_conn *conn, pcrdr_msg_target target,
+        uint64_t target_value, pcrdr_msg_data_type data_type);
+
+/* the writer of a stream created by purc_rwstream_new_for_dump() */
+ssize_t
+pcintr_rdr_page_writer_write(void *ctxt, const void *buf, size_t count);
+
+/* sends the remaining contents, destroys the writer, and returns the
+   response to the last request */
+pcrdr_msg *
+pcintr_rdr_page_writer_end(struct page_writer *writer);
+
 pcrdr_msg *
 pcintr_rdr_send_dom_req(pcintr_stack_t stack, pcdoc_operation op,
         pcdoc_element_t element, const char* property,
@@ -307,6 +324,14 @@ pcintr_rdr_send_dom_req_simple_raw(pcintr_stack_t stack, pcdoc_operation op,
         pcdoc_element_t element, const char *property,
         pcrdr_msg_data_type data_type, const char *data, size_t len);
 
+/* sends the batched DOM operations of the coroutine */
+bool
+pcintr_rdr_flush_dom_batch(pcintr_coroutine_t co);
+
+/* sends the batched DOM operations of all coroutines in the heap */
+void
+pcintr_rdr_flush_dom_batches(struct pcintr_heap *heap);
+
 
 #define pcintr_rdr_dom_append_content(stack, element, content)          \
     pcintr_rdr_send_dom_req_simple_raw(stack, PCDOC_OP_APPEND,          \
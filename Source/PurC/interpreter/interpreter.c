@@ -53,6 +53,7 @@
 #include <libgen.h>
 
 #define EVENT_TIMER_INTRVAL  10
+#define VDOM_CACHE_SWEEP_INTRVAL    10000
 
 #define EVENT_SEPARATOR      ':'
 
@@ -76,6 +77,19 @@ stack_frame_release(struct pcintr_stack_frame *frame)
         frame->ctxt  = NULL;
     }
 
+    if (frame->exclamation_listener) {
+        purc_variant_t exclamation_var;
+        exclamation_var = frame->symbol_vars[PURC_SYMBOL_VAR_EXCLAMATION];
+        purc_variant_revoke_listener(exclamation_var,
+                frame->exclamation_listener);
+        frame->exclamation_listener = NULL;
+
+        /* the temporary variables go away with the frame */
+        size_t sz;
+        if (purc_variant_object_size(exclamation_var, &sz) && sz > 0)
+            pcvarmgr_bump_generation();
+    }
+
     for (size_t i=0; i<PCA_TABLESIZE(frame->symbol_vars); ++i) {
         PURC_VARIANT_SAFE_CLEAR(frame->symbol_vars[i]);
     }
@@ -321,6 +335,11 @@ stack_release(pcintr_stack_t stack)
 
     release_scoped_variables(stack);
 
+    if (stack->var_cache) {
+        free(stack->var_cache);
+        stack->var_cache = NULL;
+    }
+
     pcintr_destroy_observer_list(&stack->intr_observers);
     pcintr_destroy_observer_list(&stack->hvml_observers);
 
@@ -367,6 +386,7 @@ coroutine_release(pcintr_coroutine_t co)
 
         PURC_VARIANT_SAFE_CLEAR(co->doc_contents);
         PURC_VARIANT_SAFE_CLEAR(co->doc_wrotten_len);
+        PURC_VARIANT_SAFE_CLEAR(co->dom_batch);
 
         struct list_head *children = &co->children;
         struct list_head *p, *n;
@@ -486,6 +506,11 @@ static void _cleanup_instance(struct pcinst* inst)
         heap->event_timer = NULL;
     }
 
+    if (heap->vdom_cache_timer) {
+        pcintr_timer_destroy(heap->vdom_cache_timer);
+        heap->vdom_cache_timer = NULL;
+    }
+
     if (heap->name_chan_map) {
         pcutils_map_destroy(heap->name_chan_map);
         heap->name_chan_map = NULL;
@@ -499,6 +524,16 @@ static void _cleanup_instance(struct pcinst* inst)
 static void
 event_timer_fire(pcintr_timer_t timer, const char* id, void* data);
 
+static void
+vdom_cache_timer_fire(pcintr_timer_t timer, const char* id, void* data)
+{
+    UNUSED_PARAM(timer);
+    UNUSED_PARAM(id);
+    UNUSED_PARAM(data);
+
+    pcintr_sweep_vdom_cache();
+}
+
 static int _init_instance(struct pcinst* inst,
         const purc_instance_extra_info* extra_info)
 {
@@ -531,6 +566,13 @@ static int _init_instance(struct pcinst* inst,
     heap->coroutines = RB_ROOT;
     heap->running_coroutine = NULL;
 
+    const char *env_value = getenv(PURC_ENVV_RDR_ASYNC_DOM);
+    heap->async_dom_reqs = (env_value && (*env_value == '1' ||
+                pcutils_strcasecmp(env_value, "true") == 0));
+    env_value = getenv(PURC_ENVV_RDR_BATCH_DOM);
+    heap->batch_dom_reqs = (env_value && (*env_value == '1' ||
+                pcutils_strcasecmp(env_value, "true") == 0));
+
     heap->name_chan_map =
         pcutils_map_create(NULL, NULL, NULL,
                 (free_val_fn)pcchan_destroy, comp_key_string, false);
@@ -546,6 +588,15 @@ static int _init_instance(struct pcinst* inst,
     pcintr_timer_set_interval(heap->event_timer, EVENT_TIMER_INTRVAL);
     pcintr_timer_start(heap->event_timer);
 
+    /* not fatal: the cache is still bounded when a vDOM is inserted */
+    heap->vdom_cache_timer = pcintr_timer_create(NULL, NULL,
+            vdom_cache_timer_fire, inst);
+    if (heap->vdom_cache_timer) {
+        pcintr_timer_set_interval(heap->vdom_cache_timer,
+                VDOM_CACHE_SWEEP_INTRVAL);
+        pcintr_timer_start(heap->vdom_cache_timer);
+    }
+
     return 0;
 }
 
@@ -727,6 +778,21 @@ init_at_symval(struct pcintr_stack_frame *frame)
     return r ? -1 : 0;
 }
 
+static bool
+exclamation_var_handler(purc_variant_t source, pcvar_op_t msg_type,
+        void* ctxt, size_t nr_args, purc_variant_t* argv)
+{
+    UNUSED_PARAM(source);
+    UNUSED_PARAM(msg_type);
+    UNUSED_PARAM(ctxt);
+    UNUSED_PARAM(nr_args);
+    UNUSED_PARAM(argv);
+
+    /* a temporary variable is bound, unbound or changed */
+    pcvarmgr_bump_generation();
+    return true;
+}
+
 static int
 init_exclamation_symval(struct pcintr_stack_frame *frame)
 {
@@ -740,8 +806,15 @@ init_exclamation_symval(struct pcintr_stack_frame *frame)
     int r;
     r = pcintr_set_exclamation_var(frame, exclamation_var);
     purc_variant_unref(exclamation_var);
+    if (r)
+        return -1;
 
-    return r ? -1 : 0;
+    int op = PCVAR_OPERATION_GROW | PCVAR_OPERATION_SHRINK |
+        PCVAR_OPERATION_CHANGE;
+    frame->exclamation_listener = purc_variant_register_post_listener(
+            exclamation_var, (pcvar_op_t)op, exclamation_var_handler, NULL);
+
+    return frame->exclamation_listener ? 0 : -1;
 }
 
 static int
@@ -1072,43 +1145,11 @@ pcintr_eval_vdom_attr(pcintr_stack_t stack, struct pcvdom_attr *attr)
     return eval_vdom_attr(stack, attr);
 }
 
-struct pcintr_walk_attrs_ud {
-    struct pcintr_stack_frame       *frame;
-    struct pcvdom_element           *element;
-    void                            *ud;
-    pcintr_attr_f                    cb;
-};
-
-static int
-walk_attr(void *key, void *val, void *ud)
-{
-    PC_ASSERT(key);
-    PC_ASSERT(val);
-    PC_ASSERT(ud);
-
-    struct pcintr_walk_attrs_ud *data = (struct pcintr_walk_attrs_ud*)ud;
-
-    struct pcintr_stack_frame *frame = data->frame;
-    PC_ASSERT(frame);
-
-    struct pcvdom_attr *attr = (struct pcvdom_attr*)val;
-    PC_ASSERT(attr->key);
-    PC_ASSERT(attr->key == key);
-
-    struct pcvdom_element *element = data->element;
-    PC_ASSERT(element);
-
-    purc_atom_t atom = PCHVML_KEYWORD_ATOM(HVML, attr->key);
-    // NOTE: we only dispatch those keyworded-attr to caller
-    return data->cb(frame, element, atom, attr, data->ud);
-}
-
 int
 pcintr_vdom_walk_attrs(struct pcintr_stack_frame *frame,
         struct pcvdom_element *element, void *ud, pcintr_attr_f cb)
 {
-    struct pcutils_map *attrs = element->attrs;
-    if (!attrs)
+    if (element->nr_attrs == 0)
         return 0;
 
     PC_ASSERT(frame->pos == element);
@@ -1120,16 +1161,13 @@ pcintr_vdom_walk_attrs(struct pcintr_stack_frame *frame,
             return -1;
     }
 
-    struct pcintr_walk_attrs_ud data = {
-        .frame        = frame,
-        .element      = element,
-        .ud           = ud,
-        .cb           = cb,
-    };
-
-    int r = pcutils_map_traverse(attrs, &data, walk_attr);
-    if (r)
-        return r;
+    for (unsigned int i = 0; i < element->nr_attrs; i++) {
+        struct pcvdom_attr *attr = element->attrs[i];
+        // NOTE: the atom of the keyword is resolved when the attr is created
+        int r = cb(frame, element, attr->kw_atom, attr, ud);
+        if (r)
+            return r;
+    }
 
     return 0;
 }
@@ -1546,6 +1584,8 @@ execute_one_step_for_exiting_co(pcintr_coroutine_t co)
     pcintr_heap_t heap = co->owner;
     struct pcinst *inst = heap->owner;
 
+    pcintr_rdr_flush_dom_batch(co);
+
     purc_variant_t result = pcintr_coroutine_get_result(co);
 
     if (heap->cond_handler) {
@@ -1779,8 +1819,7 @@ coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
         goto fail_co;
     }
 
-    pcvdom_document_ref(vdom);
-    co->vdom = vdom;
+    co->vdom = pcvdom_document_ref(vdom);
     pcintr_coroutine_set_state(co, CO_STATE_READY);
     list_head_init(&co->children);
     list_head_init(&co->ln_stopped);
@@ -1789,7 +1828,7 @@ coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
 
     co->mq = pcinst_msg_queue_create();
     if (!co->mq) {
-        goto fail_co;
+        goto fail_mq;
     }
 
     co->variables = pcvarmgr_create();
@@ -1845,6 +1884,9 @@ coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
 fail_variables:
     pcinst_msg_queue_destroy(co->mq);
 
+fail_mq:
+    pcvdom_document_unref(vdom);
+
 fail_co:
     free(co);
 
@@ -1927,10 +1969,7 @@ purc_schedule_vdom(purc_vdom_t vdom,
     return co;
 
 failed:
-    if (co == NULL) {
-        pcvdom_document_unref(vdom);
-    }
-    else {
+    if (co) {
         coroutine_destroy(co);
     }
 
@@ -2634,6 +2673,16 @@ pcintr_set_symbol_var(struct pcintr_stack_frame *frame,
     PC_ASSERT(symbol < PURC_SYMBOL_VAR_MAX);
     PC_ASSERT(val != PURC_VARIANT_INVALID);
 
+    if (symbol == PURC_SYMBOL_VAR_EXCLAMATION) {
+        if (frame->exclamation_listener) {
+            purc_variant_revoke_listener(frame->symbol_vars[symbol],
+                    frame->exclamation_listener);
+            frame->exclamation_listener = NULL;
+            /* the temporary variables are replaced */
+            pcvarmgr_bump_generation();
+        }
+    }
+
     purc_variant_ref(val);
     PURC_VARIANT_SAFE_CLEAR(frame->symbol_vars[symbol]);
     frame->symbol_vars[symbol] = val;
@@ -2745,6 +2794,7 @@ pcintr_observe_vcm_ev(pcintr_stack_t stack, struct pcintr_observer* observer,
     frame->ops = pcintr_get_ops_by_element(observer->pos);
     frame->scope = observer->scope;
     frame->pos = observer->pos;
+    pcvarmgr_bump_generation();
     frame->silently = pcintr_is_element_silently(frame->pos) ? 1 : 0;
     frame->edom_element = observer->edom_element;
 
@@ -83,6 +83,7 @@ pcintr_handle_task(struct pcintr_observer_task *task)
     frame->ops = pcintr_get_ops_by_element(task->pos);
     frame->scope = task->scope;
     frame->pos = task->pos;
+    pcvarmgr_bump_generation();
     frame->silently = pcintr_is_element_silently(frame->pos) ? 1 : 0;
     frame->edom_element = task->edom_element;
     frame->next_step = NEXT_STEP_AFTER_PUSHED;
@@ -41,11 +41,19 @@
 #define LAYOUT_STYLE_KEY        "layoutStyle"
 #define TOOLKIT_STYLE_KEY       "toolkitStyle"
 
-#define BUFF_MIN                1024
-#define BUFF_MAX                1024 * 1024 * 4
 #define LEN_BUFF_LONGLONGINT    128
 
-#define DEF_LEN_ONE_WRITE       1024 * 10
+#define DEF_LEN_ONE_WRITE       (1024 * 10)
+
+/* the maximal number of the pipelined DOM requests waiting for responses */
+#define MAX_INFLIGHT_DOM_REQS   256
+#define INFLIGHT_WAIT_MS        10
+
+/* the maximal number of the DOM operations in a batch request */
+#define MAX_BATCHED_DOM_OPS     256
+/* the maximal length of the data of a batch request; leave room for the
+   headers in a message serialized in memory */
+#define MAX_BATCHED_DOM_LEN     (PCRDR_MAX_INMEM_PAYLOAD_SIZE - 1024)
 
 static struct pcintr_rdr_data_type {
     const char *type_name;
@@ -109,13 +117,12 @@ object_set(purc_variant_t object, const char *key, const char *value)
     return true;
 }
 
-pcrdr_msg *pcintr_rdr_send_request_and_wait_response(struct pcrdr_conn *conn,
-        pcrdr_msg_target target, uint64_t target_value, const char *operation,
+static pcrdr_msg *make_request_message(pcrdr_msg_target target,
+        uint64_t target_value, const char *operation,
         pcrdr_msg_element_type element_type, const char *element,
         const char *property, pcrdr_msg_data_type data_type,
         purc_variant_t data, size_t data_len)
 {
-    pcrdr_msg *response_msg = NULL;
     pcrdr_msg *msg = pcrdr_make_request_message(
             target,                             /* target */
             target_value,                       /* target_value */
@@ -131,7 +138,7 @@ pcrdr_msg *pcintr_rdr_send_request_and_wait_response(struct pcrdr_conn *conn,
             );
     if (msg == NULL) {
         purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
-        goto failed;
+        return NULL;
     }
 
     msg->dataType = data_type;
@@ -140,6 +147,29 @@ pcrdr_msg *pcintr_rdr_send_request_and_wait_response(struct pcrdr_conn *conn,
         msg->textLen = data_len;
     }
 
+    return msg;
+}
+
+pcrdr_msg *pcintr_rdr_send_request_and_wait_response(struct pcrdr_conn *conn,
+        pcrdr_msg_target target, uint64_t target_value, const char *operation,
+        pcrdr_msg_element_type element_type, const char *element,
+        const char *property, pcrdr_msg_data_type data_type,
+        purc_variant_t data, size_t data_len)
+{
+    pcrdr_msg *response_msg = NULL;
+
+    /* keep the order of the batched DOM operations and this request */
+    pcintr_coroutine_t co = pcintr_get_coroutine();
+    if (co && co->dom_batch) {
+        pcintr_rdr_flush_dom_batch(co);
+    }
+
+    pcrdr_msg *msg = make_request_message(target, target_value, operation,
+            element_type, element, property, data_type, data, data_len);
+    if (msg == NULL) {
+        goto failed;
+    }
+
     if (pcrdr_send_request_and_wait_response(conn,
             msg, PCRDR_TIME_DEF_EXPECTED, &response_msg) < 0) {
         goto failed;
@@ -811,108 +841,171 @@ pcintr_attach_to_renderer(pcintr_coroutine_t cor,
     return true;
 }
 
-static pcrdr_msg *
-rdr_page_control_load_large_page(struct pcrdr_conn *conn,
-        pcrdr_msg_target target, uint64_t target_value,
-        pcrdr_msg_data_type data_type,
-        const char *doc_content, size_t len_content)
+/*
+ * The writer which sends the serialized document to the renderer in chunks:
+ * the first chunk with `writeBegin`, the following ones with `writeMore`,
+ * and the remaining bytes with `writeEnd`. If the whole document fits in
+ * one chunk, it is sent with `load` instead.
+ */
+struct page_writer {
+    struct pcrdr_conn      *conn;
+    pcrdr_msg_target        target;
+    uint64_t                target_value;
+    pcrdr_msg_data_type     data_type;
+
+    /* the response to the last request */
+    pcrdr_msg              *response_msg;
+    /* the number of chunks sent */
+    unsigned                nr_chunks;
+    bool                    failed;
+
+    size_t                  len;
+    char                    buf[DEF_LEN_ONE_WRITE];
+};
+
+static bool
+page_writer_send(struct page_writer *writer, const char *operation,
+        size_t len)
 {
-    pcrdr_msg *response_msg = NULL;
-    pcrdr_msg_element_type element_type = PCRDR_MSG_ELEMENT_TYPE_VOID;
     purc_variant_t data;
-    size_t len_wrotten;
-    size_t len_to_write = 0;
-
-    // writeBegin
-    const char *start = doc_content;
-    const char *end;
-    pcutils_string_check_utf8_len(start, DEF_LEN_ONE_WRITE, NULL, &end);
-    if (end > start) {
-        len_to_write = end - start;
 
-        data = purc_variant_make_string_static(start, false);
-        len_wrotten = len_to_write;
+    if (writer->response_msg) {
+        pcrdr_release_message(writer->response_msg);
+        writer->response_msg = NULL;
     }
-    else {
-        LOG_ERROR("No valid character in document content\n");
+
+    data = purc_variant_make_string_ex(writer->buf, len, false);
+    if (data == PURC_VARIANT_INVALID) {
         goto failed;
     }
 
-    response_msg = pcintr_rdr_send_request_and_wait_response(
-            conn, target, target_value, PCRDR_OPERATION_WRITEBEGIN,
-            element_type, NULL, NULL, data_type, data, len_to_write);
-    if (response_msg == NULL) {
+    writer->response_msg = pcintr_rdr_send_request_and_wait_response(
+            writer->conn, writer->target, writer->target_value, operation,
+            PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL, writer->data_type,
+            data, 0);
+    if (writer->response_msg == NULL) {
         goto failed;
     }
 
-    if (response_msg->retCode != PCRDR_SC_OK) {
+    if (writer->response_msg->retCode != PCRDR_SC_OK) {
         PC_ERROR("failed to write content to rdr\n");
         goto failed;
     }
 
-    if (len_wrotten == len_content) {
-        goto done;
+    /* keep the bytes of the incomplete character if there is any */
+    writer->len -= len;
+    memmove(writer->buf, writer->buf + len, writer->len);
+    writer->nr_chunks++;
+    return true;
+
+failed:
+    writer->failed = true;
+    return false;
+}
+
+/* returns the length of the leading complete UTF-8 characters */
+static size_t
+utf8_complete_len(const char *buf, size_t len)
+{
+    size_t n = len;
+
+    /* back to the leading byte of the last character */
+    while (n > 0 && ((unsigned char)buf[n - 1] & 0xC0) == 0x80 &&
+            len - n < 3) {
+        n--;
     }
 
-writting:
-    len_to_write = 0;
-    if (len_wrotten + DEF_LEN_ONE_WRITE > len_content) {
-        // writeEnd
-        data = purc_variant_make_string_static(doc_content + len_wrotten,
-                false);
-        response_msg = pcintr_rdr_send_request_and_wait_response(
-                conn, target, target_value, PCRDR_OPERATION_WRITEEND,
-                element_type, NULL, NULL, data_type, data, 0);
-        if (response_msg == NULL) {
-            goto failed;
-        }
+    if (n > 0) {
+        unsigned char c = buf[n - 1];
+        size_t sz_char = 1;
+        if (c >= 0xF0)
+            sz_char = 4;
+        else if (c >= 0xE0)
+            sz_char = 3;
+        else if (c >= 0xC0)
+            sz_char = 2;
 
-        if (response_msg->retCode != PCRDR_SC_OK) {
-            PC_ERROR("failed to write content to rdr\n");
-            goto failed;
-        }
-        goto done;
+        if (len - (n - 1) < sz_char)
+            return n - 1;
     }
-    else {
-        // writeMore
-        start = doc_content + len_wrotten;
-        pcutils_string_check_utf8_len(start, DEF_LEN_ONE_WRITE, NULL, &end);
-        if (end > start) {
-            len_to_write = end - start;
-            len_wrotten += len_to_write;
-            data = purc_variant_make_string_static(start, false);
-        }
-        else {
-            PC_WARN("no valid character for rdr\n");
-            goto failed;
-        }
 
-        response_msg = pcintr_rdr_send_request_and_wait_response(
-                conn, target, target_value, PCRDR_OPERATION_WRITEMORE,
-                element_type, NULL, NULL, data_type, data, len_to_write);
-        if (response_msg == NULL) {
-            goto failed;
-        }
+    return len;
+}
 
-        if (response_msg->retCode != PCRDR_SC_OK) {
-            PC_ERROR("failed to write content to rdr\n");
-            goto failed;
-        }
+struct page_writer *
+pcintr_rdr_page_writer_new(struct pcrdr_conn *conn, pcrdr_msg_target target,
+        uint64_t target_value, pcrdr_msg_data_type data_type)
+{
+    struct page_writer *writer = calloc(1, sizeof(*writer));
+    if (writer == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
 
-        if (len_wrotten == len_content) {
-            goto done;
+    writer->conn = conn;
+    writer->target = target;
+    writer->target_value = target_value;
+    writer->data_type = data_type;
+    return writer;
+}
+
+ssize_t
+pcintr_rdr_page_writer_write(void *ctxt, const void *buf, size_t count)
+{
+    struct page_writer *writer = ctxt;
+    const char *bytes = buf;
+    size_t left = count;
+
+    if (writer->failed)
+        return -1;
+
+    while (left > 0) {
+        /* send a full buffer only when more bytes come, so that the whole
+           page fitting in one chunk is sent by `load` */
+        if (writer->len == sizeof(writer->buf)) {
+            size_t len = utf8_complete_len(writer->buf, writer->len);
+            if (len == 0) {
+                PC_WARN("no valid character for rdr\n");
+                writer->failed = true;
+                return -1;
+            }
+
+            if (!page_writer_send(writer, writer->nr_chunks ?
+                        PCRDR_OPERATION_WRITEMORE : PCRDR_OPERATION_WRITEBEGIN,
+                        len)) {
+                return -1;
+            }
         }
-        goto writting;
+
+        size_t n = sizeof(writer->buf) - writer->len;
+        if (n > left)
+            n = left;
+
+        memcpy(writer->buf + writer->len, bytes, n);
+        writer->len += n;
+        bytes += n;
+        left -= n;
     }
 
-done:
-    return response_msg;
+    return count;
+}
 
-failed:
-    if (response_msg) {
+pcrdr_msg *
+pcintr_rdr_page_writer_end(struct page_writer *writer)
+{
+    if (!writer->failed) {
+        page_writer_send(writer, writer->nr_chunks ?
+                PCRDR_OPERATION_WRITEEND : PCRDR_OPERATION_LOAD, writer->len);
+    }
+
+    pcrdr_msg *response_msg = writer->response_msg;
+    if (writer->failed && response_msg) {
         pcrdr_release_message(response_msg);
+        response_msg = NULL;
     }
-    return NULL;
+
+    free(writer);
+    return response_msg;
 }
 
 bool
@@ -926,14 +1019,10 @@ pcintr_rdr_page_control_load(pcintr_stack_t stack)
 
     purc_document_t doc = stack->doc;
 
-    const char *operation = PCRDR_OPERATION_LOAD;
     pcrdr_msg_target target;
-    uint64_t target_value;
-    pcrdr_msg_element_type element_type = PCRDR_MSG_ELEMENT_TYPE_VOID;
-    pcrdr_msg_data_type data_type = doc->def_text_type;// VW
-    purc_variant_t req_data = PURC_VARIANT_INVALID;
 
     unsigned opt = 0;
+    struct page_writer *writer = NULL;
     purc_rwstream_t out = NULL;
 
     switch (stack->co->target_page_type) {
@@ -953,9 +1042,16 @@ pcintr_rdr_page_control_load(pcintr_stack_t stack)
         PC_ASSERT(0); // TODO
         break;
     }
-    target_value = stack->co->target_page_handle;
 
-    out = purc_rwstream_new_buffer(BUFF_MIN, BUFF_MAX);
+    writer = pcintr_rdr_page_writer_new(pcinst_current()->conn_to_rdr,
+            target, stack->co->target_page_handle,
+            doc->def_text_type);// VW
+    if (writer == NULL) {
+        goto failed;
+    }
+
+    /* serialize the document straight into the chunks sent to renderer */
+    out = purc_rwstream_new_for_dump(writer, pcintr_rdr_page_writer_write);
     if (out == NULL) {
         goto failed;
     }
@@ -966,34 +1062,13 @@ pcintr_rdr_page_control_load(pcintr_stack_t stack)
     opt |= PCDOC_SERIALIZE_OPT_FULL_DOCTYPE;
     opt |= PCDOC_SERIALIZE_OPT_WITH_HVML_HANDLE;
 
-    if (0 != purc_document_serialize_contents_to_stream(doc, opt, out)) {
+    if (0 != purc_document_serialize_contents_to_stream(doc, opt, out) ||
+            writer->failed) {
         goto failed;
     }
 
-    size_t sz_content = 0;
-    size_t sz_buff = 0;
-    char *p = (char*)purc_rwstream_get_mem_buffer_ex(out, &sz_content,
-            &sz_buff,true);
-    req_data = purc_variant_make_string_reuse_buff(p, sz_content, false);
-    if (req_data == PURC_VARIANT_INVALID) {
-        free(p);
-        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
-        goto failed;
-    }
-
-    struct pcinst *inst = pcinst_current();
-
-    if (sz_content > DEF_LEN_ONE_WRITE) {
-        response_msg = rdr_page_control_load_large_page(inst->conn_to_rdr,
-                    target, target_value, data_type,
-                    p, sz_content);
-    }
-    else {
-        response_msg = pcintr_rdr_send_request_and_wait_response(
-                inst->conn_to_rdr, target, target_value, operation,
-                element_type, NULL, NULL, data_type, req_data, 0);
-    }
-
+    response_msg = pcintr_rdr_page_writer_end(writer);
+    writer = NULL;
     if (response_msg == NULL) {
         goto failed;
     }
@@ -1005,13 +1080,11 @@ pcintr_rdr_page_control_load(pcintr_stack_t stack)
 
     pcrdr_release_message(response_msg);
 
-
     purc_rwstream_destroy(out);
-    out = NULL;
 
     if (ret_code != PCRDR_SC_OK) {
         purc_set_error(PCRDR_ERROR_SERVER_REFUSED);
-        goto failed;
+        return false;
     }
 
     return true;
@@ -1021,10 +1094,11 @@ failed:
         purc_rwstream_destroy(out);
     }
 
-    /* VW: double free here
-    if (req_data != PURC_VARIANT_INVALID) {
-        purc_variant_unref(req_data);
-    } */
+    if (writer) {
+        /* do not send the remaining contents */
+        writer->failed = true;
+        pcintr_rdr_page_writer_end(writer);
+    }
 
     return false;
 }
@@ -1041,6 +1115,35 @@ static const char *rdr_ops[] = {
     "",     // unknown
 };
 
+static const char *
+dom_req_operation(pcdoc_operation op, const char *property)
+{
+    if (property && op == PCDOC_OP_DISPLACE) {
+        // VW: use 'update' operation when displace property
+        return PCRDR_OPERATION_UPDATE;
+    }
+
+    return rdr_ops[op];
+}
+
+static bool
+dom_req_element(pcdoc_element_t element, char *elem, size_t sz)
+{
+    int n = snprintf(elem, sz,
+            "%llx", (unsigned long long int)(uint64_t)element);
+    if (n < 0) {
+        purc_set_error(PURC_ERROR_BAD_STDC_CALL);
+        return false;
+    }
+    else if ((size_t)n >= sz) {
+        PC_DEBUG ("Too small elemer to serialize message.\n");
+        purc_set_error(PURC_ERROR_TOO_SMALL_BUFF);
+        return false;
+    }
+
+    return true;
+}
+
 pcrdr_msg *
 pcintr_rdr_send_dom_req(pcintr_stack_t stack, pcdoc_operation op,
         pcdoc_element_t element, const char* property,
@@ -1051,11 +1154,7 @@ pcintr_rdr_send_dom_req(pcintr_stack_t stack, pcdoc_operation op,
         return NULL;
     }
 
-    const char *operation = rdr_ops[op];
-    if (property && op == PCDOC_OP_DISPLACE) {
-        // VW: use 'update' operation when displace property
-        operation = PCRDR_OPERATION_UPDATE;
-    }
+    const char *operation = dom_req_operation(op, property);
 
     pcrdr_msg *response_msg = NULL;
 
@@ -1064,15 +1163,7 @@ pcintr_rdr_send_dom_req(pcintr_stack_t stack, pcdoc_operation op,
     pcrdr_msg_element_type element_type = PCRDR_MSG_ELEMENT_TYPE_HANDLE;
 
     char elem[LEN_BUFF_LONGLONGINT];
-    int n = snprintf(elem, sizeof(elem),
-            "%llx", (unsigned long long int)(uint64_t)element);
-    if (n < 0) {
-        purc_set_error(PURC_ERROR_BAD_STDC_CALL);
-        goto failed;
-    }
-    else if ((size_t)n >= sizeof (elem)) {
-        PC_DEBUG ("Too small elemer to serialize message.\n");
-        purc_set_error(PURC_ERROR_TOO_SMALL_BUFF);
+    if (!dom_req_element(element, elem, sizeof(elem))) {
         goto failed;
     }
 
@@ -1100,6 +1191,23 @@ failed:
     return NULL;
 }
 
+static purc_variant_t
+make_dom_req_data(pcrdr_msg_data_type data_type, const char *data, size_t len)
+{
+    purc_variant_t req_data;
+    if (data_type == PCRDR_MSG_DATA_TYPE_JSON) {
+        req_data = purc_variant_make_from_json_string(data, len);
+    }
+    else {  /* VW: for other data types */
+        req_data = purc_variant_make_string(data, false);
+    }
+
+    if (req_data == PURC_VARIANT_INVALID) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    }
+    return req_data;
+}
+
 pcrdr_msg *
 pcintr_rdr_send_dom_req_raw(pcintr_stack_t stack, pcdoc_operation op,
         pcdoc_element_t element, const char* property,
@@ -1110,39 +1218,165 @@ pcintr_rdr_send_dom_req_raw(pcintr_stack_t stack, pcdoc_operation op,
         return NULL;
     }
 
-    pcrdr_msg *ret = NULL;
-    purc_variant_t req_data = PURC_VARIANT_INVALID;
-    if (data_type == PCRDR_MSG_DATA_TYPE_JSON) {
-        req_data = purc_variant_make_from_json_string(data, len);
-        if (req_data == PURC_VARIANT_INVALID) {
-            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
-            goto failed;
+    purc_variant_t req_data = make_dom_req_data(data_type, data, len);
+    if (req_data == PURC_VARIANT_INVALID) {
+        return NULL;
+    }
+
+    return pcintr_rdr_send_dom_req(stack, op, element,
+            property, data_type, req_data);
+}
+
+static void
+post_dom_req_failed_event(purc_atom_t cid, int ret_code)
+{
+    pcintr_coroutine_t co = pcintr_coroutine_get_by_id(cid);
+    if (co == NULL) {
+        /* the coroutine has exited */
+        return;
+    }
+
+    purc_variant_t hvml = pcintr_get_coroutine_variable(co,
+            PURC_PREDEF_VARNAME_CRTN);
+    purc_variant_t data = purc_variant_make_longint(ret_code);
+    pcintr_coroutine_post_event(cid, PCRDR_MSG_EVENT_REDUCE_OPT_KEEP,
+            hvml, MSG_TYPE_RDR_STATE, MSG_SUB_TYPE_DOM_REQ_FAILED,
+            data, PURC_VARIANT_INVALID);
+    if (data)
+        purc_variant_unref(data);
+}
+
+static int
+dom_req_response_handler(pcrdr_conn* conn,
+        const char *request_id, int state,
+        void *context, const pcrdr_msg *response_msg)
+{
+    UNUSED_PARAM(conn);
+    UNUSED_PARAM(request_id);
+
+    struct pcinst *inst = pcinst_current();
+    if (inst == NULL || inst->intr_heap == NULL) {
+        /* the instance is being cleaned up */
+        return 0;
+    }
+
+    struct pcintr_heap *heap = inst->intr_heap;
+    PC_ASSERT(heap->nr_inflight_dom_reqs > 0);
+    heap->nr_inflight_dom_reqs--;
+
+    purc_atom_t cid = (purc_atom_t)(uintptr_t)context;
+    switch (state) {
+    case PCRDR_RESPONSE_RESULT:
+        if (response_msg->retCode != PCRDR_SC_OK) {
+            post_dom_req_failed_event(cid, response_msg->retCode);
         }
+        break;
+
+    case PCRDR_RESPONSE_TIMEOUT:
+        post_dom_req_failed_event(cid, PCRDR_SC_CALLEE_TIMEOUT);
+        break;
+
+    default:
+        /* cancelled: the connection is lost, and the coroutines
+           get `rdrState:connLost` already */
+        break;
     }
-    else {  /* VW: for other data types */
-        req_data = purc_variant_make_string(data, false);
-        if (req_data == PURC_VARIANT_INVALID) {
-            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
-            goto failed;
+
+    return 0;
+}
+
+/* waits until the number of the inflight DOM requests is below the limit */
+static bool
+wait_inflight_dom_reqs(struct pcinst *inst, size_t limit)
+{
+    struct pcintr_heap *heap = inst->intr_heap;
+
+    while (heap->nr_inflight_dom_reqs >= limit) {
+        if (inst->conn_to_rdr == NULL)
+            return false;
+
+        if (pcrdr_wait_and_dispatch_message(inst->conn_to_rdr,
+                    INFLIGHT_WAIT_MS) < 0) {
+            int err = purc_get_last_error();
+            if (err == PCRDR_ERROR_IO || err == PCRDR_ERROR_PEER_CLOSED)
+                return false;
         }
     }
 
-    ret = pcintr_rdr_send_dom_req(stack, op, element,
-            property, data_type, req_data);
-    return ret;
+    return true;
+}
+
+/*
+ * Sends a DOM request without waiting for the response. The response
+ * is dispatched later by the scheduler; a failure is reported to the
+ * coroutine by a `rdrState:domReqFailed` event.
+ */
+static bool
+send_request_async(struct pcinst *inst, pcintr_coroutine_t co, pcrdr_msg *msg)
+{
+    if (!wait_inflight_dom_reqs(inst, MAX_INFLIGHT_DOM_REQS)) {
+        return false;
+    }
+
+    if (pcrdr_send_request(inst->conn_to_rdr, msg, PCRDR_TIME_DEF_EXPECTED,
+                (void *)(uintptr_t)co->cid, dom_req_response_handler) < 0) {
+        return false;
+    }
+
+    inst->intr_heap->nr_inflight_dom_reqs++;
+    return true;
+}
+
+static bool
+send_dom_req_async(pcintr_stack_t stack, pcdoc_operation op,
+        pcdoc_element_t element, const char *property,
+        pcrdr_msg_data_type data_type, purc_variant_t data)
+{
+    struct pcinst *inst = pcinst_current();
+    pcrdr_msg *msg = NULL;
+
+    char elem[LEN_BUFF_LONGLONGINT];
+    if (!dom_req_element(element, elem, sizeof(elem))) {
+        goto failed;
+    }
+
+    msg = make_request_message(PCRDR_MSG_TARGET_DOM,
+            stack->co->target_dom_handle, dom_req_operation(op, property),
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, elem, property, data_type,
+            data, 0);
+    if (msg == NULL) {
+        goto failed;
+    }
+    data = PURC_VARIANT_INVALID;    /* owned by the message now */
+
+    if (!send_request_async(inst, stack->co, msg)) {
+        goto failed;
+    }
+
+    pcrdr_release_message(msg);
+    return true;
 
 failed:
-    if (req_data != PURC_VARIANT_INVALID) {
-        purc_variant_unref(req_data);
+    if (msg) {
+        pcrdr_release_message(msg);
     }
-    return ret;
+    else if (data) {
+        purc_variant_unref(data);
+    }
+    return false;
 }
 
-bool
-pcintr_rdr_send_dom_req_simple(pcintr_stack_t stack, pcdoc_operation op,
+static bool
+send_dom_req_unbatched(pcintr_stack_t stack, pcdoc_operation op,
         pcdoc_element_t element, const char *property,
         pcrdr_msg_data_type data_type, purc_variant_t data)
 {
+    struct pcinst *inst = pcinst_current();
+    if (inst->intr_heap->async_dom_reqs) {
+        return send_dom_req_async(stack, op, element, property,
+                data_type, data);
+    }
+
     pcrdr_msg *response_msg = pcintr_rdr_send_dom_req(stack, op,
             element, property, data_type, data);
     if (response_msg != NULL) {
@@ -1152,6 +1386,207 @@ pcintr_rdr_send_dom_req_simple(pcintr_stack_t stack, pcdoc_operation op,
     return false;
 }
 
+static bool
+set_string_member(purc_variant_t obj, const char *key, const char *str)
+{
+    purc_variant_t v = purc_variant_make_string(str, false);
+    if (v == PURC_VARIANT_INVALID)
+        return false;
+
+    bool ret = purc_variant_object_set_by_static_ckey(obj, key, v);
+    purc_variant_unref(v);
+    return ret;
+}
+
+static ssize_t
+count_length(void *ctxt, const void *buf, size_t count)
+{
+    UNUSED_PARAM(buf);
+
+    *(size_t *)ctxt += count;
+    return count;
+}
+
+/* returns the length of the operation serialized in a batch request */
+static size_t
+serialized_length(purc_variant_t item)
+{
+    size_t len = 0;
+
+    purc_rwstream_t stream = purc_rwstream_new_for_dump(&len, count_length);
+    if (stream) {
+        purc_variant_serialize(item, stream, 0,
+                PCVARIANT_SERIALIZE_OPT_PLAIN, NULL);
+        purc_rwstream_destroy(stream);
+    }
+
+    return len;
+}
+
+/*
+ * Appends a DOM operation to the batch of the coroutine; the batch is sent
+ * at the end of the current scheduling round, before any synchronous
+ * request to the renderer, or when it grows too large. An operation too
+ * long for a batch is sent alone after the queued ones.
+ */
+static bool
+queue_dom_req(pcintr_stack_t stack, pcdoc_operation op,
+        pcdoc_element_t element, const char *property,
+        pcrdr_msg_data_type data_type, purc_variant_t data)
+{
+    pcintr_coroutine_t co = stack->co;
+    bool ret = false;
+    purc_variant_t item = PURC_VARIANT_INVALID;
+
+    char elem[LEN_BUFF_LONGLONGINT];
+    if (!dom_req_element(element, elem, sizeof(elem))) {
+        goto out;
+    }
+
+    item = purc_variant_make_object_0();
+    if (item == PURC_VARIANT_INVALID) {
+        goto out;
+    }
+
+    if (!set_string_member(item, "operation",
+                dom_req_operation(op, property)) ||
+            !set_string_member(item, "element", elem)) {
+        goto out;
+    }
+
+    if (property && !set_string_member(item, "property", property)) {
+        goto out;
+    }
+
+    if (data) {
+        if (!set_string_member(item, "dataType",
+                    pcrdr_data_type_name(data_type)) ||
+                !purc_variant_object_set_by_static_ckey(item, "data", data)) {
+            goto out;
+        }
+    }
+
+    /* the brackets of the array and a separator follow the operation */
+    size_t len = serialized_length(item) + 1;
+    if (len + 1 > MAX_BATCHED_DOM_LEN) {
+        ret = pcintr_rdr_flush_dom_batch(co);
+        ret = send_dom_req_unbatched(stack, op, element, property,
+                data_type, data) && ret;
+        data = PURC_VARIANT_INVALID;    /* consumed */
+        goto out;
+    }
+
+    if (co->dom_batch && co->dom_batch_len + len > MAX_BATCHED_DOM_LEN &&
+            !pcintr_rdr_flush_dom_batch(co)) {
+        goto out;
+    }
+
+    if (co->dom_batch == PURC_VARIANT_INVALID) {
+        co->dom_batch = purc_variant_make_array_0();
+        if (co->dom_batch == PURC_VARIANT_INVALID) {
+            goto out;
+        }
+        co->dom_batch_len = 1;
+    }
+
+    if (!purc_variant_array_append(co->dom_batch, item)) {
+        goto out;
+    }
+    co->dom_batch_len += len;
+
+    ret = true;
+    if (purc_variant_array_get_size(co->dom_batch) >= MAX_BATCHED_DOM_OPS) {
+        ret = pcintr_rdr_flush_dom_batch(co);
+    }
+
+out:
+    if (item)
+        purc_variant_unref(item);
+    if (data)
+        purc_variant_unref(data);
+    return ret;
+}
+
+bool
+pcintr_rdr_flush_dom_batch(pcintr_coroutine_t co)
+{
+    purc_variant_t batch = co->dom_batch;
+    if (batch == PURC_VARIANT_INVALID) {
+        return true;
+    }
+    co->dom_batch = PURC_VARIANT_INVALID;
+
+    struct pcinst *inst = pcinst_current();
+    if (inst->conn_to_rdr == NULL || co->target_dom_handle == 0 ||
+            co->stage != CO_STAGE_OBSERVING) {
+        /* the page has gone; drop the operations */
+        purc_variant_unref(batch);
+        return false;
+    }
+
+    pcrdr_msg *msg = make_request_message(PCRDR_MSG_TARGET_DOM,
+            co->target_dom_handle, PCRDR_OPERATION_BATCH,
+            PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+            PCRDR_MSG_DATA_TYPE_JSON, batch, 0);
+    if (msg == NULL) {
+        purc_variant_unref(batch);
+        return false;
+    }
+
+    bool ret;
+    if (inst->intr_heap->async_dom_reqs) {
+        ret = send_request_async(inst, co, msg);
+    }
+    else {
+        pcrdr_msg *response_msg = NULL;
+        ret = pcrdr_send_request_and_wait_response(inst->conn_to_rdr,
+                msg, PCRDR_TIME_DEF_EXPECTED, &response_msg) >= 0;
+        if (ret) {
+            if (response_msg->retCode != PCRDR_SC_OK) {
+                post_dom_req_failed_event(co->cid, response_msg->retCode);
+            }
+            pcrdr_release_message(response_msg);
+        }
+    }
+
+    pcrdr_release_message(msg);
+    return ret;
+}
+
+void
+pcintr_rdr_flush_dom_batches(struct pcintr_heap *heap)
+{
+    struct rb_node *p, *n;
+    struct rb_node *first = pcutils_rbtree_first(&heap->coroutines);
+    pcutils_rbtree_for_each_safe(first, p, n) {
+        pcintr_coroutine_t co;
+        co = container_of(p, struct pcintr_coroutine, node);
+        if (co->dom_batch) {
+            pcintr_rdr_flush_dom_batch(co);
+        }
+    }
+}
+
+bool
+pcintr_rdr_send_dom_req_simple(pcintr_stack_t stack, pcdoc_operation op,
+        pcdoc_element_t element, const char *property,
+        pcrdr_msg_data_type data_type, purc_variant_t data)
+{
+    if (!stack || stack->co->target_page_handle == 0
+            || stack->co->stage != CO_STAGE_OBSERVING) {
+        return false;
+    }
+
+    struct pcinst *inst = pcinst_current();
+    if (inst->intr_heap->batch_dom_reqs) {
+        return queue_dom_req(stack, op, element, property,
+                data_type, data);
+    }
+
+    return send_dom_req_unbatched(stack, op, element, property,
+            data_type, data);
+}
+
 bool
 pcintr_rdr_send_dom_req_simple_raw(pcintr_stack_t stack,
         pcdoc_operation op, pcdoc_element_t element,
@@ -1166,13 +1601,17 @@ pcintr_rdr_send_dom_req_simple_raw(pcintr_stack_t stack,
         data = " ";
         len = 1;
     }
-    pcrdr_msg *response_msg = pcintr_rdr_send_dom_req_raw(stack, op,
-            element, property, data_type, data, len);
+    if (!stack || stack->co->target_page_handle == 0
+            || stack->co->stage != CO_STAGE_OBSERVING) {
+        return false;
+    }
 
-    if (response_msg != NULL) {
-        pcrdr_release_message(response_msg);
-        return true;
+    purc_variant_t req_data = make_dom_req_data(data_type, data, len);
+    if (req_data == PURC_VARIANT_INVALID) {
+        return false;
     }
-    return false;
+
+    return pcintr_rdr_send_dom_req_simple(stack, op, element, property,
+            data_type, req_data);
 }
 
@@ -43,6 +43,7 @@
 
 #define SCHEDULE_SLEEP          10000           // usec
 #define IDLE_EVENT_TIMEOUT      100             // ms
+#define MAX_DISPATCHED_RDR_MSGS 64              // per schedule
 
 #define BUILTIN_VAR_CRTN        PURC_PREDEF_VARNAME_CRTN
 
@@ -354,7 +355,12 @@ check_and_dispatch_event_from_conn(struct pcinst *inst)
         int last_err = purc_get_last_error();
         purc_clr_error();
 
-        pcrdr_wait_and_dispatch_message(conn, 0);
+        /* drain the responses of the pipelined DOM requests, but do not
+           starve the coroutines */
+        int n = 0;
+        while (pcrdr_wait_and_dispatch_message(conn, 0) == 0 &&
+                inst->intr_heap->nr_inflight_dom_reqs > 0 &&
+                ++n < MAX_DISPATCHED_RDR_MSGS);
 
         int err = purc_get_last_error();
         if (err == PCRDR_ERROR_IO || err == PCRDR_ERROR_PEER_CLOSED) {
@@ -530,10 +536,15 @@ pcintr_schedule(void *ctxt)
     // return whether step is busy
     bool step_is_busy = execute_one_step(inst);
 
-    // 2. dispatch event for observing / stopped coroutines
+    // 2. send the DOM operations batched in this round
+    if (heap->batch_dom_reqs) {
+        pcintr_rdr_flush_dom_batches(heap);
+    }
+
+    // 3. dispatch event for observing / stopped coroutines
     bool event_is_busy = dispatch_event(inst);
 
-    // 3. its busy, goto next scheduler without sleep
+    // 4. its busy, goto next scheduler without sleep
     if (step_is_busy || event_is_busy) {
         pcintr_update_timestamp(inst);
         goto out;
@@ -33,6 +33,7 @@
 #include "private/instance.h"
 #include "private/utils.h"
 #include "private/variant.h"
+#include "private/vcm.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -194,6 +195,9 @@ static bool mgr_change_handler(purc_variant_t source, pcvar_op_t msg_type,
 static bool mgr_handler(purc_variant_t source, pcvar_op_t msg_type,
         void* ctxt, size_t nr_args, purc_variant_t* argv)
 {
+    /* the variants found by pcintr_find_named_var_by_ref() are stale */
+    pcvarmgr_bump_generation();
+
     switch (msg_type) {
     case PCVAR_OPERATION_GROW:
         return mgr_grow_handler(source, msg_type, ctxt, nr_args, argv);
@@ -223,6 +227,14 @@ add_listener_for_co_variables(pcvarmgr_t mgr)
     return -1;
 }
 
+void pcvarmgr_bump_generation(void)
+{
+    struct pcinst *inst = pcinst_current();
+    if (inst) {
+        inst->vars_generation++;
+    }
+}
+
 #define DEF_ARRAY_SIZE 10
 pcvarmgr_t pcvarmgr_create(void)
 {
@@ -266,6 +278,7 @@ int pcvarmgr_destroy(pcvarmgr_t mgr)
         }
         purc_variant_unref(mgr->object);
         free(mgr);
+        pcvarmgr_bump_generation();
     }
     return 0;
 }
@@ -283,6 +296,8 @@ bool pcvarmgr_add(pcvarmgr_t mgr, const char* name,
         return false;
     }
 
+    pcvarmgr_bump_generation();
+
     purc_variant_t k = purc_variant_make_string(name, true);
     if (k == PURC_VARIANT_INVALID) {
         return false;
@@ -334,6 +349,7 @@ purc_variant_t pcvarmgr_get(pcvarmgr_t mgr, const char* name)
 bool pcvarmgr_remove_ex(pcvarmgr_t mgr, const char* name, bool silently)
 {
     if (name) {
+        pcvarmgr_bump_generation();
         return purc_variant_object_remove_by_static_ckey(mgr->object,
                 name, silently);
     }
@@ -507,17 +523,10 @@ again:
     goto again;
 }
 
-purc_variant_t
-pcintr_find_named_var(pcintr_stack_t stack, const char* name)
+static purc_variant_t
+find_named_var(pcintr_stack_t stack, struct pcintr_stack_frame *frame,
+        const char* name)
 {
-    if (!stack || !name) {
-        PC_ASSERT(0); // FIXME: still recoverable???
-        return PURC_VARIANT_INVALID;
-    }
-
-    struct pcintr_stack_frame* frame = pcintr_stack_get_bottom_frame(stack);
-    PC_ASSERT(frame);
-
     purc_variant_t v;
     v = _find_named_temp_var(frame, name);
     if (v) {
@@ -547,6 +556,95 @@ pcintr_find_named_var(pcintr_stack_t stack, const char* name)
     return PURC_VARIANT_INVALID;
 }
 
+purc_variant_t
+pcintr_find_named_var(pcintr_stack_t stack, const char* name)
+{
+    if (!stack || !name) {
+        PC_ASSERT(0); // FIXME: still recoverable???
+        return PURC_VARIANT_INVALID;
+    }
+
+    struct pcintr_stack_frame* frame = pcintr_stack_get_bottom_frame(stack);
+    PC_ASSERT(frame);
+
+    return find_named_var(stack, frame, name);
+}
+
+#define NR_VAR_CACHE_ENTRIES    64
+
+/*
+ * The variant found for the reference `key' of the variable `atom' from
+ * the frame at `pos' which has `nr_frames' frames under it. The variant
+ * is borrowed from the variable manager or the $! holding it: any bind,
+ * unbind or change of a variable, and the pop of a frame holding
+ * temporary variables, bump the generation and retire the entry before
+ * the variant can go away.
+ */
+struct var_cache_entry {
+    const void         *key;
+    purc_atom_t         atom;
+    pcvdom_element_t    pos;
+    pcvdom_element_t    scope;
+    size_t              nr_frames;
+    uint64_t            generation;
+    purc_variant_t      value;
+};
+
+struct pcintr_var_cache {
+    struct var_cache_entry entries[NR_VAR_CACHE_ENTRIES];
+};
+
+purc_variant_t
+pcintr_find_named_var_by_ref(pcintr_stack_t stack,
+        const struct pcvcm_var_ref *ref)
+{
+    if (!stack || !ref || !ref->name) {
+        PC_ASSERT(0); // FIXME: still recoverable???
+        return PURC_VARIANT_INVALID;
+    }
+
+    struct pcintr_stack_frame* frame = pcintr_stack_get_bottom_frame(stack);
+    PC_ASSERT(frame);
+
+    if (ref->atom == 0) {
+        return find_named_var(stack, frame, ref->name);
+    }
+
+    if (stack->var_cache == NULL) {
+        stack->var_cache = (struct pcintr_var_cache *)calloc(1,
+                sizeof(struct pcintr_var_cache));
+        if (stack->var_cache == NULL) {
+            return find_named_var(stack, frame, ref->name);
+        }
+    }
+
+    uint64_t generation = pcinst_current()->vars_generation;
+    uintptr_t h = ((uintptr_t)ref >> 4) ^ ((uintptr_t)frame->pos >> 4);
+    struct var_cache_entry *entry =
+        stack->var_cache->entries + (h % NR_VAR_CACHE_ENTRIES);
+
+    if (entry->key == ref && entry->atom == ref->atom &&
+            entry->pos == frame->pos && entry->scope == frame->scope &&
+            entry->nr_frames == stack->nr_frames &&
+            entry->generation == generation) {
+        purc_clr_error();
+        return entry->value;
+    }
+
+    purc_variant_t v = find_named_var(stack, frame, ref->name);
+    if (v) {
+        entry->key = ref;
+        entry->atom = ref->atom;
+        entry->pos = frame->pos;
+        entry->scope = frame->scope;
+        entry->nr_frames = stack->nr_frames;
+        entry->generation = generation;
+        entry->value = v;
+    }
+
+    return v;
+}
+
 enum purc_symbol_var _to_symbol(char symbol)
 {
     switch (symbol) {
@@ -29,6 +29,7 @@
 #include "private/kvlist.h"
 #include "private/debug.h"
 #include "private/utils.h"
+#include "private/hashtable.h"
 #include "connect.h"
 
 #include <stdio.h>
@@ -151,13 +152,130 @@ int pcrdr_conn_set_poll_timeout(pcrdr_conn* conn, int timeout_ms)
 
 size_t pcrdr_conn_pending_requests_count(pcrdr_conn* conn)
 {
-    size_t n = 0;
-    struct pending_request *pr;
-    list_for_each_entry(pr, &conn->pending_requests, list) {
-        n++;
+    return conn->nr_timeouts;
+}
+
+static inline void
+timeout_heap_set(pcrdr_conn *conn, size_t idx, struct pending_request *pr)
+{
+    conn->timeouts[idx] = pr;
+    pr->heap_idx = idx;
+}
+
+static void
+timeout_heap_sift_up(pcrdr_conn *conn, size_t idx)
+{
+    struct pending_request *pr = conn->timeouts[idx];
+
+    while (idx > 0) {
+        size_t parent = (idx - 1) / 2;
+        if (conn->timeouts[parent]->time_expected <= pr->time_expected)
+            break;
+
+        timeout_heap_set(conn, idx, conn->timeouts[parent]);
+        idx = parent;
+    }
+
+    timeout_heap_set(conn, idx, pr);
+}
+
+static void
+timeout_heap_sift_down(pcrdr_conn *conn, size_t idx)
+{
+    struct pending_request *pr = conn->timeouts[idx];
+
+    while (true) {
+        size_t child = idx * 2 + 1;
+        if (child >= conn->nr_timeouts)
+            break;
+
+        if (child + 1 < conn->nr_timeouts &&
+                conn->timeouts[child + 1]->time_expected <
+                conn->timeouts[child]->time_expected)
+            child++;
+
+        if (pr->time_expected <= conn->timeouts[child]->time_expected)
+            break;
+
+        timeout_heap_set(conn, idx, conn->timeouts[child]);
+        idx = child;
     }
 
-    return n;
+    timeout_heap_set(conn, idx, pr);
+}
+
+static int
+add_pending_request(pcrdr_conn *conn, struct pending_request *pr)
+{
+    if (conn->pending_map == NULL) {
+        conn->pending_map = pchash_kchar_table_new(HASHTABLE_DEFAULT_SIZE, NULL);
+        if (conn->pending_map == NULL)
+            goto failed;
+    }
+
+    if (conn->nr_timeouts == conn->sz_timeouts) {
+        size_t sz = conn->sz_timeouts ? conn->sz_timeouts * 2 : 16;
+        struct pending_request **timeouts;
+        timeouts = realloc(conn->timeouts, sizeof(timeouts[0]) * sz);
+        if (timeouts == NULL)
+            goto failed;
+
+        conn->timeouts = timeouts;
+        conn->sz_timeouts = sz;
+    }
+
+    if (pchash_table_insert(conn->pending_map,
+                purc_variant_get_string_const(pr->request_id), pr))
+        goto failed;
+
+    timeout_heap_set(conn, conn->nr_timeouts++, pr);
+    timeout_heap_sift_up(conn, pr->heap_idx);
+    list_add_tail(&pr->list, &conn->pending_requests);
+    return 0;
+
+failed:
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -1;
+}
+
+static struct pending_request *
+find_pending_request(pcrdr_conn *conn, const char *request_id)
+{
+    void *pr;
+
+    if (conn->pending_map &&
+            pchash_table_lookup_ex(conn->pending_map, request_id, &pr))
+        return pr;
+
+    return NULL;
+}
+
+/* detaches the pending request; the caller should free it */
+static void
+remove_pending_request(pcrdr_conn *conn, struct pending_request *pr)
+{
+    list_del(&pr->list);
+    pchash_table_delete(conn->pending_map,
+            purc_variant_get_string_const(pr->request_id));
+
+    size_t idx = pr->heap_idx;
+    conn->nr_timeouts--;
+    if (idx < conn->nr_timeouts) {
+        struct pending_request *last = conn->timeouts[conn->nr_timeouts];
+        timeout_heap_set(conn, idx, last);
+        if (idx > 0 && conn->timeouts[(idx - 1) / 2]->time_expected >
+                last->time_expected)
+            timeout_heap_sift_up(conn, idx);
+        else
+            timeout_heap_sift_down(conn, idx);
+    }
+}
+
+static void
+free_pending_request(struct pending_request *pr)
+{
+    purc_variant_unref(pr->request_id);
+    free(pr);
 }
 
 int pcrdr_free_connection(pcrdr_conn* conn)
@@ -170,16 +288,21 @@ int pcrdr_free_connection(pcrdr_conn* conn)
 
     struct pending_request *pr, *n;
     list_for_each_entry_safe(pr, n, &conn->pending_requests, list) {
+        remove_pending_request(conn, pr);
         if (pr->response_handler) {
             pr->response_handler(conn,
                     purc_variant_get_string_const(pr->request_id),
                     PCRDR_RESPONSE_CANCELLED, pr->context, NULL);
         }
-        list_del(&pr->list);
-        purc_variant_unref(pr->request_id);
-        free(pr);
+        free_pending_request(pr);
     }
 
+    if (conn->pending_map)
+        pchash_table_free(conn->pending_map);
+    if (conn->timeouts)
+        free(conn->timeouts);
+    if (conn->send_buf)
+        free(conn->send_buf);
     free(conn);
 
     return 0;
@@ -244,7 +367,10 @@ pcrdr_set_handler_for_response_from_extra_source(pcrdr_conn* conn,
         pr->time_expected = purc_get_monotoic_time() + 3600;
     else
         pr->time_expected = purc_get_monotoic_time() + seconds_expected;
-    list_add_tail(&pr->list, &conn->pending_requests);
+    if (add_pending_request(conn, pr)) {
+        free_pending_request(pr);
+        return -1;
+    }
 
     return 0;
 }
@@ -269,73 +395,49 @@ int pcrdr_send_request(pcrdr_conn* conn, pcrdr_msg *request_msg,
         response_handler);
 }
 
-static inline int
-variant_strcmp(purc_variant_t a, purc_variant_t b)
-{
-    if (a == b)
-        return 0;
-
-    return strcmp(
-            purc_variant_get_string_const(a),
-            purc_variant_get_string_const(b));
-}
-
 static int
 handle_response_message(pcrdr_conn* conn, const pcrdr_msg *msg)
 {
-    int retval = -1;
-
-    if (!list_empty(&conn->pending_requests)) {
-        struct pending_request *pr;
-        pr = list_first_entry(&conn->pending_requests,
-                struct pending_request, list);
-
-        if (variant_strcmp(msg->requestId, pr->request_id) == 0) {
-            const char *request_id =
-                purc_variant_get_string_const(msg->requestId);
-            if (pr->response_handler && pr->response_handler(conn,
-                        request_id,
-                        PCRDR_RESPONSE_RESULT, pr->context, msg) < 0) {
-                purc_log_warn("response handler for %s returned failure\n",
-                        request_id);
-            }
+    const char *request_id = purc_variant_get_string_const(msg->requestId);
+    struct pending_request *pr = NULL;
 
-            retval = 0;
-            list_del(&pr->list);
-            purc_variant_unref(pr->request_id);
-            free(pr);
-        }
-        else {
-            purc_log_error("response not matched the first pending request\n");
-            purc_set_error(PCRDR_ERROR_UNEXPECTED);
-        }
-    }
-    else {
-        purc_log_error("no pending request?\n");
+    if (request_id)
+        pr = find_pending_request(conn, request_id);
+
+    if (pr == NULL) {
+        purc_log_error("response not matched any pending request: %s\n",
+                request_id ? request_id : "(null)");
         purc_set_error(PCRDR_ERROR_UNEXPECTED);
+        return -1;
     }
 
-    return retval;
+    /* the handler may send or wait for other requests */
+    remove_pending_request(conn, pr);
+    if (pr->response_handler && pr->response_handler(conn,
+                request_id, PCRDR_RESPONSE_RESULT, pr->context, msg) < 0) {
+        purc_log_warn("response handler for %s returned failure\n",
+                request_id);
+    }
+    free_pending_request(pr);
+
+    return 0;
 }
 
 static int
 check_timeout_requests(pcrdr_conn *conn)
 {
-    struct pending_request *pr, *n;
     time_t now = purc_get_monotoic_time();
 
-    list_for_each_entry_safe(pr, n, &conn->pending_requests, list) {
-        if (now >= pr->time_expected) {
-            if (pr->response_handler) {
-                pr->response_handler(conn,
-                    purc_variant_get_string_const(pr->request_id),
-                        PCRDR_RESPONSE_TIMEOUT, pr->context, NULL);
-            }
+    while (conn->nr_timeouts > 0 && now >= conn->timeouts[0]->time_expected) {
+        struct pending_request *pr = conn->timeouts[0];
 
-            list_del(&pr->list);
-            purc_variant_unref(pr->request_id);
-            free(pr);
+        remove_pending_request(conn, pr);
+        if (pr->response_handler) {
+            pr->response_handler(conn,
+                purc_variant_get_string_const(pr->request_id),
+                    PCRDR_RESPONSE_TIMEOUT, pr->context, NULL);
         }
+        free_pending_request(pr);
     }
 
     return 0;
@@ -510,7 +612,10 @@ pcrdr_wait_response_for_specific_request(pcrdr_conn* conn,
         pr->time_expected = purc_get_monotoic_time() + 3600;
     else
         pr->time_expected = purc_get_monotoic_time() + seconds_expected;
-    list_add(&pr->list, &conn->pending_requests);
+    if (add_pending_request(conn, pr)) {
+        free_pending_request(pr);
+        return -1;
+    }
 
     while (*response_msg == NULL) {
         pcrdr_msg *msg;
@@ -560,9 +665,8 @@ pcrdr_wait_response_for_specific_request(pcrdr_conn* conn,
     }
 
     if (*response_msg == NULL) {
-        list_del(&pr->list);
-        purc_variant_unref(pr->request_id);
-        free(pr);
+        remove_pending_request(conn, pr);
+        free_pending_request(pr);
     }
     else if (*response_msg == MSG_POINTER_INVALID) {
         *response_msg = NULL;   /* reset response messge to NULL */
@@ -33,6 +33,7 @@
 #include "private/list.h"
 
 struct pending_request {
+    /* in the order of sending */
     struct list_head        list;
 
     purc_variant_t          request_id;
@@ -40,8 +41,12 @@ struct pending_request {
     void   *context;
 
     time_t  time_expected;
+    /* the index in the timeout heap */
+    size_t  heap_idx;
 };
 
+struct pchash_table;
+
 struct pcrdr_prot_data;
 
 struct pcrdr_conn {
@@ -58,6 +63,14 @@ struct pcrdr_conn {
     void *user_data;
     struct pcrdr_prot_data *prot_data;
 
+    /* use the binary message encoding (negotiated at startSession) */
+    bool binary_msg;
+
+    /* the reusable buffer to serialize the messages to send */
+    char *send_buf;
+    size_t sz_send_buf;
+    size_t len_send_buf;
+
     pcrdr_extra_message_source source_fn;
     void *source_ctxt; /* context for extra message source */
 
@@ -67,6 +80,14 @@ struct pcrdr_conn {
     /* the pending requests queue */
     struct list_head pending_requests;
 
+    /* request identifier -> pending request; created on demand */
+    struct pchash_table *pending_map;
+
+    /* the min-heap of the pending requests ordered by the expected time */
+    struct pending_request **timeouts;
+    size_t nr_timeouts;
+    size_t sz_timeouts;
+
     /* operations */
     int (*wait_message) (pcrdr_conn* conn, int timeout_ms);
     pcrdr_msg *(*read_message) (pcrdr_conn* conn);
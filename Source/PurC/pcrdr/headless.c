@@ -56,7 +56,8 @@
     "workspace:" __STRING(8)                        \
     "/tabbedWindow:" __STRING(8)                    \
     "/widgetInTabbedWindow:" __STRING(32)           \
-    "/plainWindow:" __STRING(256)
+    "/plainWindow:" __STRING(256) "\n"              \
+    "binaryMessage:" __STRING(1)
 
 struct tabbed_window_info {
     // handle of this tabbedWindow; NULL for not used slot.
@@ -1082,10 +1083,10 @@ static void on_load(struct pcrdr_prot_data *prot_data,
 static void on_write_begin(struct pcrdr_prot_data *prot_data,
         const pcrdr_msg *msg, unsigned int op_id, struct result_info *result)
 {
-    void **domdocs = NULL;
+    void **domdocs;
 
     UNUSED_PARAM(op_id);
-    if (find_domdoc_ptr(prot_data, msg, result) == NULL) {
+    if ((domdocs = find_domdoc_ptr(prot_data, msg, result)) == NULL) {
         return;
     }
 
@@ -1098,10 +1099,10 @@ static void on_write_begin(struct pcrdr_prot_data *prot_data,
 static void on_write_more(struct pcrdr_prot_data *prot_data,
         const pcrdr_msg *msg, unsigned int op_id, struct result_info *result)
 {
-    void **domdocs = NULL;
+    void **domdocs;
 
     UNUSED_PARAM(op_id);
-    if (find_domdoc_ptr(prot_data, msg, result) == NULL) {
+    if ((domdocs = find_domdoc_ptr(prot_data, msg, result)) == NULL) {
         return;
     }
 
@@ -1120,10 +1121,10 @@ static void on_write_more(struct pcrdr_prot_data *prot_data,
 static void on_write_end(struct pcrdr_prot_data *prot_data,
         const pcrdr_msg *msg, unsigned int op_id, struct result_info *result)
 {
-    void **domdocs = NULL;
+    void **domdocs;
 
     UNUSED_PARAM(op_id);
-    if (find_domdoc_ptr(prot_data, msg, result) == NULL) {
+    if ((domdocs = find_domdoc_ptr(prot_data, msg, result)) == NULL) {
         return;
     }
 
@@ -1135,26 +1136,25 @@ static void on_write_end(struct pcrdr_prot_data *prot_data,
 
     *domdocs = domdocs;
 
+    /* the handle of the loaded document as `load` returns */
     result->retCode = PCRDR_SC_OK;
-    result->resultValue = msg->targetValue;
+    result->resultValue = (uint64_t)(uintptr_t)domdocs;
 }
 
-static void on_operate_dom(struct pcrdr_prot_data *prot_data,
-        const pcrdr_msg *msg, unsigned int op_id, struct result_info *result)
+static bool check_target_dom(struct pcrdr_prot_data *prot_data,
+        const pcrdr_msg *msg, struct result_info *result)
 {
-    UNUSED_PARAM(op_id);
-
     if (msg->target != PCRDR_MSG_TARGET_DOM ||
             msg->targetValue == 0) {
         result->retCode = PCRDR_SC_BAD_REQUEST;
         result->resultValue = 0;
-        return;
+        return false;
     }
 
     if (prot_data->session == 0) {
         result->retCode = PCRDR_SC_TOO_EARLY;
         result->resultValue = 0;
-        return;
+        return false;
     }
 
     bool found = false;
@@ -1190,6 +1190,18 @@ found:
     if (!found) {
         result->retCode = PCRDR_SC_NOT_FOUND;
         result->resultValue = msg->targetValue;
+        return false;
+    }
+
+    return true;
+}
+
+static void on_operate_dom(struct pcrdr_prot_data *prot_data,
+        const pcrdr_msg *msg, unsigned int op_id, struct result_info *result)
+{
+    UNUSED_PARAM(op_id);
+
+    if (!check_target_dom(prot_data, msg, result)) {
         return;
     }
 
@@ -1197,6 +1209,66 @@ found:
     result->resultValue = msg->targetValue;
 }
 
+static bool check_batched_operation(purc_variant_t op)
+{
+    if (!purc_variant_is_object(op))
+        return false;
+
+    purc_variant_t v;
+    const char *str;
+
+    v = purc_variant_object_get_by_ckey(op, "operation");
+    if (v == PURC_VARIANT_INVALID ||
+            (str = purc_variant_get_string_const(v)) == NULL)
+        return false;
+
+    purc_atom_t op_atom = pcrdr_check_operation(str);
+    unsigned int op_id;
+    if (op_atom == 0 || pcrdr_operation_from_atom(op_atom, &op_id) == NULL ||
+            op_id < PCRDR_K_OPERATION_APPEND ||
+            op_id > PCRDR_K_OPERATION_CLEAR)
+        return false;
+
+    v = purc_variant_object_get_by_ckey(op, "element");
+    if (v == PURC_VARIANT_INVALID ||
+            (str = purc_variant_get_string_const(v)) == NULL ||
+            strtoull(str, NULL, 16) == 0)
+        return false;
+
+    return true;
+}
+
+/* all operations in the batch are checked before any of them is applied */
+static void on_batch(struct pcrdr_prot_data *prot_data,
+        const pcrdr_msg *msg, unsigned int op_id, struct result_info *result)
+{
+    UNUSED_PARAM(op_id);
+
+    if (!check_target_dom(prot_data, msg, result)) {
+        return;
+    }
+
+    if (msg->dataType != PCRDR_MSG_DATA_TYPE_JSON ||
+            !purc_variant_is_array(msg->data)) {
+        result->retCode = PCRDR_SC_BAD_REQUEST;
+        result->resultValue = 0;
+        return;
+    }
+
+    size_t nr_ops = purc_variant_array_get_size(msg->data);
+    for (size_t i = 0; i < nr_ops; i++) {
+        purc_variant_t op = purc_variant_array_get(msg->data, i);
+        if (!check_batched_operation(op)) {
+            result->retCode = PCRDR_SC_BAD_REQUEST;
+            result->resultValue = 0;
+            return;
+        }
+    }
+
+    result->retCode = PCRDR_SC_OK;
+    result->resultValue = nr_ops;
+}
+
 static void on_call_method(struct pcrdr_prot_data *prot_data,
         const pcrdr_msg *msg, unsigned int op_id, struct result_info *result)
 {
@@ -1318,6 +1390,7 @@ static request_handler handlers[] = {
     on_call_method,
     on_get_property,
     on_set_property,
+    on_batch,
 };
 
 /* make sure the number of operation handlers matches the enumulators */
@@ -1358,6 +1431,29 @@ done:
     return 0;
 }
 
+/* Encode the message in the binary encoding and decode it as a renderer
+   does, so that the binary encoding is exercised by the headless renderer. */
+static pcrdr_msg *transfer_binary_message(const pcrdr_msg *msg)
+{
+    pcrdr_msg *decoded = NULL;
+    purc_rwstream_t buffer;
+
+    buffer = purc_rwstream_new_buffer(PCRDR_MIN_PACKET_BUFF_SIZE,
+            PCRDR_MAX_INMEM_PAYLOAD_SIZE);
+    if (buffer == NULL)
+        return NULL;
+
+    if (pcrdr_serialize_message_binary(msg,
+                (pcrdr_cb_write)purc_rwstream_write, buffer) == 0) {
+        size_t packet_len;
+        const char *packet = purc_rwstream_get_mem_buffer(buffer, &packet_len);
+        pcrdr_parse_packet_binary(packet, packet_len, &decoded);
+    }
+
+    purc_rwstream_destroy(buffer);
+    return decoded;
+}
+
 static int my_send_message(pcrdr_conn* conn, pcrdr_msg *msg)
 {
     fputs(">>>\n", conn->prot_data->fp);
@@ -1367,7 +1463,17 @@ static int my_send_message(pcrdr_conn* conn, pcrdr_msg *msg)
     }
     fputs("\n>>>END\n", conn->prot_data->fp);
 
-    evaluate_result(conn->prot_data, msg);
+    if (conn->binary_msg) {
+        pcrdr_msg *decoded = transfer_binary_message(msg);
+        if (decoded == NULL)
+            goto failed;
+
+        evaluate_result(conn->prot_data, decoded);
+        pcrdr_release_message(decoded);
+    }
+    else {
+        evaluate_result(conn->prot_data, msg);
+    }
     return 0;
 
 failed:
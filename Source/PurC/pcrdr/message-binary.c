@@ -0,0 +1,707 @@
+/*
+ * message-binary.c -- The implementation of the binary encoding of
+ *      PurCMC messages.
+ *
+ * Copyright (c) 2022 FMSoft (http://www.fmsoft.cn)
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A binary message has a fixed-layout header followed by length-prefixed
+ * fields; the fixed-size integers are little-endian, and the lengths
+ * and counts are unsigned LEB128 varints:
+ *
+ *  magic[4]        PCRDR_BINARY_MSG_MAGIC
+ *  u8              version
+ *  u8              type
+ *  u8              target
+ *  u8              elementType
+ *  u8              dataType
+ *  u8              reduceOpt
+ *  u16             reserved
+ *  u32             retCode
+ *  u64             targetValue
+ *  u64             resultValue
+ *  field[5]        operation or eventName, requestId, sourceURI,
+ *                  elementValue, property; every field is the length
+ *                  plus one (zero if absent) followed by the UTF-8 bytes.
+ *  data            none for `void`; a binary eJSON value for `json`;
+ *                  the length and the bytes for other types.
+ *
+ * A binary eJSON value is a u8 tag followed by the payload of the tag;
+ * see `enum bin_tag`.
+ */
+
+#include "config.h"
+#include "private/pcrdr.h"
+#include "private/instance.h"
+#include "private/variant.h"
+#include "private/debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* the maximal embedded levels of a binary eJSON value */
+#define MAX_EJSON_DEPTH         256
+
+enum bin_tag {
+    TAG_UNDEFINED = 0,
+    TAG_NULL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_NUMBER,         /* f64 */
+    TAG_LONGINT,        /* zigzag varint */
+    TAG_ULONGINT,       /* varint */
+    TAG_LONGDOUBLE,     /* f64; the precision of long double is lost */
+    TAG_STRING,         /* varint length + bytes */
+    TAG_ATOMSTRING,     /* varint length + bytes */
+    TAG_EXCEPTION,      /* varint length + bytes */
+    TAG_BSEQUENCE,      /* varint length + bytes */
+    TAG_OBJECT,         /* varint count + (string, value) pairs */
+    TAG_ARRAY,          /* varint count + values; sets are encoded as arrays */
+    TAG_TUPLE,          /* varint count + values */
+};
+
+static inline void
+write_u8(pcrdr_cb_write fn, void *ctxt, uint8_t v)
+{
+    fn(ctxt, &v, sizeof(v));
+}
+
+static inline void
+write_u16(pcrdr_cb_write fn, void *ctxt, uint16_t v)
+{
+    uint8_t buf[2] = { v & 0xFF, v >> 8 };
+    fn(ctxt, buf, sizeof(buf));
+}
+
+static inline void
+write_u32(pcrdr_cb_write fn, void *ctxt, uint32_t v)
+{
+    uint8_t buf[4];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = (v >> (i * 8)) & 0xFF;
+    fn(ctxt, buf, sizeof(buf));
+}
+
+static inline void
+write_u64(pcrdr_cb_write fn, void *ctxt, uint64_t v)
+{
+    uint8_t buf[8];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = (v >> (i * 8)) & 0xFF;
+    fn(ctxt, buf, sizeof(buf));
+}
+
+static inline void
+write_f64(pcrdr_cb_write fn, void *ctxt, double d)
+{
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    write_u64(fn, ctxt, v);
+}
+
+/* unsigned LEB128 */
+static inline void
+write_uvar(pcrdr_cb_write fn, void *ctxt, uint64_t v)
+{
+    uint8_t buf[10];
+    size_t n = 0;
+
+    do {
+        buf[n] = v & 0x7F;
+        v >>= 7;
+        if (v)
+            buf[n] |= 0x80;
+        n++;
+    } while (v);
+
+    fn(ctxt, buf, n);
+}
+
+static void
+write_bytes(pcrdr_cb_write fn, void *ctxt, const void *bytes, size_t len)
+{
+    write_uvar(fn, ctxt, len);
+    if (len > 0)
+        fn(ctxt, bytes, len);
+}
+
+/* the length of a field is biased by one; zero stands for an absent field */
+static void
+write_field(pcrdr_cb_write fn, void *ctxt, purc_variant_t v)
+{
+    size_t len;
+    const char *str = v ? purc_variant_get_string_const_ex(v, &len) : NULL;
+
+    if (str) {
+        write_uvar(fn, ctxt, (uint64_t)len + 1);
+        if (len > 0)
+            fn(ctxt, str, len);
+    }
+    else
+        write_u8(fn, ctxt, 0);
+}
+
+static int
+write_ejson(pcrdr_cb_write fn, void *ctxt, purc_variant_t v, int depth)
+{
+    const char *str;
+    const unsigned char *bytes;
+    size_t len;
+
+    if (depth > MAX_EJSON_DEPTH)
+        return PURC_ERROR_TOO_LARGE_ENTITY;
+
+    switch (purc_variant_get_type(v)) {
+    case PURC_VARIANT_TYPE_UNDEFINED:
+        write_u8(fn, ctxt, TAG_UNDEFINED);
+        break;
+
+    case PURC_VARIANT_TYPE_BOOLEAN:
+        write_u8(fn, ctxt, purc_variant_is_true(v) ? TAG_TRUE : TAG_FALSE);
+        break;
+
+    case PURC_VARIANT_TYPE_NUMBER: {
+        double d;
+        purc_variant_cast_to_number(v, &d, false);
+        write_u8(fn, ctxt, TAG_NUMBER);
+        write_f64(fn, ctxt, d);
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_LONGINT: {
+        int64_t i64;
+        purc_variant_cast_to_longint(v, &i64, false);
+        write_u8(fn, ctxt, TAG_LONGINT);
+        write_uvar(fn, ctxt, ((uint64_t)i64 << 1) ^ (uint64_t)(i64 >> 63));
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_ULONGINT: {
+        uint64_t u64;
+        purc_variant_cast_to_ulongint(v, &u64, false);
+        write_u8(fn, ctxt, TAG_ULONGINT);
+        write_uvar(fn, ctxt, u64);
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_LONGDOUBLE: {
+        long double ld;
+        purc_variant_cast_to_longdouble(v, &ld, false);
+        write_u8(fn, ctxt, TAG_LONGDOUBLE);
+        write_f64(fn, ctxt, (double)ld);
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_STRING:
+        str = purc_variant_get_string_const_ex(v, &len);
+        write_u8(fn, ctxt, TAG_STRING);
+        write_bytes(fn, ctxt, str, len);
+        break;
+
+    case PURC_VARIANT_TYPE_ATOMSTRING:
+        str = purc_variant_get_atom_string_const(v);
+        write_u8(fn, ctxt, TAG_ATOMSTRING);
+        write_bytes(fn, ctxt, str, strlen(str));
+        break;
+
+    case PURC_VARIANT_TYPE_EXCEPTION:
+        str = purc_variant_get_exception_string_const(v);
+        write_u8(fn, ctxt, TAG_EXCEPTION);
+        write_bytes(fn, ctxt, str, strlen(str));
+        break;
+
+    case PURC_VARIANT_TYPE_BSEQUENCE:
+        bytes = purc_variant_get_bytes_const(v, &len);
+        write_u8(fn, ctxt, TAG_BSEQUENCE);
+        write_bytes(fn, ctxt, bytes, len);
+        break;
+
+    case PURC_VARIANT_TYPE_OBJECT: {
+        purc_variant_t key, val;
+        write_u8(fn, ctxt, TAG_OBJECT);
+        write_uvar(fn, ctxt, purc_variant_object_get_size(v));
+        foreach_key_value_in_variant_object(v, key, val)
+            str = purc_variant_get_string_const_ex(key, &len);
+            write_bytes(fn, ctxt, str, len);
+            int ret = write_ejson(fn, ctxt, val, depth + 1);
+            if (ret)
+                return ret;
+        end_foreach;
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_ARRAY:
+    case PURC_VARIANT_TYPE_SET:
+    case PURC_VARIANT_TYPE_TUPLE: {
+        enum purc_variant_type type = purc_variant_get_type(v);
+        size_t sz;
+        purc_variant_t (*get)(purc_variant_t, size_t);
+
+        if (type == PURC_VARIANT_TYPE_ARRAY) {
+            sz = purc_variant_array_get_size(v);
+            get = purc_variant_array_get;
+        }
+        else if (type == PURC_VARIANT_TYPE_SET) {
+            sz = purc_variant_set_get_size(v);
+            get = purc_variant_set_get_by_index;
+        }
+        else {
+            if (!purc_variant_tuple_size(v, &sz))
+                sz = 0;
+            get = purc_variant_tuple_get;
+        }
+
+        write_u8(fn, ctxt,
+                type == PURC_VARIANT_TYPE_TUPLE ? TAG_TUPLE : TAG_ARRAY);
+        write_uvar(fn, ctxt, sz);
+        for (size_t i = 0; i < sz; i++) {
+            int ret = write_ejson(fn, ctxt, get(v, i), depth + 1);
+            if (ret)
+                return ret;
+        }
+        break;
+    }
+
+    default:
+        /* null, dynamic and native values */
+        write_u8(fn, ctxt, TAG_NULL);
+        break;
+    }
+
+    return 0;
+}
+
+int pcrdr_serialize_message_binary_head(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt, const char **text, size_t *text_len)
+{
+    if (text) {
+        *text = NULL;
+        *text_len = 0;
+    }
+
+    fn(ctxt, PCRDR_BINARY_MSG_MAGIC, PCRDR_BINARY_MSG_MAGIC_LEN);
+    write_u8(fn, ctxt, PCRDR_BINARY_MSG_VERSION);
+    write_u8(fn, ctxt, msg->type);
+    write_u8(fn, ctxt, msg->target);
+    write_u8(fn, ctxt, msg->elementType);
+    write_u8(fn, ctxt, msg->dataType);
+    write_u8(fn, ctxt, msg->reduceOpt);
+    write_u16(fn, ctxt, 0);
+    write_u32(fn, ctxt, msg->retCode);
+    write_u64(fn, ctxt, msg->targetValue);
+    write_u64(fn, ctxt, msg->resultValue);
+
+    write_field(fn, ctxt, msg->operation);
+    write_field(fn, ctxt, msg->requestId);
+    write_field(fn, ctxt, msg->sourceURI);
+    write_field(fn, ctxt, msg->elementValue);
+    write_field(fn, ctxt, msg->property);
+
+    if (msg->dataType == PCRDR_MSG_DATA_TYPE_VOID) {
+        // do nothing
+    }
+    else if (msg->dataType == PCRDR_MSG_DATA_TYPE_JSON) {
+        int ret = write_ejson(fn, ctxt, msg->data, 0);
+        if (ret)
+            return ret;
+    }
+    else {  /* for other text types */
+        size_t len;
+        const char *str;
+
+        assert(msg->data != NULL);
+        str = purc_variant_get_string_const_ex(msg->data, &len);
+        if (msg->textLen > 0)   /* override by textLen */
+            len = msg->textLen;
+
+        if (text) {
+            write_uvar(fn, ctxt, len);
+            *text = str;
+            *text_len = len;
+        }
+        else
+            write_bytes(fn, ctxt, str, len);
+    }
+
+    return 0;
+}
+
+int pcrdr_serialize_message_binary(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt)
+{
+    return pcrdr_serialize_message_binary_head(msg, fn, ctxt, NULL, NULL);
+}
+
+struct reader {
+    const uint8_t *p;
+    const uint8_t *end;
+};
+
+static inline bool
+read_u8(struct reader *reader, uint8_t *v)
+{
+    if (reader->p >= reader->end)
+        return false;
+
+    *v = *reader->p++;
+    return true;
+}
+
+static inline bool
+read_u16(struct reader *reader, uint16_t *v)
+{
+    if (reader->end - reader->p < 2)
+        return false;
+
+    *v = reader->p[0] | (reader->p[1] << 8);
+    reader->p += 2;
+    return true;
+}
+
+static inline bool
+read_u32(struct reader *reader, uint32_t *v)
+{
+    if (reader->end - reader->p < 4)
+        return false;
+
+    *v = 0;
+    for (int i = 3; i >= 0; i--)
+        *v = (*v << 8) | reader->p[i];
+    reader->p += 4;
+    return true;
+}
+
+static inline bool
+read_u64(struct reader *reader, uint64_t *v)
+{
+    if (reader->end - reader->p < 8)
+        return false;
+
+    *v = 0;
+    for (int i = 7; i >= 0; i--)
+        *v = (*v << 8) | reader->p[i];
+    reader->p += 8;
+    return true;
+}
+
+static inline bool
+read_f64(struct reader *reader, double *d)
+{
+    uint64_t v;
+    if (!read_u64(reader, &v))
+        return false;
+
+    memcpy(d, &v, sizeof(v));
+    return true;
+}
+
+static bool
+read_uvar(struct reader *reader, uint64_t *v)
+{
+    *v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (reader->p >= reader->end)
+            return false;
+
+        uint8_t byte = *reader->p++;
+        *v |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/* returns the bytes in place */
+static bool
+read_bytes(struct reader *reader, const char **bytes, size_t *len)
+{
+    uint64_t u64;
+    if (!read_uvar(reader, &u64) ||
+            (uint64_t)(reader->end - reader->p) < u64)
+        return false;
+
+    *bytes = (const char *)reader->p;
+    *len = (size_t)u64;
+    reader->p += u64;
+    return true;
+}
+
+static purc_variant_t
+read_ejson(struct reader *reader, int depth);
+
+static purc_variant_t
+read_ejson_members(struct reader *reader, uint8_t tag, int depth)
+{
+    uint64_t count;
+    purc_variant_t v = PURC_VARIANT_INVALID, member;
+
+    /* every member takes at least one byte */
+    if (!read_uvar(reader, &count) ||
+            count > (uint64_t)(reader->end - reader->p))
+        return PURC_VARIANT_INVALID;
+
+    if (tag == TAG_OBJECT) {
+        v = purc_variant_make_object_0();
+        for (size_t i = 0; v && i < count; i++) {
+            const char *key;
+            size_t len;
+            if (!read_bytes(reader, &key, &len))
+                goto failed;
+
+            purc_variant_t k = purc_variant_make_string_ex(key, len, true);
+            if (k == PURC_VARIANT_INVALID)
+                goto failed;
+
+            member = read_ejson(reader, depth + 1);
+            if (member == PURC_VARIANT_INVALID) {
+                purc_variant_unref(k);
+                goto failed;
+            }
+
+            bool ok = purc_variant_object_set(v, k, member);
+            purc_variant_unref(k);
+            purc_variant_unref(member);
+            if (!ok)
+                goto failed;
+        }
+    }
+    else if (tag == TAG_ARRAY) {
+        v = purc_variant_make_array_0();
+        for (size_t i = 0; v && i < count; i++) {
+            member = read_ejson(reader, depth + 1);
+            if (member == PURC_VARIANT_INVALID)
+                goto failed;
+
+            bool ok = purc_variant_array_append(v, member);
+            purc_variant_unref(member);
+            if (!ok)
+                goto failed;
+        }
+    }
+    else {
+        v = purc_variant_make_tuple(count, NULL);
+        for (size_t i = 0; v && i < count; i++) {
+            member = read_ejson(reader, depth + 1);
+            if (member == PURC_VARIANT_INVALID)
+                goto failed;
+
+            bool ok = purc_variant_tuple_set(v, i, member);
+            purc_variant_unref(member);
+            if (!ok)
+                goto failed;
+        }
+    }
+
+    return v;
+
+failed:
+    purc_variant_unref(v);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+read_ejson(struct reader *reader, int depth)
+{
+    uint8_t tag;
+    uint64_t u64;
+    double d;
+    const char *bytes;
+    size_t len;
+
+    if (depth > MAX_EJSON_DEPTH || !read_u8(reader, &tag))
+        return PURC_VARIANT_INVALID;
+
+    switch (tag) {
+    case TAG_UNDEFINED:
+        return purc_variant_make_undefined();
+
+    case TAG_NULL:
+        return purc_variant_make_null();
+
+    case TAG_FALSE:
+    case TAG_TRUE:
+        return purc_variant_make_boolean(tag == TAG_TRUE);
+
+    case TAG_NUMBER:
+        if (!read_f64(reader, &d))
+            break;
+        return purc_variant_make_number(d);
+
+    case TAG_LONGINT:
+        if (!read_uvar(reader, &u64))
+            break;
+        return purc_variant_make_longint(
+                (int64_t)(u64 >> 1) ^ -(int64_t)(u64 & 1));
+
+    case TAG_ULONGINT:
+        if (!read_uvar(reader, &u64))
+            break;
+        return purc_variant_make_ulongint(u64);
+
+    case TAG_LONGDOUBLE:
+        if (!read_f64(reader, &d))
+            break;
+        return purc_variant_make_longdouble(d);
+
+    case TAG_STRING:
+    case TAG_ATOMSTRING:
+    case TAG_EXCEPTION:
+    case TAG_BSEQUENCE:
+        if (!read_bytes(reader, &bytes, &len))
+            break;
+
+        if (tag == TAG_STRING)
+            return purc_variant_make_string_ex(bytes, len, true);
+        else if (tag == TAG_BSEQUENCE)
+            return purc_variant_make_byte_sequence(bytes, len);
+        else {
+            char *str = strndup(bytes, len);
+            if (str == NULL)
+                break;
+
+            purc_variant_t v;
+            if (tag == TAG_ATOMSTRING)
+                v = purc_variant_make_atom_string(str, true);
+            else
+                v = purc_variant_make_exception(
+                        purc_atom_try_string_ex(ATOM_BUCKET_EXCEPT, str));
+            free(str);
+            return v;
+        }
+
+    case TAG_OBJECT:
+    case TAG_ARRAY:
+    case TAG_TUPLE:
+        return read_ejson_members(reader, tag, depth);
+
+    default:
+        break;
+    }
+
+    return PURC_VARIANT_INVALID;
+}
+
+static bool
+read_field(struct reader *reader, purc_variant_t *v)
+{
+    uint64_t biased_len;
+
+    if (!read_uvar(reader, &biased_len) ||
+            biased_len > (uint64_t)(reader->end - reader->p) + 1)
+        return false;
+
+    if (biased_len > 0) {
+        size_t len = (size_t)(biased_len - 1);
+        *v = purc_variant_make_string_ex((const char *)reader->p, len, true);
+        if (*v == PURC_VARIANT_INVALID)
+            return false;
+        reader->p += len;
+    }
+
+    return true;
+}
+
+int pcrdr_parse_packet_binary(const void *packet, size_t sz_packet,
+        pcrdr_msg **msg_out)
+{
+    struct reader reader = { packet, (const uint8_t *)packet + sz_packet };
+    pcrdr_msg *msg;
+    uint8_t version, type, target, element_type, data_type, reduce_opt;
+    uint16_t reserved;
+
+    if (!pcrdr_is_binary_packet(packet, sz_packet)) {
+        purc_set_error(PCRDR_ERROR_BAD_MESSAGE);
+        return -1;
+    }
+    reader.p += PCRDR_BINARY_MSG_MAGIC_LEN;
+
+    if ((msg = pcinst_get_message()) == NULL) {
+        purc_set_error(PCRDR_ERROR_NOMEM);
+        return -1;
+    }
+
+    if (!read_u8(&reader, &version) || version != PCRDR_BINARY_MSG_VERSION ||
+            !read_u8(&reader, &type) || type > PCRDR_MSG_TYPE_LAST ||
+            !read_u8(&reader, &target) || target > PCRDR_MSG_TARGET_LAST ||
+            !read_u8(&reader, &element_type) ||
+            element_type > PCRDR_MSG_ELEMENT_TYPE_LAST ||
+            !read_u8(&reader, &data_type) ||
+            data_type > PCRDR_MSG_DATA_TYPE_LAST ||
+            !read_u8(&reader, &reduce_opt) ||
+            reduce_opt > PCRDR_MSG_EVENT_REDUCE_OPT_LAST ||
+            !read_u16(&reader, &reserved)) {
+        goto failed;
+    }
+
+    msg->type = type;
+    msg->target = target;
+    msg->elementType = element_type;
+    msg->dataType = data_type;
+    msg->reduceOpt = reduce_opt;
+
+    uint32_t ret_code;
+    if (!read_u32(&reader, &ret_code) ||
+            !read_u64(&reader, &msg->targetValue) ||
+            !read_u64(&reader, &msg->resultValue)) {
+        goto failed;
+    }
+    msg->retCode = ret_code;
+
+    if (!read_field(&reader, &msg->operation) ||
+            !read_field(&reader, &msg->requestId) ||
+            !read_field(&reader, &msg->sourceURI) ||
+            !read_field(&reader, &msg->elementValue) ||
+            !read_field(&reader, &msg->property)) {
+        goto failed;
+    }
+
+    if (msg->dataType == PCRDR_MSG_DATA_TYPE_VOID) {
+        // do nothing
+    }
+    else if (msg->dataType == PCRDR_MSG_DATA_TYPE_JSON) {
+        msg->data = read_ejson(&reader, 0);
+        if (msg->data == PURC_VARIANT_INVALID)
+            goto failed;
+    }
+    else {
+        const char *text;
+        size_t len;
+        if (!read_bytes(&reader, &text, &len))
+            goto failed;
+
+        msg->data = purc_variant_make_string_ex(text, len, true);
+        if (msg->data == PURC_VARIANT_INVALID)
+            goto failed;
+        msg->__data_len = len;
+    }
+
+    if (reader.p != reader.end)
+        goto failed;
+
+    *msg_out = msg;
+    return 0;
+
+failed:
+    pcrdr_release_message(msg);
+    purc_set_error(PCRDR_ERROR_BAD_MESSAGE);
+    return -1;
+}
+
@@ -257,9 +257,14 @@ variant_strcmp(purc_variant_t a, purc_variant_t b)
     if (a == b)
         return 0;
 
-    return strcmp(
-            purc_variant_get_string_const(a),
-            purc_variant_get_string_const(b));
+    const char *str_a = purc_variant_get_string_const(a);
+    const char *str_b = purc_variant_get_string_const(b);
+    if (str_a == NULL || str_b == NULL) {
+        /* the JSON data */
+        return purc_variant_compare_ex(a, b, PCVARIANT_COMPARE_OPT_AUTO);
+    }
+
+    return strcmp(str_a, str_b);
 }
 
 
@@ -709,7 +714,9 @@ int pcrdr_parse_packet(char *packet, size_t sz_packet, pcrdr_msg **msg_out)
     char *saveptr1;
     char *data;
 
-    UNUSED_PARAM(sz_packet);
+    if (pcrdr_is_binary_packet(packet, sz_packet)) {
+        return pcrdr_parse_packet_binary(packet, sz_packet, msg_out);
+    }
 
     if ((msg = pcinst_get_message()) == NULL) {
         purc_set_error(PCRDR_ERROR_NOMEM);
@@ -792,8 +799,11 @@ failed:
 
 #define LEN_BUFF_LONGLONGINT    128
 
+/* If `text_out` is not NULL, the text data which is held by the message
+   will not be written but returned via `text_out` and `len_out`. */
 static int
-serialize_message_data(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
+serialize_message_data(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt,
+        const char **text_out, size_t *len_out)
 {
     char buff[LEN_BUFF_LONGLONGINT];
     int n, errcode = 0;
@@ -856,8 +866,14 @@ serialize_message_data(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
     fn(ctxt, STR_BLANK_LINE, sizeof(STR_BLANK_LINE) - 1);
 
     if (text && text_len > 0) {
-        /* the data */
-        fn(ctxt, text, text_len);
+        if (text_out && text_alloc == NULL) {
+            *text_out = text;
+            *len_out = text_len;
+        }
+        else {
+            /* the data */
+            fn(ctxt, text, text_len);
+        }
     }
 
 done:
@@ -867,12 +883,18 @@ done:
     return errcode;
 }
 
-int pcrdr_serialize_message(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
+int pcrdr_serialize_message_head(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt, const char **text, size_t *text_len)
 {
     int n = 0;
     char buff[LEN_BUFF_LONGLONGINT];
     const char *value;
 
+    if (text) {
+        *text = NULL;
+        *text_len = 0;
+    }
+
     /* type: <request | response | event> */
     fn(ctxt, STR_KEY_TYPE, sizeof(STR_KEY_TYPE) - 1);
     fn(ctxt, STR_PAIR_SEPARATOR, sizeof(STR_PAIR_SEPARATOR) - 1);
@@ -942,7 +964,7 @@ int pcrdr_serialize_message(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
         fn(ctxt, value, strlen(value));
         fn(ctxt, STR_LINE_SEPARATOR, sizeof(STR_LINE_SEPARATOR) - 1);
 
-        n = serialize_message_data(msg, fn, ctxt);
+        n = serialize_message_data(msg, fn, ctxt, text, text_len);
     }
     else if (msg->type == PCRDR_MSG_TYPE_RESPONSE) {
         /* requestId: <requestId> */
@@ -985,7 +1007,7 @@ int pcrdr_serialize_message(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
         fn(ctxt, buff, n);
         fn(ctxt, STR_LINE_SEPARATOR, sizeof(STR_LINE_SEPARATOR) - 1);
 
-        n = serialize_message_data(msg, fn, ctxt);
+        n = serialize_message_data(msg, fn, ctxt, text, text_len);
     }
     else if (msg->type == PCRDR_MSG_TYPE_EVENT) {
         /* target: <session | window | tab | dom>/<handle> */
@@ -1043,7 +1065,7 @@ int pcrdr_serialize_message(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
             fn(ctxt, STR_LINE_SEPARATOR, sizeof(STR_LINE_SEPARATOR) - 1);
         }
 
-        n = serialize_message_data(msg, fn, ctxt);
+        n = serialize_message_data(msg, fn, ctxt, text, text_len);
     }
     else {
         assert(0);
@@ -1053,6 +1075,11 @@ int pcrdr_serialize_message(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
     return n;
 }
 
+int pcrdr_serialize_message(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
+{
+    return pcrdr_serialize_message_head(msg, fn, ctxt, NULL, NULL);
+}
+
 struct buff_info {
     char *  buf;    /* buffer address */
     size_t  size;   /* size of buffer */
@@ -1272,8 +1299,12 @@ pcrdr_parse_renderer_capabilities(const char *data)
                 rdr_caps->windowLevel = 0;
             }
 #endif
-            PC_WARN("Unknown renderer capability: %s\n", cap);
-            break;
+            if (pcutils_strcasecmp(cap, "binaryMessage") == 0) {
+                rdr_caps->binary_msg_version = strtol(value, NULL, 10);
+            }
+            else {
+                PC_WARN("Unknown renderer capability: %s\n", cap);
+            }
         }
 
         line_no++;
@@ -86,6 +86,7 @@ static struct pcrdr_opatom {
     { PCRDR_OPERATION_CALLMETHOD,           0 }, // "callMethod"
     { PCRDR_OPERATION_GETPROPERTY,          0 }, // "getProperty"
     { PCRDR_OPERATION_SETPROPERTY,          0 }, // "setProperty"
+    { PCRDR_OPERATION_BATCH,                0 }, // "batch"
 };
 
 /* make sure the number of operations matches the enumulators */
@@ -216,6 +217,22 @@ static int _init_instance(struct pcinst *curr_inst,
         purc_variant_unref(vs[i * 2 + 1]);
     }
 
+    /* ask for the binary message encoding if the renderer supports it */
+    bool binary_msg = (inst->rdr_caps->binary_msg_version >=
+            PCRDR_BINARY_MSG_VERSION);
+    if (binary_msg) {
+        purc_variant_t v = purc_variant_make_ulongint(PCRDR_BINARY_MSG_VERSION);
+        if (v == PURC_VARIANT_INVALID ||
+                !purc_variant_object_set_by_static_ckey(session_data,
+                    "binaryMessage", v)) {
+            PURC_VARIANT_SAFE_CLEAR(v);
+            purc_variant_unref(session_data);
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto failed;
+        }
+        purc_variant_unref(v);
+    }
+
     msg->dataType = PCRDR_MSG_DATA_TYPE_JSON;
     msg->data = session_data;
 
@@ -229,6 +246,8 @@ static int _init_instance(struct pcinst *curr_inst,
     int ret_code = response_msg->retCode;
     if (ret_code == PCRDR_SC_OK) {
         inst->rdr_caps->session_handle = response_msg->resultValue;
+        /* the following messages use the binary encoding */
+        inst->conn_to_rdr->binary_msg = binary_msg;
     }
 
     pcrdr_release_message(response_msg);
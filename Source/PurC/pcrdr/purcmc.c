@@ -27,6 +27,7 @@
 #include "private/list.h"
 #include "private/debug.h"
 #include "private/utils.h"
+#include "private/pcrdr.h"
 #include "purc-utils.h"
 #include "connect.h"
 
@@ -46,6 +47,7 @@
 #include <sys/socket.h>
 #include <sys/fcntl.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <sys/time.h>
 
 #define CLI_PATH    "/var/tmp/"
@@ -69,6 +71,32 @@ static inline int conn_write (int fd, const void *data, ssize_t sz)
     return PCRDR_ERROR_IO;
 }
 
+/* writes all vectors; note that the vectors will be changed */
+static int conn_writev (int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t n = writev (fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return PCRDR_ERROR_IO;
+        }
+
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    return 0;
+}
+
 static int my_wait_message (pcrdr_conn* conn, int timeout_ms)
 {
     fd_set rfds;
@@ -125,32 +153,97 @@ done:
     return msg;
 }
 
+static int send_packet_v (pcrdr_conn* conn, int op,
+        const struct iovec *segs, int nr_segs);
+
+struct send_buf_ctxt {
+    pcrdr_conn *conn;
+    bool        failed;
+};
+
+/* appends the serialized bytes to the send buffer of the connection */
+static ssize_t write_to_send_buf (void *ctxt, const void *buf, size_t count)
+{
+    struct send_buf_ctxt *sbc = ctxt;
+    pcrdr_conn *conn = sbc->conn;
+
+    if (sbc->failed)
+        return -1;
+
+    if (conn->len_send_buf + count > conn->sz_send_buf) {
+        size_t sz = conn->sz_send_buf ? conn->sz_send_buf :
+            PCRDR_MIN_PACKET_BUFF_SIZE;
+        while (sz < conn->len_send_buf + count)
+            sz <<= 1;
+
+        char *send_buf = realloc (conn->send_buf, sz);
+        if (send_buf == NULL) {
+            sbc->failed = true;
+            return -1;
+        }
+
+        conn->send_buf = send_buf;
+        conn->sz_send_buf = sz;
+    }
+
+    memcpy (conn->send_buf + conn->len_send_buf, buf, count);
+    conn->len_send_buf += count;
+    return count;
+}
+
+/*
+ * Serializes the message into the send buffer of the connection except for
+ * the text data held by the message, then sends the serialized bytes and
+ * the text data in place with writev().
+ */
 static int my_send_message (pcrdr_conn* conn, pcrdr_msg *msg)
 {
     int retv = -1;
-    purc_rwstream_t buffer = NULL;
+    struct send_buf_ctxt sbc = { conn, false };
+    struct iovec segs[2];
+    const char *text;
+    size_t text_len;
 
-    buffer = purc_rwstream_new_buffer (PCRDR_MIN_PACKET_BUFF_SIZE,
-            PCRDR_MAX_INMEM_PAYLOAD_SIZE);
-
-    if (pcrdr_serialize_message (msg,
-                (pcrdr_cb_write)purc_rwstream_write, buffer) < 0) {
-        goto done;
+    conn->len_send_buf = 0;
+    if (conn->binary_msg) {
+        retv = pcrdr_serialize_message_binary_head (msg, write_to_send_buf,
+                &sbc, &text, &text_len);
+    }
+    else {
+        retv = pcrdr_serialize_message_head (msg, write_to_send_buf,
+                &sbc, &text, &text_len);
     }
 
-    size_t packet_len;
-    const char * packet = purc_rwstream_get_mem_buffer (buffer, &packet_len);
+    if (retv == 0 && sbc.failed)
+        retv = PCRDR_ERROR_NOMEM;
 
-    if (pcrdr_purcmc_send_text_packet (conn, packet, packet_len) < 0) {
+    if (retv) {
+        purc_set_error (retv);
+        retv = -1;
         goto done;
     }
 
-    retv = 0;
+    segs[0].iov_base = conn->send_buf;
+    segs[0].iov_len = conn->len_send_buf;
+    segs[1].iov_base = (void *)text;
+    segs[1].iov_len = text_len;
+
+    retv = send_packet_v (conn,
+            conn->binary_msg ? US_OPCODE_BIN : US_OPCODE_TEXT,
+            segs, text_len > 0 ? 2 : 1);
+    if (retv) {
+        purc_set_error (retv);
+        retv = -1;
+    }
 
 done:
-    if (buffer) {
-        purc_rwstream_destroy(buffer);
+    /* do not hold a large buffer for a rare large message */
+    if (conn->sz_send_buf > PCRDR_MAX_INMEM_PAYLOAD_SIZE) {
+        free (conn->send_buf);
+        conn->send_buf = NULL;
+        conn->sz_send_buf = 0;
     }
+    conn->len_send_buf = 0;
 
     return retv;
 }
@@ -595,50 +688,83 @@ done:
     return 0;
 }
 
-int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t len)
+/* the maximal number of frames sent by one call to writev() */
+#define MAX_FRAMES_PER_WRITEV   16
+
+/*
+ * Sends a packet made of the segments as one or more frames. The frame
+ * headers and the payloads are gathered by writev(), so the segments are
+ * never concatenated.
+ */
+static int send_packet_v (pcrdr_conn* conn, int op,
+        const struct iovec *segs, int nr_segs)
 {
     int retv = 0;
 
     if (conn->type == CT_UNIX_SOCKET) {
-        USFrameHeader header;
-
-        if (len > PCRDR_MAX_FRAME_PAYLOAD_SIZE) {
-            size_t left = len;
-
-            do {
-                if (left == len) {
-                    header.op = US_OPCODE_TEXT;
-                    header.fragmented = len;
-                    header.sz_payload = PCRDR_MAX_FRAME_PAYLOAD_SIZE;
-                    left -= PCRDR_MAX_FRAME_PAYLOAD_SIZE;
-                }
-                else if (left > PCRDR_MAX_FRAME_PAYLOAD_SIZE) {
-                    header.op = US_OPCODE_CONTINUATION;
-                    header.fragmented = 0;
-                    header.sz_payload = PCRDR_MAX_FRAME_PAYLOAD_SIZE;
-                    left -= PCRDR_MAX_FRAME_PAYLOAD_SIZE;
-                }
-                else {
-                    header.op = US_OPCODE_END;
-                    header.fragmented = 0;
-                    header.sz_payload = left;
-                    left = 0;
+        USFrameHeader headers[MAX_FRAMES_PER_WRITEV];
+        struct iovec iov[MAX_FRAMES_PER_WRITEV * 3];
+        int nr_frames = 0, nr_iov = 0;
+        size_t len = 0, left;
+        int seg = 0;
+        size_t seg_off = 0;
+
+        /* a frame payload spans two segments at most */
+        assert (nr_segs <= 2);
+
+        for (int i = 0; i < nr_segs; i++)
+            len += segs[i].iov_len;
+
+        left = len;
+        do {
+            USFrameHeader *header = headers + nr_frames;
+            if (left == len) {
+                header->op = op;
+                header->fragmented = (len > PCRDR_MAX_FRAME_PAYLOAD_SIZE) ?
+                    len : 0;
+            }
+            else if (left > PCRDR_MAX_FRAME_PAYLOAD_SIZE) {
+                header->op = US_OPCODE_CONTINUATION;
+                header->fragmented = 0;
+            }
+            else {
+                header->op = US_OPCODE_END;
+                header->fragmented = 0;
+            }
+            header->sz_payload = (left > PCRDR_MAX_FRAME_PAYLOAD_SIZE) ?
+                PCRDR_MAX_FRAME_PAYLOAD_SIZE : left;
+            left -= header->sz_payload;
+
+            iov[nr_iov].iov_base = header;
+            iov[nr_iov].iov_len = sizeof (USFrameHeader);
+            nr_iov++;
+
+            size_t payload_left = header->sz_payload;
+            while (payload_left > 0) {
+                size_t n = segs[seg].iov_len - seg_off;
+                if (n > payload_left)
+                    n = payload_left;
+
+                iov[nr_iov].iov_base = (char *)segs[seg].iov_base + seg_off;
+                iov[nr_iov].iov_len = n;
+                nr_iov++;
+
+                payload_left -= n;
+                seg_off += n;
+                if (seg_off == segs[seg].iov_len) {
+                    seg++;
+                    seg_off = 0;
                 }
+            }
 
-                if (conn_write (conn->fd, &header, sizeof (USFrameHeader)) == 0) {
-                    retv = conn_write (conn->fd, text, header.sz_payload);
-                    text += header.sz_payload;
-                }
+            nr_frames++;
+            if (nr_frames == MAX_FRAMES_PER_WRITEV || left == 0) {
+                retv = conn_writev (conn->fd, iov, nr_iov);
+                nr_frames = 0;
+                nr_iov = 0;
+            }
 
-            } while (left > 0 && retv == 0);
-        }
-        else {
-            header.op = US_OPCODE_TEXT;
-            header.fragmented = 0;
-            header.sz_payload = len;
-            if (conn_write (conn->fd, &header, sizeof (USFrameHeader)) == 0)
-                retv = conn_write (conn->fd, text, len);
-        }
+        } while (left > 0 && retv == 0);
     }
     else if (conn->type == CT_WEB_SOCKET) {
         /* TODO */
@@ -650,6 +776,18 @@ int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t le
     return retv;
 }
 
+int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t len)
+{
+    struct iovec seg = { (void *)text, len };
+    return send_packet_v (conn, US_OPCODE_TEXT, &seg, 1);
+}
+
+int pcrdr_purcmc_send_binary_packet (pcrdr_conn* conn, const void* data, size_t sz)
+{
+    struct iovec seg = { (void *)data, sz };
+    return send_packet_v (conn, US_OPCODE_BIN, &seg, 1);
+}
+
 #define SCHEMA_UNIX_SOCKET  "unix://"
 
 pcrdr_msg *pcrdr_purcmc_connect(const char* renderer_uri,
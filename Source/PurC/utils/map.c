@@ -193,6 +193,9 @@ static void clear_node (pcutils_map* map, struct rb_node* node)
 static void erase_entry (pcutils_map* map, pcutils_map_entry *entry)
 {
     pcutils_rbtree_erase (&entry->node, &map->root);
+    /* the links are stale now; do not let clear_node() follow them */
+    entry->node.rb_left = NULL;
+    entry->node.rb_right = NULL;
     clear_node (map, &entry->node);
     map->size--;
 }
@@ -291,6 +294,16 @@ int pcutils_map_erase (pcutils_map* map, const void* key)
     return retval;
 }
 
+int pcutils_map_erase_nolock (pcutils_map* map, const void* key)
+{
+    pcutils_map_entry* entry = find_entry (map, key);
+    if (entry == NULL)
+        return -1;
+
+    erase_entry (map, entry);
+    return 0;
+}
+
 void pcutils_map_erase_entry_nolock (pcutils_map* map,
         pcutils_map_entry *entry)
 {
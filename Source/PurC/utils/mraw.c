@@ -49,12 +49,60 @@
 #define pcutils_mraw_data_begin(data)                                           \
     &((uint8_t *) (data))[ pcutils_mraw_meta_size() ]
 
+#define pcutils_mraw_is_small(size)                                            \
+    ((size) >= sizeof(void *) && (size) <= PCUTILS_MRAW_SMALL_MAX)
+
 
 static inline void *
 pcutils_mraw_realloc_tail(pcutils_mraw_t *mraw, void *data, void *begin,
                          size_t size, size_t begin_len, size_t new_size,
                          bool *is_valid);
 
+/*
+ * Keep a freed block for reusing: the small blocks go to the free list of
+ * their size, in which the link is stored in the block itself; the others
+ * go to the size-keyed tree.
+ */
+static inline void
+pcutils_mraw_cache_put(pcutils_mraw_t *mraw, void *data, size_t size)
+{
+    if (pcutils_mraw_is_small(size)) {
+        void **head = &mraw->free_lists[pcutils_mraw_class(size)];
+
+#if defined(PCHTML_HAVE_ADDRESS_SANITIZER)
+        ASAN_UNPOISON_MEMORY_REGION(data, sizeof(void *));
+#endif
+        memcpy(data, head, sizeof(void *));
+#if defined(PCHTML_HAVE_ADDRESS_SANITIZER)
+        ASAN_POISON_MEMORY_REGION(data, sizeof(void *));
+#endif
+
+        *head = data;
+        return;
+    }
+
+    pcutils_bst_insert(mraw->cache, pcutils_bst_root_ref(mraw->cache),
+                      size, data);
+}
+
+static inline void *
+pcutils_mraw_free_list_pop(pcutils_mraw_t *mraw, size_t size)
+{
+    void **head = &mraw->free_lists[pcutils_mraw_class(size)];
+    void *data = *head;
+
+    if (data != NULL) {
+#if defined(PCHTML_HAVE_ADDRESS_SANITIZER)
+        ASAN_UNPOISON_MEMORY_REGION(((uint8_t *) data)
+                                    - pcutils_mraw_meta_size(),
+                                    size + pcutils_mraw_meta_size());
+#endif
+        memcpy(head, data, sizeof(void *));
+    }
+
+    return data;
+}
+
 
 pcutils_mraw_t *
 pcutils_mraw_create(void)
@@ -103,6 +151,10 @@ pcutils_mraw_clean(pcutils_mraw_t *mraw)
 {
     pcutils_mem_clean(mraw->mem);
     pcutils_bst_clean(mraw->cache);
+
+    memset(mraw->free_lists, 0, sizeof(mraw->free_lists));
+    mraw->nr_blocks = 0;
+    mraw->bytes_used = 0;
 }
 
 pcutils_mraw_t *
@@ -170,9 +222,8 @@ pcutils_mraw_mem_alloc(pcutils_mraw_t *mraw, size_t length)
                                       diff + pcutils_mraw_meta_size());
 #endif
 
-            pcutils_bst_insert(mraw->cache,
-                              pcutils_bst_root_ref(mraw->cache), diff,
-                              pcutils_mraw_data_begin(&chunk->data[chunk->length]));
+            pcutils_mraw_cache_put(mraw,
+                    pcutils_mraw_data_begin(&chunk->data[chunk->length]), diff);
 
             chunk->length = chunk->size;
         }
@@ -205,6 +256,15 @@ pcutils_mraw_alloc(pcutils_mraw_t *mraw, size_t size)
 
     size = pcutils_mem_align(size);
 
+    if (pcutils_mraw_is_small(size)) {
+        data = pcutils_mraw_free_list_pop(mraw, size);
+        if (data != NULL) {
+            mraw->nr_blocks++;
+            mraw->bytes_used += size;
+            return data;
+        }
+    }
+
     if (mraw->cache->tree_length != 0) {
         data = pcutils_bst_remove_close(mraw->cache,
                                        pcutils_bst_root_ref(mraw->cache),
@@ -223,6 +283,8 @@ pcutils_mraw_alloc(pcutils_mraw_t *mraw, size_t size)
                                         (cur_size + pcutils_mraw_meta_size()));
 #endif
 
+            mraw->nr_blocks++;
+            mraw->bytes_used += pcutils_mraw_data_size(data);
             return data;
         }
     }
@@ -238,6 +300,9 @@ pcutils_mraw_alloc(pcutils_mraw_t *mraw, size_t size)
 #endif
 
     pcutils_mraw_meta_set(data, &size);
+
+    mraw->nr_blocks++;
+    mraw->bytes_used += size;
     return pcutils_mraw_data_begin(data);
 }
 
@@ -268,6 +333,9 @@ pcutils_mraw_realloc_tail(pcutils_mraw_t *mraw, void *data, void *begin,
 
         if (new_size == 0) {
             chunk->length = begin_len - pcutils_mraw_meta_size();
+
+            mraw->nr_blocks--;
+            mraw->bytes_used -= size;
             return NULL;
         }
 
@@ -278,6 +346,7 @@ pcutils_mraw_realloc_tail(pcutils_mraw_t *mraw, void *data, void *begin,
         chunk->length = begin_len + new_size;
         memcpy(begin, &new_size, sizeof(size_t));
 
+        mraw->bytes_used = mraw->bytes_used - size + new_size;
         return data;
     }
 
@@ -313,6 +382,7 @@ pcutils_mraw_realloc_tail(pcutils_mraw_t *mraw, void *data, void *begin,
         chunk->size = new_chunk.size;
         chunk->length = new_size + pcutils_mraw_meta_size();
 
+        mraw->bytes_used = mraw->bytes_used - size + new_size;
         return new_data;
     }
 
@@ -356,17 +426,23 @@ pcutils_mraw_realloc(pcutils_mraw_t *mraw, void *data, size_t new_size)
             if (is_valid == true) {
                 return ptr;
             }
+
+            /* the tail of the chunk has been joined to the data */
+            size_t old_size = size;
+            memcpy(&size, begin, sizeof(size_t));
+            mraw->bytes_used += size - old_size;
         }
     }
 
     if (new_size < size) {
         if (new_size == 0) {
+            mraw->nr_blocks--;
+            mraw->bytes_used -= size;
 
 #if defined(PCHTML_HAVE_ADDRESS_SANITIZER)
             ASAN_POISON_MEMORY_REGION(begin, size + pcutils_mraw_meta_size());
 #endif
-            pcutils_bst_insert(mraw->cache, pcutils_bst_root_ref(mraw->cache),
-                              size, data);
+            pcutils_mraw_cache_put(mraw, data, size);
             return NULL;
         }
 
@@ -374,17 +450,19 @@ pcutils_mraw_realloc(pcutils_mraw_t *mraw, void *data, size_t new_size)
 
         if (diff > pcutils_mraw_meta_size()) {
             memcpy(begin, &new_size, sizeof(size_t));
+            mraw->bytes_used -= diff;
 
+            /* the rest of the data becomes a free block */
+            begin = &((uint8_t *) data)[new_size];
             new_size = diff - pcutils_mraw_meta_size();
-            begin = &((uint8_t *) data)[diff];
 
             pcutils_mraw_meta_set(begin, &new_size);
 
 #if defined(PCHTML_HAVE_ADDRESS_SANITIZER)
             ASAN_POISON_MEMORY_REGION(begin, new_size + pcutils_mraw_meta_size());
 #endif
-            pcutils_bst_insert(mraw->cache, pcutils_bst_root_ref(mraw->cache),
-                              new_size, pcutils_mraw_data_begin(begin));
+            pcutils_mraw_cache_put(mraw, pcutils_mraw_data_begin(begin),
+                                   new_size);
         }
 
         return data;
@@ -414,8 +492,23 @@ pcutils_mraw_free(pcutils_mraw_t *mraw, void *data)
     ASAN_POISON_MEMORY_REGION(real_data, size + pcutils_mraw_meta_size());
 #endif
 
-    pcutils_bst_insert(mraw->cache, pcutils_bst_root_ref(mraw->cache),
-                      size, data);
+    mraw->nr_blocks--;
+    mraw->bytes_used -= size;
+
+    pcutils_mraw_cache_put(mraw, data, size);
 
     return NULL;
 }
+
+void
+pcutils_mraw_get_stats(pcutils_mraw_t *mraw, struct pcutils_mraw_stats *stats)
+{
+    stats->nr_blocks = mraw->nr_blocks;
+    stats->bytes_used = mraw->bytes_used;
+    stats->bytes_reserved = 0;
+
+    for (pcutils_mem_chunk_t *chunk = mraw->mem->chunk_first; chunk != NULL;
+            chunk = chunk->next) {
+        stats->bytes_reserved += chunk->size;
+    }
+}
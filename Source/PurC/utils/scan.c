@@ -0,0 +1,207 @@
+/**
+ * @file scan.c
+ * @author
+ * @date 2026/10/19
+ * @brief The implementation of scanning bytes in bulk.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "private/scan.h"
+
+#include <stdint.h>
+
+#if COMPILER(GCC_COMPATIBLE)
+#if CPU(X86_SSE2)
+#define HAVE_SCAN_SSE2 1
+#include <emmintrin.h>
+#if CPU(X86_64)
+#define HAVE_SCAN_AVX2 1
+#include <immintrin.h>
+#include <stdatomic.h>
+#endif
+#elif CPU(ARM64) || CPU(ARM_NEON)
+#define HAVE_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+static inline bool
+in_set(const struct pcutils_scan_set *set, unsigned char c)
+{
+    if (set->ctrls && c < 0x20)
+        return true;
+
+    for (unsigned i = 0; i < set->nr_bytes; i++) {
+        if (c == set->bytes[i])
+            return true;
+    }
+
+    return false;
+}
+
+static inline const unsigned char *
+scan_scalar(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set)
+{
+    while (data < end && !in_set(set, *data))
+        data++;
+
+    return data;
+}
+
+#ifdef HAVE_SCAN_SSE2
+static const unsigned char *
+scan_sse2(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set)
+{
+    __m128i v_bytes[PCUTILS_SCAN_SET_MAX];
+    for (unsigned i = 0; i < set->nr_bytes; i++)
+        v_bytes[i] = _mm_set1_epi8((char)set->bytes[i]);
+    const __m128i v_ctrl = _mm_set1_epi8(0x1F);
+
+    while (end - data >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)data);
+        __m128i m = _mm_setzero_si128();
+
+        /* v <= 0x1F if max(v, 0x1F) == 0x1F */
+        if (set->ctrls)
+            m = _mm_cmpeq_epi8(_mm_max_epu8(v, v_ctrl), v_ctrl);
+        for (unsigned i = 0; i < set->nr_bytes; i++)
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, v_bytes[i]));
+
+        unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        if (mask)
+            return data + __builtin_ctz(mask);
+
+        data += 16;
+    }
+
+    return scan_scalar(data, end, set);
+}
+#endif
+
+#ifdef HAVE_SCAN_AVX2
+__attribute__((target("avx2")))
+static const unsigned char *
+scan_avx2(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set)
+{
+    __m256i v_bytes[PCUTILS_SCAN_SET_MAX];
+    for (unsigned i = 0; i < set->nr_bytes; i++)
+        v_bytes[i] = _mm256_set1_epi8((char)set->bytes[i]);
+    const __m256i v_ctrl = _mm256_set1_epi8(0x1F);
+
+    while (end - data >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)data);
+        __m256i m = _mm256_setzero_si256();
+
+        if (set->ctrls)
+            m = _mm256_cmpeq_epi8(_mm256_max_epu8(v, v_ctrl), v_ctrl);
+        for (unsigned i = 0; i < set->nr_bytes; i++)
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, v_bytes[i]));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if (mask)
+            return data + __builtin_ctz(mask);
+
+        data += 32;
+    }
+
+    return scan_sse2(data, end, set);
+}
+#endif
+
+#ifdef HAVE_SCAN_NEON
+static const unsigned char *
+scan_neon(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set)
+{
+    uint8x16_t v_bytes[PCUTILS_SCAN_SET_MAX];
+    for (unsigned i = 0; i < set->nr_bytes; i++)
+        v_bytes[i] = vdupq_n_u8(set->bytes[i]);
+    const uint8x16_t v_ctrl = vdupq_n_u8(0x20);
+
+    while (end - data >= 16) {
+        uint8x16_t v = vld1q_u8(data);
+        uint8x16_t m = vdupq_n_u8(0);
+
+        if (set->ctrls)
+            m = vcltq_u8(v, v_ctrl);
+        for (unsigned i = 0; i < set->nr_bytes; i++)
+            m = vorrq_u8(m, vceqq_u8(v, v_bytes[i]));
+
+        /* narrow every byte of the mask to four bits */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+                    vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (mask)
+            return data + (__builtin_ctzll(mask) >> 2);
+
+        data += 16;
+    }
+
+    return scan_scalar(data, end, set);
+}
+#endif
+
+typedef const unsigned char *(*scan_fn)(const unsigned char *data,
+        const unsigned char *end, const struct pcutils_scan_set *set);
+
+#ifdef HAVE_SCAN_AVX2
+static const unsigned char *
+scan_init(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set);
+
+/* the scanner is selected by the features of the CPU on the first call;
+   the threads racing on the first calls store the same scanner */
+static _Atomic(scan_fn) scan_impl = scan_init;
+
+static const unsigned char *
+scan_init(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set)
+{
+    __builtin_cpu_init();
+    scan_fn impl = __builtin_cpu_supports("avx2") ? scan_avx2 : scan_sse2;
+    atomic_store_explicit(&scan_impl, impl, memory_order_relaxed);
+    return impl(data, end, set);
+}
+
+static inline scan_fn get_scan_impl(void)
+{
+    return atomic_load_explicit(&scan_impl, memory_order_relaxed);
+}
+#elif defined(HAVE_SCAN_SSE2)
+static inline scan_fn get_scan_impl(void) { return scan_sse2; }
+#elif defined(HAVE_SCAN_NEON)
+static inline scan_fn get_scan_impl(void) { return scan_neon; }
+#else
+static inline scan_fn get_scan_impl(void) { return scan_scalar; }
+#endif
+
+const unsigned char *
+pcutils_scan_bytes(const unsigned char *data, const unsigned char *end,
+        const struct pcutils_scan_set *set)
+{
+    /* the runs of ordinary bytes are often short */
+    if (end - data < 16)
+        return scan_scalar(data, end, set);
+
+    return get_scan_impl()(data, end, set);
+}
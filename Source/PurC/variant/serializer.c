@@ -46,6 +46,7 @@
 #include "private/instance.h"
 #include "private/errors.h"
 #include "private/debug.h"
+#include "private/scan.h"
 
 #include "variant/variant-internals.h"
 
@@ -96,93 +97,93 @@ static const char *hex_chars = "0123456789abcdefABCDEF";
         }                                                               \
     } while (0)
 
+/* the characters to be escaped; the runs of other characters are written
+   at once */
+static const struct pcutils_scan_set escaping_set = {
+    { '"', '\\', '/' }, 3, true
+};
+
+static const struct pcutils_scan_set escaping_set_noslash = {
+    { '"', '\\' }, 2, true
+};
+
+/* the longest escape sequence: \u00XX */
+#define MAX_ESCAPE_LEN  6
+
 static ssize_t
 serialize_string(purc_rwstream_t rws, const char* str,
         size_t len, unsigned int flags, size_t *len_expected)
 {
     int nr_written = 0;
-    size_t pos = 0, start_offset = 0;
-    unsigned char c;
-    char buff[3];
-
-    while (len--) {
-        c = str[pos];
-        switch (c) {
-        case '\b':
-        case '\n':
-        case '\r':
-        case '\t':
-        case '\f':
-        case '"':
-        case '\\':
-        case '/':
-            if ((flags & PCVARIANT_SERIALIZE_OPT_NOSLASHESCAPE) && c == '/') {
-                pos++;
+    bool noslash = (flags & PCVARIANT_SERIALIZE_OPT_NOSLASHESCAPE);
+    const struct pcutils_scan_set *set;
+    const unsigned char *p = (const unsigned char *)str;
+    const unsigned char *end = p + len;
+    char buff[MAX_ESCAPE_LEN * 16];
+
+    set = noslash ? &escaping_set_noslash : &escaping_set;
+    while (p < end) {
+        const unsigned char *run = p;
+        p = pcutils_scan_bytes(p, end, set);
+        if (p > run)
+            MY_WRITE(rws, (const char *)run, p - run);
+
+        /* escape the consecutive special characters with one write */
+        size_t nr_buff = 0;
+        while (p < end && nr_buff + MAX_ESCAPE_LEN <= sizeof(buff)) {
+            unsigned char c = *p;
+            char esc = 0;
+
+            switch (c) {
+            case '\b':
+                esc = 'b';
+                break;
+            case '\n':
+                esc = 'n';
+                break;
+            case '\r':
+                esc = 'r';
+                break;
+            case '\t':
+                esc = 't';
+                break;
+            case '\f':
+                esc = 'f';
+                break;
+            case '"':
+            case '\\':
+                esc = c;
+                break;
+            case '/':
+                if (!noslash)
+                    esc = c;
+                break;
+            default:
                 break;
             }
 
-            if (pos - start_offset > 0)
-                MY_WRITE(rws, str + start_offset, pos - start_offset);
-
-            buff[0] = 0;
-            if (c == '\b') {
-                buff[0] = '\\';
-                buff[1] = 'b';
-            }
-            else if (c == '\n') {
-                buff[0] = '\\';
-                buff[1] = 'n';
-            }
-            else if (c == '\r') {
-                buff[0] = '\\';
-                buff[1] = 'r';
-            }
-            else if (c == '\t') {
-                buff[0] = '\\';
-                buff[1] = 't';
-            }
-            else if (c == '\f') {
-                buff[0] = '\\';
-                buff[1] = 'f';
+            if (esc) {
+                buff[nr_buff++] = '\\';
+                buff[nr_buff++] = esc;
             }
-            else if (c == '"') {
-                buff[0] = '\\';
-                buff[1] = '\"';
+            else if (c < ' ') {
+                buff[nr_buff++] = '\\';
+                buff[nr_buff++] = 'u';
+                buff[nr_buff++] = '0';
+                buff[nr_buff++] = '0';
+                buff[nr_buff++] = hex_chars[c >> 4];
+                buff[nr_buff++] = hex_chars[c & 0xf];
             }
-            else if (c == '\\') {
-                buff[0] = '\\';
-                buff[1] = '\\';
-            }
-            else if (c == '/') {
-                buff[0] = '\\';
-                buff[1] = '/';
+            else {
+                break;
             }
 
-            if (buff[0])
-                MY_WRITE(rws, buff, 2);
-
-            start_offset = ++pos;
-            break;
-
-        default:
-            if (c < ' ') {
-                char sbuf[7];
-                if (pos - start_offset > 0)
-                    MY_WRITE(rws, str + start_offset, pos - start_offset);
-
-                if (snprintf(sbuf, sizeof(sbuf), "\\u00%c%c",
-                            hex_chars[c >> 4], hex_chars[c & 0xf]) < 0)
-                    goto failed;
-
-                MY_WRITE(rws, sbuf, sizeof(sbuf) - 1);
-                start_offset = ++pos;
-            }
-            else
-                pos++;
+            p++;
         }
+
+        if (nr_buff)
+            MY_WRITE(rws, buff, nr_buff);
     }
-    if (pos - start_offset > 0)
-        MY_WRITE(rws, str + start_offset, pos - start_offset);
 
     return nr_written;
 
@@ -184,6 +184,7 @@ obj_node_release(purc_variant_t obj, struct obj_node *node)
     struct rb_root *root = &data->kvs;
     if (&node->node == root->rb_node || node->node.rb_parent) {
         --data->size;
+        data->shape = 0;
         pcutils_rbtree_erase(&node->node, root);
         node->node.rb_parent = NULL;
     }
@@ -342,6 +343,7 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
         }
 
         --data->size;
+        data->shape = 0;
         PC_ASSERT(entry == root->rb_node || entry->rb_parent);
         pcutils_rbtree_erase(entry, root);
         entry->rb_parent = NULL;
@@ -515,6 +517,7 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
             pcutils_rbtree_insert_color(entry, root);
 
             ++data->size;
+            data->shape = 0;
 
             if (check) {
                 if (build_rev_update_chain(obj, node))
@@ -796,13 +799,22 @@ int pcvariant_object_compare (purc_variant_t lv, purc_variant_t rv)
 }
 */
 
-purc_variant_t
-purc_variant_object_get_by_ckey(purc_variant_t obj, const char* key)
+uint64_t
+pcvar_obj_get_shape(purc_variant_t obj)
 {
-    PCVARIANT_CHECK_FAIL_RET((obj && obj->type==PVT(_OBJECT) &&
-        obj->sz_ptr[1] && key),
-        PURC_VARIANT_INVALID);
+    static uint64_t last_shape;
 
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    if (data->shape == 0) {
+        data->shape = __sync_add_and_fetch(&last_shape, 1);
+    }
+
+    return data->shape;
+}
+
+struct obj_node *
+pcvar_obj_find_node(purc_variant_t obj, const char *key)
+{
     variant_obj_t data = pcvar_obj_get_data(obj);
     struct rb_root *root = &data->kvs;
 
@@ -829,13 +841,26 @@ purc_variant_object_get_by_ckey(purc_variant_t obj, const char* key)
     }
 
     if (!entry) {
+        return NULL;
+    }
+
+    return container_of(entry, struct obj_node, node);
+}
+
+purc_variant_t
+purc_variant_object_get_by_ckey(purc_variant_t obj, const char* key)
+{
+    PCVARIANT_CHECK_FAIL_RET((obj && obj->type==PVT(_OBJECT) &&
+        obj->sz_ptr[1] && key),
+        PURC_VARIANT_INVALID);
+
+    struct obj_node *node = pcvar_obj_find_node(obj, key);
+    if (!node) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
 
         return PURC_VARIANT_INVALID;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
     return node->val;
 }
 
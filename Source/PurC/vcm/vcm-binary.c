@@ -0,0 +1,255 @@
+/*
+ * @file vcm-binary.c
+ * @date 2022/10/21
+ * @brief The binary form of vcm trees for the persistent vDOM cache.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A node is written in pre-order as:
+ *
+ *      u8 type, u8 is_closed, u32 extra, <payload>, u32 nr_children
+ *
+ * followed by its children. The payload depends on the type: one byte for
+ * a boolean, the raw bytes of a number, or u32 length plus the bytes for a
+ * string or a byte sequence. The integers are in the native byte order; the
+ * vDOM cache rejects files written by another library or platform.
+ */
+
+#include "config.h"
+#include "purc-utils.h"
+#include "purc-errors.h"
+#include "private/errors.h"
+#include "private/vcm.h"
+
+#include "vcm-internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the trees nesting the nodes deeper are rejected */
+#define MAX_VCM_DEPTH           256
+
+static inline int
+write_bytes(purc_rwstream_t out, const void *buf, size_t len)
+{
+    return (purc_rwstream_write(out, buf, len) == (ssize_t)len) ? 0 : -1;
+}
+
+static inline int
+write_u8(purc_rwstream_t out, uint8_t v)
+{
+    return write_bytes(out, &v, sizeof(v));
+}
+
+static inline int
+write_u32(purc_rwstream_t out, uint32_t v)
+{
+    return write_bytes(out, &v, sizeof(v));
+}
+
+static inline bool
+read_bytes(const unsigned char **data, const unsigned char *end,
+        void *buf, size_t len)
+{
+    if ((size_t)(end - *data) < len) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return false;
+    }
+    memcpy(buf, *data, len);
+    *data += len;
+    return true;
+}
+
+static int
+write_node(purc_rwstream_t out, const struct pcvcm_node *node, int depth)
+{
+    /* the reader would reject the tree, so do not write it */
+    if (depth > MAX_VCM_DEPTH) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return -1;
+    }
+
+    if (write_u8(out, (uint8_t)node->type) ||
+            write_u8(out, node->is_closed ? 1 : 0) ||
+            write_u32(out, node->extra))
+        return -1;
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_BOOLEAN:
+        if (write_u8(out, node->b ? 1 : 0))
+            return -1;
+        break;
+
+    case PCVCM_NODE_TYPE_NUMBER:
+        if (write_bytes(out, &node->d, sizeof(node->d)))
+            return -1;
+        break;
+
+    case PCVCM_NODE_TYPE_LONG_INT:
+    case PCVCM_NODE_TYPE_ULONG_INT:
+        if (write_bytes(out, &node->u64, sizeof(node->u64)))
+            return -1;
+        break;
+
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+        if (write_bytes(out, &node->ld, sizeof(node->ld)))
+            return -1;
+        break;
+
+    case PCVCM_NODE_TYPE_STRING:
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+        if (node->sz_ptr[0] > UINT32_MAX ||
+                write_u32(out, (uint32_t)node->sz_ptr[0]))
+            return -1;
+        if (node->sz_ptr[0] && write_bytes(out,
+                    (const void *)node->sz_ptr[1], node->sz_ptr[0]))
+            return -1;
+        break;
+
+    default:
+        break;
+    }
+
+    if (write_u32(out, (uint32_t)CHILDREN_NUMBER(node)))
+        return -1;
+
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    while (child) {
+        if (write_node(out, child, depth + 1))
+            return -1;
+        child = NEXT_CHILD(child);
+    }
+
+    return 0;
+}
+
+int pcvcm_node_write_binary(purc_rwstream_t out,
+        const struct pcvcm_node *tree)
+{
+    return write_node(out, tree, 0);
+}
+
+static struct pcvcm_node *
+read_node(const unsigned char **data, const unsigned char *end, int depth)
+{
+    uint8_t type, is_closed, b;
+    uint32_t extra, len, nr_children;
+
+    if (depth > MAX_VCM_DEPTH) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return NULL;
+    }
+
+    if (!read_bytes(data, end, &type, sizeof(type)) ||
+            !read_bytes(data, end, &is_closed, sizeof(is_closed)) ||
+            !read_bytes(data, end, &extra, sizeof(extra)))
+        return NULL;
+
+    if (type > PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return NULL;
+    }
+
+    struct pcvcm_node *node;
+    node = (struct pcvcm_node *)calloc(1, sizeof(struct pcvcm_node));
+    if (node == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    node->type = (enum pcvcm_node_type)type;
+    node->is_closed = is_closed ? true : false;
+    node->extra = extra;
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_BOOLEAN:
+        if (!read_bytes(data, end, &b, sizeof(b)))
+            goto failed;
+        node->b = b ? true : false;
+        break;
+
+    case PCVCM_NODE_TYPE_NUMBER:
+        if (!read_bytes(data, end, &node->d, sizeof(node->d)))
+            goto failed;
+        break;
+
+    case PCVCM_NODE_TYPE_LONG_INT:
+    case PCVCM_NODE_TYPE_ULONG_INT:
+        if (!read_bytes(data, end, &node->u64, sizeof(node->u64)))
+            goto failed;
+        break;
+
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+        if (!read_bytes(data, end, &node->ld, sizeof(node->ld)))
+            goto failed;
+        break;
+
+    case PCVCM_NODE_TYPE_STRING:
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+    {
+        if (!read_bytes(data, end, &len, sizeof(len)))
+            goto failed;
+        if ((size_t)(end - *data) < len) {
+            pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+            goto failed;
+        }
+
+        /* keep the terminating null byte as pcvcm_node_new_string() */
+        char *buf = (char *)malloc(len + 1);
+        if (buf == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto failed;
+        }
+        memcpy(buf, *data, len);
+        buf[len] = 0;
+        *data += len;
+
+        node->sz_ptr[0] = len;
+        node->sz_ptr[1] = (uintptr_t)buf;
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    if (!read_bytes(data, end, &nr_children, sizeof(nr_children)))
+        goto failed;
+
+    for (uint32_t i = 0; i < nr_children; i++) {
+        struct pcvcm_node *child = read_node(data, end, depth + 1);
+        if (child == NULL)
+            goto failed;
+        APPEND_CHILD(node, child);
+    }
+
+    return node;
+
+failed:
+    pcvcm_node_destroy(node);
+    return NULL;
+}
+
+struct pcvcm_node *pcvcm_node_read_binary(const unsigned char **data,
+        const unsigned char *end)
+{
+    return read_node(data, end, 0);
+}
+
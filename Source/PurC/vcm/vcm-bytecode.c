@@ -0,0 +1,1075 @@
+/*
+ * @file vcm-bytecode.c
+ * @date 2022/10/19
+ * @brief The bytecode compiler and the stack VM for vcm.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A vcm tree is compiled to a flat array of instructions in post order:
+ * the instructions of the children push their values onto the operand
+ * stack, and the instruction of the parent pops them and pushes the result.
+ * The constants are not converted to variants at compile time, because
+ * a vDOM (and its vcm trees) may be shared by the instances in different
+ * threads, while the variants belong to an instance. Instead, the
+ * instructions refer to the constant nodes directly, so no dispatching
+ * on node types and no temporary name variants are needed at run time.
+ *
+ * Along with the value of a node, the VM keeps the value of the first child
+ * of the node on the stack (the `root'), which is what the tree walker finds
+ * in `attach' of the first child when calling a method of a dynamic variant.
+ */
+
+#include "config.h"
+#include "purc-utils.h"
+#include "purc-errors.h"
+#include "private/errors.h"
+#include "private/vcm.h"
+#include "private/utils.h"
+
+#include "vcm-internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_NR_INSTRS       8
+#define NR_LOCAL_SLOTS      16
+
+enum pcvcm_opcode {
+    PCVCM_OP_PUSH_UNDEFINED,
+    PCVCM_OP_PUSH_NULL,
+    PCVCM_OP_PUSH_BOOLEAN,
+    PCVCM_OP_PUSH_NUMBER,
+    PCVCM_OP_PUSH_LONG_INT,
+    PCVCM_OP_PUSH_ULONG_INT,
+    PCVCM_OP_PUSH_LONG_DOUBLE,
+    PCVCM_OP_PUSH_STRING,
+    PCVCM_OP_PUSH_BYTE_SEQUENCE,
+    PCVCM_OP_MAKE_OBJECT,           /* count: the number of key/value pairs */
+    PCVCM_OP_MAKE_ARRAY,            /* count: the number of members */
+    PCVCM_OP_CONCAT_STRING,         /* count: the number of parts */
+    PCVCM_OP_GET_VARIABLE,          /* ref: the name, or NULL if on stack */
+    PCVCM_OP_GET_ELEMENT,           /* flags, index, and count: the site */
+    PCVCM_OP_CHECK_CALLER,          /* target: the instruction after call */
+    PCVCM_OP_CALL_GETTER,           /* count: the number of parameters */
+    PCVCM_OP_CALL_SETTER,           /* count: the number of parameters */
+                                    /* node: the name if known */
+    PCVCM_OP_JUMP_IF_FALSE,         /* target */
+    PCVCM_OP_JUMP_IF_TRUE,          /* target */
+    PCVCM_OP_POP,
+};
+
+/*
+ * flags of PCVCM_OP_GET_ELEMENT; a constant parameter is not pushed onto
+ * the stack, but kept in node.
+ */
+#define INSTR_FLAG_AS_GETTER        0x0001
+#define INSTR_FLAG_CONST_PARAM      0x0002
+#define INSTR_FLAG_HAS_INDEX        0x0004
+
+struct pcvcm_instr {
+    uint16_t                    op;
+    uint16_t                    flags;
+    uint32_t                    count;  /* or the jump target */
+    union {
+        const struct pcvcm_node *node;
+        struct pcvcm_var_ref    *ref;
+    };
+    int64_t                     index;
+
+    /* the resolved methods of native entities, see vcm-ic.c */
+    struct pcvcm_native_ic     *nic;
+};
+
+struct pcvcm_bytecode {
+    struct pcvcm_instr         *instrs;
+    size_t                      nr_instrs;
+    size_t                      sz_instrs;
+    size_t                      max_depth;
+};
+
+/*
+ * The sentinels stored in pcvcm_node.bytecode: a node evaluated only
+ * once is not compiled, so one-shot trees (e.g. JSON documents) never
+ * pay for the compilation.
+ */
+static struct pcvcm_bytecode bytecode_evaluated_once;
+static struct pcvcm_bytecode bytecode_uncompilable;
+
+struct compiler {
+    struct pcvcm_bytecode      *bc;
+    size_t                      depth;
+};
+
+static struct pcvcm_instr *
+emit(struct compiler *c, enum pcvcm_opcode op)
+{
+    struct pcvcm_bytecode *bc = c->bc;
+    if (bc->nr_instrs == bc->sz_instrs) {
+        size_t sz = bc->sz_instrs ? bc->sz_instrs * 2 : MIN_NR_INSTRS;
+        struct pcvcm_instr *instrs = (struct pcvcm_instr *)realloc(
+                bc->instrs, sizeof(struct pcvcm_instr) * sz);
+        if (instrs == NULL)
+            return NULL;
+        bc->instrs = instrs;
+        bc->sz_instrs = sz;
+    }
+
+    struct pcvcm_instr *instr = bc->instrs + bc->nr_instrs++;
+    memset(instr, 0, sizeof(*instr));
+    instr->op = op;
+    return instr;
+}
+
+static inline void
+push_depth(struct compiler *c, size_t n)
+{
+    c->depth += n;
+    if (c->depth > c->bc->max_depth)
+        c->bc->max_depth = c->depth;
+}
+
+static inline void
+pop_depth(struct compiler *c, size_t n)
+{
+    PC_ASSERT(c->depth >= n);
+    c->depth -= n;
+}
+
+static int
+compile_node(struct compiler *c, struct pcvcm_node *node);
+
+static int
+compile_constant(struct compiler *c, enum pcvcm_opcode op,
+        struct pcvcm_node *node)
+{
+    struct pcvcm_instr *instr = emit(c, op);
+    if (instr == NULL)
+        return -1;
+
+    instr->node = node;
+    push_depth(c, 1);
+    return 0;
+}
+
+static int
+compile_children(struct compiler *c, enum pcvcm_opcode op,
+        struct pcvcm_node *node)
+{
+    uint32_t n = 0;
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    while (child) {
+        if (compile_node(c, child))
+            return -1;
+        n++;
+        child = NEXT_CHILD(child);
+    }
+
+    struct pcvcm_instr *instr = emit(c, op);
+    if (instr == NULL)
+        return -1;
+
+    instr->count = n;
+    pop_depth(c, n);
+    push_depth(c, 1);
+    return 0;
+}
+
+static int
+compile_object(struct compiler *c, struct pcvcm_node *node)
+{
+    /* the tree walker ignores a key without value */
+    uint32_t n = 0;
+    struct pcvcm_node *k_node = FIRST_CHILD(node);
+    struct pcvcm_node *v_node = NEXT_CHILD(k_node);
+    while (k_node && v_node) {
+        if (compile_node(c, k_node) || compile_node(c, v_node))
+            return -1;
+        n++;
+
+        k_node = NEXT_CHILD(v_node);
+        v_node = NEXT_CHILD(k_node);
+    }
+
+    struct pcvcm_instr *instr = emit(c, PCVCM_OP_MAKE_OBJECT);
+    if (instr == NULL)
+        return -1;
+
+    instr->count = n;
+    pop_depth(c, n * 2);
+    push_depth(c, 1);
+    return 0;
+}
+
+static int
+compile_get_variable(struct compiler *c, struct pcvcm_node *node)
+{
+    struct pcvcm_node *name_node = FIRST_CHILD(node);
+    if (name_node == NULL)
+        return -1;
+
+    if (name_node->type == PCVCM_NODE_TYPE_STRING) {
+        /* parse the name once, instead of on every evaluation */
+        struct pcvcm_var_ref *ref;
+        ref = pcvcm_var_ref_new((const char *)name_node->sz_ptr[1]);
+        if (ref == NULL)
+            return -1;
+
+        struct pcvcm_instr *instr = emit(c, PCVCM_OP_GET_VARIABLE);
+        if (instr == NULL) {
+            pcvcm_var_ref_destroy(ref);
+            return -1;
+        }
+        instr->ref = ref;
+        push_depth(c, 1);
+        return 0;
+    }
+
+    if (compile_node(c, name_node))
+        return -1;
+
+    /* the name is on the stack */
+    return emit(c, PCVCM_OP_GET_VARIABLE) ? 0 : -1;
+}
+
+static int
+compile_get_element(struct compiler *c, struct pcvcm_node *node)
+{
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
+    struct pcvcm_node *param_node = NEXT_CHILD(caller_node);
+    if (caller_node == NULL || param_node == NULL)
+        return -1;
+
+    bool const_param = (param_node->type == PCVCM_NODE_TYPE_STRING);
+    if (compile_node(c, caller_node) ||
+            (!const_param && compile_node(c, param_node)))
+        return -1;
+
+    struct pcvcm_instr *instr = emit(c, PCVCM_OP_GET_ELEMENT);
+    if (instr == NULL)
+        return -1;
+
+    if (pcvcm_node_is_handle_as_getter(node))
+        instr->flags |= INSTR_FLAG_AS_GETTER;
+
+    if (!const_param) {
+        pop_depth(c, 1);
+        return 0;
+    }
+
+    int64_t index;
+    instr->flags |= INSTR_FLAG_CONST_PARAM;
+    instr->node = param_node;
+    instr->count = pcvcm_ic_new_site();
+    if (pcutils_parse_int64((const char*)param_node->sz_ptr[1],
+                param_node->sz_ptr[0], &index) == 0) {
+        instr->flags |= INSTR_FLAG_HAS_INDEX;
+        instr->index = index;
+    }
+
+    if (instr->flags & INSTR_FLAG_AS_GETTER) {
+        instr->nic = pcvcm_native_ic_new();
+        if (instr->nic == NULL)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+compile_call(struct compiler *c, struct pcvcm_node *node,
+        enum pcvcm_opcode op)
+{
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
+    if (caller_node == NULL)
+        return -1;
+
+    if (compile_node(c, caller_node))
+        return -1;
+
+    /* the parameters are evaluated only if the caller is callable */
+    size_t check = c->bc->nr_instrs;
+    if (emit(c, PCVCM_OP_CHECK_CALLER) == NULL)
+        return -1;
+
+    uint32_t n = 0;
+    struct pcvcm_node *param_node = NEXT_CHILD(caller_node);
+    while (param_node) {
+        if (compile_node(c, param_node))
+            return -1;
+        n++;
+        param_node = NEXT_CHILD(param_node);
+    }
+
+    struct pcvcm_instr *instr = emit(c, op);
+    if (instr == NULL)
+        return -1;
+
+    instr->count = n;
+    pop_depth(c, n);
+    c->bc->instrs[check].count = c->bc->nr_instrs;
+
+    /* the name of a native method is known if it is a constant */
+    if (caller_node->type == PCVCM_NODE_TYPE_FUNC_GET_ELEMENT) {
+        struct pcvcm_node *name_node = NEXT_CHILD(FIRST_CHILD(caller_node));
+        if (name_node->type == PCVCM_NODE_TYPE_STRING) {
+            instr->node = name_node;
+            instr->nic = pcvcm_native_ic_new();
+            if (instr->nic == NULL)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * The operators of a CJSONEE are evaluated from left to right without
+ * precedence:
+ *
+ *  e0 && e1    =>  [e0] JUMP_IF_FALSE L; POP; [e1]; L:
+ *  e0 || e1    =>  [e0] JUMP_IF_TRUE L; POP; [e1]; L:
+ *  e0 ; e1     =>  [e0] POP; [e1]
+ *
+ * A malformed CJSONEE is left to the tree walker, which reports the error
+ * when it is evaluated.
+ */
+static int
+compile_cjsonee(struct compiler *c, struct pcvcm_node *node)
+{
+    struct pcvcm_node *curr_node = FIRST_CHILD(node);
+    if (curr_node == NULL || is_cjsonee_op(curr_node))
+        return -1;
+
+    if (compile_node(c, curr_node))
+        return -1;
+
+    struct pcvcm_node *op_node;
+    while ((op_node = NEXT_CHILD(curr_node))) {
+        if (!is_cjsonee_op(op_node))
+            return -1;
+
+        curr_node = NEXT_CHILD(op_node);
+        if (curr_node == NULL) {
+            if (op_node->type == PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON)
+                break;
+            return -1;
+        }
+        else if (is_cjsonee_op(curr_node)) {
+            return -1;
+        }
+
+        size_t jump = 0;
+        bool has_jump = false;
+        if (op_node->type != PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON) {
+            jump = c->bc->nr_instrs;
+            has_jump = true;
+            if (emit(c, op_node->type == PCVCM_NODE_TYPE_CJSONEE_OP_AND ?
+                        PCVCM_OP_JUMP_IF_FALSE : PCVCM_OP_JUMP_IF_TRUE)
+                    == NULL)
+                return -1;
+        }
+
+        if (emit(c, PCVCM_OP_POP) == NULL)
+            return -1;
+        pop_depth(c, 1);
+
+        if (compile_node(c, curr_node))
+            return -1;
+
+        if (has_jump)
+            c->bc->instrs[jump].count = c->bc->nr_instrs;
+    }
+
+    return 0;
+}
+
+static int
+compile_node(struct compiler *c, struct pcvcm_node *node)
+{
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_UNDEFINED:
+        return compile_constant(c, PCVCM_OP_PUSH_UNDEFINED, node);
+
+    case PCVCM_NODE_TYPE_OBJECT:
+        return compile_object(c, node);
+
+    case PCVCM_NODE_TYPE_ARRAY:
+        return compile_children(c, PCVCM_OP_MAKE_ARRAY, node);
+
+    case PCVCM_NODE_TYPE_STRING:
+        return compile_constant(c, PCVCM_OP_PUSH_STRING, node);
+
+    case PCVCM_NODE_TYPE_NULL:
+        return compile_constant(c, PCVCM_OP_PUSH_NULL, node);
+
+    case PCVCM_NODE_TYPE_BOOLEAN:
+        return compile_constant(c, PCVCM_OP_PUSH_BOOLEAN, node);
+
+    case PCVCM_NODE_TYPE_NUMBER:
+        return compile_constant(c, PCVCM_OP_PUSH_NUMBER, node);
+
+    case PCVCM_NODE_TYPE_LONG_INT:
+        return compile_constant(c, PCVCM_OP_PUSH_LONG_INT, node);
+
+    case PCVCM_NODE_TYPE_ULONG_INT:
+        return compile_constant(c, PCVCM_OP_PUSH_ULONG_INT, node);
+
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+        return compile_constant(c, PCVCM_OP_PUSH_LONG_DOUBLE, node);
+
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+        return compile_constant(c, PCVCM_OP_PUSH_BYTE_SEQUENCE, node);
+
+    case PCVCM_NODE_TYPE_FUNC_CONCAT_STRING:
+        return compile_children(c, PCVCM_OP_CONCAT_STRING, node);
+
+    case PCVCM_NODE_TYPE_FUNC_GET_VARIABLE:
+        return compile_get_variable(c, node);
+
+    case PCVCM_NODE_TYPE_FUNC_GET_ELEMENT:
+        return compile_get_element(c, node);
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_GETTER:
+        return compile_call(c, node, PCVCM_OP_CALL_GETTER);
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_SETTER:
+        return compile_call(c, node, PCVCM_OP_CALL_SETTER);
+
+    case PCVCM_NODE_TYPE_CJSONEE:
+        return compile_cjsonee(c, node);
+
+    default:
+        /* the tree walker evaluates other nodes to null */
+        return compile_constant(c, PCVCM_OP_PUSH_NULL, node);
+    }
+}
+
+struct pcvcm_bytecode *pcvcm_bytecode_compile(struct pcvcm_node *tree)
+{
+    if (tree == NULL)
+        return NULL;
+
+    struct pcvcm_bytecode *bc = (struct pcvcm_bytecode *)calloc(1,
+            sizeof(*bc));
+    if (bc == NULL)
+        return NULL;
+
+    struct compiler c = { bc, 0 };
+    if (compile_node(&c, tree)) {
+        pcvcm_bytecode_destroy(bc);
+        return NULL;
+    }
+
+    PC_ASSERT(c.depth == 1);
+    return bc;
+}
+
+void pcvcm_bytecode_destroy(struct pcvcm_bytecode *bc)
+{
+    if (bc) {
+        for (size_t i = 0; i < bc->nr_instrs; i++) {
+            struct pcvcm_instr *instr = bc->instrs + i;
+            if (instr->op == PCVCM_OP_GET_VARIABLE && instr->ref) {
+                pcvcm_var_ref_destroy(instr->ref);
+            }
+            pcvcm_native_ic_destroy(instr->nic);
+        }
+        free(bc->instrs);
+        free(bc);
+    }
+}
+
+size_t pcvcm_bytecode_length(struct pcvcm_bytecode *bc)
+{
+    return bc ? bc->nr_instrs : 0;
+}
+
+struct pcvcm_bytecode *pcvcm_node_get_bytecode(struct pcvcm_node *node)
+{
+    struct pcvcm_bytecode *bc = node->bytecode;
+
+    if (bc == NULL) {
+        /* the vDOM may be shared by the instances in different threads */
+        (void)__sync_val_compare_and_swap(&node->bytecode, NULL,
+                &bytecode_evaluated_once);
+        return NULL;
+    }
+
+    if (bc == &bytecode_evaluated_once) {
+        struct pcvcm_bytecode *new_bc = pcvcm_bytecode_compile(node);
+        if (new_bc == NULL)
+            new_bc = &bytecode_uncompilable;
+
+        bc = __sync_val_compare_and_swap(&node->bytecode,
+                &bytecode_evaluated_once, new_bc);
+        if (bc == &bytecode_evaluated_once) {
+            bc = new_bc;
+        }
+        else if (new_bc != &bytecode_uncompilable) {
+            pcvcm_bytecode_destroy(new_bc);
+        }
+    }
+
+    return (bc == &bytecode_uncompilable) ? NULL : bc;
+}
+
+void pcvcm_node_release_bytecode(struct pcvcm_node *node)
+{
+    struct pcvcm_bytecode *bc = node->bytecode;
+    if (bc && bc != &bytecode_evaluated_once &&
+            bc != &bytecode_uncompilable) {
+        pcvcm_bytecode_destroy(bc);
+    }
+    node->bytecode = NULL;
+}
+
+static purc_variant_t
+make_object(purc_variant_t *vals, size_t nr_pairs)
+{
+    purc_variant_t object = purc_variant_make_object(0,
+            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+    if (object == PURC_VARIANT_INVALID) {
+        return PURC_VARIANT_INVALID;
+    }
+
+    for (size_t i = 0; i < nr_pairs; i++) {
+        if (!purc_variant_object_set(object, vals[i * 2], vals[i * 2 + 1])) {
+            purc_variant_unref(object);
+            return PURC_VARIANT_INVALID;
+        }
+    }
+
+    return object;
+}
+
+static purc_variant_t
+make_array(purc_variant_t *vals, size_t nr_members)
+{
+    purc_variant_t array = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    if (array == PURC_VARIANT_INVALID) {
+        return PURC_VARIANT_INVALID;
+    }
+
+    for (size_t i = 0; i < nr_members; i++) {
+        if (!purc_variant_array_append(array, vals[i])) {
+            purc_variant_unref(array);
+            return PURC_VARIANT_INVALID;
+        }
+    }
+
+    return array;
+}
+
+static purc_variant_t
+concat_string(purc_variant_t *vals, size_t nr_parts)
+{
+    size_t len = 0;
+    size_t sz_buf = 0;
+    char *buf = NULL;
+
+    for (size_t i = 0; i < nr_parts; i++) {
+        char *part = NULL;
+        ssize_t nr_part = purc_variant_stringify_alloc(&part, vals[i]);
+        if (nr_part > 0) {
+            if (len + nr_part + 1 > sz_buf) {
+                size_t sz = pcutils_get_next_fibonacci_number(
+                        len + nr_part + 1);
+                char *new_buf = (char *)realloc(buf, sz);
+                if (new_buf == NULL) {
+                    free(part);
+                    free(buf);
+                    pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+                    return PURC_VARIANT_INVALID;
+                }
+                buf = new_buf;
+                sz_buf = sz;
+            }
+
+            memcpy(buf + len, part, nr_part);
+            len += nr_part;
+        }
+        free(part);
+    }
+
+    if (buf == NULL) {
+        return purc_variant_make_string_static("", false);
+    }
+
+    buf[len] = '\0';
+    purc_variant_t ret = purc_variant_make_string_reuse_buff(buf, sz_buf,
+            false);
+    if (ret == PURC_VARIANT_INVALID) {
+        free(buf);
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+    }
+    return ret;
+}
+
+static purc_variant_t
+get_variable(const char *name, cb_find_var find_var, void *ctxt)
+{
+    if (name == NULL || name[0] == '\0') {
+        return PURC_VARIANT_INVALID;
+    }
+
+    if (!find_var) {
+        pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
+        return PURC_VARIANT_INVALID;
+    }
+
+    purc_variant_t ret = find_var(ctxt, name);
+    if (ret) {
+        purc_variant_ref(ret);
+    }
+    return ret;
+}
+
+static purc_variant_t
+get_variable_by_ref(const struct pcvcm_var_ref *ref, cb_find_var find_var,
+        cb_find_var_ref find_var_ref, void *ctxt)
+{
+    if (!find_var_ref) {
+        return get_variable(ref->name, find_var, ctxt);
+    }
+
+    if (ref->name[0] == '\0') {
+        return PURC_VARIANT_INVALID;
+    }
+
+    purc_variant_t ret = find_var_ref(ctxt, ref);
+    if (ret) {
+        purc_variant_ref(ret);
+    }
+    return ret;
+}
+
+/* gets the member value, and calls the getter if it is a dynamic value */
+static purc_variant_t
+member_to_variant(purc_variant_t caller, purc_variant_t val,
+        uint16_t flags, bool silently)
+{
+    if (val == PURC_VARIANT_INVALID) {
+        return PURC_VARIANT_INVALID;
+    }
+
+    purc_variant_ref(val);
+    if (!purc_variant_is_dynamic(val) || !(flags & INSTR_FLAG_AS_GETTER)) {
+        return val;
+    }
+
+    purc_variant_t ret = pcvcm_call_dvariant_method(caller, val, 0, NULL,
+            GETTER_METHOD, silently);
+    purc_variant_unref(val);
+    return ret;
+}
+
+static inline const char *
+const_name(const struct pcvcm_instr *instr)
+{
+    return (const char *)instr->node->sz_ptr[1];
+}
+
+/* the parameter variant is only made when a method needs it */
+static purc_variant_t
+make_param(const struct pcvcm_instr *instr, purc_variant_t *param)
+{
+    if (*param == PURC_VARIANT_INVALID) {
+        *param = purc_variant_make_string_ex(const_name(instr),
+                instr->node->sz_ptr[0], false);
+    }
+    return *param;
+}
+
+static purc_variant_t
+get_element(const struct pcvcm_instr *instr, purc_variant_t caller,
+        purc_variant_t caller_root, purc_variant_t param, bool silently)
+{
+    purc_variant_t ret = PURC_VARIANT_INVALID;
+    purc_variant_t const_param = PURC_VARIANT_INVALID;
+    bool has_index = true;
+    int64_t index = -1;
+
+    if (instr->flags & INSTR_FLAG_CONST_PARAM) {
+        has_index = (instr->flags & INSTR_FLAG_HAS_INDEX);
+        index = instr->index;
+    }
+    else if (!purc_variant_cast_to_longint(param, &index, true)) {
+        has_index = false;
+    }
+
+    // FIXME: {{ $SESSION.myobj.bcPipe.status[0] }}
+    purc_variant_t inner_ret = PURC_VARIANT_INVALID;
+    if (pcvcm_is_inner_native_wrapper(caller)) {
+        purc_variant_t inner_caller;
+        purc_variant_t inner_param;
+        inner_caller = pcvcm_inner_native_wrapper_get_caller(caller);
+        inner_param = pcvcm_inner_native_wrapper_get_param(caller);
+        inner_ret = pcvcm_call_nvariant_method(inner_caller,
+                purc_variant_get_string_const(inner_param), 0, NULL,
+                GETTER_METHOD, silently);
+        if (inner_ret) {
+            /* the original caller is kept as the root of the result */
+            caller = inner_ret;
+        }
+    }
+
+    if (purc_variant_is_object(caller)) {
+        purc_variant_t val = (instr->flags & INSTR_FLAG_CONST_PARAM) ?
+            pcvcm_get_member_cached(instr->count, caller, const_name(instr)) :
+            purc_variant_object_get(caller, param);
+        ret = member_to_variant(caller, val, instr->flags, silently);
+    }
+    else if (purc_variant_is_array(caller)) {
+        if (!has_index) {
+            goto out;
+        }
+        if (index < 0) {
+            index += purc_variant_array_get_size(caller);
+        }
+        if (index < 0) {
+            goto out;
+        }
+
+        ret = member_to_variant(caller,
+                purc_variant_array_get(caller, index), instr->flags,
+                silently);
+    }
+    else if (purc_variant_is_set(caller)) {
+        if (!has_index) {
+            goto out;
+        }
+        if (index < 0) {
+            index += purc_variant_set_get_size(caller);
+        }
+        if (index < 0) {
+            goto out;
+        }
+
+        ret = member_to_variant(caller,
+                purc_variant_set_get_by_index(caller, index), instr->flags,
+                silently);
+    }
+    else if (purc_variant_is_dynamic(caller)) {
+        if (instr->flags & INSTR_FLAG_CONST_PARAM) {
+            param = make_param(instr, &const_param);
+            if (param == PURC_VARIANT_INVALID) {
+                goto out;
+            }
+        }
+        ret = pcvcm_call_dvariant_method(caller_root, caller, 1, &param,
+                GETTER_METHOD, silently);
+    }
+    else if (purc_variant_is_native(caller)) {
+        if (!(instr->flags & INSTR_FLAG_AS_GETTER)) {
+            if (instr->flags & INSTR_FLAG_CONST_PARAM) {
+                param = make_param(instr, &const_param);
+                if (param == PURC_VARIANT_INVALID) {
+                    goto out;
+                }
+            }
+            ret = pcvcm_inner_native_wrapper_create(caller, param);
+        }
+        else if (instr->flags & INSTR_FLAG_CONST_PARAM) {
+            ret = pcvcm_call_nvariant_method_cached(instr->nic, caller,
+                    const_name(instr), 0, NULL, GETTER_METHOD, silently);
+        }
+        else {
+            ret = pcvcm_call_nvariant_method(caller,
+                    purc_variant_get_string_const(param), 0, NULL,
+                    GETTER_METHOD, silently);
+        }
+    }
+
+out:
+    if (const_param) {
+        purc_variant_unref(const_param);
+    }
+    if (inner_ret) {
+        purc_variant_unref(inner_ret);
+    }
+    return ret;
+}
+
+static inline bool
+is_callable(purc_variant_t caller)
+{
+    return purc_variant_is_dynamic(caller) ||
+        pcvcm_is_inner_native_wrapper(caller);
+}
+
+static purc_variant_t
+call_method(const struct pcvcm_instr *instr, purc_variant_t caller,
+        purc_variant_t caller_root, size_t nr_params, purc_variant_t *params,
+        enum method_type type, bool silently)
+{
+    purc_variant_t ret = PURC_VARIANT_INVALID;
+
+    if (nr_params == 0) {
+        params = NULL;
+    }
+
+    if (purc_variant_is_dynamic(caller)) {
+        ret = pcvcm_call_dvariant_method(caller_root, caller, nr_params,
+                params, type, silently);
+    }
+    else if (pcvcm_is_inner_native_wrapper(caller)) {
+        purc_variant_t nv = pcvcm_inner_native_wrapper_get_caller(caller);
+        if (purc_variant_is_native(nv)) {
+            purc_variant_t name = pcvcm_inner_native_wrapper_get_param(caller);
+            const char *key_name = purc_variant_get_string_const(name);
+            if (key_name) {
+                /* the wrapper may come from a variable */
+                struct pcvcm_native_ic *nic = NULL;
+                if (instr->nic && strcmp(key_name, const_name(instr)) == 0)
+                    nic = instr->nic;
+                ret = pcvcm_call_nvariant_method_cached(nic, nv, key_name,
+                        nr_params, params, type, silently);
+            }
+        }
+    }
+
+    return ret;
+}
+
+static inline void
+release_slots(purc_variant_t *vals, purc_variant_t *roots, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_unref(vals[i]);
+        if (roots[i]) {
+            purc_variant_unref(roots[i]);
+        }
+    }
+}
+
+purc_variant_t pcvcm_bytecode_eval(struct pcvcm_bytecode *bc,
+        cb_find_var find_var, void *ctxt, bool silently)
+{
+    return pcvcm_bytecode_eval_ex(bc, find_var, NULL, ctxt, silently);
+}
+
+purc_variant_t pcvcm_bytecode_eval_ex(struct pcvcm_bytecode *bc,
+        cb_find_var find_var, cb_find_var_ref find_var_ref, void *ctxt,
+        bool silently)
+{
+    purc_variant_t local_vals[NR_LOCAL_SLOTS];
+    purc_variant_t local_roots[NR_LOCAL_SLOTS];
+    purc_variant_t *vals = local_vals;
+    purc_variant_t *roots = local_roots;
+    purc_variant_t ret = PURC_VARIANT_INVALID;
+    size_t sp = 0;
+    size_t pc = 0;
+
+    if (bc->max_depth > NR_LOCAL_SLOTS) {
+        vals = (purc_variant_t *)malloc(sizeof(purc_variant_t) *
+                bc->max_depth * 2);
+        if (vals == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return PURC_VARIANT_INVALID;
+        }
+        roots = vals + bc->max_depth;
+    }
+
+    while (pc < bc->nr_instrs) {
+        const struct pcvcm_instr *instr = bc->instrs + pc++;
+        const struct pcvcm_node *node = instr->node;
+        purc_variant_t root = PURC_VARIANT_INVALID;
+        size_t n;
+
+        ret = PURC_VARIANT_INVALID;
+
+        switch (instr->op) {
+        case PCVCM_OP_PUSH_UNDEFINED:
+            ret = purc_variant_make_undefined();
+            break;
+
+        case PCVCM_OP_PUSH_NULL:
+            ret = purc_variant_make_null();
+            break;
+
+        case PCVCM_OP_PUSH_BOOLEAN:
+            ret = purc_variant_make_boolean(node->b);
+            break;
+
+        case PCVCM_OP_PUSH_NUMBER:
+            ret = purc_variant_make_number(node->d);
+            break;
+
+        case PCVCM_OP_PUSH_LONG_INT:
+            ret = purc_variant_make_longint(node->i64);
+            break;
+
+        case PCVCM_OP_PUSH_ULONG_INT:
+            ret = purc_variant_make_ulongint(node->u64);
+            break;
+
+        case PCVCM_OP_PUSH_LONG_DOUBLE:
+            ret = purc_variant_make_longdouble(node->ld);
+            break;
+
+        case PCVCM_OP_PUSH_STRING:
+            ret = purc_variant_make_string_ex((const char*)node->sz_ptr[1],
+                    node->sz_ptr[0], false);
+            break;
+
+        case PCVCM_OP_PUSH_BYTE_SEQUENCE:
+            ret = (node->sz_ptr[0] > 0) ? purc_variant_make_byte_sequence(
+                    (void*)node->sz_ptr[1], node->sz_ptr[0])
+                    : purc_variant_make_byte_sequence_empty();
+            break;
+
+        case PCVCM_OP_MAKE_OBJECT:
+            n = instr->count * 2;
+            sp -= n;
+            ret = make_object(vals + sp, instr->count);
+            release_slots(vals + sp, roots + sp, n);
+            break;
+
+        case PCVCM_OP_MAKE_ARRAY:
+            n = instr->count;
+            sp -= n;
+            ret = make_array(vals + sp, n);
+            release_slots(vals + sp, roots + sp, n);
+            break;
+
+        case PCVCM_OP_CONCAT_STRING:
+            n = instr->count;
+            sp -= n;
+            ret = concat_string(vals + sp, n);
+            release_slots(vals + sp, roots + sp, n);
+            break;
+
+        case PCVCM_OP_GET_VARIABLE:
+            if (instr->ref) {
+                ret = get_variable_by_ref(instr->ref, find_var,
+                        find_var_ref, ctxt);
+            }
+            else {
+                /* keep the name as the root like the tree walker */
+                sp--;
+                root = vals[sp];
+                if (roots[sp]) {
+                    purc_variant_unref(roots[sp]);
+                }
+                if (purc_variant_is_string(root)) {
+                    ret = get_variable(purc_variant_get_string_const(root),
+                            find_var, ctxt);
+                }
+            }
+            break;
+
+        case PCVCM_OP_GET_ELEMENT:
+            if (instr->flags & INSTR_FLAG_CONST_PARAM) {
+                sp--;
+                ret = get_element(instr, vals[sp], roots[sp],
+                        PURC_VARIANT_INVALID, silently);
+            }
+            else {
+                sp -= 2;
+                ret = get_element(instr, vals[sp], roots[sp], vals[sp + 1],
+                        silently);
+                release_slots(vals + sp + 1, roots + sp + 1, 1);
+            }
+            root = vals[sp];
+            if (roots[sp]) {
+                purc_variant_unref(roots[sp]);
+            }
+            break;
+
+        case PCVCM_OP_CHECK_CALLER:
+            if (is_callable(vals[sp - 1])) {
+                continue;
+            }
+
+            sp--;
+            release_slots(vals + sp, roots + sp, 1);
+            pc = instr->count;
+            break;
+
+        case PCVCM_OP_CALL_GETTER:
+        case PCVCM_OP_CALL_SETTER:
+            n = instr->count;
+            sp -= n + 1;
+            ret = call_method(instr, vals[sp], roots[sp], n, vals + sp + 1,
+                    (instr->op == PCVCM_OP_CALL_GETTER) ?
+                    GETTER_METHOD : SETTER_METHOD, silently);
+            root = vals[sp];
+            if (roots[sp]) {
+                purc_variant_unref(roots[sp]);
+            }
+            release_slots(vals + sp + 1, roots + sp + 1, n);
+            break;
+
+        case PCVCM_OP_JUMP_IF_FALSE:
+            if (!purc_variant_booleanize(vals[sp - 1])) {
+                pc = instr->count;
+            }
+            continue;
+
+        case PCVCM_OP_JUMP_IF_TRUE:
+            if (purc_variant_booleanize(vals[sp - 1])) {
+                pc = instr->count;
+            }
+            continue;
+
+        case PCVCM_OP_POP:
+            sp--;
+            release_slots(vals + sp, roots + sp, 1);
+            continue;
+
+        default:
+            PC_ASSERT(0);
+            break;
+        }
+
+        if (ret == PURC_VARIANT_INVALID) {
+            if (silently && !pcvcm_has_fatal_error()) {
+                ret = purc_variant_make_undefined();
+            }
+            else {
+                if (root) {
+                    purc_variant_unref(root);
+                }
+                goto failed;
+            }
+        }
+
+        vals[sp] = ret;
+        roots[sp] = root;
+        sp++;
+    }
+
+    PC_ASSERT(sp == 1);
+    ret = vals[0];
+    if (roots[0]) {
+        purc_variant_unref(roots[0]);
+    }
+    goto out;
+
+failed:
+    release_slots(vals, roots, sp);
+    ret = PURC_VARIANT_INVALID;
+
+out:
+    if (vals != local_vals) {
+        free(vals);
+    }
+    return ret;
+}
+
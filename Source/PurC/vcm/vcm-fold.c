@@ -0,0 +1,231 @@
+/*
+ * @file vcm-fold.c
+ * @date 2022/10/19
+ * @brief The constant folding of vcm trees and the constant cache.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The vDOM (and its vcm trees) may be shared by the instances in
+ * different threads, so the values of the constant nodes are not attached
+ * to the nodes: every instance caches them in its own table, keyed by
+ * the address and the unique identifier of the node. Only the immutable
+ * values (not containers) are cached, because a container returned to
+ * the interpreter may be changed by it.
+ */
+
+#include "config.h"
+#include "purc-utils.h"
+#include "purc-errors.h"
+#include "private/errors.h"
+#include "private/instance.h"
+#include "private/vcm.h"
+
+#include "vcm-internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_CONST_CACHE_ENTRIES      1024
+
+struct pcvcm_const_cache_entry {
+    const struct pcvcm_node    *node;
+    uint32_t                    const_id;
+    purc_variant_t              value;
+};
+
+struct pcvcm_const_cache {
+    struct pcvcm_const_cache_entry entries[NR_CONST_CACHE_ENTRIES];
+};
+
+static uint32_t last_const_id;
+
+static bool
+fold_concat_string(struct pcvcm_node *node)
+{
+    size_t len = 0;
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    if (child == NULL)
+        return false;
+
+    while (child) {
+        if (child->type != PCVCM_NODE_TYPE_STRING)
+            return false;
+        len += child->sz_ptr[0];
+        child = NEXT_CHILD(child);
+    }
+
+    char *buf = (char *)malloc(len + 1);
+    if (buf == NULL)
+        return false;
+
+    char *p = buf;
+    child = FIRST_CHILD(node);
+    while (child) {
+        struct pcvcm_node *next = NEXT_CHILD(child);
+        memcpy(p, (const char *)child->sz_ptr[1], child->sz_ptr[0]);
+        p += child->sz_ptr[0];
+
+        pctree_node_remove(TREE_NODE(child));
+        pcvcm_node_destroy(child);
+        child = next;
+    }
+    *p = '\0';
+
+    node->type = PCVCM_NODE_TYPE_STRING;
+    node->sz_ptr[0] = len;
+    node->sz_ptr[1] = (uintptr_t)buf;
+    return true;
+}
+
+static bool
+fold_node(struct pcvcm_node *node)
+{
+    bool constant = true;
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    while (child) {
+        struct pcvcm_node *next = NEXT_CHILD(child);
+        if (!fold_node(child))
+            constant = false;
+        child = next;
+    }
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_UNDEFINED:
+    case PCVCM_NODE_TYPE_NULL:
+    case PCVCM_NODE_TYPE_BOOLEAN:
+    case PCVCM_NODE_TYPE_NUMBER:
+    case PCVCM_NODE_TYPE_LONG_INT:
+    case PCVCM_NODE_TYPE_ULONG_INT:
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+    case PCVCM_NODE_TYPE_STRING:
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+    case PCVCM_NODE_TYPE_OBJECT:
+    case PCVCM_NODE_TYPE_ARRAY:
+    case PCVCM_NODE_TYPE_CJSONEE:
+    case PCVCM_NODE_TYPE_CJSONEE_OP_AND:
+    case PCVCM_NODE_TYPE_CJSONEE_OP_OR:
+    case PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON:
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_CONCAT_STRING:
+        if (constant)
+            fold_concat_string(node);
+        break;
+
+    default:
+        /* variables and method calls */
+        constant = false;
+        break;
+    }
+
+    if (constant && !node->is_constant) {
+        node->is_constant = true;
+        node->const_id = __sync_add_and_fetch(&last_const_id, 1);
+    }
+
+    return constant;
+}
+
+bool pcvcm_node_fold_constants(struct pcvcm_node *tree)
+{
+    if (tree == NULL)
+        return false;
+
+    /* the compiled bytecode refers to the nodes which may be folded */
+    pcvcm_node_release_bytecode(tree);
+    return fold_node(tree);
+}
+
+static inline struct pcvcm_const_cache_entry *
+cache_entry(struct pcvcm_const_cache *cache, const struct pcvcm_node *node)
+{
+    uintptr_t h = ((uintptr_t)node >> 4) ^ node->const_id;
+    return cache->entries + (h % NR_CONST_CACHE_ENTRIES);
+}
+
+purc_variant_t pcvcm_get_cached_constant(const struct pcvcm_node *node)
+{
+    struct pcinst *inst = pcinst_current();
+    if (inst == NULL || inst->vcm_const_cache == NULL)
+        return PURC_VARIANT_INVALID;
+
+    struct pcvcm_const_cache_entry *entry;
+    entry = cache_entry(inst->vcm_const_cache, node);
+    if (entry->node == node && entry->const_id == node->const_id) {
+        return purc_variant_ref(entry->value);
+    }
+
+    return PURC_VARIANT_INVALID;
+}
+
+void pcvcm_cache_constant(const struct pcvcm_node *node, purc_variant_t value)
+{
+    enum purc_variant_type type = purc_variant_get_type(value);
+    switch (type) {
+    case PURC_VARIANT_TYPE_OBJECT:
+    case PURC_VARIANT_TYPE_ARRAY:
+    case PURC_VARIANT_TYPE_SET:
+    case PURC_VARIANT_TYPE_TUPLE:
+    case PURC_VARIANT_TYPE_DYNAMIC:
+    case PURC_VARIANT_TYPE_NATIVE:
+        return;
+
+    default:
+        break;
+    }
+
+    struct pcinst *inst = pcinst_current();
+    if (inst == NULL)
+        return;
+
+    if (inst->vcm_const_cache == NULL) {
+        inst->vcm_const_cache = (struct pcvcm_const_cache *)calloc(1,
+                sizeof(struct pcvcm_const_cache));
+        if (inst->vcm_const_cache == NULL)
+            return;
+    }
+
+    struct pcvcm_const_cache_entry *entry;
+    entry = cache_entry(inst->vcm_const_cache, node);
+    if (entry->value) {
+        purc_variant_unref(entry->value);
+    }
+
+    entry->node = node;
+    entry->const_id = node->const_id;
+    entry->value = purc_variant_ref(value);
+}
+
+void pcvcm_release_const_cache(struct pcinst *inst)
+{
+    struct pcvcm_const_cache *cache = inst->vcm_const_cache;
+    if (cache == NULL)
+        return;
+
+    for (size_t i = 0; i < NR_CONST_CACHE_ENTRIES; i++) {
+        if (cache->entries[i].value) {
+            purc_variant_unref(cache->entries[i].value);
+        }
+    }
+
+    free(cache);
+    inst->vcm_const_cache = NULL;
+}
+
@@ -0,0 +1,202 @@
+/*
+ * @file vcm-ic.c
+ * @date 2022/10/20
+ * @brief The inline caches of the member accesses in vcm bytecode.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Two kinds of inline caches are kept for an access site (an instruction
+ * with a constant member name):
+ *
+ *  - The method of a native entity depends only on the ops of the entity
+ *    and the name, so the resolved methods are kept in the bytecode and
+ *    shared by all instances. The entries are immutable and published with
+ *    CAS, and a site seeing more than NR_NATIVE_IC_SLOTS kinds of entities
+ *    stops caching.
+ *
+ *  - The node of an object member is only valid in the instance owning
+ *    the object, so it is kept in a per-instance table, keyed by the site
+ *    and the object, and validated by the shape of the object which changes
+ *    whenever a key is added or removed.
+ */
+
+#include "config.h"
+#include "purc-utils.h"
+#include "purc-errors.h"
+#include "private/errors.h"
+#include "private/instance.h"
+#include "private/variant.h"
+#include "private/vcm.h"
+
+#include "vcm-internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_NATIVE_IC_SLOTS          4
+#define NR_MEMBER_CACHE_ENTRIES     256
+
+struct pcvcm_native_ic_entry {
+    struct purc_native_ops     *ops;
+    purc_nvariant_method        method;
+};
+
+struct pcvcm_native_ic {
+    struct pcvcm_native_ic_entry *slots[NR_NATIVE_IC_SLOTS];
+};
+
+struct pcvcm_member_cache_entry {
+    uint32_t                    site;
+    purc_variant_t              obj;
+    uint64_t                    shape;
+    struct obj_node            *node;
+};
+
+struct pcvcm_member_cache {
+    struct pcvcm_member_cache_entry entries[NR_MEMBER_CACHE_ENTRIES];
+};
+
+static uint32_t last_site;
+
+uint32_t pcvcm_ic_new_site(void)
+{
+    uint32_t site;
+    do {
+        site = __sync_add_and_fetch(&last_site, 1);
+    } while (site == 0);
+    return site;
+}
+
+struct pcvcm_native_ic *pcvcm_native_ic_new(void)
+{
+    return (struct pcvcm_native_ic *)calloc(1,
+            sizeof(struct pcvcm_native_ic));
+}
+
+void pcvcm_native_ic_destroy(struct pcvcm_native_ic *ic)
+{
+    if (ic) {
+        for (size_t i = 0; i < NR_NATIVE_IC_SLOTS; i++) {
+            free(ic->slots[i]);
+        }
+        free(ic);
+    }
+}
+
+static purc_nvariant_method
+native_ic_lookup(struct pcvcm_native_ic *ic, struct purc_native_ops *ops,
+        const char *key_name, enum method_type type)
+{
+    size_t i;
+    for (i = 0; i < NR_NATIVE_IC_SLOTS; i++) {
+        struct pcvcm_native_ic_entry *entry = ic->slots[i];
+        if (entry == NULL)
+            break;
+        if (entry->ops == ops)
+            return entry->method;
+    }
+
+    purc_nvariant_method method = (type == GETTER_METHOD) ?
+        ops->property_getter(key_name) : ops->property_setter(key_name);
+    if (method == NULL || i == NR_NATIVE_IC_SLOTS)
+        return method;
+
+    struct pcvcm_native_ic_entry *entry;
+    entry = (struct pcvcm_native_ic_entry *)malloc(sizeof(*entry));
+    if (entry == NULL)
+        return method;
+
+    entry->ops = ops;
+    entry->method = method;
+
+    /* the bytecode may be shared by the instances in different threads */
+    for (; i < NR_NATIVE_IC_SLOTS; i++) {
+        if (__sync_val_compare_and_swap(&ic->slots[i], NULL, entry) == NULL)
+            return method;
+    }
+
+    free(entry);
+    return method;
+}
+
+purc_variant_t pcvcm_call_nvariant_method_cached(struct pcvcm_native_ic *ic,
+        purc_variant_t var, const char *key_name, size_t nr_args,
+        purc_variant_t *argv, enum method_type type, bool silently)
+{
+    if (ic == NULL) {
+        return pcvcm_call_nvariant_method(var, key_name, nr_args, argv,
+                type, silently);
+    }
+
+    struct purc_native_ops *ops = purc_variant_native_get_ops(var);
+    if (ops) {
+        purc_nvariant_method native_func = native_ic_lookup(ic, ops,
+                key_name, type);
+        if (native_func) {
+            return native_func(purc_variant_native_get_entity(var),
+                    nr_args, argv, silently);
+        }
+    }
+    return PURC_VARIANT_INVALID;
+}
+
+purc_variant_t pcvcm_get_member_cached(uint32_t site, purc_variant_t obj,
+        const char *key_name)
+{
+    struct pcinst *inst = pcinst_current();
+    if (inst == NULL) {
+        return purc_variant_object_get_by_ckey(obj, key_name);
+    }
+
+    if (inst->vcm_member_cache == NULL) {
+        inst->vcm_member_cache = (struct pcvcm_member_cache *)calloc(1,
+                sizeof(struct pcvcm_member_cache));
+        if (inst->vcm_member_cache == NULL)
+            return purc_variant_object_get_by_ckey(obj, key_name);
+    }
+
+    uintptr_t h = ((uintptr_t)obj >> 4) ^ site;
+    struct pcvcm_member_cache_entry *entry;
+    entry = inst->vcm_member_cache->entries + (h % NR_MEMBER_CACHE_ENTRIES);
+
+    uint64_t shape = pcvar_obj_get_shape(obj);
+    if (entry->site == site && entry->obj == obj && entry->shape == shape) {
+        return entry->node->val;
+    }
+
+    struct obj_node *node = pcvar_obj_find_node(obj, key_name);
+    if (node == NULL) {
+        pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
+        return PURC_VARIANT_INVALID;
+    }
+
+    entry->site = site;
+    entry->obj = obj;
+    entry->shape = shape;
+    entry->node = node;
+    return node->val;
+}
+
+void pcvcm_release_member_cache(struct pcinst *inst)
+{
+    free(inst->vcm_member_cache);
+    inst->vcm_member_cache = NULL;
+}
+
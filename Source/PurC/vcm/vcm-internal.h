@@ -0,0 +1,129 @@
+/**
+ * @file vcm-internal.h
+ * @date 2022/10/19
+ * @brief The internal interfaces shared by the tree walker and the bytecode
+ *      VM of vcm.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PURC_VCM_VCM_INTERNAL_H
+#define PURC_VCM_VCM_INTERNAL_H
+
+#include "purc-errors.h"
+#include "private/vcm.h"
+
+#define TREE_NODE(node)              ((struct pctree_node*)(node))
+#define VCM_NODE(node)               ((struct pcvcm_node*)(node))
+#define FIRST_CHILD(node)            \
+    (VCM_NODE(pctree_node_child(TREE_NODE(node))))
+#define NEXT_CHILD(node)             \
+    ((node) ? VCM_NODE(pctree_node_next(TREE_NODE(node))) : NULL)
+#define PARENT_NODE(node)            \
+    (VCM_NODE(pctree_node_parent(TREE_NODE(node))))
+#define CHILDREN_NUMBER(node)        \
+    (pctree_node_children_number(TREE_NODE(node)))
+#define APPEND_CHILD(parent, child)  \
+    pctree_node_append_child(TREE_NODE(parent), TREE_NODE(child))
+
+struct pcvcm_node_op {
+    cb_find_var find_var;
+    void *find_var_ctxt;
+};
+
+enum method_type {
+    GETTER_METHOD,
+    SETTER_METHOD
+};
+
+PCA_EXTERN_C_BEGIN
+
+static inline bool pcvcm_has_fatal_error(void)
+{
+    int err = purc_get_last_error();
+    return (err == PURC_ERROR_OUT_OF_MEMORY);
+}
+
+/* the tree walker, used when the tree can not be compiled to bytecode */
+purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
+        struct pcvcm_node_op *ops, bool silently);
+
+bool is_cjsonee_op(struct pcvcm_node *node);
+
+bool pcvcm_node_is_handle_as_getter(struct pcvcm_node *node);
+
+purc_variant_t pcvcm_call_dvariant_method(purc_variant_t root,
+        purc_variant_t var, size_t nr_args, purc_variant_t *argv,
+        enum method_type type, bool silently);
+
+purc_variant_t pcvcm_call_nvariant_method(purc_variant_t var,
+        const char *key_name, size_t nr_args, purc_variant_t *argv,
+        enum method_type type, bool silently);
+
+purc_variant_t
+pcvcm_inner_native_wrapper_create(purc_variant_t caller_node,
+        purc_variant_t param);
+
+bool
+pcvcm_is_inner_native_wrapper(purc_variant_t val);
+
+purc_variant_t
+pcvcm_inner_native_wrapper_get_caller(purc_variant_t val);
+
+purc_variant_t
+pcvcm_inner_native_wrapper_get_param(purc_variant_t val);
+
+/*
+ * Returns the bytecode of the node, compiling it on the first call.
+ * Returns NULL if the node can only be evaluated by the tree walker.
+ */
+struct pcvcm_bytecode *pcvcm_node_get_bytecode(struct pcvcm_node *node);
+
+void pcvcm_node_release_bytecode(struct pcvcm_node *node);
+
+/* returns a new reference to the cached value of the constant node */
+purc_variant_t pcvcm_get_cached_constant(const struct pcvcm_node *node);
+
+/* caches the value of the constant node if the value is immutable */
+void pcvcm_cache_constant(const struct pcvcm_node *node,
+        purc_variant_t value);
+
+/* the inline caches of the member accesses, see vcm-ic.c */
+struct pcvcm_native_ic;
+
+/* returns a new identifier of an access site, never 0 */
+uint32_t pcvcm_ic_new_site(void);
+
+struct pcvcm_native_ic *pcvcm_native_ic_new(void);
+
+void pcvcm_native_ic_destroy(struct pcvcm_native_ic *ic);
+
+/* same as pcvcm_call_nvariant_method() if ic is NULL */
+purc_variant_t pcvcm_call_nvariant_method_cached(struct pcvcm_native_ic *ic,
+        purc_variant_t var, const char *key_name, size_t nr_args,
+        purc_variant_t *argv, enum method_type type, bool silently);
+
+/* same as purc_variant_object_get_by_ckey() but cached per site */
+purc_variant_t pcvcm_get_member_cached(uint32_t site, purc_variant_t obj,
+        const char *key_name);
+
+PCA_EXTERN_C_END
+
+#endif  /* PURC_VCM_VCM_INTERNAL_H */
+
@@ -37,24 +37,13 @@
 #include "private/interpreter.h"
 #include "private/utils.h"
 
-#define TREE_NODE(node)              ((struct pctree_node*)(node))
-#define VCM_NODE(node)               ((struct pcvcm_node*)(node))
-#define FIRST_CHILD(node)            \
-    (VCM_NODE(pctree_node_child(TREE_NODE(node))))
-#define NEXT_CHILD(node)             \
-    ((node) ? VCM_NODE(pctree_node_next(TREE_NODE(node))) : NULL)
-#define PARENT_NODE(node)            \
-    (VCM_NODE(pctree_node_parent(TREE_NODE(node))))
-#define CHILDREN_NUMBER(node)        \
-    (pctree_node_children_number(TREE_NODE(node)))
-#define APPEND_CHILD(parent, child)  \
-    pctree_node_append_child(TREE_NODE(parent), TREE_NODE(child))
-
+#include "vcm-internal.h"
 
 #define MIN_BUF_SIZE         32
 #define MAX_BUF_SIZE         SIZE_MAX
 
 #define PURC_ENVV_VCM_LOG_ENABLE    "PURC_VCM_LOG_ENABLE"
+#define PURC_ENVV_VCM_BYTECODE      "PURC_VCM_BYTECODE"
 
 typedef
 void (*pcvcm_node_handle)(purc_rwstream_t rws, struct pcvcm_node *node,
@@ -68,11 +57,6 @@ static
 void pcvcm_node_serialize_to_rwstream(purc_rwstream_t rws,
         struct pcvcm_node *node, bool ignore_string_quoted);
 
-struct pcvcm_node_op {
-    cb_find_var find_var;
-    void *find_var_ctxt;
-};
-
 // expression variable
 struct pcvcm_ev {
     struct pcvcm_node *vcm;
@@ -915,6 +899,7 @@ static void pcvcm_node_destroy_callback(struct pctree_node *n,  void *data)
 {
     UNUSED_PARAM(data);
     struct pcvcm_node *node = VCM_NODE(n);
+    pcvcm_node_release_bytecode(node);
     if ((node->type == PCVCM_NODE_TYPE_STRING
                 || node->type == PCVCM_NODE_TYPE_BYTE_SEQUENCE
         ) && node->sz_ptr[1]) {
@@ -931,6 +916,29 @@ void pcvcm_node_destroy(struct pcvcm_node *root)
     }
 }
 
+static void pcvcm_node_estimate_size_callback(struct pctree_node *n,
+        void *data)
+{
+    struct pcvcm_node *node = VCM_NODE(n);
+    size_t *size = (size_t *)data;
+
+    *size += sizeof(struct pcvcm_node);
+    if (node->type == PCVCM_NODE_TYPE_STRING
+            || node->type == PCVCM_NODE_TYPE_BYTE_SEQUENCE) {
+        *size += node->sz_ptr[0] + 1;
+    }
+}
+
+size_t pcvcm_node_estimate_size(const struct pcvcm_node *tree)
+{
+    size_t size = 0;
+    if (tree) {
+        pctree_node_post_order_traversal(TREE_NODE(tree),
+                pcvcm_node_estimate_size_callback, &size);
+    }
+    return size;
+}
+
 struct pcvcm_stack {
     struct pcutils_stack *stack;
 };
@@ -976,10 +984,6 @@ void pcvcm_stack_destroy(struct pcvcm_stack *stack)
     free(stack);
 }
 
-static
-purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
-        struct pcvcm_node_op *ops, bool silently);
-
 static
 purc_variant_t pcvcm_node_object_to_variant(struct pcvcm_node *node,
         struct pcvcm_node_op *ops, bool silently)
@@ -1173,7 +1177,7 @@ static bool is_action_node(struct pcvcm_node *node)
             );
 }
 
-static bool is_handle_as_getter(struct pcvcm_node *node)
+bool pcvcm_node_is_handle_as_getter(struct pcvcm_node *node)
 {
     struct pcvcm_node *parent_node = PARENT_NODE(node);
     if (is_action_node(parent_node) && FIRST_CHILD(parent_node) == node) {
@@ -1182,13 +1186,7 @@ static bool is_handle_as_getter(struct pcvcm_node *node)
     return true;
 }
 
-enum method_type {
-    GETTER_METHOD,
-    SETTER_METHOD
-};
-
-static
-purc_variant_t call_dvariant_method(purc_variant_t root, purc_variant_t var,
+purc_variant_t pcvcm_call_dvariant_method(purc_variant_t root, purc_variant_t var,
         size_t nr_args, purc_variant_t *argv, enum method_type type,
         bool silently)
 {
@@ -1201,8 +1199,7 @@ purc_variant_t call_dvariant_method(purc_variant_t root, purc_variant_t var,
     return PURC_VARIANT_INVALID;
 }
 
-static
-purc_variant_t call_nvariant_method(purc_variant_t var,
+purc_variant_t pcvcm_call_nvariant_method(purc_variant_t var,
         const char *key_name, size_t nr_args, purc_variant_t *argv,
         enum method_type type, bool silently)
 {
@@ -1228,8 +1225,8 @@ static purc_variant_t get_attach_variant(struct pcvcm_node *node)
 #define KEY_CALLER_NODE             "__vcm_caller_node"
 #define KEY_PARAM_NODE              "__vcm_param_node"
 
-static purc_variant_t
-inner_native_wrapper_create(purc_variant_t caller_node, purc_variant_t param)
+purc_variant_t
+pcvcm_inner_native_wrapper_create(purc_variant_t caller_node, purc_variant_t param)
 {
     purc_variant_t b = purc_variant_make_boolean(true);
     if (b == PURC_VARIANT_INVALID) {
@@ -1249,8 +1246,8 @@ inner_native_wrapper_create(purc_variant_t caller_node, purc_variant_t param)
     return object;
 }
 
-static bool
-is_inner_native_wrapper(purc_variant_t val)
+bool
+pcvcm_is_inner_native_wrapper(purc_variant_t val)
 {
     if (!val || !purc_variant_is_object(val)) {
         return false;
@@ -1265,14 +1262,14 @@ is_inner_native_wrapper(purc_variant_t val)
     return false;
 }
 
-static purc_variant_t
-inner_native_wrapper_get_caller(purc_variant_t val)
+purc_variant_t
+pcvcm_inner_native_wrapper_get_caller(purc_variant_t val)
 {
     return purc_variant_object_get_by_ckey(val, KEY_CALLER_NODE);
 }
 
-static purc_variant_t
-inner_native_wrapper_get_param(purc_variant_t val)
+purc_variant_t
+pcvcm_inner_native_wrapper_get_param(purc_variant_t val)
 {
     return purc_variant_object_get_by_ckey(val, KEY_PARAM_NODE);
 }
@@ -1313,10 +1310,10 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
     }
 
     // FIXME: {{ $SESSION.myobj.bcPipe.status[0] }}
-    if (is_inner_native_wrapper(caller_var)) {
-        purc_variant_t inner_caller = inner_native_wrapper_get_caller(caller_var);
-        purc_variant_t inner_param = inner_native_wrapper_get_param(caller_var);
-        purc_variant_t inner_ret = call_nvariant_method(inner_caller,
+    if (pcvcm_is_inner_native_wrapper(caller_var)) {
+        purc_variant_t inner_caller = pcvcm_inner_native_wrapper_get_caller(caller_var);
+        purc_variant_t inner_param = pcvcm_inner_native_wrapper_get_param(caller_var);
+        purc_variant_t inner_ret = pcvcm_call_nvariant_method(inner_caller,
                 purc_variant_get_string_const(inner_param), 0, NULL,
                 GETTER_METHOD, silently);
         if (inner_ret) {
@@ -1337,12 +1334,12 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             goto out_unref_param_var;
         }
 
-        if (!is_handle_as_getter(node)) {
+        if (!pcvcm_node_is_handle_as_getter(node)) {
             ret_var = val;
             goto out_unref_param_var;
         }
 
-        ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
+        ret_var = pcvcm_call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
                 silently);
         purc_variant_unref(val);
     }
@@ -1369,11 +1366,11 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             goto out_unref_param_var;
         }
 
-        if (!is_handle_as_getter(node)) {
+        if (!pcvcm_node_is_handle_as_getter(node)) {
             ret_var = val;
             goto out_unref_param_var;
         }
-        ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
+        ret_var = pcvcm_call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
                 silently);
         purc_variant_unref(val);
     }
@@ -1400,27 +1397,27 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             goto out_unref_param_var;
         }
 
-        if (!is_handle_as_getter(node)) {
+        if (!pcvcm_node_is_handle_as_getter(node)) {
             ret_var = val;
             goto out_unref_param_var;
         }
-        ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
+        ret_var = pcvcm_call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
                 silently);
         purc_variant_unref(val);
     }
     else if (purc_variant_is_dynamic(caller_var)) {
-        ret_var = call_dvariant_method(
+        ret_var = pcvcm_call_dvariant_method(
                 get_attach_variant(FIRST_CHILD(caller_node)),
                 caller_var, 1, &param_var, GETTER_METHOD,
                 silently);
         goto out_unref_param_var;
     }
     else if (purc_variant_is_native(caller_var)) {
-        if (!is_handle_as_getter(node)) {
-            ret_var = inner_native_wrapper_create(caller_var, param_var);
+        if (!pcvcm_node_is_handle_as_getter(node)) {
+            ret_var = pcvcm_inner_native_wrapper_create(caller_var, param_var);
             goto out_unref_param_var;
         }
-        ret_var = call_nvariant_method(caller_var,
+        ret_var = pcvcm_call_nvariant_method(caller_var,
                 purc_variant_get_string_const(param_var), 0, NULL,
                 GETTER_METHOD, silently);
         goto out_unref_param_var;
@@ -1449,7 +1446,7 @@ purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
     }
 
     if (!purc_variant_is_dynamic(caller_var)
-            && !is_inner_native_wrapper(caller_var)) {
+            && !pcvcm_is_inner_native_wrapper(caller_var)) {
         goto out_unref_caller_var;
     }
 
@@ -1477,16 +1474,16 @@ purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
     }
 
     if (purc_variant_is_dynamic(caller_var)) {
-        ret_var = call_dvariant_method(
+        ret_var = pcvcm_call_dvariant_method(
                 get_attach_variant(FIRST_CHILD(caller_node)),
                 caller_var, nr_params, params, type, silently);
     }
-    else if (is_inner_native_wrapper(caller_var)) {
-        purc_variant_t nv = inner_native_wrapper_get_caller(caller_var);
+    else if (pcvcm_is_inner_native_wrapper(caller_var)) {
+        purc_variant_t nv = pcvcm_inner_native_wrapper_get_caller(caller_var);
         if (purc_variant_is_native(nv)) {
-            purc_variant_t name = inner_native_wrapper_get_param(caller_var);
+            purc_variant_t name = pcvcm_inner_native_wrapper_get_param(caller_var);
             if (name) {
-                ret_var = call_nvariant_method(nv,
+                ret_var = pcvcm_call_nvariant_method(nv,
                         purc_variant_get_string_const(name), nr_params,
                         params, type, silently);
             }
@@ -1606,12 +1603,6 @@ failed:
     return PURC_VARIANT_INVALID;
 }
 
-static bool has_fatal_error()
-{
-    int err = purc_get_last_error();
-    return (err == PURC_ERROR_OUT_OF_MEMORY);
-}
-
 purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
         struct pcvcm_node_op *ops, bool silently)
 {
@@ -1695,7 +1686,7 @@ purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
     }
 
     if (ret == PURC_VARIANT_INVALID
-            && silently && !has_fatal_error()) {
+            && silently && !pcvcm_has_fatal_error()) {
         ret = purc_variant_make_undefined();
     }
 
@@ -1746,17 +1737,99 @@ purc_variant_t find_stack_var(void *ctxt, const char *name)
     return pcintr_find_named_var(ctxt, name);
 }
 
-purc_variant_t pcvcm_eval(struct pcvcm_node *tree, struct pcintr_stack *stack,
-        bool silently)
+struct pcvcm_var_ref *pcvcm_var_ref_new(const char *name)
 {
-    if (stack) {
-        return pcvcm_eval_ex(tree, find_stack_var, stack, silently);
+    struct pcvcm_var_ref *ref = (struct pcvcm_var_ref *)calloc(1,
+            sizeof(*ref));
+    if (!ref) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
     }
-    return pcvcm_eval_ex(tree, NULL, NULL, silently);
+
+    /* classify the name in the same way as find_stack_var() */
+    size_t nr_name = strlen(name);
+    char last = nr_name ? name[nr_name - 1] : 0;
+
+    ref->name = name;
+    ref->kind = PCVCM_VAR_NAMED;
+    if (nr_name == 0) {
+        return ref;
+    }
+
+    if (is_digit(name[0])) {
+        ref->kind = PCVCM_VAR_SYMBOLIZED;
+        ref->number = atoi(name);
+        ref->symbol = last;
+    }
+    else if (nr_name == 1 && purc_ispunct(last)) {
+        ref->kind = PCVCM_VAR_SYMBOLIZED;
+        ref->number = 1;
+        ref->symbol = last;
+    }
+    else if (name[0] == '#' && nr_name > 1) {
+        ref->anchor = strndup(name + 1, nr_name - 2);
+        if (!ref->anchor) {
+            free(ref);
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+        ref->kind = PCVCM_VAR_ANCHORED;
+        ref->symbol = last;
+    }
+    else {
+        /* identifies the name in the cache of the found variables */
+        ref->atom = purc_atom_from_string(name);
+    }
+
+    return ref;
 }
 
-purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
-        cb_find_var find_var, void *ctxt, bool silently)
+void pcvcm_var_ref_destroy(struct pcvcm_var_ref *ref)
+{
+    if (ref) {
+        free(ref->anchor);
+        free(ref);
+    }
+}
+
+static
+purc_variant_t find_stack_var_ref(void *ctxt, const struct pcvcm_var_ref *ref)
+{
+    struct pcintr_stack *stack = (struct pcintr_stack*)ctxt;
+
+    switch (ref->kind) {
+    case PCVCM_VAR_SYMBOLIZED:
+        PC_ASSERT(is_digit(ref->symbol) == 0);
+        return pcintr_get_symbolized_var(stack, ref->number, ref->symbol);
+
+    case PCVCM_VAR_ANCHORED:
+        return pcintr_find_anchor_symbolized_var(stack, ref->anchor,
+                ref->symbol);
+
+    case PCVCM_VAR_NAMED:
+    default:
+        return pcintr_find_named_var_by_ref(stack, ref);
+    }
+}
+
+static bool is_bytecode_enabled(void)
+{
+    /* -1: not checked yet; 0: disabled; 1: enabled */
+    static int enabled = -1;
+
+    if (enabled < 0) {
+        const char *env_value = getenv(PURC_ENVV_VCM_BYTECODE);
+        enabled = (env_value == NULL || !(*env_value == '0' ||
+                    pcutils_strcasecmp(env_value, "false") == 0));
+    }
+
+    return enabled;
+}
+
+static purc_variant_t
+eval_tree(struct pcvcm_node *tree, cb_find_var find_var,
+        cb_find_var_ref find_var_ref, void *ctxt, bool silently,
+        bool use_bytecode)
 {
     const char *env_value;
     if ((env_value = getenv(PURC_ENVV_VCM_LOG_ENABLE))) {
@@ -1775,13 +1848,36 @@ purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
         .find_var_ctxt = ctxt,
     };
 
-    if (tree) {
+    bool constant = (tree && tree->is_constant && !_print_vcm_log);
+    if (constant) {
+        ret = pcvcm_get_cached_constant(tree);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    /* the tree walker logs every node, so keep it when logging is enabled */
+    struct pcvcm_bytecode *bc = NULL;
+    if (tree && use_bytecode && !_print_vcm_log) {
+        bc = pcvcm_node_get_bytecode(tree);
+    }
+
+    if (bc) {
+        ret = pcvcm_bytecode_eval_ex(bc, find_var, find_var_ref, ctxt,
+                silently);
+    }
+    else if (tree) {
         ret = pcvcm_node_to_variant(tree, &ops, silently);
     }
     else if (silently) {
         ret = purc_variant_make_undefined();
     }
 
+    /* undefined may come from an error ignored silently */
+    if (constant && ret && !purc_variant_is_undefined(ret)) {
+        pcvcm_cache_constant(tree, ret);
+    }
+
     if (_print_vcm_log) {
         PRINT_VARIANT(ret);
         PC_DEBUG("pcvcm_eval_ex|end|silently=%d\n", silently);
@@ -1789,6 +1885,29 @@ purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
     return ret;
 }
 
+purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
+        cb_find_var find_var, void *ctxt, bool silently)
+{
+    return eval_tree(tree, find_var, NULL, ctxt, silently,
+            is_bytecode_enabled());
+}
+
+purc_variant_t pcvcm_eval_walk_ex(struct pcvcm_node *tree,
+        cb_find_var find_var, void *ctxt, bool silently)
+{
+    return eval_tree(tree, find_var, NULL, ctxt, silently, false);
+}
+
+purc_variant_t pcvcm_eval(struct pcvcm_node *tree, struct pcintr_stack *stack,
+        bool silently)
+{
+    if (stack) {
+        return eval_tree(tree, find_stack_var, find_stack_var_ref, stack,
+                silently, is_bytecode_enabled());
+    }
+    return pcvcm_eval_ex(tree, NULL, NULL, silently);
+}
+
 static purc_variant_t
 eval_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
         bool silently)
@@ -1915,6 +2034,7 @@ on_release(void *native_entity)
 {
     struct pcvcm_ev *vcm_variant = (struct pcvcm_ev*)native_entity;
     if (vcm_variant->release_vcm) {
+        pcvcm_node_release_bytecode(vcm_variant->vcm);
         free(vcm_variant->vcm);
     }
     if (vcm_variant->const_value) {
@@ -0,0 +1,546 @@
+/*
+ * @file vdom-binary.c
+ * @date 2022/10/21
+ * @brief The binary form of vDOM for the persistent vDOM cache.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The binary form starts with a header identifying the format and the
+ * library (the version, the byte order and the size of long double), then
+ * the doctype and the children of the document in pre-order:
+ *
+ *  - element: u8 type, string tag name, u8 flags, u32 nr_attrs, the
+ *    attributes (string key, u8 operator, u8 has_value, vcm tree),
+ *    u32 nr_children and the children;
+ *  - content: u8 type and the vcm tree;
+ *  - comment: u8 type and string text.
+ *
+ * A string is written as u32 length, the bytes and a null byte, so that
+ * the reader can use the strings in place. The vcm trees are written by
+ * pcvcm_node_write_binary().
+ */
+
+#include "config.h"
+#include "purc-version.h"
+
+#include "private/instance.h"
+#include "private/errors.h"
+#include "private/debug.h"
+#include "private/utils.h"
+#include "private/vdom.h"
+#include "private/vcm.h"
+
+#include "vdom-internal.h"
+
+#include <string.h>
+
+#define VDT(x)     PCVDOM_NODE_##x
+
+#define BINARY_MAGIC            "PCVDOM\x1a\n"
+#define BINARY_FORMAT_VERSION   1
+#define BINARY_BYTE_ORDER_MARK  0x01020304
+
+#define NULL_STRING_LENGTH      UINT32_MAX
+
+/* the files nesting the nodes deeper are rejected */
+#define MAX_VDOM_DEPTH          1024
+
+#define ELEMENT_FLAG_SELF_CLOSING   0x01
+#define ELEMENT_FLAG_HEAD           0x02
+#define ELEMENT_FLAG_BODY           0x04
+
+struct binary_header {
+    char            magic[8];
+    uint32_t        format_version;
+    uint32_t        byte_order_mark;
+    uint32_t        sizeof_long_double;
+    char            lib_version[20];
+};
+
+static void
+init_header(struct binary_header *header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, BINARY_MAGIC, sizeof(header->magic));
+    header->format_version = BINARY_FORMAT_VERSION;
+    header->byte_order_mark = BINARY_BYTE_ORDER_MARK;
+    header->sizeof_long_double = sizeof(long double);
+    strncpy(header->lib_version, PURC_VERSION_STRING,
+            sizeof(header->lib_version) - 1);
+}
+
+static inline int
+write_bytes(purc_rwstream_t out, const void *buf, size_t len)
+{
+    return (purc_rwstream_write(out, buf, len) == (ssize_t)len) ? 0 : -1;
+}
+
+static inline int
+write_u8(purc_rwstream_t out, uint8_t v)
+{
+    return write_bytes(out, &v, sizeof(v));
+}
+
+static inline int
+write_u32(purc_rwstream_t out, uint32_t v)
+{
+    return write_bytes(out, &v, sizeof(v));
+}
+
+static int
+write_string(purc_rwstream_t out, const char *str)
+{
+    if (str == NULL)
+        return write_u32(out, NULL_STRING_LENGTH);
+
+    size_t len = strlen(str);
+    if (len >= NULL_STRING_LENGTH)
+        return -1;
+
+    if (write_u32(out, (uint32_t)len) || write_bytes(out, str, len + 1))
+        return -1;
+    return 0;
+}
+
+struct writer {
+    struct pcvdom_document     *doc;
+    purc_rwstream_t             out;
+};
+
+static bool
+is_body(struct pcvdom_document *doc, struct pcvdom_element *elem)
+{
+    size_t nr = pcutils_arrlist_length(doc->bodies);
+    for (size_t i = 0; i < nr; i++) {
+        if (pcutils_arrlist_get_idx(doc->bodies, i) == elem)
+            return true;
+    }
+    return false;
+}
+
+static int
+write_attr(struct writer *writer, struct pcvdom_attr *attr)
+{
+    if (write_string(writer->out, attr->key) ||
+            write_u8(writer->out, (uint8_t)attr->op) ||
+            write_u8(writer->out, attr->val ? 1 : 0))
+        return -1;
+
+    if (attr->val && pcvcm_node_write_binary(writer->out, attr->val))
+        return -1;
+
+    return 0;
+}
+
+static int
+write_node(struct writer *writer, struct pcvdom_node *node, int depth);
+
+static int
+write_children(struct writer *writer, struct pcvdom_node *node, int depth)
+{
+    uint32_t nr = 0;
+    struct pcvdom_node *child = pcvdom_node_first_child(node);
+    while (child) {
+        nr++;
+        child = pcvdom_node_next_sibling(child);
+    }
+
+    if (write_u32(writer->out, nr))
+        return -1;
+
+    child = pcvdom_node_first_child(node);
+    while (child) {
+        if (write_node(writer, child, depth))
+            return -1;
+        child = pcvdom_node_next_sibling(child);
+    }
+
+    return 0;
+}
+
+static int
+write_node(struct writer *writer, struct pcvdom_node *node, int depth)
+{
+    purc_rwstream_t out = writer->out;
+
+    /* the reader would reject the file, so do not write it */
+    if (depth > MAX_VDOM_DEPTH) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return -1;
+    }
+
+    if (write_u8(out, (uint8_t)node->type))
+        return -1;
+
+    switch (node->type) {
+    case VDT(ELEMENT):
+    {
+        struct pcvdom_element *elem = PCVDOM_ELEMENT_FROM_NODE(node);
+        uint8_t flags = 0;
+        if (elem->self_closing)
+            flags |= ELEMENT_FLAG_SELF_CLOSING;
+        if (elem == writer->doc->head)
+            flags |= ELEMENT_FLAG_HEAD;
+        if (is_body(writer->doc, elem))
+            flags |= ELEMENT_FLAG_BODY;
+
+        if (write_string(out, elem->tag_name) || write_u8(out, flags))
+            return -1;
+
+        if (write_u32(out, elem->nr_attrs))
+            return -1;
+        for (unsigned int i = 0; i < elem->nr_attrs; i++) {
+            if (write_attr(writer, elem->attrs[i]))
+                return -1;
+        }
+
+        return write_children(writer, node, depth + 1);
+    }
+
+    case VDT(CONTENT):
+    {
+        struct pcvdom_content *content = PCVDOM_CONTENT_FROM_NODE(node);
+        return pcvcm_node_write_binary(out, content->vcm);
+    }
+
+    case VDT(COMMENT):
+    {
+        struct pcvdom_comment *comment = PCVDOM_COMMENT_FROM_NODE(node);
+        return write_string(out, comment->text);
+    }
+
+    default:
+        break;
+    }
+
+    return -1;
+}
+
+int
+pcvdom_document_write_binary(struct pcvdom_document *doc,
+        purc_rwstream_t out)
+{
+    struct binary_header header;
+    init_header(&header);
+
+    if (write_bytes(out, &header, sizeof(header)) ||
+            write_string(out, doc->doctype.name) ||
+            write_string(out, doc->doctype.tag_prefix) ||
+            write_string(out, doc->doctype.system_info) ||
+            write_u8(out, doc->quirks ? 1 : 0))
+        return -1;
+
+    struct writer writer = { doc, out };
+    return write_children(&writer, &doc->node, 0);
+}
+
+struct reader {
+    const unsigned char        *data;
+    const unsigned char        *end;
+    struct pcvdom_document     *doc;
+};
+
+static bool
+read_bytes(struct reader *reader, void *buf, size_t len)
+{
+    if ((size_t)(reader->end - reader->data) < len)
+        return false;
+    memcpy(buf, reader->data, len);
+    reader->data += len;
+    return true;
+}
+
+static inline bool
+read_u8(struct reader *reader, uint8_t *v)
+{
+    return read_bytes(reader, v, sizeof(*v));
+}
+
+static inline bool
+read_u32(struct reader *reader, uint32_t *v)
+{
+    return read_bytes(reader, v, sizeof(*v));
+}
+
+/* the string is used in place; *str is NULL for a null string */
+static bool
+read_string(struct reader *reader, const char **str)
+{
+    uint32_t len;
+    if (!read_u32(reader, &len))
+        return false;
+
+    if (len == NULL_STRING_LENGTH) {
+        *str = NULL;
+        return true;
+    }
+
+    if ((size_t)(reader->end - reader->data) <= len ||
+            reader->data[len] != 0)
+        return false;
+
+    *str = (const char *)reader->data;
+    reader->data += len + 1;
+    return true;
+}
+
+static struct pcvcm_node *
+read_vcm(struct reader *reader)
+{
+    return pcvcm_node_read_binary(&reader->data, reader->end);
+}
+
+static int
+read_node(struct reader *reader, struct pcvdom_node *parent, int depth);
+
+static int
+read_attrs(struct reader *reader, struct pcvdom_element *elem)
+{
+    uint32_t nr_attrs;
+    if (!read_u32(reader, &nr_attrs))
+        return -1;
+
+    for (uint32_t i = 0; i < nr_attrs; i++) {
+        const char *key;
+        uint8_t op, has_val;
+        struct pcvcm_node *vcm = NULL;
+
+        if (!read_string(reader, &key) || key == NULL ||
+                !read_u8(reader, &op) || !read_u8(reader, &has_val))
+            return -1;
+
+        if (has_val && (vcm = read_vcm(reader)) == NULL)
+            return -1;
+
+        struct pcvdom_attr *attr;
+        attr = pcvdom_attr_create(key, (enum pchvml_attr_operator)op, vcm);
+        if (attr == NULL) {
+            pcvcm_node_destroy(vcm);
+            return -1;
+        }
+
+        if (pcvdom_element_append_attr(elem, attr)) {
+            pcvdom_attr_destroy(attr);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+attach_node(struct pcvdom_node *parent, struct pcvdom_node *child)
+{
+    if (parent->type == VDT(DOCUMENT)) {
+        struct pcvdom_document *doc = PCVDOM_DOCUMENT_FROM_NODE(parent);
+        switch (child->type) {
+        case VDT(ELEMENT):
+            return pcvdom_document_set_root(doc,
+                    PCVDOM_ELEMENT_FROM_NODE(child));
+        case VDT(CONTENT):
+            return pcvdom_document_append_content(doc,
+                    PCVDOM_CONTENT_FROM_NODE(child));
+        default:
+            return pcvdom_document_append_comment(doc,
+                    PCVDOM_COMMENT_FROM_NODE(child));
+        }
+    }
+
+    struct pcvdom_element *elem = PCVDOM_ELEMENT_FROM_NODE(parent);
+    switch (child->type) {
+    case VDT(ELEMENT):
+        return pcvdom_element_append_element(elem,
+                PCVDOM_ELEMENT_FROM_NODE(child));
+    case VDT(CONTENT):
+        return pcvdom_element_append_content(elem,
+                PCVDOM_CONTENT_FROM_NODE(child));
+    default:
+        return pcvdom_element_append_comment(elem,
+                PCVDOM_COMMENT_FROM_NODE(child));
+    }
+}
+
+static int
+read_children(struct reader *reader, struct pcvdom_node *parent, int depth)
+{
+    uint32_t nr_children;
+    if (!read_u32(reader, &nr_children))
+        return -1;
+
+    for (uint32_t i = 0; i < nr_children; i++) {
+        if (read_node(reader, parent, depth))
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Every node is attached to its parent before its children are read, so
+ * the nodes read before a failure are destroyed with the document.
+ */
+static int
+read_node(struct reader *reader, struct pcvdom_node *parent, int depth)
+{
+    struct pcvdom_node *node = NULL;
+    struct pcvdom_element *elem = NULL;
+    uint8_t type, flags = 0;
+
+    if (depth > MAX_VDOM_DEPTH || !read_u8(reader, &type))
+        return -1;
+
+    switch (type) {
+    case VDT(ELEMENT):
+    {
+        const char *tag_name;
+        if (!read_string(reader, &tag_name) || tag_name == NULL ||
+                !read_u8(reader, &flags))
+            return -1;
+
+        elem = pcvdom_element_create_c(tag_name);
+        if (elem == NULL)
+            return -1;
+
+        node = &elem->node;
+        if (flags & ELEMENT_FLAG_SELF_CLOSING)
+            elem->self_closing = 1;
+
+        if (read_attrs(reader, elem))
+            goto failed;
+        break;
+    }
+
+    case VDT(CONTENT):
+    {
+        struct pcvcm_node *vcm = read_vcm(reader);
+        if (vcm == NULL)
+            return -1;
+
+        struct pcvdom_content *content = pcvdom_content_create(vcm);
+        if (content == NULL) {
+            pcvcm_node_destroy(vcm);
+            return -1;
+        }
+        node = &content->node;
+        break;
+    }
+
+    case VDT(COMMENT):
+    {
+        const char *text;
+        if (!read_string(reader, &text) || text == NULL)
+            return -1;
+
+        struct pcvdom_comment *comment = pcvdom_comment_create(text);
+        if (comment == NULL)
+            return -1;
+        node = &comment->node;
+        break;
+    }
+
+    default:
+        return -1;
+    }
+
+    if (attach_node(parent, node))
+        goto failed;
+
+    if (elem == NULL)
+        return 0;
+
+    struct pcvdom_document *doc = reader->doc;
+    if (flags & ELEMENT_FLAG_HEAD)
+        doc->head = elem;
+
+    /* the bodies are in the document order as the generator adds them */
+    if (flags & ELEMENT_FLAG_BODY) {
+        size_t nr = pcutils_arrlist_length(doc->bodies);
+        if (pcutils_arrlist_put_idx(doc->bodies, nr, elem))
+            return -1;
+        doc->body = elem;
+    }
+
+    return read_children(reader, node, depth + 1);
+
+failed:
+    pcvdom_node_destroy(node);
+    return -1;
+}
+
+static int
+read_document(struct reader *reader)
+{
+    struct pcvdom_document *doc = reader->doc;
+    const char *name, *tag_prefix, *system_info;
+    uint8_t quirks;
+
+    if (!read_string(reader, &name) || !read_string(reader, &tag_prefix) ||
+            !read_string(reader, &system_info) || !read_u8(reader, &quirks))
+        return -1;
+
+    if (name && system_info &&
+            pcvdom_document_set_doctype(doc, name, system_info))
+        return -1;
+
+    if (tag_prefix && (doc->doctype.tag_prefix = strdup(tag_prefix)) == NULL)
+        return -1;
+
+    doc->quirks = quirks ? 1 : 0;
+
+    if (read_children(reader, &doc->node, 0))
+        return -1;
+
+    return (reader->data == reader->end) ? 0 : -1;
+}
+
+struct pcvdom_document*
+pcvdom_document_read_binary(const void *data, size_t len)
+{
+    struct binary_header expected, header;
+    init_header(&expected);
+
+    struct reader reader = {
+        .data   = (const unsigned char *)data,
+        .end    = (const unsigned char *)data + len,
+        .doc    = NULL,
+    };
+
+    if (!read_bytes(&reader, &header, sizeof(header)) ||
+            memcmp(&header, &expected, sizeof(header))) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return NULL;
+    }
+
+    reader.doc = pcvdom_document_create();
+    if (reader.doc == NULL)
+        return NULL;
+
+    if (read_document(&reader)) {
+        pcvdom_document_unref(reader.doc);
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return NULL;
+    }
+
+    /* the constant identifiers are assigned per process */
+    pcvdom_document_fold_constants(reader.doc);
+    pcvdom_document_mark_static_subtrees(reader.doc);
+    return reader.doc;
+}
+
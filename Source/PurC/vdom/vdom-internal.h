@@ -55,6 +55,11 @@
     (PCVDOM_NODE_IS_COMMENT(_node) ? \
         container_of(_node, struct pcvdom_comment, node) : NULL)
 
+// most elements have no more than four attributes
+#define PCVDOM_INLINE_ATTRS         4
+// above this, the attributes are looked up by binary search
+#define PCVDOM_LINEAR_SEARCH_ATTRS  8
+
 struct pcvdom_node {
     struct pctree_node     node;
     enum pcvdom_nodetype   type;
@@ -93,6 +98,9 @@ struct pcvdom_attr {
     const struct pchvml_attr_entry  *pre_defined;
     char                     *key;
 
+    // the atom of the key in the HVML keyword bucket, 0 for non-keywords
+    purc_atom_t               kw_atom;
+
     // operator
     enum pchvml_attr_operator       op;
 
@@ -108,11 +116,19 @@ struct pcvdom_element {
     pcvdom_tag_id           tag_id;
     char                   *tag_name;
 
-    // key: char *, the same as struct pcvdom_attr:key
-    // val: struct pcvdom_attr*
-    struct pcutils_map     *attrs;
+    // the attributes sorted by key; `attrs` points to `inline_attrs`
+    // until the element has more than PCVDOM_INLINE_ATTRS attributes
+    struct pcvdom_attr    **attrs;
+    unsigned int            nr_attrs;
+    unsigned int            sz_attrs;
 
     unsigned int            self_closing:1;
+
+    // the element is a foreign element, and its attributes, contents, and
+    // descendants are all constant; set when the vDOM is complete
+    unsigned int            static_subtree:1;
+
+    struct pcvdom_attr     *inline_attrs[PCVDOM_INLINE_ATTRS];
 };
 
 struct pcvdom_content {
@@ -31,6 +31,7 @@
 #include "private/stringbuilder.h"
 
 #include "hvml-attr.h"
+#include "keywords.h"
 
 #include "vdom-internal.h"
 
@@ -128,11 +129,17 @@ pcvdom_document_unref(struct pcvdom_document *doc)
     assert(doc);
 
     unsigned long refc = atomic_fetch_sub(&doc->refc, 1);
-    if (refc <= 2) {
+    if (refc == 1) {
         document_destroy(doc);
     }
 }
 
+unsigned long
+pcvdom_document_get_refc(struct pcvdom_document *doc)
+{
+    return atomic_load(&doc->refc);
+}
+
 struct pcvdom_document*
 pcvdom_document_create(void)
 {
@@ -254,6 +261,7 @@ pcvdom_attr_create(const char *key, enum pchvml_attr_operator op,
         }
     }
 
+    attr->kw_atom = PCHVML_KEYWORD_ATOM(HVML, attr->key);
     attr->val = vcm;
 
     return attr;
@@ -342,6 +350,78 @@ pcvdom_document_append_comment(struct pcvdom_document *doc,
     return 0;
 }
 
+/*
+ * Returns the index of the attribute with the key if found, otherwise
+ * the index at which the attribute should be inserted.
+ */
+static unsigned int
+element_locate_attr(struct pcvdom_element *elem, const char *key,
+        bool *found)
+{
+    unsigned int low = 0, high = elem->nr_attrs;
+
+    *found = false;
+    if (high <= PCVDOM_LINEAR_SEARCH_ATTRS) {
+        for (; low < high; low++) {
+            int r = strcmp(key, elem->attrs[low]->key);
+            if (r == 0)
+                *found = true;
+            if (r <= 0)
+                break;
+        }
+        return low;
+    }
+
+    while (low < high) {
+        unsigned int mid = low + (high - low) / 2;
+        int r = strcmp(key, elem->attrs[mid]->key);
+        if (r == 0) {
+            *found = true;
+            return mid;
+        }
+
+        if (r < 0)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    return low;
+}
+
+static struct pcvdom_attr*
+element_find_attr(struct pcvdom_element *elem, const char *key)
+{
+    bool found;
+    unsigned int idx = element_locate_attr(elem, key, &found);
+    return found ? elem->attrs[idx] : NULL;
+}
+
+static int
+element_grow_attrs(struct pcvdom_element *elem)
+{
+    unsigned int sz = elem->sz_attrs * 2;
+    struct pcvdom_attr **attrs;
+
+    if (elem->attrs == elem->inline_attrs) {
+        attrs = malloc(sizeof(*attrs) * sz);
+        if (attrs)
+            memcpy(attrs, elem->attrs, sizeof(*attrs) * elem->nr_attrs);
+    }
+    else {
+        attrs = realloc(elem->attrs, sizeof(*attrs) * sz);
+    }
+
+    if (!attrs) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    elem->attrs = attrs;
+    elem->sz_attrs = sz;
+    return 0;
+}
+
 int
 pcvdom_element_append_attr(struct pcvdom_element *elem,
         struct pcvdom_attr *attr)
@@ -351,13 +431,24 @@ pcvdom_element_append_attr(struct pcvdom_element *elem,
         return -1;
     }
 
-    PC_ASSERT(elem->attrs);
+    bool found;
+    unsigned int idx = element_locate_attr(elem, attr->key, &found);
+    if (found) {
+        // the later one replaces the earlier one with the same key
+        struct pcvdom_attr *old = elem->attrs[idx];
+        old->parent = NULL;
+        attr_destroy(old);
+    }
+    else {
+        if (elem->nr_attrs == elem->sz_attrs && element_grow_attrs(elem))
+            return -1;
 
-    int r;
-    r = pcutils_map_find_replace_or_insert(elem->attrs,
-            attr->key, attr, NULL);
-    PC_ASSERT(r==0);
+        memmove(elem->attrs + idx + 1, elem->attrs + idx,
+                sizeof(elem->attrs[0]) * (elem->nr_attrs - idx));
+        elem->nr_attrs++;
+    }
 
+    elem->attrs[idx] = attr;
     attr->parent = elem;
 
     return 0;
@@ -546,20 +637,13 @@ pcvdom_element_get_attr_c(struct pcvdom_element *elem,
         return NULL;
     }
 
-    if (!elem->attrs) {
-        pcinst_set_error(PURC_ERROR_NO_INSTANCE);
-        return NULL;
-    }
-
-    pcutils_map_entry *entry;
-    entry = pcutils_map_find(elem->attrs, key);
-
-    if (!entry || !entry->val) {
+    struct pcvdom_attr *attr = element_find_attr(elem, key);
+    if (!attr) {
         pcinst_set_error(PURC_ERROR_NOT_EXISTS);
         return NULL;
     }
 
-    return entry->val;
+    return attr;
 }
 
 // operation api
@@ -629,6 +713,139 @@ pcvdom_node_traverse(struct pcvdom_node *node, void *ctx,
     return arg.abortion;
 }
 
+static int
+fold_node_constants(struct pcvdom_node *top, struct pcvdom_node *node,
+        void *ctx)
+{
+    UNUSED_PARAM(top);
+    UNUSED_PARAM(ctx);
+
+    if (node->type == VDT(ELEMENT)) {
+        struct pcvdom_element *elem = PCVDOM_ELEMENT_FROM_NODE(node);
+        for (unsigned int i = 0; i < elem->nr_attrs; i++)
+            pcvcm_node_fold_constants(elem->attrs[i]->val);
+    }
+    else if (node->type == VDT(CONTENT)) {
+        struct pcvdom_content *content = PCVDOM_CONTENT_FROM_NODE(node);
+        pcvcm_node_fold_constants(content->vcm);
+    }
+
+    return 0;
+}
+
+void
+pcvdom_document_fold_constants(struct pcvdom_document *doc)
+{
+    if (doc)
+        pcvdom_node_traverse(&doc->node, NULL, fold_node_constants);
+}
+
+static bool
+is_static_attr(struct pcvdom_attr *attr)
+{
+    if (attr->op != PCHVML_ATTRIBUTE_OPERATOR)
+        return false;
+
+    /* the attributes having `hvml:` prefix control the interpreter */
+    if (strncmp(attr->key, "hvml:", 5) == 0)
+        return false;
+
+    return attr->val == NULL || attr->val->type == PCVCM_NODE_TYPE_STRING;
+}
+
+static bool
+mark_static_element(struct pcvdom_element *elem)
+{
+    bool is_static = (elem->tag_id == VTT(_UNDEF));
+
+    for (unsigned int i = 0; is_static && i < elem->nr_attrs; i++) {
+        if (!is_static_attr(elem->attrs[i]))
+            is_static = false;
+    }
+
+    /* visit all children to mark the static subtrees under a dynamic one */
+    struct pctree_node *child = elem->node.node.first_child;
+    for (; child; child = child->next) {
+        struct pcvdom_node *node = container_of(child,
+                struct pcvdom_node, node);
+        if (node->type == VDT(ELEMENT)) {
+            if (!mark_static_element(PCVDOM_ELEMENT_FROM_NODE(node)))
+                is_static = false;
+        }
+        else if (node->type == VDT(CONTENT)) {
+            struct pcvcm_node *vcm = PCVDOM_CONTENT_FROM_NODE(node)->vcm;
+            if (vcm && vcm->type != PCVCM_NODE_TYPE_STRING)
+                is_static = false;
+        }
+    }
+
+    elem->static_subtree = is_static;
+    return is_static;
+}
+
+void
+pcvdom_document_mark_static_subtrees(struct pcvdom_document *doc)
+{
+    if (doc == NULL)
+        return;
+
+    struct pctree_node *child = doc->node.node.first_child;
+    for (; child; child = child->next) {
+        struct pcvdom_node *node = container_of(child,
+                struct pcvdom_node, node);
+        if (node->type == VDT(ELEMENT))
+            mark_static_element(PCVDOM_ELEMENT_FROM_NODE(node));
+    }
+}
+
+static int
+estimate_node_size(struct pcvdom_node *top, struct pcvdom_node *node,
+        void *ctx)
+{
+    UNUSED_PARAM(top);
+
+    size_t *size = (size_t*)ctx;
+    if (node->type == VDT(ELEMENT)) {
+        struct pcvdom_element *elem = PCVDOM_ELEMENT_FROM_NODE(node);
+        *size += sizeof(*elem);
+        if (elem->tag_id == VTT(_UNDEF) && elem->tag_name)
+            *size += strlen(elem->tag_name) + 1;
+        if (elem->attrs != elem->inline_attrs)
+            *size += sizeof(elem->attrs[0]) * elem->sz_attrs;
+        for (unsigned int i = 0; i < elem->nr_attrs; i++) {
+            struct pcvdom_attr *attr = elem->attrs[i];
+            *size += sizeof(*attr);
+            if (!attr->pre_defined)
+                *size += strlen(attr->key) + 1;
+            *size += pcvcm_node_estimate_size(attr->val);
+        }
+    }
+    else if (node->type == VDT(CONTENT)) {
+        struct pcvdom_content *content = PCVDOM_CONTENT_FROM_NODE(node);
+        *size += sizeof(*content) + pcvcm_node_estimate_size(content->vcm);
+    }
+    else if (node->type == VDT(COMMENT)) {
+        struct pcvdom_comment *comment = PCVDOM_COMMENT_FROM_NODE(node);
+        *size += sizeof(*comment);
+        if (comment->text)
+            *size += strlen(comment->text) + 1;
+    }
+    else {
+        *size += sizeof(struct pcvdom_document);
+    }
+
+    return 0;
+}
+
+size_t
+pcvdom_document_estimate_size(struct pcvdom_document *doc)
+{
+    size_t size = 0;
+    if (doc)
+        pcvdom_node_traverse(&doc->node, &size, estimate_node_size);
+    return size;
+}
+
 // traverse all element
 struct element_arg {
     struct pcvdom_element    *top;
@@ -721,12 +938,9 @@ document_serialize(struct pcvdom_document *doc, int level, int push,
 }
 
 static int
-attr_serialize(void *key, void *val, void *ctxt)
+attr_serialize(struct pcvdom_attr *attr, struct serialize_data *ud)
 {
-    const char *sk = (const char*)key;
-    struct pcvdom_attr *attr = (struct pcvdom_attr*)val;
-    struct serialize_data *ud = (struct serialize_data*)ctxt;
-    PC_ASSERT(sk == attr->key);
+    const char *sk = attr->key;
     enum pchvml_attr_operator  op  = attr->op;
     struct pcvcm_node         *v = attr->val;
 
@@ -802,14 +1016,11 @@ element_serialize(struct pcvdom_element *element, int level, int push,
     char *tag_name = element->tag_name;
 
     if (push) {
-        // key: char *, the same as struct pcvdom_attr:key
-        // val: struct pcvdom_attr*
-        struct pcutils_map *attrs = element->attrs;
-
         ud->cb("<", 1, ud->ctxt);
         ud->cb(tag_name, strlen(tag_name), ud->ctxt);
 
-        pcutils_map_traverse(attrs, ud, attr_serialize);
+        for (unsigned int i = 0; i < element->nr_attrs; i++)
+            attr_serialize(element->attrs[i], ud);
 
         ud->cb(">", 1, ud->ctxt);
     }
@@ -1036,8 +1247,6 @@ document_set_doctype(struct pcvdom_document *doc,
 static void
 element_reset(struct pcvdom_element *elem)
 {
-    int r;
-
     if (elem->tag_id==VTT(_UNDEF) && elem->tag_name) {
         free(elem->tag_name);
     }
@@ -1050,11 +1259,17 @@ element_reset(struct pcvdom_element *elem)
         pcvdom_node_destroy(node);
     }
 
-    if (elem->attrs) {
-        r = pcutils_map_destroy(elem->attrs);
-        PC_ASSERT(r==0);
-        elem->attrs = NULL;
+    for (unsigned int i = 0; i < elem->nr_attrs; i++) {
+        struct pcvdom_attr *attr = elem->attrs[i];
+        attr->parent = NULL;
+        attr_destroy(attr);
     }
+    elem->nr_attrs = 0;
+
+    if (elem->attrs != elem->inline_attrs)
+        free(elem->attrs);
+    elem->attrs = elem->inline_attrs;
+    elem->sz_attrs = PCA_TABLESIZE(elem->inline_attrs);
 }
 
 static void
@@ -1065,41 +1280,6 @@ element_destroy(struct pcvdom_element *elem)
     free(elem);
 }
 
-static void*
-element_attr_copy_key(const void *key)
-{
-    return (void*)key;
-}
-
-static void
-element_attr_free_key(void *key)
-{
-    UNUSED_PARAM(key);
-}
-
-static void*
-element_attr_copy_val(const void *val)
-{
-    return (void*)val;
-}
-
-static int
-element_attr_comp_key(const void *key1, const void *key2)
-{
-    const char *s1 = (const char*)key1;
-    const char *s2 = (const char*)key2;
-
-    return strcmp(s1, s2);
-}
-
-static void
-element_attr_free_val(void *val)
-{
-    struct pcvdom_attr *attr = (struct pcvdom_attr*)val;
-    attr->parent = NULL;
-    attr_destroy(attr);
-}
-
 static struct pcvdom_element*
 element_create(void)
 {
@@ -1115,14 +1295,8 @@ element_create(void)
 
     elem->tag_id    = VTT(_UNDEF);
 
-    elem->attrs = pcutils_map_create(element_attr_copy_key, element_attr_free_key,
-        element_attr_copy_val, element_attr_free_val,
-        element_attr_comp_key, false); // non-thread-safe
-    if (!elem->attrs) {
-        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
-        element_destroy(elem);
-        return NULL;
-    }
+    elem->attrs     = elem->inline_attrs;
+    elem->sz_attrs  = PCA_TABLESIZE(elem->inline_attrs);
 
     // FIXME:
     // if (pcintr_get_stack() == NULL)
@@ -1339,20 +1513,7 @@ pcvdom_element_find_attr(struct pcvdom_element *element, const char *key)
         return NULL;
     }
 
-    struct pcutils_map *attrs = element->attrs;
-    if (!attrs)
-        return NULL;
-
-    pcutils_map_entry *entry;
-    entry = pcutils_map_find(attrs, key);
-    if (!entry)
-        return NULL;
-    PC_ASSERT(entry->val);
-
-    struct pcvdom_attr *attr;
-    attr = (struct pcvdom_attr*)entry->val;
-
-    return attr;
+    return element_find_attr(element, key);
 }
 
 purc_variant_t
@@ -1389,6 +1550,12 @@ pcvdom_element_is_silently(struct pcvdom_element *element)
         pcvdom_element_find_attr(element, SILENTLY_ATTR_FULL_NAME);
 }
 
+bool
+pcvdom_element_is_static_subtree(struct pcvdom_element *element)
+{
+    return element->static_subtree;
+}
+
 static purc_variant_t
 tokenwised_eval_attr_num(enum pchvml_attr_operator op,
         purc_variant_t ll, purc_variant_t rr)
@@ -117,6 +117,7 @@ static void print_usage(FILE *fp)
 
     fputs(
         "Usage: purc [ options ... ] [ file | url ] ... | [ app_desc_json | app_desc_ejson ]\n"
+        "       purc --compile [ -o bundle ] file ...\n"
         "\n"
         "The following options can be supplied to the command:\n"
         "\n"
@@ -154,6 +155,14 @@ static void print_usage(FILE *fp)
         "  -l --parallel\n"
         "        Execute multiple programs in parallel.\n"
         "\n"
+        "  -C --compile\n"
+        "        Compile the HVML program file(s) to precompiled bundle(s) instead of\n"
+        "        running them. The bundle of `app.hvml` is `app.hvmlc` by default;\n"
+        "        run a bundle like an HVML program: `purc app.hvmlc`.\n"
+        "\n"
+        "  -o --output=< bundle_file >\n"
+        "        The output file of `--compile`; only valid for a single program.\n"
+        "\n"
         "  -b --verbose\n"
         "        Execute the program(s) with verbose output.\n"
         "\n"
@@ -181,8 +190,11 @@ struct my_opts {
     pcutils_array_t *contents;
     char *app_info;
 
+    char *output;
+
     bool parallel;
     bool verbose;
+    bool compile;
 };
 
 static const char *archedata_header =
@@ -272,6 +284,9 @@ static void my_opts_delete(struct my_opts *opts, bool deep)
     if (opts->request)
         free(opts->request);
 
+    if (opts->output)
+        free(opts->output);
+
     if (opts->app_info)
         free(opts->app_info);
 
@@ -361,7 +376,7 @@ static bool validate_url(struct my_opts *opts, const char *url)
 
 static int read_option_args(struct my_opts *opts, int argc, char **argv)
 {
-    static const char short_options[] = "a:r:d:p:u:t:lbcvh";
+    static const char short_options[] = "a:r:d:p:u:t:lCo:bcvh";
     static const struct option long_opts[] = {
         { "app"            , required_argument , NULL , 'a' },
         { "runner"         , required_argument , NULL , 'r' },
@@ -370,6 +385,8 @@ static int read_option_args(struct my_opts *opts, int argc, char **argv)
         { "rdr-uri"        , required_argument , NULL , 'u' },
         { "request"        , required_argument , NULL , 't' },
         { "parallel"       , no_argument       , NULL , 'l' },
+        { "compile"        , no_argument       , NULL , 'C' },
+        { "output"         , required_argument , NULL , 'o' },
         { "verbose"        , no_argument       , NULL , 'b' },
         { "copying"        , no_argument       , NULL , 'c' },
         { "version"        , no_argument       , NULL , 'v' },
@@ -471,6 +488,16 @@ static int read_option_args(struct my_opts *opts, int argc, char **argv)
             opts->parallel = true;
             break;
 
+        case 'C':
+            opts->compile = true;
+            break;
+
+        case 'o':
+            if (opts->output)
+                free(opts->output);
+            opts->output = strdup(optarg);
+            break;
+
         case 'b':
             opts->verbose = true;
             break;
@@ -654,6 +681,12 @@ static bool evalute_app_info(const char *app_info)
 }
 
 
+static bool is_bundle_file(const char *file)
+{
+    const char *suffix = strrchr(file, '.');
+    return suffix && strcmp(suffix, PURC_HVML_BUNDLE_SUFFIX) == 0;
+}
+
 static purc_vdom_t load_hvml(const char *url)
 {
     struct purc_broken_down_url broken_down;
@@ -663,7 +696,10 @@ static purc_vdom_t load_hvml(const char *url)
 
     purc_vdom_t vdom;
     if (strcasecmp(broken_down.schema, "file") == 0) {
-        vdom = purc_load_hvml_from_file(broken_down.path);
+        if (is_bundle_file(broken_down.path))
+            vdom = purc_load_hvml_from_bundle(broken_down.path);
+        else
+            vdom = purc_load_hvml_from_file(broken_down.path);
     }
     else {
         vdom = purc_load_hvml_from_url(url);
@@ -1238,6 +1274,80 @@ run_programs_sequentially(struct my_opts *opts, purc_variant_t request)
     return nr_executed > 0;
 }
 
+static char *bundle_file_name(const char *file)
+{
+    const char *slash = strrchr(file, '/');
+    const char *suffix = strrchr(file, '.');
+    size_t len = strlen(file);
+
+    if (suffix && (slash == NULL || suffix > slash + 1))
+        len = suffix - file;
+
+    char *bundle = malloc(len + sizeof(PURC_HVML_BUNDLE_SUFFIX));
+    if (bundle) {
+        memcpy(bundle, file, len);
+        strcpy(bundle + len, PURC_HVML_BUNDLE_SUFFIX);
+    }
+
+    return bundle;
+}
+
+static bool compile_programs(struct my_opts *opts)
+{
+    if (opts->output && opts->urls->length > 1) {
+        fprintf(stderr, "Only one program can be compiled with --output\n");
+        return false;
+    }
+
+    size_t nr_compiled = 0;
+    for (size_t i = 0; i < opts->urls->length; i++) {
+        const char *url = opts->urls->list[i];
+        struct purc_broken_down_url broken_down;
+
+        memset(&broken_down, 0, sizeof(broken_down));
+        pcutils_url_break_down(&broken_down, url);
+        if (strcasecmp(broken_down.schema, "file")) {
+            fprintf(stderr, "Not a local file: %s\n", url);
+            pcutils_broken_down_url_clear(&broken_down);
+            continue;
+        }
+
+        const char *file = broken_down.path;
+        char *bundle = opts->output ? strdup(opts->output) :
+            bundle_file_name(file);
+
+        purc_vdom_t vdom = purc_load_hvml_from_file(file);
+        if (vdom == NULL) {
+            fprintf(stderr, "Failed to load HVML from %s: %s\n", file,
+                    purc_get_error_message(purc_get_last_error()));
+
+            struct purc_parse_error_info *parse_error = NULL;
+            purc_get_local_data(PURC_LDNAME_PARSE_ERROR,
+                    (uintptr_t *)(void *)&parse_error, NULL);
+            if (parse_error) {
+                fprintf(stderr,
+                        "Parse %s failed : line=%d, column=%d, character=0x%x\n",
+                        file, parse_error->line, parse_error->column,
+                        parse_error->character);
+            }
+        }
+        else if (!purc_compile_hvml_to_bundle(vdom, bundle)) {
+            fprintf(stderr, "Failed to write the bundle %s: %s\n", bundle,
+                    purc_get_error_message(purc_get_last_error()));
+        }
+        else {
+            if (opts->verbose)
+                fprintf(stdout, "Compiled %s to %s\n", file, bundle);
+            nr_compiled++;
+        }
+
+        free(bundle);
+        pcutils_broken_down_url_clear(&broken_down);
+    }
+
+    return nr_compiled == opts->urls->length;
+}
+
 int main(int argc, char** argv)
 {
     int ret;
@@ -1309,6 +1419,30 @@ int main(int argc, char** argv)
 
     extra_info.renderer_uri = opts->rdr_uri;
 
+    if (opts->compile) {
+        if (opts->app_info) {
+            fprintf(stderr, "Only HVML programs can be compiled\n");
+            my_opts_delete(opts, true);
+            return EXIT_FAILURE;
+        }
+
+        /* compiling needs no data fetcher */
+        ret = purc_init_ex(PURC_MODULE_HVML & ~PURC_HAVE_FETCHER,
+                opts->app ? opts->app : DEF_APP_NAME,
+                opts->run ? opts->run : DEF_RUN_NAME, &extra_info);
+        if (ret != PURC_ERROR_OK) {
+            fprintf(stderr, "Failed to initialize the PurC instance: %s\n",
+                purc_get_error_message(ret));
+            my_opts_delete(opts, true);
+            return EXIT_FAILURE;
+        }
+
+        success = compile_programs(opts);
+        my_opts_delete(opts, true);
+        purc_cleanup();
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     ret = purc_init_ex(modules, opts->app ? opts->app : DEF_APP_NAME,
             opts->run ? opts->run : DEF_RUN_NAME, &extra_info);
     if (ret != PURC_ERROR_OK) {
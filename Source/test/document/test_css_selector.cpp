@@ -0,0 +1,229 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/document.h"
+#include "private/css-selector.h"
+#include "private/dom.h"
+#include "tools.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <chrono>
+
+typedef doc_test css_selector;
+typedef doc_perf css_selector_perf;
+
+TEST_F(css_selector, select)
+{
+    const char *html =
+        "<html><body>"
+        "<div id='main' class='box'>"
+          "<ul lang='en-US'>"
+            "<li class='item first'>1</li>"
+            "<li class='item'><a href='https://a.com/x.pdf'>2</a></li>"
+            "<li class='item' data-x='Foo Bar'>3</li>"
+            "<li class='item last'></li>"
+          "</ul>"
+          "<p>a</p><span>b</span><p>c</p>"
+        "</div>"
+        "<div class='box other'><p></p></div>"
+        "</body></html>";
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    static const struct {
+        const char *selector;
+        size_t      nr_found;
+    } cases[] = {
+        { "li", 4 },
+        { "LI", 4 },
+        { "div li", 4 },
+        { "#main > ul > li", 4 },
+        { "body > li", 0 },
+        { ".box p", 3 },
+        { ".other p", 1 },
+        { "div.box.other", 1 },
+        { "li.item.first", 1 },
+        { "li:first-child", 1 },
+        { "li:last-child", 1 },
+        { "li:nth-child(2n+1)", 2 },
+        { "li:nth-child(odd)", 2 },
+        { "li:nth-child(even)", 2 },
+        { "li:nth-child(-n+3)", 3 },
+        { "li:nth-last-child(1)", 1 },
+        { "p:nth-of-type(2)", 1 },
+        { "p:first-of-type", 2 },
+        { "p:only-of-type", 1 },
+        { "p:only-child", 1 },
+        { "li:empty", 1 },
+        { "p:empty", 1 },
+        { "html:root", 1 },
+        { "div:root", 0 },
+        { "li:not(.first)", 3 },
+        { "li:not(.first):not(:last-child)", 2 },
+        { "[data-x]", 1 },
+        { "[data-x='Foo Bar']", 1 },
+        { "[data-x='foo bar']", 0 },
+        { "[data-x='foo bar' i]", 1 },
+        { "[data-x~=Bar]", 1 },
+        { "[lang|=en]", 1 },
+        { "a[href^='https:']", 1 },
+        { "a[href$='.pdf']", 1 },
+        { "a[href*='a.com']", 1 },
+        { "ul + p", 1 },
+        { "ul ~ p", 2 },
+        { "span + p", 1 },
+        { "li.first ~ li", 3 },
+        { "#main, .other", 2 },
+        { "p, li, p", 7 },
+        { "*", 15 },
+        { ".box > *", 5 },
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(cases); i++) {
+        pcdoc_elem_coll_t coll = pcdoc_elem_coll_new_from_document(doc,
+                cases[i].selector);
+        ASSERT_NE(coll, nullptr) << cases[i].selector;
+        ASSERT_EQ(pcutils_arrlist_length(coll->elems), cases[i].nr_found)
+            << cases[i].selector;
+        pcdoc_elem_coll_delete(doc, coll);
+    }
+
+    /* the results are in document order */
+    pcdoc_elem_coll_t coll = pcdoc_elem_coll_new_from_document(doc,
+            "p, ul");
+    ASSERT_NE(coll, nullptr);
+    ASSERT_EQ(pcutils_arrlist_length(coll->elems), 4u);
+    pcdom_element_t *elem;
+    elem = (pcdom_element_t *)pcutils_arrlist_get_idx(coll->elems, 0);
+    size_t len;
+    const unsigned char *tag = pcdom_element_local_name(elem, &len);
+    ASSERT_EQ(len, 2u);
+    ASSERT_EQ(strncmp((const char *)tag, "ul", len), 0);
+
+    /* select in a collection */
+    pcdoc_elem_coll_t sub = pcdoc_elem_coll_select(doc, coll, "#main > p");
+    ASSERT_NE(sub, nullptr);
+    ASSERT_EQ(pcutils_arrlist_length(sub->elems), 2u);
+    pcdoc_elem_coll_delete(doc, sub);
+    pcdoc_elem_coll_delete(doc, coll);
+
+    /* the scope includes the element itself and the combinators may
+       reach the elements out of the scope */
+    pcdoc_element_t main = pcdoc_find_element_in_document(doc, "#main");
+    ASSERT_NE(main, nullptr);
+    ASSERT_EQ(pcdoc_find_element_in_descendants(doc, main, "div"), main);
+    coll = pcdoc_elem_coll_new_from_descendants(doc, main, "body li");
+    ASSERT_NE(coll, nullptr);
+    ASSERT_EQ(pcutils_arrlist_length(coll->elems), 4u);
+    pcdoc_elem_coll_delete(doc, coll);
+
+    /* bad and unsupported selectors */
+    static const char *bad_selectors[] = {
+        "", "li >", "> li", "li,", "[x", "[x=]", ":nth-child(x)", "a..b",
+    };
+    for (size_t i = 0; i < PCA_TABLESIZE(bad_selectors); i++) {
+        ASSERT_EQ(pcdoc_elem_coll_new_from_document(doc, bad_selectors[i]),
+                nullptr) << bad_selectors[i];
+        ASSERT_EQ(purc_get_last_error(), PURC_ERROR_INVALID_VALUE)
+            << bad_selectors[i];
+    }
+    ASSERT_EQ(pcdoc_elem_coll_new_from_document(doc, "a:hover"), nullptr);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_NOT_SUPPORTED);
+    ASSERT_EQ(pcdoc_elem_coll_new_from_document(doc, "p::before"), nullptr);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_NOT_SUPPORTED);
+
+    purc_document_delete(doc);
+}
+
+struct walk_args {
+    struct pcdoc_selector  *sel;
+    size_t                  nr_found;
+};
+
+static int
+match_walked_element(purc_document_t doc, pcdoc_element_t element, void *ud)
+{
+    (void)doc;
+    struct walk_args *args = (struct walk_args *)ud;
+    if (pcdoc_selector_match(args->sel, (pcdom_element_t *)element))
+        args->nr_found++;
+    return 0;
+}
+
+#define NR_SELECTOR_SECTIONS    200
+
+TEST_F(css_selector_perf, select)
+{
+    purc_document_t doc = purc_document_new(PCDOC_K_TYPE_HTML);
+    ASSERT_NE(doc, nullptr);
+
+    pcdoc_element_t body = purc_document_special_elem(doc,
+            PCDOC_SPECIAL_ELEM_BODY);
+    ASSERT_NE(body, nullptr);
+
+    char buf[256];
+    for (int i = 0; i < NR_SELECTOR_SECTIONS; i++) {
+        snprintf(buf, sizeof(buf),
+                "<section class='%s'><div><ul>"
+                "<li>a</li><li class='hit'>b</li><li>c</li>"
+                "</ul><p>text</p></div></section>",
+                (i % 10) ? "plain" : "target");
+        pcdoc_element_new_content(doc, body, PCDOC_OP_APPEND, buf, 0);
+    }
+
+    const char *selector = "section.target li";
+    size_t nr_expected = NR_SELECTOR_SECTIONS / 10 * 3;
+
+    /* walk every element and match it from scratch */
+    size_t nr_walked = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        struct walk_args args = { pcdoc_selector_new(selector), 0 };
+        ASSERT_NE(args.sel, nullptr);
+        pcdoc_travel_descendant_elements(doc, NULL,
+                match_walked_element, &args, NULL);
+        pcdoc_selector_delete(args.sel);
+        nr_walked += args.nr_found;
+    }
+    auto walked = std::chrono::steady_clock::now() - start;
+
+    /* the cached compiled selector with the ancestor filter */
+    size_t nr_selected = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        nr_selected += count_elements(doc, NULL, selector);
+    }
+    auto selected = std::chrono::steady_clock::now() - start;
+
+    long long walked_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(walked).count();
+    long long selected_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(selected).count();
+
+    fprintf(stderr, "%zu queries of `%s`\n", nr_loops, selector);
+    fprintf(stderr, "full walk: %10lld us\n", walked_us);
+    fprintf(stderr, "compiled:  %10lld us\n", selected_us);
+
+    ASSERT_EQ(nr_walked, nr_loops * nr_expected);
+    ASSERT_EQ(nr_selected, nr_loops * nr_expected);
+
+    purc_document_delete(doc);
+}
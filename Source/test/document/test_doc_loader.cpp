@@ -0,0 +1,93 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/document.h"
+#include "tools.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+typedef doc_test doc_loader;
+
+static std::string
+chunky_page(void)
+{
+    /* the tokens of every kind to be split by the chunks */
+    std::string html = "<!DOCTYPE html><html><head><title>A &amp; B</title>"
+        "<script>if (a < b && c > d) document.write('</p>');</script>"
+        "<style>p > a { color: red; }</style></head><body>"
+        "<!-- a comment -- with dashes -->"
+        "<textarea id='t'>a <b>raw</b> &lt;text&gt;</textarea>";
+    html += cards_page(20);
+    html += "<p title=\"x &quot;y&quot; &#x263A; &nbsp;z\">"
+        "\xe4\xb8\xad\xe6\x96\x87 &unknown; text</p></body></html>";
+    return html;
+}
+
+/* loading in chunks of any size builds the same document as loading the
+   whole content at once */
+TEST_F(doc_loader, chunks)
+{
+    auto serialized = [](purc_document_t doc) {
+        return stream_to_string([&](purc_rwstream_t out) {
+            purc_document_serialize_contents_to_stream(doc,
+                    PCDOC_SERIALIZE_OPT_UNDEF, out);
+        });
+    };
+
+    struct purc_document_ops *ops = &_pcdoc_html_ops;
+    std::string html = chunky_page();
+    purc_document_t ref = purc_document_load(PCDOC_K_TYPE_HTML,
+            html.c_str(), html.size());
+    ASSERT_NE(ref, nullptr);
+    std::string expected = serialized(ref);
+    purc_document_delete(ref);
+
+    const size_t chunk_sizes[] = { 1, 2, 3, 7, 64, 1000, 4096, 1 << 20 };
+    for (size_t chunk_size : chunk_sizes) {
+        purc_document_t doc = ops->load_begin();
+        ASSERT_NE(doc, nullptr);
+
+        for (size_t pos = 0; pos < html.size(); pos += chunk_size) {
+            /* the chunk is gone once loaded */
+            std::string chunk = html.substr(pos, chunk_size);
+            ASSERT_EQ(ops->load_chunk(doc, chunk.c_str(), chunk.size()), 0);
+        }
+
+        ASSERT_EQ(ops->load_end(doc), 0);
+        ASSERT_EQ(serialized(doc),
+                expected) << "chunks of " << chunk_size << " bytes";
+        ASSERT_NE(pcdoc_find_element_in_document(doc, "#card-19"), nullptr);
+        purc_document_delete(doc);
+    }
+
+    /* nothing loaded */
+    purc_document_t doc = ops->load_begin();
+    ASSERT_NE(doc, nullptr);
+    ASSERT_EQ(ops->load_end(doc), 0);
+    ASSERT_NE(purc_document_body(doc), nullptr);
+    purc_document_delete(doc);
+
+    /* given up */
+    doc = ops->load_begin();
+    ASSERT_NE(doc, nullptr);
+    ASSERT_EQ(ops->load_chunk(doc, html.c_str(), 100), 0);
+    purc_document_delete(doc);
+}
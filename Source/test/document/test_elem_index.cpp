@@ -0,0 +1,158 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/document.h"
+#include "tools.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <chrono>
+
+typedef doc_test elem_index;
+typedef doc_perf elem_index_perf;
+
+TEST_F(elem_index, update)
+{
+    const char *html =
+        "<html><body>"
+        "<div id='a' class='x y'><p class='y'>1</p><p id='b'>2</p></div>"
+        "<div id='c' class=' y\tz '></div>"
+        "</body></html>";
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    pcdoc_element_t a = pcdoc_find_element_in_document(doc, "#a");
+    ASSERT_NE(a, nullptr);
+    ASSERT_EQ(pcdoc_find_element_in_document(doc, "#nonexistent"), nullptr);
+    ASSERT_EQ(count_elements(doc, NULL, ".y"), 3u);
+    ASSERT_EQ(count_elements(doc, NULL, ".z"), 1u);
+
+    /* the results are in document order */
+    pcdoc_elem_coll_t coll = pcdoc_elem_coll_new_from_document(doc, ".y");
+    ASSERT_NE(coll, nullptr);
+    ASSERT_EQ(pcutils_arrlist_get_idx(coll->elems, 0), a);
+    ASSERT_EQ(pcutils_arrlist_get_idx(coll->elems, 2),
+            pcdoc_find_element_in_document(doc, "#c"));
+    pcdoc_elem_coll_delete(doc, coll);
+
+    /* the scope includes the element itself */
+    coll = pcdoc_elem_coll_new_from_descendants(doc, a, ".y");
+    ASSERT_NE(coll, nullptr);
+    ASSERT_EQ(pcutils_arrlist_length(coll->elems), 2u);
+    pcdoc_elem_coll_delete(doc, coll);
+
+    /* changes of the attributes */
+    pcdoc_element_t b = pcdoc_find_element_in_document(doc, "#b");
+    ASSERT_NE(b, nullptr);
+    int ret = pcdoc_element_set_attribute(doc, b, PCDOC_OP_DISPLACE,
+            "id", "d", 0);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(pcdoc_find_element_in_document(doc, "#b"), nullptr);
+    ASSERT_EQ(pcdoc_find_element_in_document(doc, "#d"), b);
+    ret = pcdoc_element_set_attribute(doc, b, PCDOC_OP_DISPLACE,
+            "class", "y z", 0);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(count_elements(doc, NULL, ".y"), 4u);
+    ASSERT_EQ(count_elements(doc, NULL, ".z"), 2u);
+
+    /* new content */
+    pcdoc_element_new_content(doc, b, PCDOC_OP_APPEND,
+            "<span id='e' class='z'></span>", 0);
+    ASSERT_NE(pcdoc_find_element_in_document(doc, "#e"), nullptr);
+    ASSERT_EQ(count_elements(doc, NULL, ".z"), 3u);
+
+    /* removal of elements */
+    pcdoc_element_clear(doc, b);
+    ASSERT_EQ(pcdoc_find_element_in_document(doc, "#e"), nullptr);
+    ASSERT_EQ(count_elements(doc, NULL, ".z"), 2u);
+    pcdoc_element_erase(doc, a);
+    ASSERT_EQ(pcdoc_find_element_in_document(doc, "#a"), nullptr);
+    ASSERT_EQ(pcdoc_find_element_in_document(doc, "#d"), nullptr);
+    ASSERT_EQ(count_elements(doc, NULL, ".y"), 1u);
+
+    /* a repeated class token matches the element once */
+    pcdoc_element_t c = pcdoc_find_element_in_document(doc, "#c");
+    ASSERT_NE(c, nullptr);
+    ret = pcdoc_element_set_attribute(doc, c, PCDOC_OP_DISPLACE,
+            "class", "w z w", 0);
+    ASSERT_EQ(ret, 0);
+    pcdoc_element_new_content(doc, c, PCDOC_OP_APPEND,
+            "<span class='w w'></span>", 0);
+    ASSERT_EQ(count_elements(doc, NULL, ".w"), 2u);
+    pcdoc_element_clear(doc, c);
+    ASSERT_EQ(count_elements(doc, NULL, ".w"), 1u);
+    ret = pcdoc_element_set_attribute(doc, c, PCDOC_OP_DISPLACE,
+            "class", "z", 0);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(count_elements(doc, NULL, ".w"), 0u);
+
+    purc_document_delete(doc);
+}
+
+#define NR_INDEXED_ELEMS    2000
+
+TEST_F(elem_index_perf, lookup)
+{
+    purc_document_t doc = purc_document_new(PCDOC_K_TYPE_HTML);
+    ASSERT_NE(doc, nullptr);
+
+    pcdoc_element_t body = purc_document_special_elem(doc,
+            PCDOC_SPECIAL_ELEM_BODY);
+    ASSERT_NE(body, nullptr);
+
+    char buf[64];
+    for (int i = 0; i < NR_INDEXED_ELEMS; i++) {
+        snprintf(buf, sizeof(buf),
+                "<div id='item-%d' class='item c%d'></div>", i, i % 10);
+        pcdoc_element_new_content(doc, body, PCDOC_OP_APPEND, buf, 0);
+    }
+
+    size_t nr_found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        for (int i = 0; i < NR_INDEXED_ELEMS; i++) {
+            snprintf(buf, sizeof(buf), "#item-%d", i);
+            if (pcdoc_find_element_in_document(doc, buf))
+                nr_found++;
+        }
+    }
+    auto by_id = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        nr_found += count_elements(doc, NULL, ".c3");
+    }
+    auto by_class = std::chrono::steady_clock::now() - start;
+
+    long long by_id_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(by_id).count();
+    long long by_class_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(by_class).count();
+
+    fprintf(stderr, "%d elements\n", NR_INDEXED_ELEMS);
+    fprintf(stderr, "by id:    %10zu queries, %10lld us\n",
+            nr_loops * NR_INDEXED_ELEMS, by_id_us);
+    fprintf(stderr, "by class: %10zu queries, %10lld us\n",
+            nr_loops, by_class_us);
+
+    ASSERT_EQ(nr_found, nr_loops * (NR_INDEXED_ELEMS + NR_INDEXED_ELEMS / 10));
+
+    purc_document_delete(doc);
+}
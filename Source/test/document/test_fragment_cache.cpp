@@ -0,0 +1,165 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/document.h"
+#include "tools.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+typedef doc_test fragment_cache;
+typedef doc_perf fragment_cache_perf;
+
+/* the repeated fragments are cloned from the prebuilt subtrees */
+TEST_F(fragment_cache, clone)
+{
+    const char *html = "<html><body><ul id='list'></ul>"
+        "<textarea id='text'></textarea></body></html>";
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html, strlen(html));
+    purc_document_t ref = purc_document_load(PCDOC_K_TYPE_HTML,
+            html, strlen(html));
+    ASSERT_NE(doc, nullptr);
+    ASSERT_NE(ref, nullptr);
+
+    pcdoc_element_t ul = pcdoc_find_element_in_document(doc, "#list");
+    pcdoc_element_t textarea = pcdoc_find_element_in_document(doc, "#text");
+    ASSERT_NE(ul, nullptr);
+    ASSERT_NE(textarea, nullptr);
+
+    struct purc_fragment_cache_stats before, after;
+    ASSERT_TRUE(purc_get_fragment_cache_stats(&before));
+
+    std::string fragment = "<li id='item' class='a b' title='&lt;x&gt;'>"
+        "one <b>two</b><!-- three --><custom-tag x-attr='y'>four</custom-tag>"
+        "</li>";
+    for (int i = 0; i < 5; i++) {
+        pcdoc_element_new_content(doc, ul, PCDOC_OP_APPEND,
+                fragment.c_str(), fragment.size());
+    }
+
+    /* seen once, parsed and prebuilt, then cloned three times */
+    ASSERT_TRUE(purc_get_fragment_cache_stats(&after));
+    ASSERT_EQ(after.nr_misses - before.nr_misses, 2u);
+    ASSERT_EQ(after.nr_stored - before.nr_stored, 1u);
+    ASSERT_EQ(after.nr_hits - before.nr_hits, 3u);
+
+    /* the same as the markup parsed at once */
+    std::string all;
+    for (int i = 0; i < 5; i++)
+        all += fragment;
+    pcdoc_element_t ref_ul = pcdoc_find_element_in_document(ref, "#list");
+    pcdoc_element_new_content(ref, ref_ul, PCDOC_OP_APPEND,
+            all.c_str(), all.size());
+    ASSERT_EQ(stream_to_string([&](purc_rwstream_t out) {
+                pcdoc_serialize_descendants_to_stream(doc, ul,
+                    PCDOC_SERIALIZE_OPT_UNDEF, out);
+            }),
+            stream_to_string([&](purc_rwstream_t out) {
+                pcdoc_serialize_descendants_to_stream(ref, ref_ul,
+                    PCDOC_SERIALIZE_OPT_UNDEF, out);
+            }));
+
+    /* the clones do not share anything with the prebuilt subtree */
+    pcdoc_element_t li = pcdoc_find_element_in_document(doc, "li.a");
+    ASSERT_NE(li, nullptr);
+    pcdoc_element_set_attribute(doc, li, PCDOC_OP_DISPLACE, "class", "z", 0);
+    pcdoc_element_new_content(doc, ul, PCDOC_OP_APPEND,
+            fragment.c_str(), fragment.size());
+    ASSERT_EQ(count_elements(doc, ul, "li.a"), 5u);
+    ASSERT_EQ(count_elements(doc, ul, "li.z"), 1u);
+    ASSERT_EQ(count_elements(doc, ul, "#item"), 6u);
+    ASSERT_EQ(count_elements(doc, ul, "custom-tag[x-attr=y]"), 6u);
+
+    /* the context element is a part of the key: no element is created
+       for the markup in a textarea */
+    const char *bold = "<b>1</b>";
+    for (int i = 0; i < 3; i++)
+        pcdoc_element_new_content(doc, textarea, PCDOC_OP_APPEND, bold, 0);
+    for (int i = 0; i < 3; i++)
+        pcdoc_element_new_content(doc, ul, PCDOC_OP_APPEND, bold, 0);
+    ASSERT_EQ(count_elements(doc, textarea, "b"), 0u);
+    ASSERT_EQ(count_elements(doc, ul, "ul > b"), 3u);
+
+    purc_document_delete(ref);
+    purc_document_delete(doc);
+}
+
+TEST_F(fragment_cache_perf, update)
+{
+    nr_loops *= 100;
+
+    const char *html = "<html><body><div id='box'></div></body></html>";
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html, strlen(html));
+    ASSERT_NE(doc, nullptr);
+    pcdoc_element_t box = pcdoc_find_element_in_document(doc, "#box");
+    ASSERT_NE(box, nullptr);
+
+    /* a rendered template of about a hundred nodes */
+    std::string fragment;
+    for (int i = 0; i < 10; i++) {
+        fragment += "<div class='card'><h2 class='title'>Title "
+            + std::to_string(i) + "</h2><p class='desc'>The description "
+            "of the card &amp; more</p><ul><li>a</li><li>b</li><li>c</li>"
+            "</ul><a href='/cards/" + std::to_string(i) + "'>more</a></div>";
+    }
+
+    /* the fragments differing in a comment are parsed every time */
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        std::string unique = fragment + "<!--" + std::to_string(n) + "-->";
+        pcdoc_element_new_content(doc, box, PCDOC_OP_DISPLACE,
+                unique.c_str(), unique.size());
+    }
+    auto parsed = std::chrono::steady_clock::now() - start;
+
+    struct purc_fragment_cache_stats before, after;
+    ASSERT_TRUE(purc_get_fragment_cache_stats(&before));
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        pcdoc_element_new_content(doc, box, PCDOC_OP_DISPLACE,
+                fragment.c_str(), fragment.size());
+    }
+    auto cloned = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(purc_get_fragment_cache_stats(&after));
+
+    double parsed_us = std::chrono::duration<double, std::micro>(
+            parsed).count() / nr_loops;
+    double cloned_us = std::chrono::duration<double, std::micro>(
+            cloned).count() / nr_loops;
+
+    fprintf(stderr, "%zu insertions of %zu bytes\n", nr_loops,
+            fragment.size());
+    fprintf(stderr, "parsed: %10.2f us per fragment\n", parsed_us);
+    fprintf(stderr, "cloned: %10.2f us per fragment\n", cloned_us);
+    fprintf(stderr, "hits: %llu, misses: %llu\n",
+            (unsigned long long)(after.nr_hits - before.nr_hits),
+            (unsigned long long)(after.nr_misses - before.nr_misses));
+
+    ASSERT_EQ(after.nr_hits - before.nr_hits, nr_loops - 2);
+    ASSERT_EQ(count_elements(doc, box, "div.card"), 10u);
+
+    purc_document_delete(doc);
+}
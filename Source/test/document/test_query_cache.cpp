@@ -0,0 +1,171 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/document.h"
+#include "private/dvobjs.h"
+#include "tools.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <chrono>
+
+typedef doc_test query_cache;
+typedef doc_perf query_cache_perf;
+
+/* the number of the elements in the result of a query */
+static size_t
+count_elements(purc_variant_t elements)
+{
+    size_t n = 0;
+    while (pcdvobjs_get_element_from_elements(elements, n))
+        n++;
+    return n;
+}
+
+TEST_F(query_cache, invalidate)
+{
+    const char *html =
+        "<html><body>"
+        "<div id='a' class='y'><p class='y'>1</p><p id='b'></p></div>"
+        "</body></html>";
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    /* the repeated queries share the result */
+    purc_variant_t ys = pcdvobjs_elements_by_css(doc, ".y");
+    ASSERT_NE(ys, PURC_VARIANT_INVALID);
+    ASSERT_EQ(count_elements(ys), 2u);
+    purc_variant_t other = pcdvobjs_elements_by_css(doc, ".y");
+    ASSERT_EQ(other, ys);
+    purc_variant_unref(other);
+
+    purc_variant_t empties = pcdvobjs_elements_by_css(doc, "p:empty");
+    ASSERT_NE(empties, PURC_VARIANT_INVALID);
+    ASSERT_EQ(count_elements(empties), 1u);
+    purc_variant_t titled = pcdvobjs_elements_by_css(doc, "[title]");
+    ASSERT_NE(titled, PURC_VARIANT_INVALID);
+    ASSERT_EQ(count_elements(titled), 0u);
+
+    /* an attribute change only invalidates the results depending on it */
+    pcdoc_element_t b = pcdoc_find_element_in_document(doc, "#b");
+    ASSERT_NE(b, nullptr);
+    int ret = pcdoc_element_set_attribute(doc, b, PCDOC_OP_DISPLACE,
+            "title", "t", 0);
+    ASSERT_EQ(ret, 0);
+    other = pcdvobjs_elements_by_css(doc, ".y");
+    ASSERT_EQ(other, ys);
+    purc_variant_unref(other);
+    other = pcdvobjs_elements_by_css(doc, "[title]");
+    ASSERT_NE(other, titled);
+    ASSERT_EQ(count_elements(other), 1u);
+    purc_variant_unref(other);
+    purc_variant_unref(titled);
+
+    /* a text change only invalidates the results depending on the text */
+    pcdoc_element_new_text_content(doc, b, PCDOC_OP_APPEND, "2", 0);
+    other = pcdvobjs_elements_by_css(doc, ".y");
+    ASSERT_EQ(other, ys);
+    purc_variant_unref(other);
+    other = pcdvobjs_elements_by_css(doc, "p:empty");
+    ASSERT_NE(other, empties);
+    ASSERT_EQ(count_elements(other), 0u);
+    purc_variant_unref(other);
+    purc_variant_unref(empties);
+
+    /* a class change */
+    ret = pcdoc_element_set_attribute(doc, b, PCDOC_OP_DISPLACE,
+            "class", "y", 0);
+    ASSERT_EQ(ret, 0);
+    other = pcdvobjs_elements_by_css(doc, ".y");
+    ASSERT_NE(other, ys);
+    ASSERT_EQ(count_elements(other), 3u);
+    purc_variant_unref(ys);
+    ys = other;
+
+    /* a structure change invalidates all results */
+    pcdoc_element_erase(doc, b);
+    other = pcdvobjs_elements_by_css(doc, ".y");
+    ASSERT_NE(other, ys);
+    ASSERT_EQ(count_elements(other), 2u);
+    purc_variant_unref(other);
+    purc_variant_unref(ys);
+
+    purc_document_delete(doc);
+}
+
+#define NR_INDEXED_ELEMS    2000
+
+TEST_F(query_cache_perf, query)
+{
+    purc_document_t doc = purc_document_new(PCDOC_K_TYPE_HTML);
+    ASSERT_NE(doc, nullptr);
+
+    pcdoc_element_t body = purc_document_special_elem(doc,
+            PCDOC_SPECIAL_ELEM_BODY);
+    ASSERT_NE(body, nullptr);
+
+    char buf[64];
+    for (int i = 0; i < NR_INDEXED_ELEMS; i++) {
+        snprintf(buf, sizeof(buf),
+                "<div id='item-%d' class='item c%d'></div>", i, i % 10);
+        pcdoc_element_new_content(doc, body, PCDOC_OP_APPEND, buf, 0);
+    }
+
+    const char *selector = "div.c3";
+    pcdoc_element_t first = pcdoc_find_element_in_document(doc, "#item-0");
+    ASSERT_NE(first, nullptr);
+
+    /* select the elements on every query */
+    size_t nr_selected = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        nr_selected += count_elements(doc, NULL, selector);
+    }
+    auto selected = std::chrono::steady_clock::now() - start;
+
+    /* the cached results, with the changes of an unrelated attribute
+       between the queries */
+    size_t nr_cached = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        pcdoc_element_set_attribute(doc, first, PCDOC_OP_DISPLACE,
+                "title", "t", 0);
+        purc_variant_t elements = pcdvobjs_elements_by_css(doc, selector);
+        ASSERT_NE(elements, PURC_VARIANT_INVALID);
+        nr_cached += count_elements(elements);
+        purc_variant_unref(elements);
+    }
+    auto cached = std::chrono::steady_clock::now() - start;
+
+    long long selected_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(selected).count();
+    long long cached_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(cached).count();
+
+    fprintf(stderr, "%zu queries of `%s` in %d elements\n",
+            nr_loops, selector, NR_INDEXED_ELEMS);
+    fprintf(stderr, "selected: %10lld us\n", selected_us);
+    fprintf(stderr, "cached:   %10lld us\n", cached_us);
+
+    ASSERT_EQ(nr_selected, nr_loops * NR_INDEXED_ELEMS / 10);
+    ASSERT_EQ(nr_cached, nr_loops * NR_INDEXED_ELEMS / 10);
+
+    purc_document_delete(doc);
+}
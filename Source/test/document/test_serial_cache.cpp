@@ -0,0 +1,201 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/document.h"
+#include "private/dom.h"
+#include "private/html.h"
+#include "tools.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+typedef doc_test serial_cache;
+typedef doc_perf serial_cache_perf;
+
+/* the cached bytes are the same as the ones serialized from scratch after
+   every kind of change */
+TEST_F(serial_cache, update)
+{
+    std::string html = cards_page(20);
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html.c_str(), html.size());
+    ASSERT_NE(doc, nullptr);
+
+    pcdom_node_t *dom_doc = pcdom_interface_node(doc->impl);
+    const unsigned all_opts[] = {
+        PCDOC_SERIALIZE_OPT_UNDEF,
+        PCDOC_SERIALIZE_OPT_SKIP_WS_NODES | PCDOC_SERIALIZE_OPT_SKIP_COMMENT,
+        PCDOC_SERIALIZE_OPT_WITH_HVML_HANDLE,
+    };
+
+    auto serialized = [&](unsigned opts) {
+        return stream_to_string([&](purc_rwstream_t out) {
+            purc_document_serialize_contents_to_stream(doc, opts, out);
+        });
+    };
+
+    /* by walking the whole tree, bypassing the serial cache */
+    auto walked = [&](pcdom_node_t *node, unsigned opts) {
+        return stream_to_string([&](purc_rwstream_t out) {
+            pcdom_node_write_to_stream_ex(node,
+                    (enum pchtml_html_serialize_opt)opts, out);
+        });
+    };
+
+    auto check = [&](const char *what) {
+        for (unsigned opts : all_opts) {
+            std::string expected = walked(dom_doc, opts);
+            /* the second time from the cache */
+            ASSERT_EQ(serialized(opts), expected) << what;
+            ASSERT_EQ(serialized(opts), expected) << what;
+        }
+
+        /* an element serialized at another indent than in the document */
+        pcdoc_element_t cards = pcdoc_find_element_in_document(doc, "#cards");
+        std::string element = stream_to_string([&](purc_rwstream_t out) {
+            pcdoc_serialize_descendants_to_stream(doc, cards,
+                    PCDOC_SERIALIZE_OPT_UNDEF, out);
+        });
+        ASSERT_EQ(element, walked(pcdom_interface_node(cards),
+                    PCDOC_SERIALIZE_OPT_UNDEF)) << what;
+        ASSERT_EQ(serialized(PCDOC_SERIALIZE_OPT_UNDEF),
+                walked(dom_doc, PCDOC_SERIALIZE_OPT_UNDEF)) << what;
+    };
+
+    check("loaded");
+
+    pcdoc_element_t elem;
+    elem = pcdoc_find_element_in_document(doc, "#card-3 .desc");
+    pcdoc_element_set_attribute(doc, elem, PCDOC_OP_DISPLACE,
+            "class", "changed", 0);
+    check("attribute changed");
+
+    elem = pcdoc_find_element_in_document(doc, "#card-4 ul");
+    pcdoc_element_new_element(doc, elem, PCDOC_OP_APPEND, "li", false);
+    check("element appended");
+
+    elem = pcdoc_find_element_in_document(doc, "#card-5 h2");
+    pcdoc_element_new_text_content(doc, elem, PCDOC_OP_DISPLACE,
+            "New title", 0);
+    check("text displaced");
+
+    elem = pcdoc_find_element_in_document(doc, "#card-6");
+    pcdoc_element_new_content(doc, elem, PCDOC_OP_INSERTBEFORE,
+            "<div class='card'>inserted</div>", 0);
+    check("content inserted before");
+
+    elem = pcdoc_find_element_in_document(doc, "#card-7");
+    pcdoc_element_new_content(doc, elem, PCDOC_OP_INSERTAFTER,
+            "<div class='card'>inserted</div>", 0);
+    check("content inserted after");
+
+    /* the nodes of the erased elements are reused by the new ones */
+    for (int i = 8; i < 12; i++) {
+        std::string sel = "#card-" + std::to_string(i);
+        elem = pcdoc_find_element_in_document(doc, sel.c_str());
+        pcdoc_element_erase(doc, elem);
+    }
+    check("elements erased");
+
+    elem = pcdoc_find_element_in_document(doc, "#card-12");
+    pcdoc_element_new_content(doc, elem, PCDOC_OP_DISPLACE,
+            "<p>displaced</p>", 0);
+    check("content displaced");
+
+    elem = pcdoc_find_element_in_document(doc, "#card-13");
+    pcdoc_element_clear(doc, elem);
+    check("element cleared");
+
+    elem = pcdoc_find_element_in_document(doc, "#card-14 a");
+    pcdoc_element_remove_attribute(doc, elem, "href");
+    check("attribute removed");
+
+    std::string more = cards_page(3);
+    elem = pcdoc_find_element_in_document(doc, "#footer");
+    pcdoc_element_new_content(doc, elem, PCDOC_OP_APPEND,
+            more.c_str(), more.size());
+    check("content appended");
+
+    purc_document_delete(doc);
+}
+
+#define NR_SERIAL_CARDS     2000
+
+TEST_F(serial_cache_perf, update)
+{
+    std::string html = cards_page(NR_SERIAL_CARDS);
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html.c_str(), html.size());
+    ASSERT_NE(doc, nullptr);
+    pcdom_node_t *dom_doc = pcdom_interface_node(doc->impl);
+
+    std::vector<pcdoc_element_t> titles;
+    for (int i = 0; i < NR_SERIAL_CARDS; i += NR_SERIAL_CARDS / 10) {
+        std::string sel = "#card-" + std::to_string(i) + " h2";
+        titles.push_back(pcdoc_find_element_in_document(doc, sel.c_str()));
+    }
+
+    /* a small change before every serialization */
+    size_t nr_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        pcdoc_element_t title = titles[n % titles.size()];
+        pcdoc_element_new_text_content(doc, title, PCDOC_OP_DISPLACE,
+                std::to_string(n).c_str(), 0);
+        nr_bytes += stream_to_string([&](purc_rwstream_t out) {
+            pcdom_node_write_to_stream_ex(dom_doc,
+                    PCHTML_HTML_SERIALIZE_OPT_UNDEF, out);
+        }).size();
+    }
+    auto walked = std::chrono::steady_clock::now() - start;
+
+    std::string expected;
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        pcdoc_element_t title = titles[n % titles.size()];
+        pcdoc_element_new_text_content(doc, title, PCDOC_OP_DISPLACE,
+                std::to_string(n).c_str(), 0);
+        expected = stream_to_string([&](purc_rwstream_t out) {
+            purc_document_serialize_contents_to_stream(doc,
+                    PCDOC_SERIALIZE_OPT_UNDEF, out);
+        });
+    }
+    auto cached = std::chrono::steady_clock::now() - start;
+
+    double walked_ms = std::chrono::duration<double, std::milli>(
+            walked).count() / nr_loops;
+    double cached_ms = std::chrono::duration<double, std::milli>(
+            cached).count() / nr_loops;
+
+    fprintf(stderr, "%zu serializations of %zu bytes\n", nr_loops,
+            nr_bytes / nr_loops);
+    fprintf(stderr, "walked: %10.3f ms per document\n", walked_ms);
+    fprintf(stderr, "cached: %10.3f ms per document\n", cached_ms);
+
+    ASSERT_EQ(expected, stream_to_string([&](purc_rwstream_t out) {
+                pcdom_node_write_to_stream_ex(dom_doc,
+                    PCHTML_HTML_SERIALIZE_OPT_UNDEF, out);
+            }));
+
+    purc_document_delete(doc);
+}
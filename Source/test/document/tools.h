@@ -0,0 +1,111 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PURC_TEST_DOCUMENT_TOOLS_H
+#define PURC_TEST_DOCUMENT_TOOLS_H
+
+#include "purc.h"
+#include "private/document.h"
+
+#include <stdlib.h>
+#include <functional>
+#include <string>
+
+#include <gtest/gtest.h>
+
+/* the instance for the tests of the documents */
+class doc_test : public testing::Test
+{
+protected:
+    void SetUp() {
+        purc_instance_extra_info info = {};
+        int ret = purc_init_ex(PURC_MODULE_HTML | PURC_MODULE_VARIANT,
+                "cn.fmsoft.hybridos.test", "document", &info);
+        ASSERT_EQ(ret, PURC_ERROR_OK);
+    }
+    void TearDown() {
+        purc_cleanup();
+    }
+};
+
+/* the perf tests are skipped unless the number of loops is given by the
+   environment variable LOOPS */
+class doc_perf : public doc_test
+{
+protected:
+    size_t nr_loops;
+
+    void SetUp() {
+        const char *loops = getenv("LOOPS");
+        nr_loops = loops ? atoll(loops) : 0;
+        if (nr_loops == 0)
+            GTEST_SKIP() << "LOOPS is not set";
+        doc_test::SetUp();
+    }
+};
+
+/* the number of the elements matched by the selector in the subtree of
+   the scope, or in the whole document if the scope is NULL */
+static inline size_t
+count_elements(purc_document_t doc, pcdoc_element_t scope,
+        const char *selector)
+{
+    pcdoc_elem_coll_t coll = pcdoc_elem_coll_new_from_descendants(doc, scope,
+            selector);
+    if (coll == NULL)
+        return (size_t)-1;
+
+    size_t n = pcutils_arrlist_length(coll->elems);
+    pcdoc_elem_coll_delete(doc, coll);
+    return n;
+}
+
+/* the bytes written by the function to a buffer stream */
+static inline std::string
+stream_to_string(const std::function<void (purc_rwstream_t)> &write)
+{
+    purc_rwstream_t out = purc_rwstream_new_buffer(1024, 1024*1024*64);
+    write(out);
+
+    size_t size = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(out, &size);
+    std::string str(buf, size);
+    purc_rwstream_destroy(out);
+    return str;
+}
+
+/* a page of cards with the nodes of most kinds */
+static inline std::string
+cards_page(int nr_cards)
+{
+    std::string html = "<!DOCTYPE html><html><head><title>Cards</title>"
+        "</head><body><div id='cards'>";
+    for (int i = 0; i < nr_cards; i++) {
+        std::string n = std::to_string(i);
+        html += "<div class='card' id='card-" + n + "'><h2>Title " + n +
+            "</h2><p class='desc'>The description of the card &amp; "
+            "the &lt;details&gt; of it</p><ul><li>a</li><li>b</li>"
+            "<li>c</li></ul><a href='/cards/" + n + "'>more</a>"
+            "<template><span>hidden " + n + "</span></template></div>";
+    }
+    html += "</div><div id='footer'><br><p>footer</p></div></body></html>";
+    return html;
+}
+
+#endif  /* PURC_TEST_DOCUMENT_TOOLS_H */
@@ -22,6 +22,7 @@
 #include "purc-executor.h"
 
 #include "private/utils.h"
+#include "private/executor.h"
 
 #include <gtest/gtest.h>
 #include <glob.h>
@@ -37,6 +38,8 @@ extern "C" {
 
 #include "utils.cpp.in"
 
+PCEXE_DEFINE_RULE_PARSER(exe_range);
+
 TEST(exe_range, basic)
 {
     purc_instance_extra_info info = {};
@@ -109,3 +112,58 @@ TEST(exe_range, files)
     ASSERT_TRUE(ok);
 }
 
+
+TEST(exe_range, rule_cache)
+{
+    purc_instance_extra_info info = {};
+    int r = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hvml.test", "exe_range",
+            &info);
+    ASSERT_EQ(r, PURC_ERROR_OK);
+
+    char *err_msg = NULL;
+    void *first = pcexecutor_parse_rule(&exe_range_rule_parser,
+            "RANGE: FROM 0 TO 10", &err_msg);
+    ASSERT_NE(first, nullptr);
+
+    // the same rule is parsed only once
+    void *param = pcexecutor_parse_rule(&exe_range_rule_parser,
+            "RANGE: FROM 0 TO 10", &err_msg);
+    ASSERT_EQ(param, first);
+    pcexecutor_release_rule(param);
+
+    struct exe_range_param *p = (struct exe_range_param *)first;
+    ASSERT_EQ(p->rule.from, 0);
+    ASSERT_EQ(p->rule.to, 10);
+
+    param = pcexecutor_parse_rule(&exe_range_rule_parser,
+            "RANGE: FROM 0 TO 20", &err_msg);
+    ASSERT_NE(param, nullptr);
+    ASSERT_NE(param, first);
+    pcexecutor_release_rule(param);
+
+    // the failures are not cached
+    param = pcexecutor_parse_rule(&exe_range_rule_parser,
+            "RANGE: FROM", &err_msg);
+    ASSERT_EQ(param, nullptr);
+    free(err_msg);
+
+    // the least recently used rules are evicted
+    for (int i = 0; i < 100; i++) {
+        char rule[64];
+        snprintf(rule, sizeof(rule), "RANGE: FROM %d", i);
+        param = pcexecutor_parse_rule(&exe_range_rule_parser, rule, &err_msg);
+        ASSERT_NE(param, nullptr);
+        pcexecutor_release_rule(param);
+    }
+
+    // the evicted rule is kept alive by the holder
+    ASSERT_EQ(p->rule.to, 10);
+    param = pcexecutor_parse_rule(&exe_range_rule_parser,
+            "RANGE: FROM 0 TO 10", &err_msg);
+    ASSERT_NE(param, nullptr);
+    ASSERT_NE(param, first);
+    pcexecutor_release_rule(param);
+    pcexecutor_release_rule(first);
+
+    ASSERT_TRUE(purc_cleanup());
+}
@@ -23,6 +23,7 @@
 #include "private/list.h"
 #include "private/html.h"
 #include "private/dom.h"
+#include "private/document.h"
 #include "purc-html.h"
 #include "./html/interfaces/document.h"
 #include "private/interpreter.h"
@@ -31,6 +32,9 @@
 #include <gtest/gtest.h>
 
 #include <stdarg.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
 
 #define lxb_status_t                               int
 #define LXB_STATUS_OK                              PCHTML_STATUS_OK
@@ -744,3 +748,162 @@ TEST(inner, basic)
     purc_cleanup ();
 }
 
+static void
+document_stats(purc_document_t doc, struct pcdom_document_stats *stats)
+{
+    pcdom_document_get_stats(pcdom_interface_document(doc->impl), stats);
+}
+
+/* the nodes of the subtrees created and destroyed repeatedly are
+   recycled by the arena of the document */
+TEST(dom_arena, recycle)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    const char *html = "<html><head></head><body>"
+        "<p id='a' class='x'>text</p></body></html>";
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html, strlen(html));
+    ASSERT_NE(doc, nullptr);
+
+    /* html, head, body, p, and the text */
+    struct pcdom_document_stats stats;
+    document_stats(doc, &stats);
+    ASSERT_EQ(stats.nr_nodes, 5u);
+    ASSERT_EQ(stats.nr_attrs, 2u);
+    ASSERT_GE(stats.nodes.nr_blocks, stats.nr_nodes + stats.nr_attrs);
+    ASSERT_GE(stats.nodes.bytes_reserved, stats.nodes.bytes_used);
+
+    pcdoc_element_t body = purc_document_special_elem(doc,
+            PCDOC_SPECIAL_ELEM_BODY);
+    ASSERT_NE(body, nullptr);
+
+    std::string fragment;
+    for (int i = 0; i < 100; i++) {
+        fragment += "<div class='item'><span title='t'>" +
+            std::to_string(i) + "</span></div>";
+    }
+
+    size_t nr_blocks = 0, bytes_used = 0, bytes_reserved = 0;
+    for (int n = 0; n < 20; n++) {
+        pcdoc_element_new_content(doc, body, PCDOC_OP_DISPLACE,
+                fragment.c_str(), fragment.size());
+        document_stats(doc, &stats);
+        ASSERT_EQ(stats.nr_nodes, 3u + 300);
+        ASSERT_EQ(stats.nr_attrs, 200u);
+
+        pcdoc_element_clear(doc, body);
+        document_stats(doc, &stats);
+        ASSERT_EQ(stats.nr_nodes, 3u);
+        ASSERT_EQ(stats.nr_attrs, 0u);
+
+        /* the fragment cache keeps a copy of the subtree after the
+           second round */
+        if (n <= 1) {
+            nr_blocks = stats.nodes.nr_blocks;
+            bytes_used = stats.nodes.bytes_used;
+            bytes_reserved = stats.nodes.bytes_reserved +
+                stats.text.bytes_reserved;
+        }
+        else {
+            /* no more memory is taken afterwards */
+            ASSERT_EQ(stats.nodes.nr_blocks, nr_blocks);
+            ASSERT_EQ(stats.nodes.bytes_used, bytes_used);
+            ASSERT_EQ(stats.nodes.bytes_reserved + stats.text.bytes_reserved,
+                    bytes_reserved);
+        }
+    }
+
+    purc_document_delete(doc);
+
+    purc_cleanup();
+}
+
+static const size_t NR_ARENA_NODES = 100000;
+
+TEST(dom_arena, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops == 0)
+        GTEST_SKIP() << "LOOPS is not set";
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    /* an element and a text node per paragraph */
+    std::string html = "<html><head></head><body>";
+    for (size_t i = 0; i < NR_ARENA_NODES / 2; i++) {
+        html += "<p class='c" + std::to_string(i % 10) + "'>" +
+            std::to_string(i) + "</p>";
+    }
+    html += "</body></html>";
+
+    struct pcdom_document_stats stats = {};
+    std::chrono::steady_clock::duration built{}, deleted{};
+    for (size_t n = 0; n < nr_loops; n++) {
+        auto start = std::chrono::steady_clock::now();
+        purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+                html.c_str(), html.size());
+        ASSERT_NE(doc, nullptr);
+        built += std::chrono::steady_clock::now() - start;
+
+        document_stats(doc, &stats);
+
+        start = std::chrono::steady_clock::now();
+        purc_document_delete(doc);
+        deleted += std::chrono::steady_clock::now() - start;
+    }
+
+    ASSERT_GE(stats.nr_nodes, NR_ARENA_NODES);
+
+    /* the subtrees created and destroyed by a template */
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            "<html><body></body></html>", 0);
+    ASSERT_NE(doc, nullptr);
+    pcdoc_element_t body = purc_document_special_elem(doc,
+            PCDOC_SPECIAL_ELEM_BODY);
+
+    std::string fragment;
+    for (int i = 0; i < 500; i++) {
+        fragment += "<li class='item'>" + std::to_string(i) + "</li>";
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops * 20; n++) {
+        pcdoc_element_new_content(doc, body, PCDOC_OP_DISPLACE,
+                fragment.c_str(), fragment.size());
+    }
+    auto churned = std::chrono::steady_clock::now() - start;
+
+    struct pcdom_document_stats churn_stats;
+    document_stats(doc, &churn_stats);
+    purc_document_delete(doc);
+
+    double built_ms = std::chrono::duration<double, std::milli>(
+            built).count() / nr_loops;
+    double deleted_ms = std::chrono::duration<double, std::milli>(
+            deleted).count() / nr_loops;
+    double churned_us = std::chrono::duration<double, std::micro>(
+            churned).count() / (nr_loops * 20);
+
+    fprintf(stderr, "%zu nodes and %zu attributes per document\n",
+            stats.nr_nodes, stats.nr_attrs);
+    fprintf(stderr, "built:    %10.2f ms per document\n", built_ms);
+    fprintf(stderr, "deleted:  %10.2f ms per document\n", deleted_ms);
+    fprintf(stderr, "node arena: %.1f bytes per node, %zu bytes reserved\n",
+            (double)stats.nodes.bytes_used /
+            (stats.nr_nodes + stats.nr_attrs), stats.nodes.bytes_reserved);
+    fprintf(stderr, "text arena: %zu bytes used, %zu bytes reserved\n",
+            stats.text.bytes_used, stats.text.bytes_reserved);
+    fprintf(stderr, "fragment of 1000 nodes displaced: %10.2f us, "
+            "%zu bytes reserved\n", churned_us,
+            churn_stats.nodes.bytes_reserved + churn_stats.text.bytes_reserved);
+
+    purc_cleanup();
+}
@@ -21,6 +21,7 @@
 #include "private/list.h"
 #include "private/html.h"
 #include "private/dom.h"
+#include "private/document.h"
 
 #include <limits.h>
 #include <stdio.h>
@@ -30,6 +31,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <dirent.h>
 
 // test html parser for whole html file
 TEST(html, html_parser_html_file_x)
@@ -622,3 +627,136 @@ TEST(html, collection)
     purc_cleanup ();
 }
 
+/* the bytes written by the function to a buffer stream */
+static std::string
+stream_to_string(const std::function<void (purc_rwstream_t)> &write)
+{
+    purc_rwstream_t out = purc_rwstream_new_buffer(1024, 1024*1024*64);
+    write(out);
+
+    size_t size = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(out, &size);
+    std::string str(buf, size);
+    purc_rwstream_destroy(out);
+    return str;
+}
+
+/* the special bytes at every position around the boundaries of the blocks
+   scanned in bulk by the tokenizer */
+TEST(html, tokenizer_scan)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    for (size_t k = 0; k < 70; k++) {
+        std::string run(k, 'x');
+        std::string html = "<html><body>";
+        html += "<p title=\"" + run + "&amp;\" lang='" + run + "&lt;'>";
+        html += run + "&lt;" + run + "\r\n" + run + "\rz</p>";
+        html += "</body></html>";
+
+        purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+                html.c_str(), html.size());
+        ASSERT_NE(doc, nullptr);
+
+        pcdoc_element_t p = pcdoc_find_element_in_document(doc, "p");
+        ASSERT_NE(p, nullptr);
+        std::string text = stream_to_string([&](purc_rwstream_t out) {
+            pcdoc_serialize_text_contents_to_stream(doc, p, 0, out);
+        });
+        ASSERT_EQ(text, run + "<" + run + "\n" + run + "\nz");
+
+        const char *val;
+        size_t len;
+        ret = pcdoc_element_get_attribute(doc, p, "title", &val, &len);
+        ASSERT_EQ(ret, 0);
+        ASSERT_EQ(std::string(val, len), run + "&");
+        ret = pcdoc_element_get_attribute(doc, p, "lang", &val, &len);
+        ASSERT_EQ(ret, 0);
+        ASSERT_EQ(std::string(val, len), run + "<");
+
+        purc_document_delete(doc);
+    }
+
+    purc_cleanup();
+}
+
+static double
+parse_throughput(const std::string &html, size_t nr_loops)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+                html.c_str(), html.size());
+        if (doc == NULL)
+            return 0;
+        purc_document_delete(doc);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double secs = std::chrono::duration<double>(elapsed).count();
+    return html.size() * nr_loops / secs / (1024 * 1024);
+}
+
+TEST(html, parser_perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops == 0)
+        GTEST_SKIP() << "LOOPS is not set";
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    char this_file[] = __FILE__;
+    char path[PATH_MAX];
+    int n = snprintf(path, sizeof(path), "%s/test_files", dirname(this_file));
+    ASSERT_LT(n, sizeof(path));
+
+    /* the test files, and a large page made of them with long texts
+       and attribute values */
+    std::string page = "<html><body>";
+    std::string text(400, 'x');
+    DIR *dir = opendir(path);
+    ASSERT_NE(dir, nullptr);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        size_t len = strlen(entry->d_name);
+        if (len < 5 || strcmp(entry->d_name + len - 5, ".html"))
+            continue;
+
+        std::string file = std::string(path) + "/" + entry->d_name;
+        FILE *fp = fopen(file.c_str(), "r");
+        ASSERT_NE(fp, nullptr);
+        std::string html;
+        char buf[1024];
+        size_t nr;
+        while ((nr = fread(buf, 1, sizeof(buf), fp)) > 0)
+            html.append(buf, nr);
+        fclose(fp);
+
+        fprintf(stderr, "%-32s %8zu bytes, %8.2f MiB/s\n", entry->d_name,
+                html.size(), parse_throughput(html, nr_loops));
+
+        for (int i = 0; i < 50; i++) {
+            page += "<div class=\"" + text + "\"><p title='" + text + "'>";
+            page += text + "&amp;" + text + "</p>" + html + "</div>\n";
+        }
+    }
+    closedir(dir);
+
+    page += "</body></html>";
+    double mibps = parse_throughput(page, nr_loops);
+    fprintf(stderr, "%-32s %8zu bytes, %8.2f MiB/s\n", "(text-heavy page)",
+            page.size(), mibps);
+    ASSERT_GT(mibps, 0);
+
+    purc_cleanup();
+}
+
+
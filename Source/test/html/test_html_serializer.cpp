@@ -0,0 +1,124 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/html.h"
+#include "private/dom.h"
+#include "private/document.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <string>
+
+/* the bytes written by the function to a buffer stream */
+static std::string
+stream_to_string(const std::function<void (purc_rwstream_t)> &write)
+{
+    purc_rwstream_t out = purc_rwstream_new_buffer(1024, 1024*1024*64);
+    write(out);
+
+    size_t size = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(out, &size);
+    std::string str(buf, size);
+    purc_rwstream_destroy(out);
+    return str;
+}
+
+/* the characters to escape at every position around the blocks scanned
+   in bulk by the serializer */
+TEST(html_serializer, escaping)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    for (size_t k = 0; k < 70; k++) {
+        std::string run(k, 'x');
+        std::string html = "<html><body><p title='" + run + "&quot;" + run +
+            "&lt;&#39;\xc2\xa0'>" + run + "&amp;" + run + "&lt;&gt;" + run +
+            "\xc2\xa0\xc2\xa1</p></body></html>";
+
+        purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+                html.c_str(), html.size());
+        ASSERT_NE(doc, nullptr);
+
+        pcdoc_element_t p = pcdoc_find_element_in_document(doc, "p");
+        ASSERT_NE(p, nullptr);
+        std::string serialized = stream_to_string([&](purc_rwstream_t out) {
+            pcdoc_serialize_descendants_to_stream(doc, p,
+                    PCDOC_SERIALIZE_OPT_UNDEF, out);
+        });
+        ASSERT_EQ(serialized, "<p title=\"" + run + "&quot;" + run +
+                "&lt;&#039;&nbsp;\">\n  " + run + "&amp;" + run +
+                "&lt;&gt;" + run + "&nbsp;\xc2\xa1\n</p>\n");
+
+        purc_document_delete(doc);
+    }
+
+    purc_cleanup();
+}
+
+TEST(html_serializer, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops == 0)
+        GTEST_SKIP() << "LOOPS is not set";
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    std::string text(400, 'x');
+    std::string html = "<html><body>";
+    for (int i = 0; i < 500; i++) {
+        html += "<div class='" + text + "'><p title='" + text + "'>";
+        html += text + "&amp;" + text + "</p></div>\n";
+    }
+    html += "</body></html>";
+
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html.c_str(), html.size());
+    ASSERT_NE(doc, nullptr);
+
+    size_t nr_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        nr_bytes += stream_to_string([&](purc_rwstream_t out) {
+            pcdom_node_write_to_stream_ex(
+                    pcdom_interface_node(purc_document_root(doc)),
+                    PCHTML_HTML_SERIALIZE_OPT_UNDEF, out);
+        }).size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double secs = std::chrono::duration<double>(elapsed).count();
+    fprintf(stderr, "%zu bytes serialized, %8.2f MiB/s\n", nr_bytes,
+            nr_bytes / secs / (1024 * 1024));
+    ASSERT_GT(nr_bytes, html.size() * nr_loops / 2);
+
+    purc_document_delete(doc);
+
+    purc_cleanup();
+}
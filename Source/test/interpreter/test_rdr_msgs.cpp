@@ -0,0 +1,899 @@
+/*
+ * @file test_rdr_msgs.cpp
+ * @date 2022/10/19
+ * @brief The program to test the messages sent to the renderer.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#undef NDEBUG
+
+#include "purc.h"
+#include "private/interpreter.h"
+#include "private/pcrdr.h"
+#include "private/utils.h"
+#include "interpreter/internal.h"
+#include "pcrdr/connect.h"
+#include "../helpers.h"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#define RUNNER          "test_rdr_msgs"
+#define LOG_FILE        "/tmp/" APP_NAME "-" RUNNER ".log"
+
+/* a message logged by the headless renderer */
+struct rdr_msg {
+    bool request;
+    std::map<std::string, std::string> headers;
+    std::string data;
+};
+
+static void
+read_log(const char *file, std::vector<rdr_msg> &msgs)
+{
+    std::string log;
+    FILE *fp = fopen(file, "r");
+    ASSERT_NE(fp, nullptr);
+
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        log.append(buf, n);
+    fclose(fp);
+
+    size_t pos = 0;
+    while (pos < log.size()) {
+        rdr_msg msg;
+        if (log.compare(pos, 4, ">>>\n") == 0)
+            msg.request = true;
+        else if (log.compare(pos, 4, "<<<\n") == 0)
+            msg.request = false;
+        else
+            break;
+        pos += 4;
+
+        /* the headers end with a line containing a space */
+        for (;;) {
+            size_t eol = log.find('\n', pos);
+            ASSERT_NE(eol, std::string::npos);
+            std::string line = log.substr(pos, eol - pos);
+            pos = eol + 1;
+            if (line == " ")
+                break;
+
+            size_t colon = line.find(':');
+            ASSERT_NE(colon, std::string::npos);
+            msg.headers[line.substr(0, colon)] = line.substr(colon + 1);
+        }
+
+        size_t len = strtoul(msg.headers["dataLen"].c_str(), NULL, 10);
+        msg.data = log.substr(pos, len);
+        pos = log.find("END\n", pos + len);
+        ASSERT_NE(pos, std::string::npos);
+        pos += 4;
+
+        msgs.push_back(msg);
+    }
+}
+
+/* runs the page with the headless renderer and reads the logged messages;
+   `envv` names the environment variable enabling a way to send the DOM
+   requests, if not NULL */
+static void
+run_page(const char *hvml, const char *envv, purc_cond_handler handler,
+        void *user_data, std::vector<rdr_msg> &msgs)
+{
+    unsetenv(PURC_ENVV_RDR_BATCH_DOM);
+    unsetenv(PURC_ENVV_RDR_ASYNC_DOM);
+    if (envv)
+        setenv(envv, "1", 1);
+    unlink(LOG_FILE);
+
+    purc_instance_extra_info info = {};
+    info.renderer_prot = PURC_RDRPROT_HEADLESS;
+    info.renderer_uri = "file://" LOG_FILE;
+    int ret = purc_init_ex(PURC_MODULE_HVML | PURC_MODULE_PCRDR,
+            APP_NAME, RUNNER, &info);
+    if (envv)
+        unsetenv(envv);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(hvml);
+    ASSERT_NE(vdom, nullptr);
+
+    purc_renderer_extra_info rdr_info = {};
+    purc_coroutine_t cor = purc_schedule_vdom(vdom, 0, PURC_VARIANT_INVALID,
+            PCRDR_PAGE_TYPE_PLAINWIN, "main", NULL, RUNNER, &rdr_info,
+            NULL, NULL);
+    ASSERT_NE(cor, nullptr);
+    purc_coroutine_set_user_data(cor, user_data);
+
+    purc_run(handler);
+
+    /* the log is flushed when the connection is closed */
+    purc_cleanup();
+    read_log(LOG_FILE, msgs);
+}
+
+static bool
+is_load_operation(const std::string &operation)
+{
+    return operation == "load" || operation == "writeBegin" ||
+        operation == "writeMore" || operation == "writeEnd";
+}
+
+/* names the element handles after their order in the loaded page */
+static std::map<std::string, std::string>
+element_names(const std::vector<rdr_msg> &msgs)
+{
+    static const char key[] = "hvml-handle=";
+    std::map<std::string, std::string> names;
+    std::string page;
+
+    for (const rdr_msg &msg : msgs) {
+        auto it = msg.headers.find("operation");
+        if (msg.request && it != msg.headers.end() &&
+                is_load_operation(it->second))
+            page += msg.data;
+    }
+
+    size_t pos = 0;
+    while ((pos = page.find(key, pos)) != std::string::npos) {
+        pos += sizeof(key) - 1;
+        size_t end = page.find_first_not_of("0123456789abcdef", pos);
+        std::string handle = page.substr(pos, end - pos);
+        names[handle] = "e" + std::to_string(names.size());
+    }
+
+    return names;
+}
+
+static std::string
+member_string(purc_variant_t obj, const char *key)
+{
+    purc_variant_t v = purc_variant_object_get_by_ckey(obj, key);
+    const char *str = v ? purc_variant_get_string_const(v) : NULL;
+    return str ? str : "";
+}
+
+/* the DOM operations sent in single requests or in batches */
+struct dom_reqs {
+    std::vector<std::string> ops;
+    std::vector<size_t> batches;    /* the number of operations per batch */
+    std::vector<size_t> batch_lens; /* the length of every batch */
+    size_t nr_singles;
+};
+
+static std::string
+describe_op(const std::string &operation, const std::string &element,
+        const std::string &property, const std::string &data_type,
+        const std::string &data)
+{
+    return operation + " " + element + " " + property + " " +
+        data_type + ":" + data;
+}
+
+static void
+collect_dom_reqs(const std::vector<rdr_msg> &msgs, dom_reqs &reqs)
+{
+    std::map<std::string, std::string> names = element_names(msgs);
+    reqs.nr_singles = 0;
+
+    for (const rdr_msg &msg : msgs) {
+        auto target = msg.headers.find("target");
+        if (!msg.request || target == msg.headers.end() ||
+                target->second.compare(0, 4, "dom/") != 0)
+            continue;
+
+        /* the DOM updates always refer to the elements by handles */
+        std::map<std::string, std::string> headers = msg.headers;
+        if (headers["operation"] != "batch") {
+            std::string element = headers["element"];
+            if (element.compare(0, 7, "handle/") != 0)
+                continue;
+
+            element = names[element.substr(7)];
+            reqs.ops.push_back(describe_op(headers["operation"], element,
+                        headers["property"], headers["dataType"], msg.data));
+            reqs.nr_singles++;
+            continue;
+        }
+
+        purc_variant_t batch = purc_variant_make_from_json_string(
+                msg.data.c_str(), msg.data.size());
+        ASSERT_NE(batch, PURC_VARIANT_INVALID);
+        ASSERT_TRUE(purc_variant_is_array(batch));
+
+        size_t nr_ops = purc_variant_array_get_size(batch);
+        for (size_t i = 0; i < nr_ops; i++) {
+            purc_variant_t op = purc_variant_array_get(batch, i);
+            reqs.ops.push_back(describe_op(member_string(op, "operation"),
+                        names[member_string(op, "element")],
+                        member_string(op, "property"),
+                        member_string(op, "dataType"),
+                        member_string(op, "data")));
+        }
+        reqs.batches.push_back(nr_ops);
+        reqs.batch_lens.push_back(msg.data.size());
+        purc_variant_unref(batch);
+    }
+}
+
+/* the operations of the requests sent after the page is loaded */
+static std::vector<std::string>
+operations_after_load(const std::vector<rdr_msg> &msgs)
+{
+    std::vector<std::string> ops;
+    bool loaded = false;
+
+    for (const rdr_msg &msg : msgs) {
+        auto it = msg.headers.find("operation");
+        if (!msg.request || it == msg.headers.end())
+            continue;
+
+        if (loaded)
+            ops.push_back(it->second);
+        else if (it->second == "load" || it->second == "writeEnd")
+            loaded = true;
+    }
+
+    return ops;
+}
+
+/* every `<li>` is updated in a single step when the coroutine gets idle */
+static std::string
+make_list_page(size_t nr_items, const std::string &update)
+{
+    std::string page =
+        "<!DOCTYPE hvml>\n"
+        "<hvml target=\"html\">\n"
+        "<body>\n"
+        "    <ul id=\"list\">";
+    for (size_t i = 0; i < nr_items; i++)
+        page += "<li class=\"item\">" + std::to_string(i) + "</li>";
+    page +=
+        "</ul>\n"
+        "    <p id=\"status\">running</p>\n"
+        "    <observe on=\"$CRTN\" for=\"idle\">\n"
+        "        " + update + "\n"
+        "        <update on=\"#status\" at=\"textContent\" with=\"done\" />\n"
+        "        <forget on=\"$CRTN\" for=\"idle\" />\n"
+        "    </observe>\n"
+        "</body>\n"
+        "</hvml>\n";
+    return page;
+}
+
+static const char *update_text =
+    "<update on=\"li.item\" at=\"textContent\" with=\"updated\" />";
+
+/* the batches carry the same operations in the same order as the single
+   requests, and every scheduling round sends its own batch */
+TEST(dom_batch, same_operations)
+{
+    std::string page = make_list_page(3, update_text);
+    std::vector<rdr_msg> single_msgs, batch_msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), NULL, NULL, NULL,
+                single_msgs));
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), PURC_ENVV_RDR_BATCH_DOM,
+                NULL, NULL, batch_msgs));
+
+    PurCInstance purc(PURC_MODULE_VARIANT, APP_NAME, RUNNER);
+    ASSERT_TRUE(purc);
+
+    dom_reqs singles, batched;
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(single_msgs, singles));
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(batch_msgs, batched));
+
+    /* e0-e3 are <html>, <head>, <body> and <ul> */
+    std::vector<std::string> expected = {
+        "update e4 textContent plain:updated",
+        "update e5 textContent plain:updated",
+        "update e6 textContent plain:updated",
+        "update e7 textContent plain:done",
+    };
+    ASSERT_EQ(singles.ops, expected);
+    ASSERT_EQ(singles.nr_singles, 4u);
+    ASSERT_TRUE(singles.batches.empty());
+
+    ASSERT_EQ(batched.ops, expected);
+    ASSERT_EQ(batched.nr_singles, 0u);
+    ASSERT_EQ(batched.batches, std::vector<size_t>({ 3, 1 }));
+}
+
+/* a batch is sent as soon as it has MAX_BATCHED_DOM_OPS (256) operations */
+TEST(dom_batch, split_by_count)
+{
+    std::string page = make_list_page(600,
+            "<update on=\"li.item\" at=\"attr.class\" with=\"x\" />");
+    std::vector<rdr_msg> single_msgs, batch_msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), NULL, NULL, NULL,
+                single_msgs));
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), PURC_ENVV_RDR_BATCH_DOM,
+                NULL, NULL, batch_msgs));
+
+    PurCInstance purc(PURC_MODULE_VARIANT, APP_NAME, RUNNER);
+    ASSERT_TRUE(purc);
+
+    dom_reqs singles, batched;
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(single_msgs, singles));
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(batch_msgs, batched));
+
+    ASSERT_EQ(singles.ops.size(), 601u);
+    ASSERT_EQ(singles.ops[0], "update e4 attr.class plain:x");
+    ASSERT_EQ(batched.ops, singles.ops);
+    ASSERT_EQ(batched.batches, std::vector<size_t>({ 256, 256, 88, 1 }));
+}
+
+/* a batch never exceeds the in-memory payload of a message, and a longer
+   operation is sent alone in order */
+TEST(dom_batch, split_by_length)
+{
+    std::string text(500, 'x');
+    /* too long for a batch, but not for a message */
+    std::string long_text(PCRDR_MAX_INMEM_PAYLOAD_SIZE - 960, 'y');
+    std::string page = make_list_page(200,
+            "<update on=\"li.item\" at=\"textContent\" with=\"" + text +
+            "\" />\n"
+            "        <update on=\"#list\" at=\"attr.title\" with=\"" +
+            long_text + "\" />");
+    std::vector<rdr_msg> single_msgs, batch_msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), NULL, NULL, NULL,
+                single_msgs));
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), PURC_ENVV_RDR_BATCH_DOM,
+                NULL, NULL, batch_msgs));
+
+    PurCInstance purc(PURC_MODULE_VARIANT, APP_NAME, RUNNER);
+    ASSERT_TRUE(purc);
+
+    dom_reqs singles, batched;
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(single_msgs, singles));
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(batch_msgs, batched));
+
+    ASSERT_EQ(singles.ops.size(), 202u);
+    ASSERT_EQ(batched.ops, singles.ops);
+    ASSERT_EQ(batched.nr_singles, 1u);
+    ASSERT_GT(batched.batches.size(), 3u);
+    for (size_t len : batched.batch_lens)
+        ASSERT_LE(len, (size_t)PCRDR_MAX_INMEM_PAYLOAD_SIZE - 1024);
+
+    /* the batches are as full as possible */
+    size_t nr_ops = 0;
+    for (size_t i = 0; i + 2 < batched.batches.size(); i++) {
+        ASSERT_GT(batched.batch_lens[i] + text.size() + 100,
+                (size_t)PCRDR_MAX_INMEM_PAYLOAD_SIZE - 1024) << i;
+        nr_ops += batched.batches[i];
+    }
+    ASSERT_EQ(nr_ops + batched.batches[batched.batches.size() - 2], 200u);
+    ASSERT_EQ(batched.batches.back(), 1u);
+}
+
+struct flush_state {
+    size_t nr_queued;
+    bool flushed_before_request;
+    bool queued_at_exit;
+};
+
+/* queues operations after the observer ran: the first batch is sent before
+   a synchronous request, the second one when the coroutine exits */
+static int
+flush_cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    if (event != PURC_COND_COR_ONE_RUN)
+        return 0;
+
+    struct purc_cor_run_info *info = (struct purc_cor_run_info *)data;
+    if (info->run_idx != 1)
+        return 0;
+
+    pcintr_coroutine_t co = (pcintr_coroutine_t)arg;
+    struct flush_state *state =
+        (struct flush_state *)purc_coroutine_get_user_data(co);
+    pcdoc_element_t status = pcdoc_find_element_in_document(info->doc,
+            "#status");
+
+    pcintr_rdr_send_dom_req_simple_raw(&co->stack, PCDOC_OP_APPEND, status,
+            NULL, PCRDR_MSG_DATA_TYPE_HTML, "<b>before</b>", 0);
+    state->nr_queued = co->dom_batch ?
+        purc_variant_array_get_size(co->dom_batch) : 0;
+
+    pcrdr_msg *response = pcintr_rdr_send_request_and_wait_response(
+            purc_get_conn_to_renderer(), PCRDR_MSG_TARGET_DOM,
+            co->target_dom_handle, PCRDR_OPERATION_GETPROPERTY,
+            PCRDR_MSG_ELEMENT_TYPE_ID, "status", "textContent",
+            PCRDR_MSG_DATA_TYPE_VOID, PURC_VARIANT_INVALID, 0);
+    if (response)
+        pcrdr_release_message(response);
+    state->flushed_before_request = (co->dom_batch == PURC_VARIANT_INVALID);
+
+    pcintr_rdr_send_dom_req_simple_raw(&co->stack, PCDOC_OP_APPEND, status,
+            NULL, PCRDR_MSG_DATA_TYPE_HTML, "<b>at exit</b>", 0);
+    state->queued_at_exit = (co->dom_batch != PURC_VARIANT_INVALID);
+
+    /* no scheduling round sends the batch any more */
+    co->owner->batch_dom_reqs = 0;
+    return 0;
+}
+
+TEST(dom_batch, flush)
+{
+    std::string page = make_list_page(3, update_text);
+    struct flush_state state = { };
+    std::vector<rdr_msg> msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), PURC_ENVV_RDR_BATCH_DOM,
+                flush_cond_handler, &state, msgs));
+
+    ASSERT_EQ(state.nr_queued, 1u);
+    ASSERT_TRUE(state.flushed_before_request);
+    ASSERT_TRUE(state.queued_at_exit);
+
+    ASSERT_EQ(operations_after_load(msgs), std::vector<std::string>({
+                "batch", "batch", "batch", "getProperty", "batch",
+                "endSession" }));
+
+    PurCInstance purc(PURC_MODULE_VARIANT, APP_NAME, RUNNER);
+    ASSERT_TRUE(purc);
+
+    dom_reqs batched;
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(msgs, batched));
+    ASSERT_EQ(batched.batches, std::vector<size_t>({ 3, 1, 1, 1 }));
+    ASSERT_EQ(batched.ops[4], "append e7  html:<b>before</b>");
+    ASSERT_EQ(batched.ops[5], "append e7  html:<b>at exit</b>");
+}
+
+struct batch_result {
+    int ret_code;
+    uint64_t result_value;
+};
+
+static const char *batches[] = {
+    "[{\"operation\":\"append\",\"element\":\"%s\","
+        "\"dataType\":\"html\",\"data\":\"<p>1</p>\"},"
+     "{\"operation\":\"update\",\"element\":\"%s\","
+        "\"property\":\"textContent\",\"dataType\":\"plain\",\"data\":\"2\"},"
+     "{\"operation\":\"clear\",\"element\":\"%s\"}]",
+    /* an unknown operation */
+    "[{\"operation\":\"append\",\"element\":\"%s\","
+        "\"dataType\":\"html\",\"data\":\"<p>1</p>\"},"
+     "{\"operation\":\"frobnicate\",\"element\":\"%s\"},"
+     "{\"operation\":\"clear\",\"element\":\"%s\"}]",
+    /* not a DOM operation */
+    "[{\"operation\":\"append\",\"element\":\"%s\","
+        "\"dataType\":\"html\",\"data\":\"<p>1</p>\"},"
+     "{\"operation\":\"clear\",\"element\":\"%s\"},"
+     "{\"operation\":\"load\",\"element\":\"%s\"}]",
+    /* a bad element */
+    "[{\"operation\":\"append\",\"element\":\"%s\","
+        "\"dataType\":\"html\",\"data\":\"<p>1</p>\"},"
+     "{\"operation\":\"clear\",\"element\":\"%s\"},"
+     "{\"operation\":\"clear\",\"element\":\"0%.0s\"}]",
+};
+
+static int
+batch_cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    if (event != PURC_COND_COR_ONE_RUN)
+        return 0;
+
+    struct purc_cor_run_info *info = (struct purc_cor_run_info *)data;
+    if (info->run_idx != 0)
+        return 0;
+
+    pcintr_coroutine_t co = (pcintr_coroutine_t)arg;
+    struct batch_result *results =
+        (struct batch_result *)purc_coroutine_get_user_data(co);
+
+    char element[32];
+    snprintf(element, sizeof(element), "%llx", (unsigned long long)(uintptr_t)
+            pcdoc_find_element_in_document(info->doc, "#status"));
+
+    for (size_t i = 0; i < PCA_TABLESIZE(batches); i++) {
+        char json[1024];
+        snprintf(json, sizeof(json), batches[i], element, element, element);
+
+        pcrdr_msg *msg = pcrdr_make_request_message(PCRDR_MSG_TARGET_DOM,
+                co->target_dom_handle, PCRDR_OPERATION_BATCH, NULL, NULL,
+                PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+                PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+        msg->dataType = PCRDR_MSG_DATA_TYPE_JSON;
+        msg->data = purc_variant_make_from_json_string(json, strlen(json));
+
+        pcrdr_msg *response = NULL;
+        results[i].ret_code = -1;
+        if (pcrdr_send_request_and_wait_response(purc_get_conn_to_renderer(),
+                    msg, PCRDR_TIME_DEF_EXPECTED, &response) >= 0) {
+            results[i].ret_code = response->retCode;
+            results[i].result_value = response->resultValue;
+            pcrdr_release_message(response);
+        }
+        pcrdr_release_message(msg);
+    }
+
+    return 0;
+}
+
+/* the renderer applies all operations of a batch or none of them */
+TEST(dom_batch, rejected)
+{
+    std::string page = make_list_page(1, update_text);
+    struct batch_result results[PCA_TABLESIZE(batches)] = { };
+    std::vector<rdr_msg> msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), PURC_ENVV_RDR_BATCH_DOM,
+                batch_cond_handler, results, msgs));
+
+    ASSERT_EQ(results[0].ret_code, PCRDR_SC_OK);
+    ASSERT_EQ(results[0].result_value, 3u);
+    for (size_t i = 1; i < PCA_TABLESIZE(batches); i++) {
+        ASSERT_EQ(results[i].ret_code, PCRDR_SC_BAD_REQUEST) << i;
+        ASSERT_EQ(results[i].result_value, 0u) << i;
+    }
+}
+
+/* the page observes the failures of the pipelined DOM requests */
+static const char *async_page =
+    "<!DOCTYPE hvml>\n"
+    "<hvml target=\"html\">\n"
+    "<body>\n"
+    "    <p id=\"status\">running</p>\n"
+    "    <observe on=\"$CRTN\" for=\"rdrState:domReqFailed\">\n"
+    "        <update on=\"#status\" at=\"textContent\" with=\"failed: $?\" />\n"
+    "        <forget on=\"$CRTN\" for=\"rdrState:domReqFailed\" />\n"
+    "    </observe>\n"
+    "    <observe on=\"$CRTN\" for=\"idle\">\n"
+    "        <forget on=\"$CRTN\" for=\"idle\" />\n"
+    "    </observe>\n"
+    "</body>\n"
+    "</hvml>\n";
+
+struct async_state {
+    /* the identifiers of the requests sent */
+    std::vector<std::string> sent;
+    /* the pending requests after every response dispatched */
+    std::vector<std::vector<std::string>> pending;
+    /* the number of the inflight DOM requests after every step */
+    std::vector<size_t> nr_inflight;
+    /* the eDOM when the coroutine exits */
+    std::string html;
+};
+
+static std::vector<std::string>
+pending_request_ids(pcrdr_conn *conn)
+{
+    std::vector<std::string> ids;
+
+    struct list_head *p;
+    for (p = conn->pending_requests.next; p != &conn->pending_requests;
+            p = p->next) {
+        struct pending_request *pr;
+        pr = list_entry(p, struct pending_request, list);
+        ids.push_back(purc_variant_get_string_const(pr->request_id));
+    }
+
+    return ids;
+}
+
+/* the responses dispatched in place of the ones of the headless renderer */
+static std::vector<pcrdr_msg *> injected_msgs;
+static pcrdr_extra_message_source saved_source;
+static void *saved_source_ctxt;
+
+static pcrdr_msg *
+inject_message(pcrdr_conn *conn, void *ctxt)
+{
+    UNUSED_PARAM(ctxt);
+
+    if (injected_msgs.empty()) {
+        return saved_source ? saved_source(conn, saved_source_ctxt) : NULL;
+    }
+
+    pcrdr_msg *msg = injected_msgs.front();
+    injected_msgs.erase(injected_msgs.begin());
+    return msg;
+}
+
+static int
+wait_no_message(pcrdr_conn *conn, int timeout_ms)
+{
+    UNUSED_PARAM(conn);
+    UNUSED_PARAM(timeout_ms);
+    return 0;
+}
+
+static void
+drain_dom_reqs(pcrdr_conn *conn, struct pcintr_heap *heap)
+{
+    while (heap->nr_inflight_dom_reqs > 0 &&
+            pcrdr_wait_and_dispatch_message(conn, 0) == 0);
+}
+
+static void
+keep_edom(purc_cond_t event, void *arg, void *data)
+{
+    purc_coroutine_t cor = (purc_coroutine_t)arg;
+    struct async_state *state =
+        (struct async_state *)purc_coroutine_get_user_data(cor);
+    struct purc_cor_exit_info *info = (struct purc_cor_exit_info *)data;
+
+    if (event != PURC_COND_COR_EXITED)
+        return;
+
+    purc_rwstream_t out = purc_rwstream_new_buffer(1024, 1024 * 1024);
+    purc_document_serialize_contents_to_stream(info->doc,
+            PCDOC_SERIALIZE_OPT_UNDEF, out);
+
+    size_t size = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(out, &size);
+    state->html.assign(buf, size);
+    purc_rwstream_destroy(out);
+}
+
+/* sends three requests and dispatches their responses in the order 3, 1, 2;
+   the first request fails */
+static int
+out_of_order_cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    keep_edom(event, arg, data);
+    if (event != PURC_COND_COR_ONE_RUN)
+        return 0;
+
+    struct purc_cor_run_info *info = (struct purc_cor_run_info *)data;
+    if (info->run_idx != 1)
+        return 0;
+
+    pcintr_coroutine_t co = (pcintr_coroutine_t)arg;
+    struct async_state *state =
+        (struct async_state *)purc_coroutine_get_user_data(co);
+    struct pcintr_heap *heap = co->owner;
+    pcrdr_conn *conn = purc_get_conn_to_renderer();
+    pcdoc_element_t status = pcdoc_find_element_in_document(info->doc,
+            "#status");
+
+    drain_dom_reqs(conn, heap);
+
+    /* the headless renderer answers nothing from now on */
+    int (*saved_wait_message)(pcrdr_conn *, int) = conn->wait_message;
+    conn->wait_message = wait_no_message;
+
+    for (int i = 0; i < 3; i++) {
+        pcintr_rdr_send_dom_req_simple_raw(&co->stack, PCDOC_OP_APPEND,
+                status, NULL, PCRDR_MSG_DATA_TYPE_HTML, "<b>x</b>", 0);
+    }
+    state->sent = pending_request_ids(conn);
+    state->nr_inflight.push_back(heap->nr_inflight_dom_reqs);
+
+    static const size_t order[] = { 2, 0, 1 };
+    for (size_t idx : order) {
+        injected_msgs.push_back(pcrdr_make_response_message(
+                    state->sent[idx].c_str(), NULL,
+                    idx == 0 ? PCRDR_SC_NOT_FOUND : PCRDR_SC_OK, 0,
+                    PCRDR_MSG_DATA_TYPE_VOID, NULL, 0));
+    }
+
+    saved_source = pcrdr_conn_set_extra_message_source(conn,
+            inject_message, NULL, &saved_source_ctxt);
+    while (!injected_msgs.empty()) {
+        pcrdr_wait_and_dispatch_message(conn, 0);
+        state->pending.push_back(pending_request_ids(conn));
+        state->nr_inflight.push_back(heap->nr_inflight_dom_reqs);
+    }
+    pcrdr_conn_set_extra_message_source(conn, saved_source,
+            saved_source_ctxt, NULL);
+    conn->wait_message = saved_wait_message;
+
+    purc_clr_error();
+    return 0;
+}
+
+/* the responses are matched by the request identifiers, and a failure
+   reaches the coroutine as a `rdrState:domReqFailed` event */
+TEST(dom_async, out_of_order)
+{
+    struct async_state state;
+    std::vector<rdr_msg> msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(async_page, PURC_ENVV_RDR_ASYNC_DOM,
+                out_of_order_cond_handler, &state, msgs));
+
+    ASSERT_EQ(state.sent.size(), 3u);
+    ASSERT_EQ(state.pending, std::vector<std::vector<std::string>>({
+                { state.sent[0], state.sent[1] },
+                { state.sent[1] },
+                { } }));
+    ASSERT_EQ(state.nr_inflight, std::vector<size_t>({ 3, 2, 1, 0 }));
+    ASSERT_NE(state.html.find("failed: 404"), std::string::npos)
+        << state.html;
+}
+
+/* sends more requests than MAX_INFLIGHT_DOM_REQS (256) in a row */
+static int
+back_pressure_cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    if (event != PURC_COND_COR_ONE_RUN)
+        return 0;
+
+    struct purc_cor_run_info *info = (struct purc_cor_run_info *)data;
+    if (info->run_idx != 1)
+        return 0;
+
+    pcintr_coroutine_t co = (pcintr_coroutine_t)arg;
+    struct async_state *state =
+        (struct async_state *)purc_coroutine_get_user_data(co);
+    pcdoc_element_t status = pcdoc_find_element_in_document(info->doc,
+            "#status");
+
+    drain_dom_reqs(purc_get_conn_to_renderer(), co->owner);
+    for (int i = 0; i < 300; i++) {
+        pcintr_rdr_send_dom_req_simple_raw(&co->stack, PCDOC_OP_APPEND,
+                status, NULL, PCRDR_MSG_DATA_TYPE_HTML, "<b>x</b>", 0);
+        state->nr_inflight.push_back(co->owner->nr_inflight_dom_reqs);
+    }
+
+    return 0;
+}
+
+TEST(dom_async, back_pressure)
+{
+    std::string page = make_list_page(0, "");
+    struct async_state state;
+    std::vector<rdr_msg> msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), PURC_ENVV_RDR_ASYNC_DOM,
+                back_pressure_cond_handler, &state, msgs));
+
+    ASSERT_EQ(state.nr_inflight.size(), 300u);
+    for (size_t i = 0; i < 256; i++)
+        ASSERT_EQ(state.nr_inflight[i], i + 1);
+    for (size_t i = 256; i < 300; i++)
+        ASSERT_EQ(state.nr_inflight[i], 256u);
+
+    /* the 257th request is sent after the first response */
+    std::set<std::string> outstanding;
+    size_t max_outstanding = 0;
+    for (const rdr_msg &msg : msgs) {
+        const std::string &request_id = msg.headers.at("requestId");
+        if (msg.request)
+            outstanding.insert(request_id);
+        else
+            outstanding.erase(request_id);
+        max_outstanding = std::max(max_outstanding, outstanding.size());
+    }
+    ASSERT_EQ(max_outstanding, 256u);
+
+    PurCInstance purc(PURC_MODULE_VARIANT, APP_NAME, RUNNER);
+    ASSERT_TRUE(purc);
+
+    dom_reqs reqs;
+    ASSERT_NO_FATAL_FAILURE(collect_dom_reqs(msgs, reqs));
+    /* e3 and e4 are <ul> and <p> */
+    ASSERT_EQ(reqs.ops.size(), 301u);
+    ASSERT_EQ(reqs.ops.front(), "update e4 textContent plain:done");
+    for (size_t i = 1; i < reqs.ops.size(); i++)
+        ASSERT_EQ(reqs.ops[i], "append e4  html:<b>x</b>") << i;
+}
+
+
+/* the contents written to the page writer in pieces of the given size,
+   and the chunks expected to be sent */
+struct page_case {
+    std::string contents;
+    size_t sz_piece;
+    std::vector<std::string> operations;
+    std::vector<size_t> chunk_lens;
+    int ret_code;
+};
+
+static int
+page_writer_cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    if (event != PURC_COND_COR_ONE_RUN)
+        return 0;
+
+    struct purc_cor_run_info *info = (struct purc_cor_run_info *)data;
+    if (info->run_idx != 0)
+        return 0;
+
+    pcintr_coroutine_t co = (pcintr_coroutine_t)arg;
+    std::vector<page_case> *cases =
+        (std::vector<page_case> *)purc_coroutine_get_user_data(co);
+
+    for (page_case &pc : *cases) {
+        struct page_writer *writer = pcintr_rdr_page_writer_new(
+                purc_get_conn_to_renderer(), PCRDR_MSG_TARGET_PLAINWINDOW,
+                co->target_page_handle, PCRDR_MSG_DATA_TYPE_HTML);
+        if (writer == NULL)
+            continue;
+
+        for (size_t pos = 0; pos < pc.contents.size(); pos += pc.sz_piece) {
+            size_t n = std::min(pc.sz_piece, pc.contents.size() - pos);
+            pcintr_rdr_page_writer_write(writer, pc.contents.data() + pos, n);
+        }
+
+        pcrdr_msg *response = pcintr_rdr_page_writer_end(writer);
+        pc.ret_code = response ? response->retCode : -1;
+        if (response)
+            pcrdr_release_message(response);
+    }
+
+    return 0;
+}
+
+/* a page is sent in chunks of at most DEF_LEN_ONE_WRITE (10240) bytes
+   which never split a UTF-8 character, and by `load` if it fits in one */
+TEST(page_writer, chunks)
+{
+    const size_t sz_chunk = 1024 * 10;
+    std::string a(sz_chunk, 'a');
+    std::vector<page_case> cases = {
+        { "", 1, { "load" }, { 0 }, 0 },
+        { a, sz_chunk, { "load" }, { sz_chunk }, 0 },
+        { a, 7, { "load" }, { sz_chunk }, 0 },
+        { a + a, sz_chunk, { "writeBegin", "writeEnd" },
+            { sz_chunk, sz_chunk }, 0 },
+        { a + a + a, 4096, { "writeBegin", "writeMore", "writeEnd" },
+            { sz_chunk, sz_chunk, sz_chunk }, 0 },
+        { a + "\xc3\xa9", 3, { "writeBegin", "writeEnd" },
+            { sz_chunk, 2 }, 0 },
+        /* a 3-byte and a 4-byte character straddling the first chunk */
+        { a.substr(1) + "\xe4\xb8\xad" + std::string(100, 'b'), 1,
+            { "writeBegin", "writeEnd" }, { sz_chunk - 1, 103 }, 0 },
+        { a.substr(2) + "\xf0\x9f\x98\x80" + "b", sz_chunk + 3,
+            { "writeBegin", "writeEnd" }, { sz_chunk - 2, 5 }, 0 },
+    };
+
+    std::string page = make_list_page(1, update_text);
+    std::vector<rdr_msg> msgs;
+    ASSERT_NO_FATAL_FAILURE(run_page(page.c_str(), NULL,
+                page_writer_cond_handler, &cases, msgs));
+
+    /* the page itself is loaded first */
+    std::vector<const rdr_msg *> chunks;
+    for (const rdr_msg &msg : msgs) {
+        auto it = msg.headers.find("operation");
+        if (msg.request && it != msg.headers.end() &&
+                is_load_operation(it->second))
+            chunks.push_back(&msg);
+    }
+    ASSERT_FALSE(chunks.empty());
+    ASSERT_EQ(chunks.front()->headers.at("operation"), "load");
+    chunks.erase(chunks.begin());
+
+    size_t idx = 0;
+    for (size_t i = 0; i < cases.size(); i++) {
+        const page_case &pc = cases[i];
+        ASSERT_EQ(pc.ret_code, PCRDR_SC_OK) << i;
+
+        std::vector<std::string> operations;
+        std::vector<size_t> chunk_lens;
+        std::string contents;
+        for (size_t j = 0; j < pc.operations.size(); j++, idx++) {
+            ASSERT_LT(idx, chunks.size()) << i;
+            operations.push_back(chunks[idx]->headers.at("operation"));
+            chunk_lens.push_back(chunks[idx]->data.size());
+            contents += chunks[idx]->data;
+        }
+
+        ASSERT_EQ(operations, pc.operations) << i;
+        ASSERT_EQ(chunk_lens, pc.chunk_lens) << i;
+        ASSERT_EQ(contents, pc.contents) << i;
+    }
+    ASSERT_EQ(idx, chunks.size());
+}
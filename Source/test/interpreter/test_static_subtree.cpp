@@ -0,0 +1,197 @@
+/*
+ * @file test_static_subtree.cpp
+ * @date 2022/10/19
+ * @brief The program to test the static subtrees built in one pass.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#undef NDEBUG
+
+#include "purc.h"
+#include "private/interpreter.h"
+#include "private/document.h"
+#include "private/vdom.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+/* every `@` is replaced by nothing to get the static subtrees, or by an
+   attribute having `hvml:` prefix, which is not set to the eDOM, to build
+   every element in a frame */
+static const char *page_template =
+"<!DOCTYPE hvml>\n"
+"<hvml target=\"html\">\n"
+"<head><title@>Static &amp; dynamic</title></head>\n"
+"<body>\n"
+"  <init as=\"word\" with=\"dynamic\" />\n"
+"  <div@ id=\"first\" class=\"a  b\" title=\"x &quot;y&quot; &lt;z&gt;\""
+        " data-empty=\"\">\n"
+"    <!-- a comment in a static subtree -->\n"
+"    <h1@>Title <b@>bold</b><i@>it&nbsp;alic</i></h1>\n"
+"    <p@ lang=\"en\">one\r\ntwo\rthree\xc2\xa0" "four &lt;&amp;&gt;</p>\n"
+"    <ul@><li@>1</li><li@ class=\"x\"><span@>2</span></li><li@></li></ul>\n"
+"    <input@ type=\"checkbox\" checked />\n"
+"  </div>\n"
+"  <p class=\"$word\">a $word sibling</p>\n"
+"  <section@><p@>after a <em@>dynamic</em> sibling</p><!-- end --></section>\n"
+"</body>\n"
+"</hvml>\n";
+
+static std::string
+make_page(const char *replacement)
+{
+    std::string page;
+    for (const char *p = page_template; *p; p++) {
+        if (*p == '@')
+            page += replacement;
+        else
+            page += *p;
+    }
+    return page;
+}
+
+static int
+collect_static(struct pcvdom_element *top, struct pcvdom_element *elem,
+        void *ctx)
+{
+    UNUSED_PARAM(top);
+
+    std::string *tags = (std::string *)ctx;
+    if (pcvdom_element_is_static_subtree(elem)) {
+        tags->append(pcvdom_element_get_tagname(elem));
+        tags->append(" ");
+    }
+    return 0;
+}
+
+static std::string
+static_tags(purc_vdom_t vdom)
+{
+    std::string tags;
+    pcvdom_element_traverse(pcvdom_document_get_root(vdom), &tags,
+            collect_static);
+    return tags;
+}
+
+/* the nodes with their exact text; the serializer trims the white spaces */
+static void
+dump_nodes(pcdom_node_t *node, std::string &out)
+{
+    size_t len;
+    const unsigned char *str;
+
+    for (; node; node = pcdom_node_next(node)) {
+        if (node->type == PCDOM_NODE_TYPE_ELEMENT) {
+            pcdom_element_t *elem = pcdom_interface_element(node);
+            str = pcdom_element_local_name(elem, &len);
+            std::string tag((const char *)str, len);
+
+            out += "<" + tag;
+            pcdom_attr_t *attr = pcdom_element_first_attribute(elem);
+            for (; attr; attr = pcdom_element_next_attribute(attr)) {
+                str = pcdom_attr_local_name(attr, &len);
+                out += " " + std::string((const char *)str, len);
+                str = pcdom_attr_value(attr, &len);
+                if (str)
+                    out += "=[" + std::string((const char *)str, len) + "]";
+            }
+            out += ">";
+            dump_nodes(pcdom_node_first_child(node), out);
+            out += "</" + tag + ">";
+        }
+        else if (node->type == PCDOM_NODE_TYPE_TEXT ||
+                node->type == PCDOM_NODE_TYPE_COMMENT) {
+            pcdom_character_data_t *data;
+            data = pcdom_interface_character_data(node);
+            out += node->type == PCDOM_NODE_TYPE_TEXT ? "[" : "<!--[";
+            out.append((const char *)data->data.data, data->data.length);
+            out += node->type == PCDOM_NODE_TYPE_TEXT ? "]" : "]-->";
+        }
+    }
+}
+
+struct edom {
+    std::string html;
+    std::string nodes;
+};
+
+static int
+cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    if (event == PURC_COND_COR_EXITED) {
+        purc_coroutine_t cor = (purc_coroutine_t)arg;
+        struct edom *edom = (struct edom *)purc_coroutine_get_user_data(cor);
+        struct purc_cor_exit_info *info = (struct purc_cor_exit_info *)data;
+
+        purc_rwstream_t out = purc_rwstream_new_buffer(1024, 1024 * 1024);
+        purc_document_serialize_contents_to_stream(info->doc,
+                PCDOC_SERIALIZE_OPT_UNDEF, out);
+
+        size_t size = 0;
+        const char *buf = (const char *)purc_rwstream_get_mem_buffer(out,
+                &size);
+        edom->html.assign(buf, size);
+        purc_rwstream_destroy(out);
+
+        dump_nodes(pcdom_node_first_child(
+                    pcdom_interface_node(info->doc->impl)), edom->nodes);
+    }
+
+    return 0;
+}
+
+/* the eDOM built from the static subtrees is byte-identical to the one
+   built frame by frame */
+TEST(static_subtree, same_edom)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hvml.test",
+            "static_subtree", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    std::string static_page = make_page("");
+    purc_vdom_t static_vdom = purc_load_hvml_from_string(static_page.c_str());
+    ASSERT_NE(static_vdom, nullptr);
+    ASSERT_EQ(static_tags(static_vdom),
+            "title div h1 b i p ul li li span li input section p em ");
+
+    std::string framed_page = make_page(" hvml:framed=\"yes\"");
+    purc_vdom_t framed_vdom = purc_load_hvml_from_string(framed_page.c_str());
+    ASSERT_NE(framed_vdom, nullptr);
+    ASSERT_EQ(static_tags(framed_vdom), "");
+
+    struct edom static_edom, framed_edom;
+    purc_coroutine_t cor = purc_schedule_vdom_null(static_vdom);
+    ASSERT_NE(cor, nullptr);
+    purc_coroutine_set_user_data(cor, &static_edom);
+    cor = purc_schedule_vdom_null(framed_vdom);
+    ASSERT_NE(cor, nullptr);
+    purc_coroutine_set_user_data(cor, &framed_edom);
+
+    purc_run(cond_handler);
+
+    ASSERT_NE(static_edom.nodes.find("<p class=[dynamic]>"),
+            std::string::npos) << static_edom.nodes;
+    ASSERT_NE(static_edom.nodes.find("three\xc2\xa0" "four <&>"),
+            std::string::npos) << static_edom.nodes;
+    ASSERT_EQ(static_edom.html, framed_edom.html);
+    ASSERT_EQ(static_edom.nodes, framed_edom.nodes);
+
+    purc_cleanup();
+}
@@ -0,0 +1,122 @@
+/*
+ * @file test_vdom_cache.cpp
+ * @date 2022/10/19
+ * @brief The program to test the LRU policy of the vDOM cache.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#undef NDEBUG
+
+#include "purc.h"
+#include "private/interpreter.h"
+#include "private/vdom.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+static std::string
+make_program(int n)
+{
+    return "<!DOCTYPE hvml><hvml target=\"html\"><body>"
+        "<p>Program " + std::to_string(n) + ": $SYSTEM.time</p>"
+        "</body></hvml>";
+}
+
+TEST(vdom_cache, lru)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hvml.test",
+            "vdom_cache", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    struct purc_vdom_cache_stats s0, s1;
+    ASSERT_TRUE(purc_get_vdom_cache_stats(&s0));
+
+    std::vector<purc_vdom_t> loaded;
+    std::string first = make_program(0);
+    purc_vdom_t vdom = purc_load_hvml_from_string(first.c_str());
+    ASSERT_NE(vdom, nullptr);
+    loaded.push_back(vdom);
+    ASSERT_EQ(purc_load_hvml_from_string(first.c_str()), vdom);
+    loaded.push_back(vdom);
+
+    for (int i = 1; i < 8; i++) {
+        std::string hvml = make_program(i);
+        vdom = purc_load_hvml_from_string(hvml.c_str());
+        ASSERT_NE(vdom, nullptr);
+        loaded.push_back(vdom);
+    }
+
+    ASSERT_TRUE(purc_get_vdom_cache_stats(&s1));
+    ASSERT_EQ(s1.nr_entries, s0.nr_entries + 8);
+    ASSERT_EQ(s1.nr_hits, s0.nr_hits + 1);
+    ASSERT_EQ(s1.nr_misses, s0.nr_misses + 8);
+    ASSERT_GT(s1.size, s0.size);
+    ASSERT_GT(s1.orig_size, s0.orig_size);
+
+    /* the vDOMs used by the coroutines must not be evicted */
+    for (size_t i = 0; i < loaded.size(); i++) {
+        ASSERT_NE(purc_schedule_vdom_null(loaded[i]), nullptr);
+    }
+
+    size_t old_budget = purc_set_vdom_cache_budget(1);
+    ASSERT_TRUE(purc_get_vdom_cache_stats(&s1));
+    ASSERT_EQ(s1.budget, 1U);
+    ASSERT_EQ(s1.nr_entries, s0.nr_entries + 8);
+
+    pcintr_sweep_vdom_cache();
+    ASSERT_TRUE(purc_get_vdom_cache_stats(&s1));
+    ASSERT_EQ(s1.nr_entries, s0.nr_entries + 8);
+
+    /* once the coroutines exit, the cache holds the only reference, so
+       the vDOMs are freed when they are evicted */
+    purc_run(NULL);
+    for (size_t i = 0; i < loaded.size(); i++) {
+        ASSERT_EQ(pcvdom_document_get_refc(loaded[i]), 1UL);
+    }
+
+    pcintr_sweep_vdom_cache();
+    ASSERT_TRUE(purc_get_vdom_cache_stats(&s1));
+    ASSERT_EQ(s1.nr_entries, 0U);
+    ASSERT_EQ(s1.size, 0U);
+    ASSERT_EQ(s1.orig_size, 0U);
+    ASSERT_GE(s1.nr_evictions, s0.nr_evictions + 8);
+
+    /* so are the vDOMs loaded but never scheduled */
+    std::string unused = make_program(8);
+    vdom = purc_load_hvml_from_string(unused.c_str());
+    ASSERT_NE(vdom, nullptr);
+    ASSERT_EQ(purc_load_hvml_from_string(unused.c_str()), vdom);
+    ASSERT_EQ(pcvdom_document_get_refc(vdom), 1UL);
+
+    pcintr_sweep_vdom_cache();
+    ASSERT_TRUE(purc_get_vdom_cache_stats(&s1));
+    ASSERT_EQ(s1.nr_entries, 0U);
+    ASSERT_GE(s1.nr_evictions, s0.nr_evictions + 9);
+
+    /* the evicted program is parsed again */
+    ASSERT_EQ(purc_set_vdom_cache_budget(old_budget), 1U);
+    ASSERT_NE(purc_load_hvml_from_string(first.c_str()), nullptr);
+    ASSERT_TRUE(purc_get_vdom_cache_stats(&s1));
+    ASSERT_EQ(s1.nr_entries, 1U);
+    ASSERT_EQ(s1.nr_misses, s0.nr_misses + 10);
+
+    purc_cleanup();
+}
@@ -21,8 +21,22 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
+static ssize_t write_to_string(void *ctxt, const void *buf, size_t count)
+{
+    std::string *str = (std::string *)ctxt;
+    str->append((const char *)buf, count);
+    return count;
+}
+
 #define ATOM_BITS_NR        (sizeof(purc_atom_t) << 3)
 #define BUCKET_BITS(bucket)       \
     ((purc_atom_t)bucket << (ATOM_BITS_NR - PURC_ATOM_BUCKET_BITS))
@@ -93,3 +107,507 @@ TEST(instance, messages)
     purc_cleanup();
 }
 
+TEST(instance, binary_messages)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, NULL, NULL, NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_variant_t data = purc_variant_make_from_json_string(
+            "{ \"name\": \"item\", \"count\": 3, \"ratio\": 0.5, "
+            "\"flags\": [ true, false, null ], \"nested\": { \"a\": [] } }",
+            (size_t)-1);
+    ASSERT_NE(data, PURC_VARIANT_INVALID);
+
+    pcrdr_msg *msgs[3];
+    msgs[0] = pcrdr_make_request_message(PCRDR_MSG_TARGET_DOM,
+            0x7f3c2a40, PCRDR_OPERATION_UPDATE, "request-id", NULL,
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, "10000", "textContent",
+            PCRDR_MSG_DATA_TYPE_PLAIN, "The data", 0);
+    msgs[1] = pcrdr_make_response_message("request-id", NULL,
+            PCRDR_SC_OK, 0x1234, PCRDR_MSG_DATA_TYPE_JSON, NULL, 0);
+    msgs[1]->data = data;
+    msgs[2] = pcrdr_make_event_message(PCRDR_MSG_TARGET_PLAINWINDOW,
+            0x5678, "click", "edpt://localhost/app/runner",
+            PCRDR_MSG_ELEMENT_TYPE_ID, "the-button", NULL,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+
+    for (size_t i = 0; i < PCA_TABLESIZE(msgs); i++) {
+        ASSERT_NE(msgs[i], nullptr);
+
+        std::string packet;
+        ret = pcrdr_serialize_message_binary(msgs[i], write_to_string,
+                &packet);
+        ASSERT_EQ(ret, 0);
+        ASSERT_TRUE(pcrdr_is_binary_packet(packet.data(), packet.size()));
+
+        /* pcrdr_parse_packet() recognizes a binary packet */
+        pcrdr_msg *msg_parsed = NULL;
+        ret = pcrdr_parse_packet(&packet[0], packet.size(), &msg_parsed);
+        ASSERT_EQ(ret, 0);
+        ASSERT_EQ(pcrdr_compare_messages(msgs[i], msg_parsed), 0);
+        pcrdr_release_message(msg_parsed);
+
+        /* a truncated packet must be refused */
+        msg_parsed = NULL;
+        ret = pcrdr_parse_packet_binary(packet.data(), packet.size() - 1,
+                &msg_parsed);
+        ASSERT_NE(ret, 0);
+        ASSERT_EQ(msg_parsed, nullptr);
+
+        pcrdr_release_message(msgs[i]);
+    }
+
+    purc_cleanup();
+}
+
+struct fake_responses {
+    std::vector<std::string> request_ids;
+    size_t next;
+};
+
+/* returns the responses in the order given by the test */
+static pcrdr_msg *fake_response_source(pcrdr_conn *conn, void *ctxt)
+{
+    (void)conn;
+    struct fake_responses *responses = (struct fake_responses *)ctxt;
+
+    if (responses->next >= responses->request_ids.size())
+        return NULL;
+
+    const char *request_id =
+        responses->request_ids[responses->next++].c_str();
+    return pcrdr_make_response_message(request_id, NULL,
+            PCRDR_SC_OK, 0, PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+}
+
+struct handled_response {
+    std::string request_id;
+    int state;
+};
+
+static int record_response(pcrdr_conn* conn,
+        const char *request_id, int state,
+        void *context, const pcrdr_msg *response_msg)
+{
+    (void)conn;
+    (void)response_msg;
+
+    std::vector<handled_response> *handled =
+        (std::vector<handled_response> *)context;
+    handled->push_back({ request_id, state });
+    return 0;
+}
+
+TEST(instance, out_of_order_responses)
+{
+    int ret = purc_init_ex(PURC_MODULE_PCRDR, "cn.fmsoft.purc.test",
+            "messages", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    pcrdr_conn *conn = purc_get_conn_to_renderer();
+    ASSERT_NE(conn, nullptr);
+
+    std::vector<handled_response> handled;
+    const char *request_ids[] = { "req-0", "req-1", "req-2", "req-3" };
+    for (size_t i = 0; i < PCA_TABLESIZE(request_ids); i++) {
+        purc_variant_t v = purc_variant_make_string_static(request_ids[i],
+                false);
+        ret = pcrdr_set_handler_for_response_from_extra_source(conn, v, 10,
+                &handled, record_response);
+        purc_variant_unref(v);
+        ASSERT_EQ(ret, 0);
+    }
+    ASSERT_EQ(pcrdr_conn_pending_requests_count(conn), 4U);
+
+    struct fake_responses responses;
+    responses.request_ids = { "req-2", "req-0", "req-3", "req-1" };
+    responses.next = 0;
+    pcrdr_conn_set_extra_message_source(conn, fake_response_source,
+            &responses, NULL);
+
+    for (int i = 0; i < 8 && pcrdr_conn_pending_requests_count(conn); i++) {
+        pcrdr_wait_and_dispatch_message(conn, 0);
+    }
+
+    ASSERT_EQ(handled.size(), 4U);
+    for (size_t i = 0; i < handled.size(); i++) {
+        ASSERT_EQ(handled[i].request_id, responses.request_ids[i]);
+        ASSERT_EQ(handled[i].state, PCRDR_RESPONSE_RESULT);
+    }
+    ASSERT_EQ(pcrdr_conn_pending_requests_count(conn), 0U);
+
+    /* the request expecting the response earlier times out first */
+    handled.clear();
+    purc_variant_t v;
+    v = purc_variant_make_string_static("req-long", false);
+    pcrdr_set_handler_for_response_from_extra_source(conn, v, 3600,
+            &handled, record_response);
+    purc_variant_unref(v);
+    v = purc_variant_make_string_static("req-short", false);
+    pcrdr_set_handler_for_response_from_extra_source(conn, v, 1,
+            &handled, record_response);
+    purc_variant_unref(v);
+
+    for (int i = 0; i < 30 && handled.empty(); i++) {
+        pcrdr_wait_and_dispatch_message(conn, 100);
+    }
+
+    ASSERT_EQ(handled.size(), 1U);
+    ASSERT_EQ(handled[0].request_id, "req-short");
+    ASSERT_EQ(handled[0].state, PCRDR_RESPONSE_TIMEOUT);
+    ASSERT_EQ(pcrdr_conn_pending_requests_count(conn), 1U);
+
+    pcrdr_conn_set_extra_message_source(conn, NULL, NULL, NULL);
+    purc_cleanup();
+}
+
+#define NR_DOM_OPS      1000
+
+static pcrdr_msg *make_dom_request(const char *operation,
+        const char *element, pcrdr_msg_data_type data_type,
+        purc_variant_t data)
+{
+    pcrdr_msg *msg;
+    msg = pcrdr_make_request_message(PCRDR_MSG_TARGET_DOM,
+            0x7f3c2a40, operation, NULL, NULL,
+            element ? PCRDR_MSG_ELEMENT_TYPE_HANDLE :
+                PCRDR_MSG_ELEMENT_TYPE_VOID, element, NULL,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+    msg->dataType = data_type;
+    msg->data = data;
+    return msg;
+}
+
+/* makes the data of a batch of `append` operations */
+static purc_variant_t make_batch_data(int nr_ops)
+{
+    char element[32];
+    char content[64];
+
+    purc_variant_t batch = purc_variant_make_array_0();
+    for (int i = 0; i < nr_ops; i++) {
+        snprintf(element, sizeof(element), "%x", 0x10000 + i);
+        snprintf(content, sizeof(content), "<li>item %d</li>", i);
+
+        purc_variant_t op = purc_variant_make_object_0();
+        purc_variant_t v;
+        v = purc_variant_make_string_static(PCRDR_OPERATION_APPEND, false);
+        purc_variant_object_set_by_static_ckey(op, "operation", v);
+        purc_variant_unref(v);
+        v = purc_variant_make_string(element, false);
+        purc_variant_object_set_by_static_ckey(op, "element", v);
+        purc_variant_unref(v);
+        v = purc_variant_make_string_static("html", false);
+        purc_variant_object_set_by_static_ckey(op, "dataType", v);
+        purc_variant_unref(v);
+        v = purc_variant_make_string(content, false);
+        purc_variant_object_set_by_static_ckey(op, "data", v);
+        purc_variant_unref(v);
+
+        purc_variant_array_append(batch, op);
+        purc_variant_unref(op);
+    }
+
+    return batch;
+}
+
+/* serializes the message and parses it as the renderer does */
+static size_t transfer_message(pcrdr_msg *msg)
+{
+    std::string packet;
+    pcrdr_serialize_message(msg, write_to_string, &packet);
+
+    pcrdr_msg *msg_parsed = NULL;
+    int ret = pcrdr_parse_packet(&packet[0], packet.size(), &msg_parsed);
+    if (ret == 0)
+        pcrdr_release_message(msg_parsed);
+
+    pcrdr_release_message(msg);
+    return packet.size();
+}
+
+TEST(dom_batch, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops <= 0) {
+        nr_loops = 10;
+    }
+
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, NULL, NULL, NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    char element[32];
+    char content[64];
+    size_t single_bytes = 0, batch_bytes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        for (int i = 0; i < NR_DOM_OPS; i++) {
+            snprintf(element, sizeof(element), "%x", 0x10000 + i);
+            snprintf(content, sizeof(content), "<li>item %d</li>", i);
+            pcrdr_msg *msg = make_dom_request(PCRDR_OPERATION_APPEND, element,
+                    PCRDR_MSG_DATA_TYPE_HTML,
+                    purc_variant_make_string(content, false));
+            single_bytes += transfer_message(msg);
+        }
+    }
+    auto single = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        pcrdr_msg *msg = make_dom_request(PCRDR_OPERATION_BATCH, NULL,
+                PCRDR_MSG_DATA_TYPE_JSON, make_batch_data(NR_DOM_OPS));
+        batch_bytes += transfer_message(msg);
+    }
+    auto batched = std::chrono::steady_clock::now() - start;
+
+    long long single_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(single).count();
+    long long batched_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(batched).count();
+    if (single_us == 0)
+        single_us = 1;
+    if (batched_us == 0)
+        batched_us = 1;
+
+    size_t nr_ops = nr_loops * NR_DOM_OPS;
+    fprintf(stderr, "%zu DOM operations\n", nr_ops);
+    fprintf(stderr, "single: %8zu messages, %10zu bytes, %10.0f msgs/s, "
+            "%10.0f ops/s\n",
+            nr_ops, single_bytes,
+            nr_ops * 1000000.0 / single_us, nr_ops * 1000000.0 / single_us);
+    fprintf(stderr, "batch:  %8zu messages, %10zu bytes, %10.0f msgs/s, "
+            "%10.0f ops/s\n",
+            nr_loops, batch_bytes,
+            nr_loops * 1000000.0 / batched_us, nr_ops * 1000000.0 / batched_us);
+
+    ASSERT_LT(batch_bytes, single_bytes);
+
+    purc_cleanup();
+}
+
+#define NR_PERF_MSGS    100
+
+TEST(binary_messages, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops <= 0) {
+        nr_loops = 10;
+    }
+
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, NULL, NULL, NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    /* a mix of small HTML updates and batches with JSON data */
+    std::vector<pcrdr_msg *> msgs;
+    char element[32];
+    char content[64];
+    for (int i = 0; i < NR_PERF_MSGS; i++) {
+        snprintf(element, sizeof(element), "%x", 0x10000 + i);
+        snprintf(content, sizeof(content), "<li>item %d</li>", i);
+        msgs.push_back(make_dom_request(PCRDR_OPERATION_APPEND, element,
+                PCRDR_MSG_DATA_TYPE_HTML,
+                purc_variant_make_string(content, false)));
+        if (i % 10 == 0) {
+            msgs.push_back(make_dom_request(PCRDR_OPERATION_BATCH, NULL,
+                    PCRDR_MSG_DATA_TYPE_JSON, make_batch_data(32)));
+        }
+    }
+
+    size_t text_bytes = 0, binary_bytes = 0;
+    std::string packet;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        for (size_t i = 0; i < msgs.size(); i++) {
+            packet.clear();
+            pcrdr_serialize_message(msgs[i], write_to_string, &packet);
+            text_bytes += packet.size();
+
+            pcrdr_msg *msg_parsed = NULL;
+            ret = pcrdr_parse_packet(&packet[0], packet.size(), &msg_parsed);
+            ASSERT_EQ(ret, 0);
+            pcrdr_release_message(msg_parsed);
+        }
+    }
+    auto text = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        for (size_t i = 0; i < msgs.size(); i++) {
+            packet.clear();
+            pcrdr_serialize_message_binary(msgs[i], write_to_string, &packet);
+            binary_bytes += packet.size();
+
+            pcrdr_msg *msg_parsed = NULL;
+            ret = pcrdr_parse_packet_binary(packet.data(), packet.size(),
+                    &msg_parsed);
+            ASSERT_EQ(ret, 0);
+            pcrdr_release_message(msg_parsed);
+        }
+    }
+    auto binary = std::chrono::steady_clock::now() - start;
+
+    for (size_t i = 0; i < msgs.size(); i++)
+        pcrdr_release_message(msgs[i]);
+
+    long long text_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(text).count();
+    long long binary_us = std::chrono::duration_cast<
+        std::chrono::microseconds>(binary).count();
+    if (text_us == 0)
+        text_us = 1;
+    if (binary_us == 0)
+        binary_us = 1;
+
+    size_t nr_msgs = nr_loops * msgs.size();
+    fprintf(stderr, "%zu messages serialized and parsed\n", nr_msgs);
+    fprintf(stderr, "text:   %10zu bytes, %10.0f msgs/s\n",
+            text_bytes, nr_msgs * 1000000.0 / text_us);
+    fprintf(stderr, "binary: %10zu bytes, %10.0f msgs/s\n",
+            binary_bytes, nr_msgs * 1000000.0 / binary_us);
+
+    ASSERT_LT(binary_bytes, text_bytes);
+
+    purc_cleanup();
+}
+
+static bool read_fully(int fd, void *buf, size_t sz)
+{
+    char *p = (char *)buf;
+    while (sz > 0) {
+        ssize_t n = read(fd, p, sz);
+        if (n <= 0)
+            return false;
+        p += n;
+        sz -= n;
+    }
+    return true;
+}
+
+/* a fake PurCMC server which accepts one client and counts the payload */
+static void purcmc_sink(int listen_fd, std::string caps, size_t *nr_bytes)
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+        return;
+
+    USFrameHeader header;
+    header.op = US_OPCODE_TEXT;
+    header.fragmented = 0;
+    header.sz_payload = caps.size();
+    if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+            write(fd, caps.data(), caps.size()) != (ssize_t)caps.size()) {
+        close(fd);
+        return;
+    }
+
+    std::vector<char> payload(PCRDR_MAX_FRAME_PAYLOAD_SIZE);
+    while (read_fully(fd, &header, sizeof(header))) {
+        if (header.op == US_OPCODE_CLOSE)
+            break;
+        if (header.sz_payload > payload.size() ||
+                !read_fully(fd, payload.data(), header.sz_payload))
+            break;
+        *nr_bytes += header.sz_payload;
+    }
+
+    close(fd);
+}
+
+#define NR_SOCKET_MSGS  1000
+
+TEST(purcmc_send, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops <= 0) {
+        nr_loops = 10;
+    }
+
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test",
+            "messages", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/purc-test-purcmc-%d.sock", getpid());
+    unlink(path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(listen_fd, 0);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    ASSERT_EQ(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    ASSERT_EQ(listen(listen_fd, 1), 0);
+
+    pcrdr_msg *caps_msg = pcrdr_make_response_message("0", NULL,
+            PCRDR_SC_OK, 0, PCRDR_MSG_DATA_TYPE_PLAIN,
+            "PURCMC:100\nHTML:5.3\nworkspace:0/tabbedWindow:0"
+            "/widgetInTabbedWindow:0/plainWindow:-1", 0);
+    std::string caps;
+    pcrdr_serialize_message(caps_msg, write_to_string, &caps);
+    pcrdr_release_message(caps_msg);
+
+    size_t received = 0;
+    std::thread sink(purcmc_sink, listen_fd, caps, &received);
+
+    std::string uri = std::string("unix://") + path;
+    pcrdr_conn *conn = NULL;
+    pcrdr_msg *msg = pcrdr_purcmc_connect(uri.c_str(),
+            "cn.fmsoft.purc.test", "messages", &conn);
+    ASSERT_NE(msg, nullptr);
+    pcrdr_release_message(msg);
+
+    /* DOM updates with small and large HTML fragments */
+    std::string fragment;
+    for (int i = 0; fragment.size() < 64 * 1024; i++) {
+        fragment += "<li class=\"item\">item ";
+        fragment += std::to_string(i);
+        fragment += "</li>";
+    }
+
+    char element[32];
+    size_t sent = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        for (int i = 0; i < NR_SOCKET_MSGS; i++) {
+            size_t len = (i % 10 == 0) ? fragment.size() : 256;
+            snprintf(element, sizeof(element), "%x", 0x10000 + i);
+            msg = make_dom_request(PCRDR_OPERATION_DISPLACE, element,
+                    PCRDR_MSG_DATA_TYPE_HTML,
+                    purc_variant_make_string_ex(fragment.data(), len, false));
+            /* no response is expected from the sink */
+            ret = pcrdr_send_request(conn, msg, 3600, NULL, NULL);
+            pcrdr_release_message(msg);
+            ASSERT_EQ(ret, 0);
+            sent += len;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    pcrdr_disconnect(conn);
+    sink.join();
+    close(listen_fd);
+    unlink(path);
+
+    long long us = std::chrono::duration_cast<
+        std::chrono::microseconds>(elapsed).count();
+    if (us == 0)
+        us = 1;
+
+    size_t nr_msgs = nr_loops * NR_SOCKET_MSGS;
+    fprintf(stderr, "%zu messages sent over a Unix socket\n", nr_msgs);
+    fprintf(stderr, "%10zu bytes of data, %10zu bytes received, "
+            "%10.0f msgs/s, %8.1f MiB/s\n",
+            sent, received, nr_msgs * 1000000.0 / us,
+            received / 1048576.0 * 1000000.0 / us);
+
+    ASSERT_GT(received, sent);
+
+    purc_cleanup();
+}
@@ -24,6 +24,8 @@
 #include <stdio.h>
 #include <errno.h>
 #include <gtest/gtest.h>
+#include <chrono>
+#include <string>
 
 static inline int my_puts(const char* str)
 {
@@ -994,3 +996,98 @@ TEST(variant, serialize_object_with_empty_key2)
 
     purc_cleanup ();
 }
+
+static std::string
+serialize_to_string(purc_variant_t v, unsigned int flags)
+{
+    purc_rwstream_t rws = purc_rwstream_new_buffer(1024, 1024 * 1024 * 16);
+    purc_variant_serialize(v, rws, 0, flags, NULL);
+
+    size_t size = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(rws, &size);
+    std::string result(buf, size);
+    purc_rwstream_destroy(rws);
+    return result;
+}
+
+// to test: the characters to escape at every position around the blocks
+// scanned in bulk
+TEST(variant, serialize_string_escapes)
+{
+    int ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "variant", NULL);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    for (size_t k = 0; k < 70; k++) {
+        std::string run(k, 'x');
+        std::string str = run + "\"" + run + "\\\\/\x01" + run + "\n\t" + "中";
+        std::string escaped = "\"" + run + "\\\"" + run + "\\\\\\\\";
+        std::string expected = escaped + "\\/\\u0001" + run + "\\n\\t中\"";
+        std::string expected_noslash = escaped + "/\\u0001" + run +
+            "\\n\\t中\"";
+
+        purc_variant_t v = purc_variant_make_string(str.c_str(), false);
+        ASSERT_NE(v, PURC_VARIANT_INVALID);
+        ASSERT_EQ(serialize_to_string(v, PCVARIANT_SERIALIZE_OPT_PLAIN),
+                expected);
+        ASSERT_EQ(serialize_to_string(v, PCVARIANT_SERIALIZE_OPT_PLAIN |
+                    PCVARIANT_SERIALIZE_OPT_NOSLASHESCAPE), expected_noslash);
+        purc_variant_unref(v);
+    }
+
+    /* a long run of the characters to escape */
+    std::string ctrls(300, '\x1f');
+    purc_variant_t v = purc_variant_make_string(ctrls.c_str(), false);
+    ASSERT_NE(v, PURC_VARIANT_INVALID);
+    std::string expected = "\"";
+    for (size_t i = 0; i < ctrls.size(); i++)
+        expected += "\\u001f";
+    expected += "\"";
+    ASSERT_EQ(serialize_to_string(v, PCVARIANT_SERIALIZE_OPT_PLAIN),
+            expected);
+    purc_variant_unref(v);
+
+    purc_cleanup ();
+}
+
+TEST(serialize_string, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops == 0)
+        GTEST_SKIP() << "LOOPS is not set";
+
+    int ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "variant", NULL);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    /* a text with a quoted phrase and a line break every 200 bytes */
+    std::string text;
+    for (int i = 0; i < 5000; i++) {
+        text += std::string(80, 'a') + " \"quoted\" " + std::string(100, 'b');
+        text += "\n";
+    }
+
+    purc_variant_t v = purc_variant_make_string(text.c_str(), false);
+    ASSERT_NE(v, PURC_VARIANT_INVALID);
+
+    purc_rwstream_t rws = purc_rwstream_new_buffer(1024, 1024 * 1024 * 16);
+    size_t nr_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        purc_rwstream_seek(rws, 0, SEEK_SET);
+        ssize_t nr = purc_variant_serialize(v, rws, 0,
+                PCVARIANT_SERIALIZE_OPT_PLAIN, NULL);
+        ASSERT_GT(nr, 0);
+        nr_bytes += text.size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double secs = std::chrono::duration<double>(elapsed).count();
+    fprintf(stderr, "%zu bytes serialized, %8.2f MiB/s\n", nr_bytes,
+            nr_bytes / secs / (1024 * 1024));
+
+    purc_rwstream_destroy(rws);
+    purc_variant_unref(v);
+    purc_cleanup ();
+}
@@ -0,0 +1,449 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/vcm.h"
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+static const char *data_json =
+    "{"
+    "  \"title\": \"Object title\","
+    "  \"name\": \"PurC\","
+    "  \"flag\": true,"
+    "  \"arr\": [ 1, 2, 3, \"four\" ],"
+    "  \"obj\": { \"inner\": { \"value\": 3.14 } }"
+    "}";
+
+static const char *expressions[] = {
+    "$DATA",
+    "$DATA.title",
+    "$DATA['name']",
+    "$DATA.arr[1]",
+    "$DATA.arr[-1]",
+    "$DATA.arr[10]",
+    "$DATA.obj.inner.value",
+    "$DATA.missing",
+    "$NOVAR",
+    "$NOVAR.x",
+    "[ 1, 2.5, \"str\", true, false, null, $DATA.title ]",
+    "{ \"a\": $DATA.arr, \"b\": { \"c\": 1 }, \"d\": bx0A0B }",
+    "\"Hello, $DATA.name!\"",
+    "\"$DATA.arr[0] and $DATA.obj.inner.value\"",
+    "$STR.contains($DATA.title, 'title')",
+    "$STR.join('a', 'b', $DATA.name)",
+    "$STR.nonexistent('a')",
+    "$EJSON.type($DATA.arr)",
+    "$EJSON.count($DATA.arr)",
+    "$DATA.title($DATA.name)",
+    "{{ $DATA.flag && $DATA.title || 'no' }}",
+    "{{ $DATA.missing && $DATA.title || 'no' }}",
+    "{{ $DATA.missing || $DATA.name && $DATA.title }}",
+    "{{ $DATA.title ; $DATA.name }}",
+    "{{ $DATA.title ; }}",
+    "$NATIVE.value",
+    "$NATIVE.add(2)",
+    "$NATIVE.missing",
+    "$NATIVE.missing(2)",
+};
+
+struct native_entity {
+    int64_t value;
+    int nr_lookups;
+};
+
+static purc_variant_t
+native_value(void *entity, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    (void)nr_args;
+    (void)argv;
+    (void)silently;
+    return purc_variant_make_longint(((struct native_entity *)entity)->value);
+}
+
+static purc_variant_t
+native_add(void *entity, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    (void)silently;
+    int64_t n = 0;
+    if (nr_args > 0)
+        purc_variant_cast_to_longint(argv[0], &n, false);
+    return purc_variant_make_longint(
+            ((struct native_entity *)entity)->value + n);
+}
+
+static struct native_entity native = { 40, 0 };
+
+static purc_nvariant_method native_getter(const char *name)
+{
+    native.nr_lookups++;
+    if (strcmp(name, "value") == 0)
+        return native_value;
+    if (strcmp(name, "add") == 0)
+        return native_add;
+    return NULL;
+}
+
+static struct purc_native_ops native_ops = {
+    .property_getter       = native_getter,
+    .property_setter       = NULL,
+    .property_cleaner      = NULL,
+    .property_eraser       = NULL,
+
+    .updater               = NULL,
+    .cleaner               = NULL,
+    .eraser                = NULL,
+    .match_observe         = NULL,
+
+    .on_observe           = NULL,
+    .on_forget            = NULL,
+    .on_release           = NULL,
+};
+
+static purc_variant_t find_var(void *ctxt, const char *name)
+{
+    return purc_variant_object_get_by_ckey((purc_variant_t)ctxt, name);
+}
+
+class test_vcm_bytecode : public testing::Test
+{
+protected:
+    void SetUp() {
+        purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hybridos.test",
+                "vcm_bytecode", NULL);
+
+        vars = purc_variant_make_object(0, PURC_VARIANT_INVALID,
+                PURC_VARIANT_INVALID);
+        ASSERT_NE(vars, nullptr);
+
+        purc_variant_t v = purc_variant_make_from_json_string(data_json,
+                strlen(data_json));
+        ASSERT_NE(v, nullptr);
+        purc_variant_object_set_by_static_ckey(vars, "DATA", v);
+        purc_variant_unref(v);
+
+        v = purc_dvobj_string_new();
+        purc_variant_object_set_by_static_ckey(vars, "STR", v);
+        purc_variant_unref(v);
+
+        v = purc_dvobj_ejson_new();
+        purc_variant_object_set_by_static_ckey(vars, "EJSON", v);
+        purc_variant_unref(v);
+
+        v = purc_variant_make_native(&native, &native_ops);
+        purc_variant_object_set_by_static_ckey(vars, "NATIVE", v);
+        purc_variant_unref(v);
+    }
+
+    void TearDown() {
+        purc_variant_unref(vars);
+        purc_cleanup();
+    }
+
+    struct pcvcm_node *parse(const char *expr) {
+        struct purc_ejson_parse_tree *ptree;
+        ptree = purc_variant_ejson_parse_string(expr, strlen(expr));
+        return (struct pcvcm_node *)ptree;
+    }
+
+    purc_variant_t vars;
+};
+
+TEST_F(test_vcm_bytecode, same_as_tree_walker)
+{
+    for (size_t i = 0; i < PCA_TABLESIZE(expressions); i++) {
+        struct pcvcm_node *tree = parse(expressions[i]);
+        ASSERT_NE(tree, nullptr) << expressions[i];
+
+        struct pcvcm_bytecode *bc = pcvcm_bytecode_compile(tree);
+        ASSERT_NE(bc, nullptr) << expressions[i];
+        ASSERT_GT(pcvcm_bytecode_length(bc), 0u);
+
+        for (int silently = 0; silently < 2; silently++) {
+            purc_variant_t expected = pcvcm_eval_walk_ex(tree, find_var,
+                    vars, silently);
+            purc_variant_t result = pcvcm_bytecode_eval(bc, find_var,
+                    vars, silently);
+
+            if (expected == PURC_VARIANT_INVALID) {
+                ASSERT_EQ(result, nullptr) << expressions[i];
+                continue;
+            }
+
+            ASSERT_NE(result, nullptr) << expressions[i];
+            ASSERT_TRUE(purc_variant_is_equal_to(expected, result))
+                << expressions[i];
+            purc_variant_unref(expected);
+            purc_variant_unref(result);
+        }
+
+        pcvcm_bytecode_destroy(bc);
+        pcvcm_node_destroy(tree);
+    }
+}
+
+TEST_F(test_vcm_bytecode, lazy_compilation)
+{
+    struct pcvcm_node *tree = parse("$DATA.arr[1]");
+    ASSERT_NE(tree, nullptr);
+
+    /* the first evaluation walks the tree; the second one compiles it */
+    for (int i = 0; i < 3; i++) {
+        purc_variant_t v = pcvcm_eval_ex(tree, find_var, vars, false);
+        ASSERT_NE(v, nullptr);
+
+        int64_t i64 = 0;
+        ASSERT_TRUE(purc_variant_cast_to_longint(v, &i64, false));
+        ASSERT_EQ(i64, 2);
+        purc_variant_unref(v);
+    }
+
+    pcvcm_node_destroy(tree);
+}
+
+TEST_F(test_vcm_bytecode, uncompilable)
+{
+    /* malformed CJSONEE is left to the tree walker */
+    struct pcvcm_node *tree = pcvcm_node_new_cjsonee();
+    ASSERT_NE(tree, nullptr);
+    ASSERT_EQ(pcvcm_bytecode_compile(tree), nullptr);
+
+    purc_variant_t v = pcvcm_eval_ex(tree, find_var, vars, true);
+    ASSERT_NE(v, nullptr);
+    ASSERT_TRUE(purc_variant_is_undefined(v));
+    purc_variant_unref(v);
+
+    pcvcm_node_destroy(tree);
+}
+
+TEST(vcm_var_ref, classify)
+{
+    struct pcvcm_var_ref *ref;
+
+    ref = pcvcm_var_ref_new("DATA");
+    ASSERT_NE(ref, nullptr);
+    ASSERT_EQ(ref->kind, PCVCM_VAR_NAMED);
+    ASSERT_STREQ(ref->name, "DATA");
+    pcvcm_var_ref_destroy(ref);
+
+    ref = pcvcm_var_ref_new("?");
+    ASSERT_NE(ref, nullptr);
+    ASSERT_EQ(ref->kind, PCVCM_VAR_SYMBOLIZED);
+    ASSERT_EQ(ref->number, 1u);
+    ASSERT_EQ(ref->symbol, '?');
+    pcvcm_var_ref_destroy(ref);
+
+    ref = pcvcm_var_ref_new("12@");
+    ASSERT_NE(ref, nullptr);
+    ASSERT_EQ(ref->kind, PCVCM_VAR_SYMBOLIZED);
+    ASSERT_EQ(ref->number, 12u);
+    ASSERT_EQ(ref->symbol, '@');
+    pcvcm_var_ref_destroy(ref);
+
+    ref = pcvcm_var_ref_new("#anchor<");
+    ASSERT_NE(ref, nullptr);
+    ASSERT_EQ(ref->kind, PCVCM_VAR_ANCHORED);
+    ASSERT_STREQ(ref->anchor, "anchor");
+    ASSERT_EQ(ref->symbol, '<');
+    pcvcm_var_ref_destroy(ref);
+}
+
+struct ref_ctxt {
+    purc_variant_t vars;
+    const struct pcvcm_var_ref *last_ref;
+    int nr_calls;
+};
+
+static purc_variant_t find_var_ref(void *ctxt,
+        const struct pcvcm_var_ref *ref)
+{
+    struct ref_ctxt *c = (struct ref_ctxt *)ctxt;
+    c->last_ref = ref;
+    c->nr_calls++;
+    return purc_variant_object_get_by_ckey(c->vars, ref->name);
+}
+
+TEST_F(test_vcm_bytecode, find_var_ref)
+{
+    struct pcvcm_node *tree = parse("[ $DATA.name, $DATA.title ]");
+    ASSERT_NE(tree, nullptr);
+
+    struct pcvcm_bytecode *bc = pcvcm_bytecode_compile(tree);
+    ASSERT_NE(bc, nullptr);
+
+    struct ref_ctxt c = { vars, NULL, 0 };
+    const struct pcvcm_var_ref *refs[2];
+    for (int i = 0; i < 2; i++) {
+        purc_variant_t v = pcvcm_bytecode_eval_ex(bc, NULL, find_var_ref,
+                &c, false);
+        ASSERT_NE(v, nullptr);
+        ASSERT_EQ(purc_variant_array_get_size(v), 2u);
+        purc_variant_unref(v);
+        refs[i] = c.last_ref;
+    }
+
+    /* the references are parsed once, so they can be used as keys */
+    ASSERT_EQ(c.nr_calls, 4);
+    ASSERT_NE(refs[0], nullptr);
+    ASSERT_EQ(refs[0], refs[1]);
+
+    pcvcm_bytecode_destroy(bc);
+    pcvcm_node_destroy(tree);
+}
+
+TEST_F(test_vcm_bytecode, native_inline_cache)
+{
+    static const char *exprs[] = {
+        "$NATIVE.value",
+        "$NATIVE.add(2)",
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(exprs); i++) {
+        struct pcvcm_node *tree = parse(exprs[i]);
+        ASSERT_NE(tree, nullptr);
+
+        struct pcvcm_bytecode *bc = pcvcm_bytecode_compile(tree);
+        ASSERT_NE(bc, nullptr);
+
+        native.nr_lookups = 0;
+        for (int n = 0; n < 3; n++) {
+            purc_variant_t v = pcvcm_bytecode_eval(bc, find_var, vars,
+                    false);
+            ASSERT_NE(v, nullptr) << exprs[i];
+
+            int64_t i64 = 0;
+            ASSERT_TRUE(purc_variant_cast_to_longint(v, &i64, false));
+            ASSERT_EQ(i64, (i == 0) ? 40 : 42);
+            purc_variant_unref(v);
+        }
+
+        /* the method is resolved once per site */
+        ASSERT_EQ(native.nr_lookups, 1) << exprs[i];
+
+        pcvcm_bytecode_destroy(bc);
+        pcvcm_node_destroy(tree);
+    }
+}
+
+TEST_F(test_vcm_bytecode, member_inline_cache)
+{
+    struct pcvcm_node *tree = parse("$DATA.title");
+    ASSERT_NE(tree, nullptr);
+
+    struct pcvcm_bytecode *bc = pcvcm_bytecode_compile(tree);
+    ASSERT_NE(bc, nullptr);
+
+    purc_variant_t data = purc_variant_object_get_by_ckey(vars, "DATA");
+    ASSERT_NE(data, nullptr);
+
+    purc_variant_t v = pcvcm_bytecode_eval(bc, find_var, vars, false);
+    ASSERT_NE(v, nullptr);
+    ASSERT_STREQ(purc_variant_get_string_const(v), "Object title");
+    purc_variant_unref(v);
+
+    /* the value is changed in place */
+    purc_variant_t s = purc_variant_make_string("New title", false);
+    purc_variant_object_set_by_static_ckey(data, "title", s);
+    purc_variant_unref(s);
+
+    v = pcvcm_bytecode_eval(bc, find_var, vars, false);
+    ASSERT_NE(v, nullptr);
+    ASSERT_STREQ(purc_variant_get_string_const(v), "New title");
+    purc_variant_unref(v);
+
+    /* the member is removed: the shape changes */
+    purc_variant_object_remove_by_static_ckey(data, "title", false);
+    v = pcvcm_bytecode_eval(bc, find_var, vars, true);
+    ASSERT_NE(v, nullptr);
+    ASSERT_TRUE(purc_variant_is_undefined(v));
+    purc_variant_unref(v);
+
+    s = purc_variant_make_string("Another title", false);
+    purc_variant_object_set_by_static_ckey(data, "title", s);
+    purc_variant_unref(s);
+
+    v = pcvcm_bytecode_eval(bc, find_var, vars, false);
+    ASSERT_NE(v, nullptr);
+    ASSERT_STREQ(purc_variant_get_string_const(v), "Another title");
+    purc_variant_unref(v);
+
+    pcvcm_bytecode_destroy(bc);
+    pcvcm_node_destroy(tree);
+}
+
+static const char *bench_expressions[] = {
+    "$DATA.title",
+    "$DATA.arr[1]",
+    "$DATA.obj.inner.value",
+    "\"Hello, $DATA.name!\"",
+    "{ \"name\": $DATA.name, \"value\": $DATA.arr[0] }",
+    "$STR.contains($DATA.title, 'title')",
+    "{{ $DATA.flag && $DATA.title || 'no' }}",
+    "$NATIVE.value",
+    "$NATIVE.add(2)",
+};
+
+TEST_F(test_vcm_bytecode, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops <= 0) {
+        nr_loops = 10000;
+    }
+
+    for (size_t i = 0; i < PCA_TABLESIZE(bench_expressions); i++) {
+        struct pcvcm_node *tree = parse(bench_expressions[i]);
+        ASSERT_NE(tree, nullptr);
+
+        struct pcvcm_bytecode *bc = pcvcm_bytecode_compile(tree);
+        ASSERT_NE(bc, nullptr);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < nr_loops; n++) {
+            purc_variant_t v = pcvcm_eval_walk_ex(tree, find_var, vars,
+                    false);
+            ASSERT_NE(v, nullptr);
+            purc_variant_unref(v);
+        }
+        auto walk = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < nr_loops; n++) {
+            purc_variant_t v = pcvcm_bytecode_eval(bc, find_var, vars,
+                    false);
+            ASSERT_NE(v, nullptr);
+            purc_variant_unref(v);
+        }
+        auto vm = std::chrono::steady_clock::now() - start;
+
+        fprintf(stderr, "%-56s walker: %8lld us, bytecode: %8lld us\n",
+                bench_expressions[i],
+                (long long)std::chrono::duration_cast<
+                    std::chrono::microseconds>(walk).count(),
+                (long long)std::chrono::duration_cast<
+                    std::chrono::microseconds>(vm).count());
+
+        pcvcm_bytecode_destroy(bc);
+        pcvcm_node_destroy(tree);
+    }
+}
+
@@ -0,0 +1,154 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/vcm.h"
+#include "private/tree.h"
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+class test_vcm_fold : public testing::Test
+{
+protected:
+    void SetUp() {
+        purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hybridos.test",
+                "vcm_fold", NULL);
+    }
+
+    void TearDown() {
+        purc_cleanup();
+    }
+
+    struct pcvcm_node *parse(const char *expr) {
+        struct purc_ejson_parse_tree *ptree;
+        ptree = purc_variant_ejson_parse_string(expr, strlen(expr));
+        return (struct pcvcm_node *)ptree;
+    }
+};
+
+TEST_F(test_vcm_fold, concat_string)
+{
+    struct pcvcm_node *tree = pcvcm_node_new_concat_string(0, NULL);
+    ASSERT_NE(tree, nullptr);
+
+    const char *parts[] = { "Hello", ", ", "world", "!" };
+    for (size_t i = 0; i < PCA_TABLESIZE(parts); i++) {
+        pctree_node_append_child(&tree->tree_node,
+                &pcvcm_node_new_string(parts[i])->tree_node);
+    }
+
+    ASSERT_TRUE(pcvcm_node_fold_constants(tree));
+    ASSERT_EQ(tree->type, PCVCM_NODE_TYPE_STRING);
+    ASSERT_EQ(pcvcm_node_children_count(tree), 0u);
+
+    purc_variant_t v = pcvcm_eval_ex(tree, NULL, NULL, false);
+    ASSERT_NE(v, nullptr);
+    ASSERT_STREQ(purc_variant_get_string_const(v), "Hello, world!");
+    purc_variant_unref(v);
+
+    pcvcm_node_destroy(tree);
+}
+
+TEST_F(test_vcm_fold, constant_nodes)
+{
+    struct pcvcm_node *tree;
+
+    tree = parse("[ 1, \"a\", { \"b\": true, \"c\": null }, bx0A ]");
+    ASSERT_NE(tree, nullptr);
+    ASSERT_TRUE(pcvcm_node_fold_constants(tree));
+    ASSERT_TRUE(tree->is_constant);
+    pcvcm_node_destroy(tree);
+
+    tree = parse("[ 1, $DATA.name ]");
+    ASSERT_NE(tree, nullptr);
+    ASSERT_FALSE(pcvcm_node_fold_constants(tree));
+    ASSERT_FALSE(tree->is_constant);
+
+    struct pcvcm_node *first = (struct pcvcm_node *)
+        pctree_node_child(&tree->tree_node);
+    ASSERT_TRUE(first->is_constant);
+    pcvcm_node_destroy(tree);
+}
+
+TEST_F(test_vcm_fold, cached_values)
+{
+    struct pcvcm_node *tree = parse("\"a constant string in an attribute\"");
+    ASSERT_NE(tree, nullptr);
+    ASSERT_TRUE(pcvcm_node_fold_constants(tree));
+
+    /* immutable values are shared by the evaluations */
+    purc_variant_t v1 = pcvcm_eval_ex(tree, NULL, NULL, false);
+    purc_variant_t v2 = pcvcm_eval_ex(tree, NULL, NULL, false);
+    ASSERT_NE(v1, nullptr);
+    ASSERT_EQ(v1, v2);
+    purc_variant_unref(v1);
+    purc_variant_unref(v2);
+    pcvcm_node_destroy(tree);
+
+    /* containers are not, for they can be changed by the caller */
+    tree = parse("[ 1, 2, 3 ]");
+    ASSERT_NE(tree, nullptr);
+    ASSERT_TRUE(pcvcm_node_fold_constants(tree));
+
+    v1 = pcvcm_eval_ex(tree, NULL, NULL, false);
+    v2 = pcvcm_eval_ex(tree, NULL, NULL, false);
+    ASSERT_NE(v1, nullptr);
+    ASSERT_NE(v1, v2);
+    ASSERT_TRUE(purc_variant_is_equal_to(v1, v2));
+    purc_variant_unref(v1);
+    purc_variant_unref(v2);
+    pcvcm_node_destroy(tree);
+}
+
+TEST_F(test_vcm_fold, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops <= 0) {
+        nr_loops = 100000;
+    }
+
+    const char *expr = "\"FUNC: a constant attribute value which is "
+        "evaluated every time the element is pushed\"";
+
+    long long us[2];
+    for (int fold = 0; fold < 2; fold++) {
+        struct pcvcm_node *tree = parse(expr);
+        ASSERT_NE(tree, nullptr);
+        if (fold) {
+            ASSERT_TRUE(pcvcm_node_fold_constants(tree));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < nr_loops; n++) {
+            purc_variant_t v = pcvcm_eval_ex(tree, NULL, NULL, false);
+            ASSERT_NE(v, nullptr);
+            purc_variant_unref(v);
+        }
+        us[fold] = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+        pcvcm_node_destroy(tree);
+    }
+
+    fprintf(stderr, "%zu evaluations: %lld us without folding, "
+            "%lld us with folding\n", nr_loops, us[0], us[1]);
+}
+
@@ -23,6 +23,7 @@
 #include "../helpers.h"
 
 #include <gtest/gtest.h>
+#include <string>
 
 static int _element_count(struct pcvdom_element *top,
     struct pcvdom_element *elem, void *ctx)
@@ -143,3 +144,54 @@ TEST(vdom, fragment)
     }
 }
 
+
+static int
+append_to_string(const char *buf, size_t len, void *ctxt)
+{
+    std::string *str = (std::string *)ctxt;
+    str->append(buf, len);
+    return 0;
+}
+
+TEST(vdom, attrs)
+{
+    PurCInstance purc("cn.fmsoft.hybridos.test", "test_init", false);
+
+    struct pcvdom_element *elem = pcvdom_element_create_c("div");
+    ASSERT_NE(elem, nullptr);
+
+    /* more than the inline ones and the linearly searched ones */
+    static const char *keys[] = {
+        "m", "b", "x", "a", "k", "on", "d", "z", "c", "y", "with", "e",
+    };
+    for (size_t i = 0; i < PCA_TABLESIZE(keys); i++) {
+        struct pcvdom_attr *attr;
+        attr = pcvdom_attr_create_simple(keys[i], NULL);
+        ASSERT_NE(attr, nullptr);
+        ASSERT_EQ(0, pcvdom_element_append_attr(elem, attr));
+    }
+
+    for (size_t i = 0; i < PCA_TABLESIZE(keys); i++) {
+        struct pcvdom_attr *attr = pcvdom_element_find_attr(elem, keys[i]);
+        ASSERT_NE(attr, nullptr) << keys[i];
+        ASSERT_EQ(attr, pcvdom_element_get_attr_c(elem, keys[i]));
+    }
+    ASSERT_EQ(pcvdom_element_find_attr(elem, "f"), nullptr);
+    ASSERT_EQ(pcvdom_element_find_attr(elem, "zz"), nullptr);
+
+    /* the later one replaces the earlier one */
+    struct pcvdom_attr *attr;
+    attr = pcvdom_attr_create("on", PCHVML_ATTRIBUTE_ADDITION_OPERATOR,
+            pcvcm_node_new_string("foo"));
+    ASSERT_NE(attr, nullptr);
+    ASSERT_EQ(0, pcvdom_element_append_attr(elem, attr));
+    ASSERT_EQ(pcvdom_element_find_attr(elem, "on"), attr);
+
+    /* the attributes are serialized in the order of keys */
+    std::string str;
+    pcvdom_util_node_serialize(pcvdom_node_from_element(elem),
+            append_to_string, &str);
+    ASSERT_EQ(str, "<div a b c d e k m on+=\"foo\" with x y z></div>");
+
+    pcvdom_node_destroy(pcvdom_node_from_element(elem));
+}
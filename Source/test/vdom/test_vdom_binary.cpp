@@ -0,0 +1,438 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/vdom.h"
+#include "private/vcm.h"
+#include "private/utils.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <dirent.h>
+#include <glob.h>
+
+#include "../helpers.h"
+
+static int
+append_to_string(const char *buf, size_t len, void *ctxt)
+{
+    std::string *str = (std::string *)ctxt;
+    str->append(buf, len);
+    return 0;
+}
+
+static std::string
+serialize(struct pcvdom_document *doc)
+{
+    std::string str;
+    pcvdom_util_node_serialize(pcvdom_node_from_document(doc),
+            append_to_string, &str);
+    return str;
+}
+
+static std::string
+to_binary(struct pcvdom_document *doc)
+{
+    std::string bin;
+    purc_rwstream_t out = purc_rwstream_new_buffer(0, 0);
+    if (pcvdom_document_write_binary(doc, out) == 0) {
+        size_t len;
+        const char *data = (const char *)purc_rwstream_get_mem_buffer(out,
+                &len);
+        bin.assign(data, len);
+    }
+    purc_rwstream_destroy(out);
+    return bin;
+}
+
+static struct pcvdom_document *
+parse(const char *hvml)
+{
+    purc_rwstream_t in = purc_rwstream_new_from_mem((void *)hvml,
+            strlen(hvml));
+    struct pcvdom_document *doc = purc_load_hvml_from_rwstream(in);
+    purc_rwstream_destroy(in);
+    return doc;
+}
+
+class test_vdom_binary : public testing::Test
+{
+protected:
+    void SetUp() {
+        purc_instance_extra_info info = {};
+        int ret = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hybridos.test",
+                "vdom_binary", &info);
+        ASSERT_EQ(ret, PURC_ERROR_OK);
+    }
+    void TearDown() {
+        purc_cleanup();
+    }
+};
+
+static void
+check_round_trip(struct pcvdom_document *doc, const char *name)
+{
+    std::string bin = to_binary(doc);
+    ASSERT_FALSE(bin.empty()) << name;
+
+    struct pcvdom_document *loaded;
+    loaded = pcvdom_document_read_binary(bin.data(), bin.size());
+    ASSERT_NE(loaded, nullptr) << name;
+
+    ASSERT_EQ(serialize(doc), serialize(loaded)) << name;
+    ASSERT_EQ(bin, to_binary(loaded)) << name;
+
+    pcvdom_document_unref(loaded);
+}
+
+TEST_F(test_vdom_binary, files)
+{
+    char path[PATH_MAX+1];
+    const char *env = "SOURCE_FILES";
+    test_getpath_from_env_or_rel(path, sizeof(path), env, "/data/*.hvml");
+
+    glob_t globbuf;
+    memset(&globbuf, 0, sizeof(globbuf));
+    if (glob(path, 0, NULL, &globbuf)) {
+        globfree(&globbuf);
+        return;
+    }
+
+    for (size_t i = 0; i < globbuf.gl_pathc; i++) {
+        const char *fn = globbuf.gl_pathv[i];
+        if (strstr(pcutils_basename(fn), "neg.") == pcutils_basename(fn))
+            continue;
+
+        purc_rwstream_t in = purc_rwstream_new_from_file(fn, "r");
+        ASSERT_NE(in, nullptr) << fn;
+        struct pcvdom_document *doc = purc_load_hvml_from_rwstream(in);
+        purc_rwstream_destroy(in);
+        if (doc == NULL)
+            continue;
+
+        check_round_trip(doc, fn);
+        pcvdom_document_unref(doc);
+    }
+
+    globfree(&globbuf);
+}
+
+static const char *sample =
+    "<!DOCTYPE hvml SYSTEM 'v: MATH'>"
+    "<hvml target=\"html\" lang=\"en\">"
+    "<head><title>Sample</title>"
+    "<init as=\"buttons\">[{ \"letters\": \"7\", \"class\": \"number\" },"
+    "  { \"n\": 1.5, \"b\": true, \"z\": null, \"l\": 10L, \"u\": 11UL,"
+    "    \"bytes\": bx00ff }]</init>"
+    "</head>"
+    "<body id=\"main\">"
+    "<!-- a comment -->"
+    "<div class=\"$buttons[0].class\" hidden>"
+    "<p>Hello, $SYSTEM.time('%H:%M')! {{ $buttons && 'yes' || 'no' }}</p>"
+    "<input type=\"text\" value=\"$buttons[1].n\" readonly />"
+    "</div>"
+    "<update on=\"$buttons\" at=\".class\" with += \"foo\" />"
+    "</body>"
+    "</hvml>";
+
+TEST_F(test_vdom_binary, sample)
+{
+    struct pcvdom_document *doc = parse(sample);
+    ASSERT_NE(doc, nullptr);
+
+    check_round_trip(doc, "sample");
+
+    /* the truncated or changed data must be rejected, not crash */
+    std::string bin = to_binary(doc);
+    for (size_t len = 0; len < bin.size(); len += 7) {
+        struct pcvdom_document *loaded;
+        loaded = pcvdom_document_read_binary(bin.data(), len);
+        ASSERT_EQ(loaded, nullptr) << len;
+    }
+
+    std::string other = bin;
+    other[8] ^= 0xff;   /* the format version */
+    ASSERT_EQ(pcvdom_document_read_binary(other.data(), other.size()),
+            nullptr);
+
+    pcvdom_document_unref(doc);
+}
+
+static std::string
+nested_vcm_binary(int depth)
+{
+    struct pcvcm_node *tree = pcvcm_node_new_string("leaf");
+    for (int i = 0; i < depth && tree; i++)
+        tree = pcvcm_node_new_array(1, &tree);
+
+    std::string bin;
+    purc_rwstream_t out = purc_rwstream_new_buffer(0, 0);
+    if (tree && pcvcm_node_write_binary(out, tree) == 0) {
+        size_t len;
+        const char *data = (const char *)purc_rwstream_get_mem_buffer(out,
+                &len);
+        bin.assign(data, len);
+    }
+    purc_rwstream_destroy(out);
+    pcvcm_node_destroy(tree);
+    return bin;
+}
+
+static std::string
+nested_elements(int depth)
+{
+    std::string hvml = "<hvml target=\"html\"><body>";
+    for (int i = 0; i < depth; i++)
+        hvml += "<div>";
+    for (int i = 0; i < depth; i++)
+        hvml += "</div>";
+    hvml += "</body></hvml>";
+    return hvml;
+}
+
+TEST_F(test_vdom_binary, depth_limits)
+{
+    /* too deep vcm trees are rejected instead of exhausting the stack */
+    std::string bin = nested_vcm_binary(200);
+    ASSERT_FALSE(bin.empty());
+    const unsigned char *data = (const unsigned char *)bin.data();
+    struct pcvcm_node *tree = pcvcm_node_read_binary(&data,
+            data + bin.size());
+    ASSERT_NE(tree, nullptr);
+    pcvcm_node_destroy(tree);
+
+    /* and never written, as the reader would reject them */
+    bin = nested_vcm_binary(1000);
+    ASSERT_TRUE(bin.empty());
+
+    /* so are too deep vDOM trees */
+    std::string hvml = nested_elements(500);
+    struct pcvdom_document *doc = parse(hvml.c_str());
+    ASSERT_NE(doc, nullptr);
+    check_round_trip(doc, "500 levels");
+    pcvdom_document_unref(doc);
+
+    hvml = nested_elements(2000);
+    doc = parse(hvml.c_str());
+    ASSERT_NE(doc, nullptr);
+    bin = to_binary(doc);
+    ASSERT_TRUE(bin.empty());
+    pcvdom_document_unref(doc);
+}
+
+TEST_F(test_vdom_binary, disk_cache)
+{
+    char dir[] = "/tmp/purc-vdom-cache-XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    setenv(PURC_ENVV_VDOM_CACHE_DIR, dir, 1);
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(sample);
+    ASSERT_NE(vdom, nullptr);
+
+    /* the programs which could not be read back are not cached */
+    std::string deep = nested_elements(2000);
+    ASSERT_NE(purc_load_hvml_from_string(deep.c_str()), nullptr);
+
+    unsetenv(PURC_ENVV_VDOM_CACHE_DIR);
+
+    unsigned char md5[MD5_DIGEST_SIZE];
+    char md5_hex[MD5_DIGEST_SIZE * 2 + 1];
+    pcutils_md5digest(sample, md5);
+    pcutils_bin2hex(md5, MD5_DIGEST_SIZE, md5_hex, false);
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s-%s.vdom", dir, md5_hex,
+            PURC_VERSION_STRING);
+
+    size_t len;
+    char *data = purc_load_file_contents(path, &len);
+    ASSERT_NE(data, nullptr) << path;
+
+    struct pcvdom_document *loaded = pcvdom_document_read_binary(data, len);
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_EQ(serialize(vdom), serialize(loaded));
+
+    pcvdom_document_unref(loaded);
+    free(data);
+
+    pcutils_md5digest(deep.c_str(), md5);
+    pcutils_bin2hex(md5, MD5_DIGEST_SIZE, md5_hex, false);
+    char deep_path[PATH_MAX];
+    snprintf(deep_path, sizeof(deep_path), "%s/%s-%s.vdom", dir, md5_hex,
+            PURC_VERSION_STRING);
+    ASSERT_NE(access(deep_path, F_OK), 0);
+
+    unlink(path);
+    ASSERT_EQ(rmdir(dir), 0);
+}
+
+TEST_F(test_vdom_binary, bundle)
+{
+    char dir[] = "/tmp/purc-bundle-XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+
+    std::string bundle = std::string(dir) + "/sample" PURC_HVML_BUNDLE_SUFFIX;
+    std::string text = std::string(dir) + "/sample.hvml";
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(sample);
+    ASSERT_NE(vdom, nullptr);
+    ASSERT_TRUE(purc_compile_hvml_to_bundle(vdom, bundle.c_str()));
+
+    purc_vdom_t loaded = purc_load_hvml_from_bundle(bundle.c_str());
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_NE(loaded, vdom);
+    ASSERT_EQ(serialize(vdom), serialize(loaded));
+
+    /* the bundle is cached like an HVML program */
+    ASSERT_EQ(purc_load_hvml_from_bundle(bundle.c_str()), loaded);
+
+    /* an HVML text is not a bundle */
+    FILE *fp = fopen(text.c_str(), "w");
+    ASSERT_NE(fp, nullptr);
+    fputs(sample, fp);
+    fclose(fp);
+    ASSERT_EQ(purc_load_hvml_from_bundle(text.c_str()), nullptr);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_INVALID_VALUE);
+
+    unlink(text.c_str());
+    unlink(bundle.c_str());
+    ASSERT_EQ(purc_load_hvml_from_bundle(bundle.c_str()), nullptr);
+    rmdir(dir);
+}
+
+static std::string
+make_large_program(size_t nr_blocks)
+{
+    std::string hvml =
+        "<!DOCTYPE hvml>"
+        "<hvml target=\"html\" lang=\"en\">"
+        "<head><title>Large</title>"
+        "<init as=\"items\">[{ \"name\": \"a\", \"value\": 1 },"
+        "  { \"name\": \"b\", \"value\": 2 }]</init>"
+        "</head><body>";
+
+    for (size_t i = 0; i < nr_blocks; i++) {
+        std::string n = std::to_string(i);
+        hvml += "<div id=\"block" + n + "\" class=\"block $items[0].name\">"
+            "<h2>Block " + n + ": $items[1].value</h2>"
+            "<ul><iterate on=\"$items\" by=\"RANGE: FROM 0\">"
+            "<update on=\"$@\" to=\"append\" with=\"$?.name\" />"
+            "</iterate></ul>"
+            "<test with=\"$L.gt($items[0].value, " + n + ")\">"
+            "<p class=\"{{ $items[0].name && 'yes' || 'no' }}\">"
+            "$items[0].name</p>"
+            "</test>"
+            "</div>";
+    }
+
+    hvml += "</body></hvml>";
+    return hvml;
+}
+
+static const char *static_sample =
+    "<hvml target=\"html\"><head><title>Static</title></head><body>"
+    "<section class=\"card\"><h1>Title</h1>"
+    "<p>Hello <b>world</b></p><!-- note --></section>"
+    "<article><p>$name</p></article>"
+    "<nav><ul><li>one</li></ul><init as=\"x\" with=\"[]\" /></nav>"
+    "<aside hvml:silently><span>s</span></aside>"
+    "<footer title=\"{{ $x }}\">f</footer>"
+    "</body></hvml>";
+
+static int
+collect_static(struct pcvdom_element *top, struct pcvdom_element *elem,
+        void *ctx)
+{
+    UNUSED_PARAM(top);
+
+    std::string *tags = (std::string *)ctx;
+    if (pcvdom_element_is_static_subtree(elem)) {
+        tags->append(pcvdom_element_get_tagname(elem));
+        tags->append(" ");
+    }
+    return 0;
+}
+
+static std::string
+static_tags(struct pcvdom_document *doc)
+{
+    std::string tags;
+    pcvdom_element_traverse(pcvdom_document_get_root(doc), &tags,
+            collect_static);
+    return tags;
+}
+
+TEST_F(test_vdom_binary, static_subtrees)
+{
+    struct pcvdom_document *doc = parse(static_sample);
+    ASSERT_NE(doc, nullptr);
+
+    ASSERT_EQ(static_tags(doc), "title section h1 p b ul li span ");
+
+    /* the marks are computed again when the binary form is loaded */
+    std::string bin = to_binary(doc);
+    struct pcvdom_document *loaded;
+    loaded = pcvdom_document_read_binary(bin.data(), bin.size());
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_EQ(static_tags(loaded), static_tags(doc));
+
+    pcvdom_document_unref(loaded);
+    pcvdom_document_unref(doc);
+}
+
+TEST_F(test_vdom_binary, perf)
+{
+    const char *loops = getenv("LOOPS");
+    size_t nr_loops = loops ? atoll(loops) : 0;
+    if (nr_loops <= 0) {
+        nr_loops = 10;
+    }
+
+    std::string hvml = make_large_program(1000);
+    struct pcvdom_document *doc = parse(hvml.c_str());
+    ASSERT_NE(doc, nullptr);
+    std::string bin = to_binary(doc);
+    pcvdom_document_unref(doc);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        doc = parse(hvml.c_str());
+        ASSERT_NE(doc, nullptr);
+        pcvdom_document_unref(doc);
+    }
+    auto parsing = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nr_loops; n++) {
+        doc = pcvdom_document_read_binary(bin.data(), bin.size());
+        ASSERT_NE(doc, nullptr);
+        pcvdom_document_unref(doc);
+    }
+    auto loading = std::chrono::steady_clock::now() - start;
+
+    fprintf(stderr, "HVML: %zu bytes, binary: %zu bytes; "
+            "parsing: %8lld us, loading: %8lld us\n",
+            hvml.size(), bin.size(),
+            (long long)std::chrono::duration_cast<
+                std::chrono::microseconds>(parsing).count(),
+            (long long)std::chrono::duration_cast<
+                std::chrono::microseconds>(loading).count());
+}
+